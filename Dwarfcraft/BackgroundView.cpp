@@ -136,46 +136,42 @@ void BackgroundView::RenderScreenTexture(int x, int y, int width, int height, GL
     glDisable(GL_TEXTURE_2D);
 }
 
+Vector3<float> BackgroundView::GetDaylight()
+{
+    return GetTimeColor(TotalTime, BackgroundView_DaylightColors, BackgroundView_DaylightColors[1]);
+}
+
 void BackgroundView::GetSkyColorPair(float Time, Vector3<float>* BottomColor, Vector3<float>* TopColor)
+{
+    // The bottom piece is in the past so we have a smooth change in colors
+    // (if it falls before the first range, it stays the same as the top)
+    *TopColor = GetTimeColor(Time, BackgroundView_TimeColors, Vector3<float>());
+    *BottomColor = GetTimeColor(Time - 2000, BackgroundView_TimeColors, *TopColor);
+}
+
+Vector3<float> BackgroundView::GetTimeColor(float Time, const Vector3<float>* Colors, Vector3<float> DefaultColor)
 {
     // Total amount of time we look in the past and future to merge colors with
     static const float MergeRange = 3000;
     
-    // Create two colors, the bottom being in the past so we have a
-    // smooth change in colors
-    Vector3<float> Color;
-    for(int j = 0; j < 2; j++)
+    // For each time range
+    for(int i = 0; i < 4; i++)
     {
-        // Move time back for the bottom piece (j == 1)
-        if(j == 1)
-            Time -= 2000;
-        
-        // For each time range
-        for(int i = 0; i < 4; i++)
+        // Are we in this color's range?
+        if(Time >= BackgroundView_TimeRanges[i][0] && Time <= BackgroundView_TimeRanges[i][1])
         {
-            // Are we in this color's range?
-            if(Time >= BackgroundView_TimeRanges[i][0] && Time <= BackgroundView_TimeRanges[i][1])
-            {
-                // Colors in question
-                Vector3<float> PrevColor = BackgroundView_TimeColors[(i == 0) ? 3 : (i - 1)]; // If 0, go back to 3, else i -1
-                Vector3<float> CurrentColor = BackgroundView_TimeColors[i];
-                
-                // Calc intensity
-                float Intensity = fmin(fabs((Time - BackgroundView_TimeRanges[i][0]) / MergeRange), 1);
-                
-                // Merge this color with the next color
-                Color = CurrentColor * Intensity + PrevColor * (1.0f - Intensity);
-                
-                break;
-            }
+            // Colors in question
+            Vector3<float> PrevColor = Colors[(i == 0) ? 3 : (i - 1)]; // If 0, go back to 3, else i -1
+            Vector3<float> CurrentColor = Colors[i];
+            
+            // Calc intensity
+            float Intensity = fmin(fabs((Time - BackgroundView_TimeRanges[i][0]) / MergeRange), 1);
+            
+            // Merge this color with the next color
+            return CurrentColor * Intensity + PrevColor * (1.0f - Intensity);
         }
-        
-        // Save the color
-        if(j == 0)
-            *TopColor = Color;
-        else
-            *BottomColor = Color;
     }
     
-    // Done
+    // Not in any range
+    return DefaultColor;
 }
@@ -52,6 +52,15 @@ static const Vector3<float> BackgroundView_TimeColors[4] =
     Vector3<float>(5.0f / 255.0f, 5.0f / 255.0f, 20.0f / 255.0f),
 };
 
+// The color of the light falling onto the world at the above times
+static const Vector3<float> BackgroundView_DaylightColors[4] =
+{
+    Vector3<float>(0.85f, 0.65f, 0.55f),
+    Vector3<float>(1.0f, 1.0f, 1.0f),
+    Vector3<float>(0.55f, 0.45f, 0.5f),
+    Vector3<float>(0.22f, 0.24f, 0.35f),
+};
+
 class BackgroundView : public GrfxObject
 {
 public:
@@ -63,6 +72,10 @@ public:
     // Pass the current camera angle, so we only draw the sun / moon in the same area..
     void SetCameraAngle(float CameraAngle, float CameraPitch);
     
+    // Returns the color of the sky light (sun or moon) at the current time; meant
+    // to modulate everything lit by the sky
+    Vector3<float> GetDaylight();
+    
 protected:
     
     // Standard render and update functions from GrfxObject
@@ -78,6 +91,10 @@ private:
     // Color pair based on the current time
     void GetSkyColorPair(float Time, Vector3<float>* BottomColor, Vector3<float>* TopColor);
     
+    // Blend the given colors (one per time range) for the given time; if the time isn't within
+    // any range, the default color is returned
+    Vector3<float> GetTimeColor(float Time, const Vector3<float>* Colors, Vector3<float> DefaultColor);
+    
     // Total elapsed time
     float TotalTime;
     
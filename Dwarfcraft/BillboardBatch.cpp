@@ -0,0 +1,237 @@
+/***************************************************************
+ 
+ DwarfCraft - Dwarf Fortress / Minecraft clone
+ Copyright 2011 Jeremy Bridon - See License.txt for info
+ 
+ This source file is developed and maintained by:
+ + Jeremy Bridon jbridon@cores2.com
+ 
+***************************************************************/
+
+#include "BillboardBatch.h"
+
+// Internal: number of floats per sprite vertex ((x,y,z)(u,v)) and shadow vertex ((x,y,z))
+static const int __BillboardBatch_SpriteFloats = 5;
+static const int __BillboardBatch_ShadowFloats = 3;
+
+// Internal: number of vertices per shadow (a triangle per segment)
+static const int __BillboardBatch_ShadowVertices = BillboardBatch_ShadowSegments * 3;
+
+// Internal: draw order of two sprites; layer, then texture
+static int __BillboardBatch_Compare(const void* A, const void* B)
+{
+    const BillboardBatch_Sprite* SpriteA = (const BillboardBatch_Sprite*)A;
+    const BillboardBatch_Sprite* SpriteB = (const BillboardBatch_Sprite*)B;
+    
+    if(SpriteA->Layer != SpriteB->Layer)
+        return (SpriteA->Layer < SpriteB->Layer) ? -1 : 1;
+    if(SpriteA->TextureID != SpriteB->TextureID)
+        return (SpriteA->TextureID < SpriteB->TextureID) ? -1 : 1;
+    return 0;
+}
+
+BillboardBatch::BillboardBatch()
+{
+    // Nothing queued or allocated
+    Sprites = NULL;
+    SpriteCount = SpriteCapacity = 0;
+    Shadows = NULL;
+    ShadowCount = ShadowCapacity = 0;
+    Vertices = NULL;
+    VertexCapacity = 0;
+    BufferID = 0;
+    DrawCalls = 0;
+}
+
+BillboardBatch::~BillboardBatch()
+{
+    delete[] Sprites;
+    delete[] Shadows;
+    delete[] Vertices;
+    if(BufferID != 0)
+        glDeleteBuffers(1, &BufferID);
+}
+
+void BillboardBatch::AddSprite(GLuint TextureID, Vector3<float> Pos, float Width, float Height, float SrcX, float SrcY, float SrcWidth, float SrcHeight, bool Flip, bool IsOverlay)
+{
+    // Grow as needed
+    if(SpriteCount >= SpriteCapacity)
+    {
+        SpriteCapacity = (SpriteCapacity == 0) ? 64 : (SpriteCapacity * 2);
+        BillboardBatch_Sprite* NewSprites = new BillboardBatch_Sprite[SpriteCapacity];
+        for(int i = 0; i < SpriteCount; i++)
+            NewSprites[i] = Sprites[i];
+        delete[] Sprites;
+        Sprites = NewSprites;
+    }
+    
+    BillboardBatch_Sprite& Sprite = Sprites[SpriteCount++];
+    Sprite.TextureID = TextureID;
+    Sprite.Layer = IsOverlay ? 1 : 0;
+    Sprite.Pos = Pos;
+    Sprite.Width = Width;
+    Sprite.Height = Height;
+    Sprite.SrcX = SrcX;
+    Sprite.SrcY = SrcY;
+    Sprite.SrcWidth = SrcWidth;
+    Sprite.SrcHeight = SrcHeight;
+    Sprite.Flip = Flip;
+}
+
+void BillboardBatch::AddShadow(Vector3<float> Pos, float Radius)
+{
+    // Grow as needed
+    if(ShadowCount >= ShadowCapacity)
+    {
+        ShadowCapacity = (ShadowCapacity == 0) ? 64 : (ShadowCapacity * 2);
+        BillboardBatch_Shadow* NewShadows = new BillboardBatch_Shadow[ShadowCapacity];
+        for(int i = 0; i < ShadowCount; i++)
+            NewShadows[i] = Shadows[i];
+        delete[] Shadows;
+        Shadows = NewShadows;
+    }
+    
+    BillboardBatch_Shadow& Shadow = Shadows[ShadowCount++];
+    Shadow.Pos = Pos;
+    Shadow.Radius = Radius;
+}
+
+void BillboardBatch::Render(float CameraAngle)
+{
+    // Ignore if nothing to draw
+    DrawCalls = 0;
+    if(SpriteCount <= 0 && ShadowCount <= 0)
+        return;
+    
+    /*** Build Vertices ***/
+    
+    // Grow the scratch buffer as needed: all shadows, then all sprites
+    int ShadowFloats = ShadowCount * __BillboardBatch_ShadowVertices * __BillboardBatch_ShadowFloats;
+    int TotalFloats = ShadowFloats + SpriteCount * 4 * __BillboardBatch_SpriteFloats;
+    if(TotalFloats > VertexCapacity)
+    {
+        delete[] Vertices;
+        VertexCapacity = TotalFloats * 2;
+        Vertices = new float[VertexCapacity];
+    }
+    
+    // Unit circle, shared by all shadows
+    float CircleX[BillboardBatch_ShadowSegments + 1], CircleZ[BillboardBatch_ShadowSegments + 1];
+    for(int i = 0; i <= BillboardBatch_ShadowSegments; i++)
+    {
+        float n = float(i) * (UtilPI / (BillboardBatch_ShadowSegments * 0.5f));
+        CircleX[i] = -cos(n);
+        CircleZ[i] = sin(n);
+    }
+    
+    // Each shadow segment is a triangle from the center (same winding as a fan)
+    float* Vertex = Vertices;
+    for(int i = 0; i < ShadowCount; i++)
+    {
+        const BillboardBatch_Shadow& Shadow = Shadows[i];
+        for(int j = 0; j < BillboardBatch_ShadowSegments; j++)
+        {
+            *Vertex++ = Shadow.Pos.x; *Vertex++ = Shadow.Pos.y; *Vertex++ = Shadow.Pos.z;
+            *Vertex++ = Shadow.Pos.x + CircleX[j] * Shadow.Radius; *Vertex++ = Shadow.Pos.y; *Vertex++ = Shadow.Pos.z + CircleZ[j] * Shadow.Radius;
+            *Vertex++ = Shadow.Pos.x + CircleX[j + 1] * Shadow.Radius; *Vertex++ = Shadow.Pos.y; *Vertex++ = Shadow.Pos.z + CircleZ[j + 1] * Shadow.Radius;
+        }
+    }
+    
+    // Sort sprites into runs of the same layer and texture
+    qsort(Sprites, SpriteCount, sizeof(BillboardBatch_Sprite), __BillboardBatch_Compare);
+    
+    // The camera's right-hand direction; sprites span it horizontally (same as rotating about y by the camera angle)
+    float Angle = CameraAngle - UtilPI / 2.0f;
+    float RightX = cos(Angle), RightZ = -sin(Angle);
+    
+    for(int i = 0; i < SpriteCount; i++)
+    {
+        const BillboardBatch_Sprite& Sprite = Sprites[i];
+        
+        // Bottom-left, bottom-right, top-right, top-left; textures are upside-down, and mirrored if flipped
+        float HalfX = RightX * Sprite.Width / 2.0f, HalfZ = RightZ * Sprite.Width / 2.0f;
+        float Left = Sprite.SrcX + Sprite.SrcWidth, Right = Sprite.SrcX;
+        if(Sprite.Flip)
+        {
+            Left = Sprite.SrcX;
+            Right = Sprite.SrcX + Sprite.SrcWidth;
+        }
+        float Bottom = Sprite.SrcY + Sprite.SrcHeight, Top = Sprite.SrcY;
+        
+        *Vertex++ = Sprite.Pos.x - HalfX; *Vertex++ = Sprite.Pos.y; *Vertex++ = Sprite.Pos.z - HalfZ;
+        *Vertex++ = Left; *Vertex++ = Bottom;
+        *Vertex++ = Sprite.Pos.x + HalfX; *Vertex++ = Sprite.Pos.y; *Vertex++ = Sprite.Pos.z + HalfZ;
+        *Vertex++ = Right; *Vertex++ = Bottom;
+        *Vertex++ = Sprite.Pos.x + HalfX; *Vertex++ = Sprite.Pos.y + Sprite.Height; *Vertex++ = Sprite.Pos.z + HalfZ;
+        *Vertex++ = Right; *Vertex++ = Top;
+        *Vertex++ = Sprite.Pos.x - HalfX; *Vertex++ = Sprite.Pos.y + Sprite.Height; *Vertex++ = Sprite.Pos.z - HalfZ;
+        *Vertex++ = Left; *Vertex++ = Top;
+    }
+    
+    /*** Upload ***/
+    
+    // Re-specify the whole buffer every frame, so the driver never waits on the previous frame's draws
+    if(BufferID == 0)
+        glGenBuffers(1, &BufferID);
+    glBindBuffer(GL_ARRAY_BUFFER, BufferID);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * TotalFloats, (void*)Vertices, GL_STREAM_DRAW);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    
+    /*** Draw ***/
+    
+    // All shadows at once
+    if(ShadowCount > 0)
+    {
+        glColor4f(0, 0, 0, 0.5f);
+        glVertexPointer(3, GL_FLOAT, sizeof(float) * __BillboardBatch_ShadowFloats, 0);
+        glDrawArrays(GL_TRIANGLES, 0, ShadowCount * __BillboardBatch_ShadowVertices);
+        DrawCalls++;
+    }
+    
+    // Sprites, one draw call per run of the same layer and texture
+    if(SpriteCount > 0)
+    {
+        glColor3f(1, 1, 1);
+        glEnable(GL_TEXTURE_2D);
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+        glVertexPointer(3, GL_FLOAT, sizeof(float) * __BillboardBatch_SpriteFloats, (char*)NULL + sizeof(float) * ShadowFloats);
+        glTexCoordPointer(2, GL_FLOAT, sizeof(float) * __BillboardBatch_SpriteFloats, (char*)NULL + sizeof(float) * (ShadowFloats + 3));
+        
+        int RunStart = 0;
+        for(int i = 1; i <= SpriteCount; i++)
+        {
+            // Keep growing the run while the states match
+            if(i < SpriteCount && Sprites[i].Layer == Sprites[RunStart].Layer && Sprites[i].TextureID == Sprites[RunStart].TextureID)
+                continue;
+            
+            // Overlays are pulled towards the camera so they draw over their base sprite
+            if(Sprites[RunStart].Layer > 0)
+            {
+                glEnable(GL_POLYGON_OFFSET_FILL);
+                glPolygonOffset(-1.0f, -1.0f);
+            }
+            
+            glBindTexture(GL_TEXTURE_2D, Sprites[RunStart].TextureID);
+            glDrawArrays(GL_QUADS, RunStart * 4, (i - RunStart) * 4);
+            DrawCalls++;
+            RunStart = i;
+        }
+        
+        glDisable(GL_POLYGON_OFFSET_FILL);
+        glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+        glDisable(GL_TEXTURE_2D);
+    }
+    
+    // Release states
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    
+    // Done with this frame's queues
+    SpriteCount = 0;
+    ShadowCount = 0;
+}
+
+int BillboardBatch::GetDrawCalls()
+{
+    return DrawCalls;
+}
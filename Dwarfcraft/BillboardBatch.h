@@ -0,0 +1,95 @@
+/***************************************************************
+ 
+ DwarfCraft - Dwarf Fortress / Minecraft clone
+ Copyright 2011 Jeremy Bridon - See License.txt for info
+ 
+ This source file is developed and maintained by:
+ + Jeremy Bridon jbridon@cores2.com
+ 
+ File: BillboardBatch.h/cpp
+ Desc: Draws many camera-facing sprites (entities, wearables,
+ dropped items) and their ground shadows in a few draw calls.
+ Sprites and shadows are queued during a frame; on "Render(...)"
+ all sprites are turned to face the camera in one pass on the CPU,
+ everything is streamed into a single dynamic VBO, and drawn as
+ one batch of shadows followed by one batch of sprites per run of
+ the same texture.
+ 
+ Overlay sprites (i.e. a dwarf's tools, drawn over its body) are
+ drawn after all base sprites, pulled towards the camera with a
+ polygon offset so they win over the equally-deep base sprite.
+ 
+***************************************************************/
+
+// Inclusion guard
+#ifndef __BILLBOARDBATCH_H__
+#define __BILLBOARDBATCH_H__
+
+#include "MUtil.h"
+#include "Vector3.h"
+
+// Number of segments of a shadow circle
+static const int BillboardBatch_ShadowSegments = 12;
+
+// A single queued sprite
+struct BillboardBatch_Sprite
+{
+    // Texture and drawing layer (0 for base sprites, 1 for overlays)
+    GLuint TextureID;
+    int Layer;
+    
+    // Bottom-center position, and the world size
+    Vector3<float> Pos;
+    float Width, Height;
+    
+    // Texture source rectangle, and if it is mirrored horizontally
+    float SrcX, SrcY, SrcWidth, SrcHeight;
+    bool Flip;
+};
+
+// A single queued shadow; center and radius
+struct BillboardBatch_Shadow
+{
+    Vector3<float> Pos;
+    float Radius;
+};
+
+class BillboardBatch
+{
+public:
+    
+    // Constructor and destructor (releases the VBO)
+    BillboardBatch();
+    ~BillboardBatch();
+    
+    // Queue a sprite, standing on the given position and facing the camera
+    void AddSprite(GLuint TextureID, Vector3<float> Pos, float Width, float Height, float SrcX, float SrcY, float SrcWidth, float SrcHeight, bool Flip = false, bool IsOverlay = false);
+    
+    // Queue a flat, half-transparent black circle centered on the given position
+    void AddShadow(Vector3<float> Pos, float Radius);
+    
+    // Draw everything queued, facing the given camera angle (radians, about the y axis), then empty the queues
+    void Render(float CameraAngle);
+    
+    // Number of draw calls made during the last render
+    int GetDrawCalls();
+    
+private:
+    
+    // Queued sprites and shadows
+    BillboardBatch_Sprite* Sprites;
+    int SpriteCount, SpriteCapacity;
+    BillboardBatch_Shadow* Shadows;
+    int ShadowCount, ShadowCapacity;
+    
+    // Vertex scratch buffer, and the streaming VBO
+    float* Vertices;
+    int VertexCapacity;
+    GLuint BufferID;
+    
+    // Statistics
+    int DrawCalls;
+};
+
+// End of inclusion guard
+#endif
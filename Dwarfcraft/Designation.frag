@@ -0,0 +1,8 @@
+// Designation job tiles: the icon modulated by the tile's color
+
+uniform sampler2D IconTexture;
+
+void main()
+{
+    gl_FragColor = texture2D(IconTexture, gl_TexCoord[0].st) * gl_Color;
+}
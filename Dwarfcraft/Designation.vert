@@ -0,0 +1,19 @@
+// Designation job tiles: each tile bobs gently and pulses; the tile's (x, z) and
+// whether its job is assigned come in as the second texture coordinate set
+
+uniform float Phase;
+
+void main()
+{
+    // Tiny oscillating offset, out of phase across tiles
+    vec3 Tile = gl_MultiTexCoord1.xyz;
+    vec4 Pos = gl_Vertex;
+    Pos.y += 0.005 * sin(Phase * 0.5 + Tile.y) + 0.005 * cos(Phase * 0.5 + Tile.x);
+    
+    // Assigned jobs are tinted red, and pulse out of step with unassigned jobs
+    float Pulse = mix(sin(Phase), cos(Phase), Tile.z);
+    gl_FrontColor = vec4(1.0, mix(1.0, 0.5, Tile.z), mix(1.0, 0.5, Tile.z), 0.9 + 0.1 * Pulse);
+    
+    gl_Position = gl_ModelViewProjectionMatrix * Pos;
+    gl_TexCoord[0] = gl_MultiTexCoord0;
+}
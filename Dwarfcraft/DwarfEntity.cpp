@@ -233,9 +233,7 @@ void DwarfEntity::Render()
     float x, y, width, height;
     GLuint TextID;
     
-    // Always render ontop
-    glEnable(GL_POLYGON_OFFSET_FILL);
-    glPolygonOffset(-1.0f, -1.0f);
+    // Note: all wearables are overlays, always drawn ontop of the dwarf
     
     /*** Render Armor ***/
     /*
@@ -249,7 +247,7 @@ void DwarfEntity::Render()
         
         // Render the sprite (flip as needed)
         Vector2<float> WorldSize = GetWorldSize();
-        RenderBillboard(GetPosition(), WorldSize.x, WorldSize.y, x, y, width, height, 0, (NewGlobalFacing == EntityFacing_FL || NewGlobalFacing == EntityFacing_BL), TextID);
+        RenderBillboard(GetPosition(), WorldSize.x, WorldSize.y, x, y, width, height, 0, (NewGlobalFacing == EntityFacing_FL || NewGlobalFacing == EntityFacing_BL), TextID, true);
     }
     */
     /*** Render Boots ***/
@@ -264,7 +262,7 @@ void DwarfEntity::Render()
         
         // Render the sprite (flip as needed)
         Vector2<float> WorldSize = GetWorldSize();
-        RenderBillboard(GetPosition(), WorldSize.x, WorldSize.y, x, y, width, height, 0, (NewGlobalFacing == EntityFacing_FL || NewGlobalFacing == EntityFacing_BL), TextID);
+        RenderBillboard(GetPosition(), WorldSize.x, WorldSize.y, x, y, width, height, 0, (NewGlobalFacing == EntityFacing_FL || NewGlobalFacing == EntityFacing_BL), TextID, true);
     }
     */
     /*** Render Tools (IFF mining) ***/
@@ -275,11 +273,8 @@ void DwarfEntity::Render()
         x += width * float(GetSpriteCellIndex());
         
         Vector2<float> WorldSize = GetWorldSize();
-        RenderBillboard(GetPosition(), WorldSize.x, WorldSize.y, x, y, width, height, 0, (NewGlobalFacing == EntityFacing_FL || NewGlobalFacing == EntityFacing_BL), TextID);
+        RenderBillboard(GetPosition(), WorldSize.x, WorldSize.y, x, y, width, height, 0, (NewGlobalFacing == EntityFacing_FL || NewGlobalFacing == EntityFacing_BL), TextID, true);
     }
-    
-    // Render normal z-fighting render method
-    glDisable(GL_POLYGON_OFFSET_FILL);
 }
 
 void DwarfEntity::InstructionComplete(EntityInstruction Instr)
@@ -335,8 +330,9 @@ void* DwarfEntity::ComputeTask(void* data)
     // Get the entity handle
     DwarfEntity* self = (DwarfEntity*)data;
     
-    // Max number of times we attempt to find a task
+    // Max number of times we attempt to find a task, and of candidate jobs searched at once
     static const int MaxAttempts = 3;
+    static const int MaxCandidates = 16;
     
     // Job we want to do; not to be modified
     JobTask* Job;
@@ -350,53 +346,64 @@ void* DwarfEntity::ComputeTask(void* data)
     bool FoundJob = false;
     for(int Attempt = 0; Attempt < MaxAttempts && !FoundJob; Attempt++)
     {
-        // Find a job
-        FoundJob = self->GetDesignations()->GetJob(self, &Job);
-        Vector3<int> DwarfPosition = self->GetPositionBlock();
+        // Find candidate jobs (copies, none are taken yet)
+        JobTask Candidates[MaxCandidates];
+        int CandidateCount = self->GetDesignations()->GetJobCandidates(self, Candidates, MaxCandidates);
         
-        // If we didn't find a job, restart
-        if(!FoundJob)
+        // If we didn't find any job, restart
+        if(CandidateCount <= 0)
             continue;
-        // Else, we need to confirm a path ot it (reset flag)
-        else
-            FoundJob = false;
         
-        // Attempt to find a path to it
-        for(int i = 0; i < AdjacentOffsetsCount && !FoundJob; i++)
+        // Gather every open space around all candidates, remembering the candidate of each
+        Vector3<int> Targets[MaxCandidates * AdjacentOffsetsCount];
+        int TargetCandidates[MaxCandidates * AdjacentOffsetsCount];
+        int TargetCount = 0;
+        for(int j = 0; j < CandidateCount; j++)
         {
-            // Path into the target or directly adjacent to it if that target is air or a half block
-            Vector3<int> TargetPosition = Job->TargetBlock + AdjacentOffsets[i];
-            dBlock BlockCheck = self->GetWorld()->GetBlock(TargetPosition);
-            
-            // Is the offset (Job target + adjacent) an open space?
-            if(self->GetWorld()->IsWithinWorld(TargetPosition) && (BlockCheck.GetType() == dBlockType_Air || !BlockCheck.IsWhole()))
+            for(int i = 0; i < AdjacentOffsetsCount; i++)
             {
-                // Attempt a path-plan to target
-                EntityPath PathCheck(self->GetWorld(), self->GetPositionBlock(), TargetPosition);
-                PathCheck.ComputePath();
-                
-                // Can we reach this path? (Do a busy wait, not a busy stall)
-                // (Must like "pthread_yield" but sched_yield is posix) This gives
-                // up the thread's allocated proc. time and moves on
-                bool IsSolved;
-                while(!PathCheck.GetPath(&self->JobPath, &IsSolved))
-                    sched_yield();
+                // Path into the target or directly adjacent to it if that target is air or a half block
+                Vector3<int> TargetPosition = Candidates[j].TargetBlock + AdjacentOffsets[i];
+                dBlock BlockCheck = self->GetWorld()->GetBlock(TargetPosition);
                 
-                // This is the first valid path, take it
-                // Note: it is up to the dwarf to generate instructions for the job
-                if(IsSolved)
-                    FoundJob = true;
+                // Is the offset (Job target + adjacent) an open space?
+                if(self->GetWorld()->IsWithinWorld(TargetPosition) && (BlockCheck.GetType() == dBlockType_Air || !BlockCheck.IsWhole()))
+                {
+                    Targets[TargetCount] = TargetPosition;
+                    TargetCandidates[TargetCount++] = j;
+                }
             }
         }
         
-        // Job is not good, resign it
-        if(!FoundJob)
-            self->GetDesignations()->ResignJob(Job);
+        // Attempt a single path-plan to the nearest of all targets
+        EntityPath PathCheck(self->GetWorld(), self->GetPositionBlock(), Targets, TargetCount);
+        PathCheck.ComputePath(EntityPath_Priority_High);
+        
+        // Can we reach any of them? (Sleeps until the path service is done with it)
+        bool IsSolved;
+        PathCheck.WaitPath(&self->JobPath, &IsSolved);
+        
+        // Take the job of the nearest target, unless another dwarf just did
+        // Note: it is up to the dwarf to generate instructions for the job
+        if(IsSolved)
+        {
+            int JobID = Candidates[TargetCandidates[PathCheck.GetSinkIndex()]].ID;
+            FoundJob = self->GetDesignations()->TakeJob(JobID, &Job);
+        }
+        // No candidate is good, count the attempt on all of them
+        else
+            self->GetDesignations()->PassJobs(Candidates, CandidateCount);
     }
     
     // No job found, go idle
     if(!FoundJob)
     {
+        // Idle dwarves gather in the meeting hall, if there is one
+        Vector3<int> HallMin, HallMax;
+        Vector3<int> DwarfPosition = self->GetPositionBlock();
+        bool HasHall = self->GetDesignations()->GetZone(UI_ZonesMenu_Hall, &HallMin, &HallMax);
+        bool InHall = HasHall && DwarfPosition.x >= HallMin.x && DwarfPosition.x <= HallMax.x && DwarfPosition.y >= HallMin.y && DwarfPosition.y <= HallMax.y && DwarfPosition.z >= HallMin.z && DwarfPosition.z <= HallMax.z;
+        
         // Switch between either pausing (idle for a few seconds) or pathing
         static int Count = 0;
         if(Count % 2 == 0)
@@ -408,6 +415,20 @@ void* DwarfEntity::ComputeTask(void* data)
             // Push the instruction
             self->AddInstruction(Instruction);
         }
+        // Head to the hall (all dwarves share the path field there)
+        else if(HasHall && !InHall)
+        {
+            Instruction.Operator = EntityOp_MoveToVolume;
+            Instruction.Data.Volume.MinX = HallMin.x;
+            Instruction.Data.Volume.MinY = HallMin.y;
+            Instruction.Data.Volume.MinZ = HallMin.z;
+            Instruction.Data.Volume.MaxX = HallMax.x;
+            Instruction.Data.Volume.MaxY = HallMax.y;
+            Instruction.Data.Volume.MaxZ = HallMax.z;
+            
+            // Push the instruction
+            self->AddInstruction(Instruction);
+        }
         else
         {
             // Choose a random block in a 3D volume
@@ -19,11 +19,14 @@ Entities::Entities(WorldContainer* MainWorld, VolumeView* MainDesignations, Item
     
     // Default to not rendering the path
     RenderablePath = true;
+    
+    // Sprite batch
+    Billboards = new BillboardBatch();
 }
 
 Entities::~Entities()
 {
-    // Nothing to release...
+    delete Billboards;
 }
 
 void Entities::AddEntity(Entity* NewEntity)
@@ -32,6 +35,7 @@ void Entities::AddEntity(Entity* NewEntity)
     NewEntity->MainWorld = MainWorld;
     NewEntity->Designations = MainDesignations;
     NewEntity->Items = MainItems;
+    NewEntity->WorldEntities = this;
     EntitiesList.Resize(EntitiesList.GetSize() + 1);
     EntitiesList[EntitiesList.GetSize() - 1] = NewEntity;
 }
@@ -142,6 +146,11 @@ void Entities::Update(float dT)
         EntitiesList[i]->__Update(dT);
 }
 
+BillboardBatch* Entities::GetBillboards()
+{
+    return Billboards;
+}
+
 void Entities::Render(int LayerCutoff, float CameraAngle)
 {
     // Render those below the cutoff
@@ -152,6 +161,9 @@ void Entities::Render(int LayerCutoff, float CameraAngle)
             EntitiesList[i]->__Render(CameraAngle);
     }
     
+    // Draw all the sprites and shadows queued by the entities
+    Billboards->Render(CameraAngle);
+    
     // Define line properties
     glLineWidth(3.0f);
     glEnable(GL_LINE_SMOOTH);
@@ -23,6 +23,7 @@
 #include "VolumeView.h"
 #include "Entity.h"
 #include "Queue.h"
+#include "BillboardBatch.h"
 
 class Entities
 {
@@ -54,6 +55,9 @@ public:
     // Render all entities
     void Render(int LayerCutoff, float CameraAngle);
     
+    // Sprite batch all entity sprites, overlays, and shadows are queued into while rendering
+    BillboardBatch* GetBillboards();
+    
 private:
     
     // List of all entities
@@ -76,6 +80,9 @@ private:
     
     // Render paths if true
     bool RenderablePath;
+    
+    // All entity sprites and shadows, drawn in one batch
+    BillboardBatch* Billboards;
 };
 
 #endif
@@ -10,6 +10,7 @@
 
 // Includes
 #include "Entity.h"
+#include "Entities.h"
 
 // Total nubmer of entities instantiated
 static int __EntityCount;
@@ -30,8 +31,11 @@ Entity::Entity(const char* ConfigName)
     // Load the animals texture
     char* str = NULL;
     ConfigFile->GetValue("General", "Texture", &str);
-    TextureID = g2LoadImage(str, &TextureWidth, &TextureHeight, NULL, false, false);
-    UtilAssert(TextureID != UINT_MAX, "Unable to load art asset for an entity; \"%s\"", str);
+    bool Packed = TextureAtlas::GetShared()->GetImage(str, &SpriteImage);
+    UtilAssert(Packed, "Unable to load art asset for an entity; \"%s\"", str);
+    TextureID = SpriteImage.TextureID;
+    TextureWidth = SpriteImage.PixelWidth;
+    TextureHeight = SpriteImage.PixelHeight;
     
     // Get target entity size
     Size = 1.0f; // Default
@@ -56,8 +60,8 @@ Entity::Entity(const char* ConfigName)
         WearablesConfig[i].LoadFile(EntityWearablesConfig[i]);
         WearablesConfig[i].GetValue("General", "Texture", &str);
         
-        WearablesTextureID[i] = g2LoadImage(str, &WearblesTextureWidth[i][0], &WearblesTextureWidth[i][1], NULL, false, false);
-        UtilAssert(WearablesTextureID[i] != UINT_MAX, "Unable to load art asset for an entity; \"%s\"", str);
+        Packed = TextureAtlas::GetShared()->GetImage(str, &WearablesImage[i]);
+        UtilAssert(Packed, "Unable to load art asset for an entity; \"%s\"", str);
     }
     
     // Not currently executing anything
@@ -71,6 +75,7 @@ Entity::Entity(const char* ConfigName)
     
     // Path planning starts invalid
     PathPlanner = NULL;
+    MovingRepair = NULL;
     
     // Not jumping
     IsJumping = false;
@@ -94,6 +99,7 @@ Entity::~Entity()
 {
     pthread_mutex_destroy(&InstructionsLock);
     delete ConfigFile;
+    delete MovingRepair;
 }
 
 g2Config* Entity::GetConfigFile()
@@ -242,9 +248,11 @@ void Entity::RaiseExecutionError(EntityError Error)
     // Save the error
     ExecutionError = Error;
     
-    // Release all instructions
+    // Release all instructions (and the path being moved along)
     IsExecuting = false;
     ClearInstructions();
+    delete MovingRepair;
+    MovingRepair = NULL;
     
     // Push a stall instruction
     EntityInstruction Instr;
@@ -282,6 +290,7 @@ void Entity::RenderPreview(int x, int y, int width, int height)
     float srcheight = SpriteSize.y / float(TextureHeight);
     float srcx = SpritePos.x / float(TextureWidth) + srcwidth * float(SpriteIndex);
     float srcy = SpritePos.y / float(TextureHeight);
+    TextureAtlas_ToAtlas(SpriteImage, &srcx, &srcy, &srcwidth, &srcheight);
     
     RenderPreview(x, y, width, height, srcx, srcy, srcwidth, srcheight);
 }
@@ -441,6 +450,7 @@ void Entity::__Render(float CameraAngle)
     float height = SpriteSize.y / float(TextureHeight);
     float x = SpritePos.x / float(TextureWidth) + width * float(SpriteIndex);
     float y = SpritePos.y / float(TextureHeight);
+    TextureAtlas_ToAtlas(SpriteImage, &x, &y, &width, &height);
     
     // Render the sprite (flip as needed)
     Vector2<float> WorldSize = GetWorldSize();
@@ -554,7 +564,7 @@ void Entity::Execute(float dT)
     }
     
     // If generating path, but not already moving
-    else if(ActiveInstruction.Operator == EntityOp_MoveTo)
+    else if(ActiveInstruction.Operator == EntityOp_MoveTo || ActiveInstruction.Operator == EntityOp_MoveToVolume)
     {
         // Path s actually valid
         bool IsValidPath;
@@ -568,16 +578,22 @@ void Entity::Execute(float dT)
         // Not yet started computing
         else if(PathPlanner == NULL)
         {
-            // Allocate and launch thread
-            PathPlanner = new EntityPath(MainWorld, GetPositionBlock(), Vector3<int>(ActiveInstruction.Data.Pos.x, ActiveInstruction.Data.Pos.y, ActiveInstruction.Data.Pos.z));
-            PathPlanner->ComputePath();
+            // Allocate and queue the request, searched a slice per frame (volumes are shared destinations, see PathField)
+            if(ActiveInstruction.Operator == EntityOp_MoveToVolume)
+            {
+                EntityInstruction::__Data::__Volume& Volume = ActiveInstruction.Data.Volume;
+                PathPlanner = new EntityPath(MainWorld, GetPositionBlock(), Vector3<int>(Volume.MinX, Volume.MinY, Volume.MinZ), Vector3<int>(Volume.MaxX, Volume.MaxY, Volume.MaxZ));
+            }
+            else
+                PathPlanner = new EntityPath(MainWorld, GetPositionBlock(), Vector3<int>(ActiveInstruction.Data.Pos.x, ActiveInstruction.Data.Pos.y, ActiveInstruction.Data.Pos.z));
+            PathPlanner->ComputeSliced();
             
             // Empty current paths
             while(!MovingPath.IsEmpty())
                 MovingPath.Pop();
         }
-        // Else, attempt to get the path
-        else if(PathPlanner->GetPath(&MovingPath, &IsValidPath))
+        // Else, search this frame's slice and attempt to get the path
+        else if(PathPlanner->PumpPath(&MovingPath, &IsValidPath))
         {
             // If empty, then it is an invalid path
             if(MovingPath.GetSize() > 0 && IsValidPath)
@@ -596,6 +612,12 @@ void Entity::Execute(float dT)
                     State = EntityState_Idle;
                     IsExecuting = false;
                 }
+                // Else, repair the path as the world changes
+                else
+                {
+                    delete MovingRepair;
+                    MovingRepair = new PathRepair(MainWorld, StartingPos, &MovingPath);
+                }
             }
             // Error out
             else
@@ -636,6 +658,12 @@ void Entity::Execute(float dT)
                 State = EntityState_Idle;
                 IsExecuting = false;
             }
+            // Else, repair the path as the world changes
+            else
+            {
+                delete MovingRepair;
+                MovingRepair = new PathRepair(MainWorld, StartingPos, &MovingPath);
+            }
         }
     }
     
@@ -721,12 +749,28 @@ void Entity::Execute(float dT)
 
 void Entity::ExecuteMove(float dT)
 {
+    // If blocks changed near the path, repair it from the space we are leaving (only if it broke)
+    if(MovingRepair != NULL && (MovingRepair->IsChanged() || MovingRepair->IsRepairing()))
+    {
+        if(!MovingRepair->Repair(Vector3ftoi(AnimationSource), &MovingPath))
+        {
+            RaiseExecutionError(EntityError_Blocked);
+            return;
+        }
+        
+        // Wait in place while the repair is still searching (resumed next frame)
+        if(MovingRepair->IsRepairing())
+            return;
+    }
+    
     // Are we done traveling to our target?
     if(MovingPath.IsEmpty())
     {
         // Done moving; make sure we are at the precise right location
         State = EntityState_Idle;
         IsExecuting = false;
+        delete MovingRepair;
+        MovingRepair = NULL;
     }
     // Commit to animation
     else
@@ -865,92 +909,20 @@ void Entity::SetBillboardState(const char* State)
     GetConfigFile()->GetValue(State, "delay", &SpriteDelay);
 }
 
-void Entity::RenderBillboard(Vector3<float> pos, float outwidth, float outheight, float srcx, float srcy, float srcwidth, float srcheight, float doffset, bool flip, GLuint TextureID)
+void Entity::RenderBillboard(Vector3<float> pos, float outwidth, float outheight, float srcx, float srcy, float srcwidth, float srcheight, float doffset, bool flip, GLuint TextureID, bool IsOverlay)
 {
     // Default texture ID
     if(TextureID == INT_MAX)
         TextureID = this->TextureID;
     
-    float TextureCoords[4][2] =
-    {
-        {srcx + srcwidth, srcy + srcheight},
-        {srcx, srcy + srcheight},
-        {srcx, srcy},
-        {srcx + srcwidth, srcy},
-    };
-    
-    // Flip on the y axis the texture if facing left
-    if(flip)
-    {
-        // Bottom x-coordinates
-        float temp = TextureCoords[0][0];
-        TextureCoords[0][0] = TextureCoords[1][0];
-        TextureCoords[1][0] = temp;
-        
-        // Top x-coordinates
-        temp = TextureCoords[2][0];
-        TextureCoords[2][0] = TextureCoords[3][0];
-        TextureCoords[3][0] = temp;
-    }
-    
-    // Enable texture
-    glEnable(GL_TEXTURE_2D);
-    glBindTexture(GL_TEXTURE_2D, TextureID);
-    
-    // Render a 0.5 0.5 bilboard at the target position
-    glPushMatrix();
-    {
-        // Initialize color, rotation, and location
-        glColor3f(1, 1, 1);
-        
-        glTranslatef(pos.x, pos.y, pos.z);
-        glRotatef(UtilRadToDeg * (GetCameraAngle()  - UtilPI / 2.0f), 0, 1, 0);
-        
-        // Front facing sprite
-        glBegin(GL_QUADS);
-        {
-            glTexCoord2f(TextureCoords[0][0], TextureCoords[0][1]);
-            glVertex3f(-outwidth / 2.0f, 0, 0);
-            
-            glTexCoord2f(TextureCoords[1][0], TextureCoords[1][1]);
-            glVertex3f(outwidth / 2.0f, 0, 0);
-            
-            glTexCoord2f(TextureCoords[2][0], TextureCoords[2][1]);
-            glVertex3f(outwidth / 2.0f, outheight, 0);
-            
-            glTexCoord2f(TextureCoords[3][0], TextureCoords[3][1]);
-            glVertex3f(-outwidth / 2.0f, outheight, 0);
-        }
-        glEnd();
-    }
-    glPopMatrix();
-    glDisable(GL_TEXTURE_2D);
+    // Queue a camera-facing sprite at the target position (flipped on the y axis if facing left)
+    GetEntities()->GetBillboards()->AddSprite(TextureID, pos, outwidth, outheight, srcx, srcy, srcwidth, srcheight, flip, IsOverlay);
 }
 
 void Entity::RenderShadow(Vector3<float> pos, float radius)
 {
-    // Total segments
-    static const int Segments = 12;
-    
-    // Start a circle at the face
     // About the center, above ground
-    glPushMatrix();
-    glTranslatef(pos.x, pos.y + 0.01f, pos.z);
-    glColor4f(0, 0, 0, 0.5f);
-    
-    glBegin(GL_TRIANGLE_FAN);
-    
-    glVertex3f(0, 0, 0); // Center point
-    for(int i = 0; i <= Segments; i++)
-    {
-        float n = float(i) * (UtilPI / (Segments * 0.5f));
-        glVertex3f(-cos(n) * radius, 0, sin(n) * radius);
-    }
-    
-    glEnd();
-    
-    // Finished
-    glPopMatrix();
+    GetEntities()->GetBillboards()->AddShadow(Vector3<float>(pos.x, pos.y + 0.01f, pos.z), radius);
 }
 
 EntityFacing Entity::GetGlobalFacing()
@@ -1034,14 +1006,15 @@ bool Entity::GetWearableSprite(dItemType ItemType, float* x, float* y, float* wi
                 }
             }
             
-            // Convert to sprite coordinates
-            *x /= float(WearblesTextureWidth[i][0]);
-            *y /= float(WearblesTextureWidth[i][1]);
-            *width /= float(WearblesTextureWidth[i][0]);
-            *height /= float(WearblesTextureWidth[i][1]);
+            // Convert to sprite coordinates, then into the atlas
+            *x /= float(WearablesImage[i].PixelWidth);
+            *y /= float(WearablesImage[i].PixelHeight);
+            *width /= float(WearablesImage[i].PixelWidth);
+            *height /= float(WearablesImage[i].PixelHeight);
+            TextureAtlas_ToAtlas(WearablesImage[i], x, y, width, height);
             
             // Post texture ID
-            *TextureID = WearablesTextureID[i];
+            *TextureID = WearablesImage[i].TextureID;
             
             // All done!
             return true;
@@ -53,8 +53,10 @@
 #include <Glui2/g2Images.h>
 #include "WorldContainer.h"
 #include "EntityPath.h"
+#include "PathRepair.h"
 #include "VolumeView.h"
 #include "ItemsView.h"
+#include "TextureAtlas.h"
 #include "g2ChatController.h"
 
 // Foward declare, as we can't do an inclusion cycle
@@ -71,7 +73,7 @@ enum EntityError
 
 // Entity instruction set
 // Operator: what we are doing
-static const int EntityOpCount = 4;
+static const int EntityOpCount = 8;
 enum EntityOp
 {
     EntityOp_Idle = 0,  // Stall (no-op)
@@ -81,6 +83,7 @@ enum EntityOp
     EntityOp_Pickup,    // Take an item from the current position
     EntityOp_Dropoff,   // Drop item off at the current position
     EntityOp_MovePath,  // Move using the given path
+    EntityOp_MoveToVolume, // Move to the nearest space within "Volume" (i.e. a stockpile or zone)
 };
 
 // Entity instruction set names
@@ -90,6 +93,10 @@ static const char EntityOpNames[EntityOpCount][32] =
     "Moving to target",
     "Facing target",
     "Breaking target",
+    "Picking up item",
+    "Dropping off item",
+    "Moving along path",
+    "Moving to area",
 };
 
 // Each instruction can have a series of parameters
@@ -111,6 +118,11 @@ struct EntityInstruction
         } Pos;
         int ItemID;
         Stack<Vector3<int> >* Path;
+        struct __Volume
+        {
+            int MinX, MinY, MinZ;
+            int MaxX, MaxY, MaxZ;
+        } Volume;
     } Data;
 };
 
@@ -322,7 +334,7 @@ protected:
     // States include "idle_Front", "idle_Front", etc..
     void SetBillboardState(const char* State);
     
-    // Render the shadow
+    // Render the shadow (queued into the entities' sprite batch)
     void RenderShadow(Vector3<float> pos, float radius);
     
     // Get the current facing direction of the sprite
@@ -337,8 +349,9 @@ protected:
     
     /*** Rendering Functions ***/
     
-    // Render the sprite based on the given state
-    void RenderBillboard(Vector3<float> pos, float outwidth, float outheight, float srcx, float srcy, float srcwidth, float srcheight, float doffset, bool flip, GLuint TextureID = INT_MAX);
+    // Render the sprite based on the given state (queued into the entities' sprite batch)
+    // Overlays (i.e. wearables) are drawn over the entity's own sprite
+    void RenderBillboard(Vector3<float> pos, float outwidth, float outheight, float srcx, float srcy, float srcwidth, float srcheight, float doffset, bool flip, GLuint TextureID = INT_MAX, bool IsOverlay = false);
     
     /*** Gameplay Data ***/
     
@@ -369,10 +382,13 @@ private:
     // Configuration file
     g2Config* ConfigFile;
     
-    // Texture handle and size
+    // Texture handle (the sprite atlas page) and size (of the sprite sheet itself)
     GLuint TextureID;
     int TextureWidth, TextureHeight;
     
+    // Where the sprite sheet was packed in the sprite atlas
+    TextureAtlas_Image SpriteImage;
+    
     // Size of the mob, relative to the world
     float Size;
     
@@ -420,8 +436,7 @@ private:
     
     // Wearable texture ID & config pair; ordered based on global "EntityWearablesConfig"
     g2Config WearablesConfig[EntityWearablesCount];
-    GLuint WearablesTextureID[EntityWearablesCount];
-    int WearblesTextureWidth[EntityWearablesCount][2];
+    TextureAtlas_Image WearablesImage[EntityWearablesCount];
     
     /*** Animation ***/
     
@@ -460,6 +475,9 @@ private:
     // Current path generation object
     EntityPath* PathPlanner;
     
+    // Repair of the path being moved along, as the world changes (NULL if not moving)
+    PathRepair* MovingRepair;
+    
     /*** Breaking Info. ***/
     
     // Target we are attempting to break
@@ -9,12 +9,483 @@
 ***************************************************************/
 
 #include "EntityPath.h"
+#include "PathGraph.h"
+#include "PathField.h"
+#include "PathWalkMap.h"
+#include "PathSlicer.h"
 
-// Comparison function looks at the second value of the tuple-pair
-// Used for sorting in our A* algorithm; internal function
-static bool compare_NodeType(EntityPath::NodeType A, EntityPath::NodeType B)
+// Internal: free search states, shared by all paths
+static Stack< EntityPath_Search* > __EntityPath_FreeSearches;
+static pthread_mutex_t __EntityPath_PoolLock = PTHREAD_MUTEX_INITIALIZER;
+
+// Internal: orders multi-sink search targets by block index, then by sink
+static int __EntityPath_CompareTargets(const void* A, const void* B)
+{
+    const EntityPath_Target* TargetA = (const EntityPath_Target*)A;
+    const EntityPath_Target* TargetB = (const EntityPath_Target*)B;
+    if(TargetA->Index != TargetB->Index)
+        return (TargetA->Index < TargetB->Index) ? -1 : 1;
+    return TargetA->Sink - TargetB->Sink;
+}
+
+EntityPath_Search::EntityPath_Search(WorldContainer* WorldData)
+{
+    // Save world and sizes
+    this->WorldData = WorldData;
+    WorldWidth = WorldData->GetWorldWidth();
+    WorldHeight = WorldData->GetWorldHeight();
+    
+    // Allocate all nodes, none stamped by any search yet
+    int NodeCount = WorldWidth * WorldWidth * WorldHeight;
+    Nodes = new EntityPath_Node[NodeCount];
+    for(int i = 0; i < NodeCount; i++)
+        Nodes[i].Stamp = 0;
+    Generation = 0;
+    
+    // Start with a small heap, grown as needed
+    HeapCapacity = 1024;
+    HeapCount = 0;
+    Heap = new EntityPath_HeapEntry[HeapCapacity];
+    
+    // Nothing searched yet
+    Targets = NULL;
+    TargetCount = TargetCapacity = 0;
+    HasEstimate = false;
+    FoundTarget = NULL;
+    Status = EntityPath_Status_Failed;
+    
+    // Only looked up while searching
+    WalkMap = NULL;
+    
+    VisitedCount = TotalVisitedCount = 0;
+}
+
+EntityPath_Search::~EntityPath_Search()
+{
+    delete[] Nodes;
+    delete[] Heap;
+    delete[] Targets;
+}
+
+bool EntityPath_Search::FindPath(Vector3<int> Source, Vector3<int> Sink, Stack< Vector3<int> >* PathOut, const volatile bool* IsCancelled, float MaxTime)
+{
+    // Search towards the single sink in one go
+    if(!StartPath(Source, Sink) || Run(0, IsCancelled, MaxTime) != EntityPath_Status_Found)
+        return false;
+    
+    GetResult(PathOut);
+    return true;
+}
+
+bool EntityPath_Search::FindNearest(Vector3<int> Source, const Vector3<int>* Sinks, int SinkCount, Stack< Vector3<int> >* PathOut, int* SinkOut, const volatile bool* IsCancelled, float MaxTime)
+{
+    // Search towards all sinks in one go
+    if(!StartNearest(Source, Sinks, SinkCount) || Run(0, IsCancelled, MaxTime) != EntityPath_Status_Found)
+        return false;
+    
+    *SinkOut = GetResult(PathOut);
+    return true;
+}
+
+bool EntityPath_Search::StartPath(Vector3<int> Source, Vector3<int> Sink)
+{
+    // Ignore if either end is out of the world
+    VisitedCount = 0;
+    Status = EntityPath_Status_Failed;
+    if(!WorldData->IsWithinWorld(Source) || !WorldData->IsWithinWorld(Sink))
+        return false;
+    
+    // Grow the targets as needed
+    if(TargetCapacity < 1)
+    {
+        TargetCapacity = 1;
+        Targets = new EntityPath_Target[TargetCapacity];
+    }
+    
+    // Search towards the single sink
+    Targets[0].Index = GetIndex(Sink);
+    Targets[0].Sink = 0;
+    Start(Source, 1, &Sink);
+    return true;
+}
+
+bool EntityPath_Search::StartNearest(Vector3<int> Source, const Vector3<int>* Sinks, int SinkCount)
+{
+    // Ignore if the source is out of the world
+    VisitedCount = 0;
+    Status = EntityPath_Status_Failed;
+    if(!WorldData->IsWithinWorld(Source))
+        return false;
+    
+    // Grow the targets as needed
+    if(SinkCount > TargetCapacity)
+    {
+        delete[] Targets;
+        TargetCapacity = max(SinkCount, TargetCapacity * 2);
+        Targets = new EntityPath_Target[TargetCapacity];
+    }
+    
+    // Gather all sinks within the world, sorted by block index
+    int Count = 0;
+    for(int i = 0; i < SinkCount; i++)
+    {
+        if(!WorldData->IsWithinWorld(Sinks[i]))
+            continue;
+        Targets[Count].Index = GetIndex(Sinks[i]);
+        Targets[Count].Sink = i;
+        Count++;
+    }
+    if(Count <= 0)
+        return false;
+    qsort(Targets, Count, sizeof(EntityPath_Target), __EntityPath_CompareTargets);
+    
+    // Search without an estimate, so the first target visited is the nearest
+    Start(Source, Count, NULL);
+    return true;
+}
+
+EntityPath_Status EntityPath_Search::Resume(int MaxVisits)
+{
+    // Only ever bounded by visits
+    return Run(max(MaxVisits, 1), NULL, 0.0f);
+}
+
+int EntityPath_Search::GetResult(Stack< Vector3<int> >* PathOut)
+{
+    PushPath(FoundTarget->Index, PathOut);
+    return FoundTarget->Sink;
+}
+
+void EntityPath_Search::Start(Vector3<int> Source, int TargetCount, const Vector3<int>* EstimateSink)
+{
+    // Save the targets and estimate
+    this->TargetCount = TargetCount;
+    HasEstimate = (EstimateSink != NULL);
+    if(HasEstimate)
+        this->EstimateSink = *EstimateSink;
+    FoundTarget = NULL;
+    Status = EntityPath_Status_Searching;
+    
+    // New generation; on wrap-around, reset all stamps so no stale node looks current
+    Generation++;
+    if(Generation == 0)
+    {
+        for(int i = 0; i < WorldWidth * WorldWidth * WorldHeight; i++)
+            Nodes[i].Stamp = 0;
+        Generation = 1;
+    }
+    
+    // Start from the source
+    int SourceIndex = GetIndex(Source);
+    EntityPath_Node& SourceNode = Nodes[SourceIndex];
+    SourceNode.Stamp = Generation;
+    SourceNode.Cost = 0;
+    SourceNode.Parent = -1;
+    SourceNode.HeapIndex = 0;
+    
+    HeapCount = 1;
+    Heap[0].Index = SourceIndex;
+    Heap[0].Estimate = HasEstimate ? GetEstimate(Source, this->EstimateSink) : 0;
+    Heap[0].Total = Heap[0].Estimate;
+}
+
+EntityPath_Status EntityPath_Search::Run(int MaxVisits, const volatile bool* IsCancelled, float MaxTime)
+{
+    // Nothing left to do if already done
+    if(Status != EntityPath_Status_Searching)
+        return Status;
+    
+    // Start the internal timer (measures real-time, not thread-time, elapsed)
+    UtilHighresClock SearchClock(true);
+    
+    // Look steps up in the world's walkability map, if it has one
+    WalkMap = PathWalkMap::Acquire(WorldData);
+    
+    // Keep visiting the most promising node until a target is reached (failed if none left)
+    Vector3<int> Adjacent[EntityPath_MaxAdjacent];
+    Status = EntityPath_Status_Failed;
+    for(int Visits = 0; HeapCount > 0; Visits++)
+    {
+        // Pause once out of visits
+        if(MaxVisits > 0 && Visits >= MaxVisits)
+        {
+            Status = EntityPath_Status_Searching;
+            break;
+        }
+        
+        // Every so often, give up if cancelled or out of time
+        if(VisitedCount % EntityPath_CheckInterval == EntityPath_CheckInterval - 1)
+        {
+            if(IsCancelled != NULL && *IsCancelled)
+                break;
+            
+            SearchClock.Stop();
+            if(MaxTime > 0.0f && SearchClock.GetTime() > MaxTime)
+                break;
+        }
+        
+        // Pop the best node and mark it as visited
+        int Index = Heap[0].Index;
+        Nodes[Index].HeapIndex = -1;
+        Heap[0] = Heap[--HeapCount];
+        if(HeapCount > 0)
+        {
+            Nodes[Heap[0].Index].HeapIndex = 0;
+            HeapDown(0);
+        }
+        VisitedCount++;
+        TotalVisitedCount++;
+        
+        // Done once a target itself is visited (binary search for the first target of this block)
+        int Low = 0, High = TargetCount;
+        while(Low < High)
+        {
+            int Middle = (Low + High) / 2;
+            if(Targets[Middle].Index < Index)
+                Low = Middle + 1;
+            else
+                High = Middle;
+        }
+        if(Low < TargetCount && Targets[Low].Index == Index)
+        {
+            FoundTarget = &Targets[Low];
+            Status = EntityPath_Status_Found;
+            break;
+        }
+        
+        // Open (or improve) each adjacent space; every step costs the same
+        int Cost = Nodes[Index].Cost + 1;
+        int AdjacentCount = GetAdjacent(GetPosition(Index), Adjacent);
+        for(int i = 0; i < AdjacentCount; i++)
+        {
+            int NextIndex = GetIndex(Adjacent[i]);
+            EntityPath_Node& Next = Nodes[NextIndex];
+            
+            // Never seen by this search: open it
+            if(Next.Stamp != Generation)
+            {
+                // Grow the heap as needed
+                if(HeapCount >= HeapCapacity)
+                {
+                    EntityPath_HeapEntry* NewHeap = new EntityPath_HeapEntry[HeapCapacity * 2];
+                    memcpy(NewHeap, Heap, sizeof(EntityPath_HeapEntry) * HeapCount);
+                    delete[] Heap;
+                    Heap = NewHeap;
+                    HeapCapacity *= 2;
+                }
+                
+                Next.Stamp = Generation;
+                Next.Cost = Cost;
+                Next.Parent = Index;
+                Next.HeapIndex = HeapCount;
+                
+                EntityPath_HeapEntry& Entry = Heap[HeapCount++];
+                Entry.Index = NextIndex;
+                Entry.Estimate = HasEstimate ? GetEstimate(Adjacent[i], EstimateSink) : 0;
+                Entry.Total = Cost + Entry.Estimate;
+                HeapUp(Next.HeapIndex);
+            }
+            // Still open, but found a shorter way in
+            else if(Next.HeapIndex >= 0 && Cost < Next.Cost)
+            {
+                Next.Cost = Cost;
+                Next.Parent = Index;
+                Heap[Next.HeapIndex].Total = Cost + Heap[Next.HeapIndex].Estimate;
+                HeapUp(Next.HeapIndex);
+            }
+        }
+    }
+    
+    if(WalkMap != NULL)
+        WalkMap->Release();
+    WalkMap = NULL;
+    return Status;
+}
+
+void EntityPath_Search::PushPath(int Index, Stack< Vector3<int> >* PathOut)
+{
+    for(; Index >= 0; Index = Nodes[Index].Parent)
+        PathOut->Push(GetPosition(Index));
+}
+
+WorldContainer* EntityPath_Search::GetWorld()
+{
+    return WorldData;
+}
+
+int EntityPath_Search::GetVisitedCount()
+{
+    return VisitedCount;
+}
+
+int EntityPath_Search::GetTotalVisitedCount()
+{
+    return TotalVisitedCount;
+}
+
+int EntityPath_Search::GetMemoryUsage()
+{
+    return WorldWidth * WorldWidth * WorldHeight * sizeof(EntityPath_Node) + HeapCapacity * sizeof(EntityPath_HeapEntry) + TargetCapacity * sizeof(EntityPath_Target);
+}
+
+int EntityPath_Search::GetAdjacent(Vector3<int> Position, Vector3<int>* AdjacentOut)
+{
+    // Entities can only go foward, left, right, backwards
+    int AdjacentCount = 0;
+    for(int i = 0; i < EntityPath_MaxAdjacent; i++)
+    {
+        if(PathWalkMap::GetStep(WalkMap, WorldData, Position, i, &AdjacentOut[AdjacentCount]))
+            AdjacentCount++;
+    }
+    return AdjacentCount;
+}
+
+bool EntityPath_Search::GetStep(WorldContainer* WorldData, Vector3<int> Position, int Direction, Vector3<int>* StepOut)
+{
+    // Entities can only go foward, left, right, backwards if the
+    // height is the same, -0.5 or +0.5 (0.5 means half step)
+    
+    // Transition rules depend on whether we are in a full block (just air) or on a half block
+    bool IsWhole = WorldData->GetBlock(Position).IsWhole();
+    
+    // Create the offset position
+    Vector3<int> Adjacent(Position.x + EntityPath_OffsetX[Direction], Position.y, Position.z + EntityPath_OffsetZ[Direction]);
+    
+    // We will only look at the block below (has to be half step) or the block
+    // ahead (which can either be empty or half) or the block above (on half block, moving to full)
+    for(int j = -1; j <= 1; j++)
+    {
+        // Logic above: checking for block existance
+        if(!WorldData->IsWithinWorld(Adjacent.x, Adjacent.y + j - 1, Adjacent.z))
+            continue;
+        if(!WorldData->IsWithinWorld(Adjacent.x, Adjacent.y + j + 1, Adjacent.z))
+            continue;
+        
+        // Get the block spaces that we want to move into (or above, if half step)
+        dBlock BelowTargetSpace = WorldData->GetBlock(Adjacent.x, Adjacent.y + j - 1, Adjacent.z);
+        dBlock TargetSpace = WorldData->GetBlock(Adjacent.x, Adjacent.y + j, Adjacent.z);
+        dBlock AboveTargetSpace = WorldData->GetBlock(Adjacent.x, Adjacent.y + j + 1, Adjacent.z);
+        
+        // Boolean flag set to true if target space is valid to move into; default to no-valid pos
+        bool TargetValid = false;
+        
+        // If we are currently in full block (just air), apply different rules for transition
+        // Note: We can only check if we are transitioning to the same level or below)
+        if(IsWhole)
+        {
+            // If we are looking below, only half block acceptable
+            if(j == -1 && dIsSolid(TargetSpace) && !TargetSpace.IsWhole() && AboveTargetSpace.GetType() == dBlockType_Air)
+                TargetValid = true;
+            // If we are looking adjacent, only below full and target is empty air
+            else if(j == 0 && dIsSolid(BelowTargetSpace) && BelowTargetSpace.IsWhole() && TargetSpace.GetType() == dBlockType_Air)
+                TargetValid = true;
+            // If we are looking adjacent, adjacent can be a half block if top is air
+            else if(j == 0 && dIsSolid(TargetSpace) && !TargetSpace.IsWhole() && AboveTargetSpace.GetType() == dBlockType_Air)
+                TargetValid = true;
+        }
+        // Start on a half-block
+        else
+        {
+            // We can go adjacent if it is empty and below is full solid
+            if(j == 0 && dIsSolid(BelowTargetSpace) && BelowTargetSpace.IsWhole() && TargetSpace.GetType() == dBlockType_Air)
+                TargetValid = true;
+            // We can go adjacent if it is a step
+            else if(j == 0 && dIsSolid(BelowTargetSpace) && BelowTargetSpace.IsWhole() && dIsSolid(TargetSpace) && !TargetSpace.IsWhole())
+                TargetValid = true;
+            // We can go up if adjacent is a full solid
+            else if(j == 1 && dIsSolid(BelowTargetSpace) && BelowTargetSpace.IsWhole() && TargetSpace.GetType() == dBlockType_Air)
+                TargetValid = true;
+        }
+        
+        // Only the first valid space in this column is taken
+        if(TargetValid)
+        {
+            *StepOut = Vector3<int>(Adjacent.x, Adjacent.y + j, Adjacent.z);
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+bool EntityPath_Search::IsSpace(WorldContainer* WorldData, Vector3<int> Position)
+{
+    // Must have a block below and above within the world
+    if(!WorldData->IsWithinWorld(Position.x, Position.y - 1, Position.z) || !WorldData->IsWithinWorld(Position.x, Position.y + 1, Position.z))
+        return false;
+    
+    // Same as the targets of GetStep(...): either air above a full solid block, or a
+    // half solid block with either air above or a full solid block below
+    dBlock Block = WorldData->GetBlock(Position);
+    dBlock Below = WorldData->GetBlock(Position.x, Position.y - 1, Position.z);
+    bool IsOnWhole = dIsSolid(Below) && Below.IsWhole();
+    if(Block.GetType() == dBlockType_Air)
+        return IsOnWhole;
+    return dIsSolid(Block) && !Block.IsWhole() && (IsOnWhole || WorldData->GetBlock(Position.x, Position.y + 1, Position.z).GetType() == dBlockType_Air);
+}
+
+inline int EntityPath_Search::GetEstimate(Vector3<int> Pos, Vector3<int> Sink)
+{
+    int Horizontal = abs(Pos.x - Sink.x) + abs(Pos.z - Sink.z);
+    int Vertical = abs(Pos.y - Sink.y);
+    return (Horizontal > Vertical) ? Horizontal : Vertical;
+}
+
+inline bool EntityPath_Search::IsBefore(const EntityPath_HeapEntry& A, const EntityPath_HeapEntry& B)
+{
+    return A.Total < B.Total || (A.Total == B.Total && A.Estimate < B.Estimate);
+}
+
+void EntityPath_Search::HeapUp(int HeapIndex)
+{
+    // Swap with the parent while better than it
+    EntityPath_HeapEntry Entry = Heap[HeapIndex];
+    while(HeapIndex > 0)
+    {
+        int ParentIndex = (HeapIndex - 1) / 2;
+        if(!IsBefore(Entry, Heap[ParentIndex]))
+            break;
+        
+        Heap[HeapIndex] = Heap[ParentIndex];
+        Nodes[Heap[HeapIndex].Index].HeapIndex = HeapIndex;
+        HeapIndex = ParentIndex;
+    }
+    
+    Heap[HeapIndex] = Entry;
+    Nodes[Entry.Index].HeapIndex = HeapIndex;
+}
+
+void EntityPath_Search::HeapDown(int HeapIndex)
+{
+    // Swap with the best child while worse than it
+    EntityPath_HeapEntry Entry = Heap[HeapIndex];
+    while(true)
+    {
+        int ChildIndex = HeapIndex * 2 + 1;
+        if(ChildIndex >= HeapCount)
+            break;
+        if(ChildIndex + 1 < HeapCount && IsBefore(Heap[ChildIndex + 1], Heap[ChildIndex]))
+            ChildIndex++;
+        if(!IsBefore(Heap[ChildIndex], Entry))
+            break;
+        
+        Heap[HeapIndex] = Heap[ChildIndex];
+        Nodes[Heap[HeapIndex].Index].HeapIndex = HeapIndex;
+        HeapIndex = ChildIndex;
+    }
+    
+    Heap[HeapIndex] = Entry;
+    Nodes[Entry.Index].HeapIndex = HeapIndex;
+}
+
+inline int EntityPath_Search::GetIndex(Vector3<int> Pos)
+{
+    return (Pos.y * WorldWidth + Pos.z) * WorldWidth + Pos.x;
+}
+
+inline Vector3<int> EntityPath_Search::GetPosition(int Index)
 {
-    return A.second < B.second;
+    return Vector3<int>(Index % WorldWidth, Index / (WorldWidth * WorldWidth), (Index / WorldWidth) % WorldWidth);
 }
 
 EntityPath::EntityPath(WorldContainer* WorldData, Vector3<int> Source, Vector3<int> Sink)
@@ -23,23 +494,115 @@ EntityPath::EntityPath(WorldContainer* WorldData, Vector3<int> Source, Vector3<i
     this->WorldData = WorldData;
     this->Source = Source;
     this->Sink = Sink;
+    Sinks = NULL;
+    SinkCount = 1;
+    IsVolume = false;
+    
+    // Allocate the mutex
+    pthread_mutex_init(&PathComputed, NULL);
+    pthread_cond_init(&PathDone, NULL);
+    IsComputed = false;
+    SolvedPath = false;
+    SolvedSink = -1;
+    IsSubmitted = false;
+    IsCancelled = false;
+    IsSliced = false;
+    Slicer = NULL;
+    SliceSearch = NULL;
+    VisitedCount = 0;
+}
+
+EntityPath::EntityPath(WorldContainer* WorldData, Vector3<int> Source, const Vector3<int>* Sinks, int SinkCount)
+{
+    // Save all references, and copy the sinks
+    this->WorldData = WorldData;
+    this->Source = Source;
+    this->Sink = (SinkCount > 0) ? Sinks[0] : Source;
+    this->SinkCount = SinkCount;
+    this->Sinks = new Vector3<int>[max(SinkCount, 1)];
+    for(int i = 0; i < SinkCount; i++)
+        this->Sinks[i] = Sinks[i];
+    IsVolume = false;
     
     // Allocate the mutex
     pthread_mutex_init(&PathComputed, NULL);
+    pthread_cond_init(&PathDone, NULL);
     IsComputed = false;
     SolvedPath = false;
+    SolvedSink = -1;
+    IsSubmitted = false;
+    IsCancelled = false;
+    IsSliced = false;
+    Slicer = NULL;
+    SliceSearch = NULL;
+    VisitedCount = 0;
 }
 
 EntityPath::~EntityPath()
 {
+    // A worker may still be searching this path; stop it and wait for it to let go
+    if(IsSubmitted)
+    {
+        Cancel();
+        pthread_mutex_lock(&PathComputed);
+        while(!IsComputed)
+            pthread_cond_wait(&PathDone, &PathComputed);
+        pthread_mutex_unlock(&PathComputed);
+    }
+    
     // Release mutex
+    pthread_cond_destroy(&PathDone);
     pthread_mutex_destroy(&PathComputed);
+    delete[] Sinks;
 }
 
-void EntityPath::ComputePath()
+EntityPath::EntityPath(WorldContainer* WorldData, Vector3<int> Source, Vector3<int> Min, Vector3<int> Max)
 {
-    // Launch the thread
-    pthread_create(&MainThread, NULL, ComputePath, (void*)this);
+    // Save all references; the sinks are only gathered if searched
+    this->WorldData = WorldData;
+    this->Source = Source;
+    this->Sink = Min;
+    Sinks = NULL;
+    SinkCount = 0;
+    IsVolume = true;
+    VolumeMin = Min;
+    VolumeMax = Max;
+    
+    // Allocate the mutex
+    pthread_mutex_init(&PathComputed, NULL);
+    pthread_cond_init(&PathDone, NULL);
+    IsComputed = false;
+    SolvedPath = false;
+    SolvedSink = -1;
+    IsSubmitted = false;
+    IsCancelled = false;
+    IsSliced = false;
+    Slicer = NULL;
+    SliceSearch = NULL;
+    VisitedCount = 0;
+}
+
+void EntityPath::ComputePath(EntityPath_Priority Priority)
+{
+    // Queue the request
+    IsSubmitted = true;
+    PathService::GetShared()->Submit(this, (int)Priority);
+}
+
+void EntityPath::ComputeSliced(EntityPath_Priority Priority)
+{
+    // Without a slicer, the path service searches it instead
+    PathSlicer* WorldSlicer = PathSlicer::Get(WorldData);
+    if(WorldSlicer == NULL)
+    {
+        ComputePath(Priority);
+        return;
+    }
+    
+    // Queue the request; searched as it is pumped
+    IsSubmitted = true;
+    IsSliced = true;
+    WorldSlicer->Submit(this, (int)Priority);
 }
 
 bool EntityPath::GetPath(Stack< Vector3<int> >* Path, bool* IsSolved)
@@ -58,228 +621,316 @@ bool EntityPath::GetPath(Stack< Vector3<int> >* Path, bool* IsSolved)
     return Complete;
 }
 
-void* EntityPath::ComputePath(void* Data)
+void EntityPath::WaitPath(Stack< Vector3<int> >* Path, bool* IsSolved)
 {
-    // Start the internal timer (measures real-time, not thread-time, elapsed)
-    UtilHighresClock ThreadClock(true);
-    float TotalTime = 0.0f;
-    
-    // Convert to self object
-    EntityPath* self = (EntityPath*)Data;
-    
-    // Build a queue of all adjacent paths we can visit, as well as the current path
-    // Pair / tuple is (Position, Street-Distance)
-    // Note that if a node's distance is set to a INT_MAX value, then that node
-    // has been visited
-    std::list<NodeType> ToVisit;
-    std::list<NodeType> Visited;
-    std::list<ComesFromType> ComesFrom;
+    // Sleep until posted
+    pthread_mutex_lock(&PathComputed);
+    while(!IsComputed)
+        pthread_cond_wait(&PathDone, &PathComputed);
+    *IsSolved = SolvedPath;
+    pthread_mutex_unlock(&PathComputed);
     
-    // Push the initial source position
-    int InitialDistance = self->GetDistance(self->Source, self->Sink);
-    ToVisit.push_front(NodeType(self->Source, InitialDistance));
+    *Path = this->ComputedPath;
+}
+
+bool EntityPath::PumpPath(Stack< Vector3<int> >* Path, bool* IsSolved)
+{
+    // Search this request's share of the frame, if searched on a slicer
+    if(Slicer != NULL)
+        Slicer->Pump(this);
+    return GetPath(Path, IsSolved);
+}
+
+int EntityPath::GetSinkIndex()
+{
+    pthread_mutex_lock(&PathComputed);
+    int Index = SolvedSink;
+    pthread_mutex_unlock(&PathComputed);
+    return Index;
+}
+
+int EntityPath::GetVisitedCount()
+{
+    pthread_mutex_lock(&PathComputed);
+    int Count = VisitedCount;
+    pthread_mutex_unlock(&PathComputed);
+    return Count;
+}
+
+void EntityPath::Cancel()
+{
+    // A running search sees the flag; a queued request is simply dropped (sliced ones are dropped either way)
+    IsCancelled = true;
+    if(IsSliced)
+    {
+        if(Slicer != NULL && Slicer->Cancel(this))
+            PostPath(false, NULL);
+    }
+    else if(IsSubmitted && PathService::GetShared()->Cancel(this))
+        PostPath(false, NULL);
+}
+
+EntityPath_Search* EntityPath::AcquireSearch(WorldContainer* WorldData)
+{
+    // Reuse a free search of this world; any of another world is stale
+    EntityPath_Search* Search = NULL;
+    pthread_mutex_lock(&__EntityPath_PoolLock);
+    while(Search == NULL && !__EntityPath_FreeSearches.IsEmpty())
+    {
+        Search = __EntityPath_FreeSearches.Pop();
+        if(Search->GetWorld() != WorldData)
+        {
+            delete Search;
+            Search = NULL;
+        }
+    }
+    pthread_mutex_unlock(&__EntityPath_PoolLock);
     
+    // Else, allocate a new one
+    if(Search == NULL)
+        Search = new EntityPath_Search(WorldData);
+    return Search;
+}
+
+void EntityPath::ReleaseSearch(EntityPath_Search* Search)
+{
+    pthread_mutex_lock(&__EntityPath_PoolLock);
+    __EntityPath_FreeSearches.Push(Search);
+    pthread_mutex_unlock(&__EntityPath_PoolLock);
+}
+
+void EntityPath::Search()
+{
     // Default to actively searching
     bool Solved = false;
     Stack< Vector3<int> > Path;
     
+    // Towards a volume, or the nearest of several sinks
+    if(IsVolume)
+    {
+        if(!IsCancelled)
+            Solved = SearchVolume(&Path);
+    }
+    else if(Sinks != NULL)
+    {
+        if(!IsCancelled)
+            Solved = SearchNearest(&Path);
+    }
     // If source is the dont compute, and just return
-    if(self->Source == self->Sink)
+    else if(Source == Sink)
     {
         // Solved by default, and just push the sink position
         Solved = true;
-        Path.Push(self->Sink);
+        Path.Push(Sink);
     }
-    else
+    else if(!IsCancelled)
     {
-        // Keep searching...
-        while(!Solved)
+        // Search with a pooled search state, over the world's path graph if it has one
+        EntityPath_Search* PathSearch = AcquireSearch(WorldData);
+        int Visited = PathSearch->GetTotalVisitedCount();
+        PathGraph* Graph = PathGraph::Acquire(WorldData);
+        if(Graph != NULL)
         {
-            // Check the total time for the hard limit
-            ThreadClock.Stop();
-            TotalTime += ThreadClock.GetTime();
-            ThreadClock.Start();
-            
-            //if(TotalTime > EntityPath_MaxThreadTime)
-            //    break;
-            
-            // If no nodes left, we were unable to find a solution
-            if(ToVisit.size() <= 0)
-                break;
-            
-            // Grab the highest-ranked node (already sorted) and mark as visited
-            NodeType Node = ToVisit.front();
-            ToVisit.pop_front();
-            Visited.push_front(Node);
-            
-            // Push all adjacent positions of this new position
-            // Notes: computes distance internally
-            self->AddAdjacent(Node.first, &ComesFrom, &ToVisit, &Visited);
-            
-            // Sort based on the distance function; from least to greatest
-            ToVisit.sort(compare_NodeType);
-            
-            // What we want to visit next
-            NodeType NextPos = ToVisit.front();
-            if(NextPos.second <= 0)
-                Solved = true;
+            Solved = Graph->FindPath(Source, Sink, &Path, PathSearch, &IsCancelled, EntityPath_MaxThreadTime);
+            Graph->Release();
         }
-        
-        // Our final path
-        Path.Push(self->Sink);
-        
-        // If we found something...
-        if(Solved)
+        else
+            Solved = PathSearch->FindPath(Source, Sink, &Path, &IsCancelled, EntityPath_MaxThreadTime);
+        VisitedCount += PathSearch->GetTotalVisitedCount() - Visited;
+        ReleaseSearch(PathSearch);
+    }
+    
+    // Done!
+    PostPath(Solved, &Path);
+}
+
+bool EntityPath::SearchNearest(Stack< Vector3<int> >* Path)
+{
+    // Only keep sinks in the same region as the source (if the world has a path graph), remembering which sink each one is
+    PathGraph* Graph = PathGraph::Acquire(WorldData);
+    Vector3<int>* KeptSinks = new Vector3<int>[max(SinkCount, 1)];
+    int* KeptIndices = new int[max(SinkCount, 1)];
+    int KeptCount = 0;
+    for(int i = 0; i < SinkCount; i++)
+    {
+        if(Graph == NULL || Graph->IsReachable(Source, Sinks[i]))
         {
-            // From the sink, go to the source (backtrace path)
-            while(Path.Peek() != self->Source)
-            {
-                // What comes from the current path's node?
-                bool FoundSource = false;
-                std::list<ComesFromType>::iterator Node;
-                for(Node = ComesFrom.begin(); Node != ComesFrom.end() && !FoundSource; Node++)
-                {
-                    // Did we find a match?
-                    if(Node->first == Path.Peek())
-                    {
-                        FoundSource = true;
-                        Path.Push(Node->second);
-                    }
-                }
-                
-                // If we never find a source, there is a consistency issue, fail out
-                UtilAssert(FoundSource, "Internal consistency failure with path planning");
-            }
+            KeptSinks[KeptCount] = Sinks[i];
+            KeptIndices[KeptCount++] = i;
         }
     }
+    if(Graph != NULL)
+        Graph->Release();
     
-    // Mutex lock, post data, move on
-    pthread_mutex_lock(&self->PathComputed);
-    self->IsComputed = true;
-    self->ComputedPath = Path;
-    self->SolvedPath = Solved;
-    pthread_mutex_unlock(&self->PathComputed);
+    // Search with a pooled search state
+    int Kept = -1;
+    EntityPath_Search* PathSearch = AcquireSearch(WorldData);
+    bool Solved = KeptCount > 0 && PathSearch->FindNearest(Source, KeptSinks, KeptCount, Path, &Kept, &IsCancelled, EntityPath_MaxThreadTime);
+    VisitedCount += PathSearch->GetVisitedCount();
+    ReleaseSearch(PathSearch);
+    if(Solved)
+        SolvedSink = KeptIndices[Kept];
     
-    // Done!
-    return NULL;
+    delete[] KeptSinks;
+    delete[] KeptIndices;
+    return Solved;
 }
 
-int EntityPath::GetDistance(Vector3<int> A, Vector3<int> B)
+bool EntityPath::SearchVolume(Stack< Vector3<int> >* Path)
 {
-    // Street-distance
-    return abs(A.x - B.x) + abs(A.y - B.y) + abs(A.z - B.z);
+    // Follow the volume's shared field; else (or if the path is longer than the field reaches), search towards every space of the volume
+    if(FollowField(Path))
+        return true;
+    
+    GatherSinks();
+    return SearchNearest(Path);
 }
 
-bool EntityPath::IsUnique(Vector3<int> Position, std::list<NodeType>* ToVisit, std::list<NodeType>* Visited)
+bool EntityPath::FollowField(Stack< Vector3<int> >* Path)
 {
-    // Does this position exist in either lists?
-    std::list<NodeType>::iterator NodeTypeIt;
+    // Only if the world has any, and the source is within its reach
+    PathField* Field = PathFieldCache::Acquire(WorldData, VolumeMin, VolumeMax);
+    if(Field == NULL)
+        return false;
     
-    for(NodeTypeIt = ToVisit->begin(); NodeTypeIt != ToVisit->end(); NodeTypeIt++)
+    bool Solved = Field->IsInRange(Source) && Field->FindPath(Source, Path);
+    PathFieldCache::Release(Field);
+    return Solved;
+}
+
+void EntityPath::GatherSinks()
+{
+    int Capacity = 16;
+    Sinks = new Vector3<int>[Capacity];
+    SinkCount = 0;
+    for(int y = VolumeMin.y; y <= VolumeMax.y; y++)
+    for(int z = VolumeMin.z; z <= VolumeMax.z; z++)
+    for(int x = VolumeMin.x; x <= VolumeMax.x; x++)
     {
-        if((*NodeTypeIt).first == Position)
-            return false;
+        if(!EntityPath_Search::IsSpace(WorldData, Vector3<int>(x, y, z)))
+            continue;
+        
+        // Grow as needed
+        if(SinkCount >= Capacity)
+        {
+            Vector3<int>* NewSinks = new Vector3<int>[Capacity * 2];
+            for(int i = 0; i < SinkCount; i++)
+                NewSinks[i] = Sinks[i];
+            delete[] Sinks;
+            Sinks = NewSinks;
+            Capacity *= 2;
+        }
+        Sinks[SinkCount++] = Vector3<int>(x, y, z);
     }
+}
+
+bool EntityPath::IsReachable()
+{
+    // Without a graph, anything may be
+    PathGraph* Graph = PathGraph::Acquire(WorldData);
+    if(Graph == NULL)
+        return true;
+    
+    bool Reachable = false;
+    if(Sinks == NULL)
+        Reachable = Graph->IsReachable(Source, Sink);
+    for(int i = 0; i < SinkCount && Sinks != NULL && !Reachable; i++)
+        Reachable = Graph->IsReachable(Source, Sinks[i]);
+    Graph->Release();
+    return Reachable;
+}
+
+bool EntityPath::StartSlices()
+{
+    Stack< Vector3<int> > Path;
     
-    for(NodeTypeIt = Visited->begin(); NodeTypeIt != Visited->end(); NodeTypeIt++)
+    // Volumes follow the volume's field if they can, else search towards all of its spaces
+    if(IsVolume)
     {
-        if((*NodeTypeIt).first == Position)
+        if(!IsCancelled && FollowField(&Path))
+        {
+            PostPath(true, &Path);
             return false;
+        }
+        GatherSinks();
+    }
+    // If source is the sink, just return it
+    else if(Sinks == NULL && Source == Sink)
+    {
+        Path.Push(Sink);
+        PostPath(true, &Path);
+        return false;
     }
     
-    // Never found, thus is unique
-    return true;
+    // Give up right away if cancelled, or if no sink can be reached (the search would visit the whole region)
+    if(IsCancelled || !IsReachable())
+    {
+        PostPath(false, NULL);
+        return false;
+    }
+    
+    // Start searching with a pooled search state, held until done
+    SliceSearch = AcquireSearch(WorldData);
+    bool Started = false;
+    if(Sinks != NULL)
+        Started = SliceSearch->StartNearest(Source, Sinks, SinkCount);
+    else
+        Started = SliceSearch->StartPath(Source, Sink);
+    
+    if(!Started)
+    {
+        StopSlices();
+        PostPath(false, NULL);
+    }
+    return Started;
 }
 
-int EntityPath::AddAdjacent(Vector3<int> Position, std::list<ComesFromType>* ComesFrom, std::list<NodeType>* ToVisit, std::list<NodeType>* Visited)
+bool EntityPath::SearchSlice(int MaxVisits, int* VisitedOut)
 {
-    // Entities can only go foward, left, right, backwards if the
-    // height is the same, -0.5 or +0.5 (0.5 means half step)
+    // Keep searching, unless cancelled
+    int Visited = SliceSearch->GetVisitedCount();
+    EntityPath_Status Status = IsCancelled ? EntityPath_Status_Failed : SliceSearch->Resume(MaxVisits);
+    *VisitedOut = SliceSearch->GetVisitedCount() - Visited;
+    VisitedCount += *VisitedOut;
+    if(Status == EntityPath_Status_Searching)
+        return false;
     
-    // All four positions
-    static Vector3<int> Offsets[4] = {
-        Vector3<int>(1, 0, 0),
-        Vector3<int>(-1, 0, 0),
-        Vector3<int>(0, 0, 1),
-        Vector3<int>(0, 0, -1),
-    };
-    
-    // For each position
-    int NodeCount = 0;
-    for(int i = 0; i < 4; i++)
+    // Done; post the path, if found
+    Stack< Vector3<int> > Path;
+    bool Solved = (Status == EntityPath_Status_Found);
+    if(Solved)
+        SolvedSink = SliceSearch->GetResult(&Path);
+    StopSlices();
+    PostPath(Solved, &Path);
+    return true;
+}
+
+void EntityPath::StopSlices()
+{
+    if(SliceSearch != NULL)
+        ReleaseSearch(SliceSearch);
+    SliceSearch = NULL;
+}
+
+void EntityPath::PostPath(bool Solved, Stack< Vector3<int> >* Path)
+{
+    // Unsolved paths are only the sink
+    Stack< Vector3<int> > UnsolvedPath;
+    if(!Solved)
     {
-        // Create the offset position
-        Vector3<int> Adjacent = Position + Offsets[i];
-        
-        // We will only look at the block below (has to be half step) or the block
-        // ahead (which can either be empty or half) or the block above (on half block, moving to full)
-        for(int j = -1; j <= 1; j++)
-        {
-            // Logic above: checking for block existance
-            if(!WorldData->IsWithinWorld(Adjacent.x, Adjacent.y + j - 1, Adjacent.z))
-                continue;
-            if(!WorldData->IsWithinWorld(Adjacent.x, Adjacent.y + j, Adjacent.z))
-                continue;
-            if(!WorldData->IsWithinWorld(Adjacent.x, Adjacent.y + j + 1, Adjacent.z))
-                continue;
-            
-            // Get the block spaces that we want to move into (or above, if half step)
-            dBlock BelowTargetSpace = WorldData->GetBlock(Adjacent.x, Adjacent.y + j - 1, Adjacent.z);
-            dBlock TargetSpace = WorldData->GetBlock(Adjacent.x, Adjacent.y + j, Adjacent.z);
-            dBlock AboveTargetSpace = WorldData->GetBlock(Adjacent.x, Adjacent.y + j + 1, Adjacent.z);
-            
-            // Boolean flag set to true if target space is valid to move into; default to no-valid pos
-            bool TargetValid = false;
-            
-            // If we are currently in full block (just air), apply different rules for transition
-            // Note: We can only check if we are transitioning to the same level or below)
-            if(WorldData->GetBlock(Position).IsWhole())
-            {
-                // If we are looking below, only half block acceptable
-                if(j == -1 && dIsSolid(TargetSpace) && !TargetSpace.IsWhole() && AboveTargetSpace.GetType() == dBlockType_Air)
-                    TargetValid = true;
-                // If we are looking adjacent, only below full and target is empty air
-                else if(j == 0 && dIsSolid(BelowTargetSpace) && BelowTargetSpace.IsWhole() && TargetSpace.GetType() == dBlockType_Air)
-                    TargetValid = true;
-                // If we are looking adjacent, adjacent can be a half block if top is air
-                else if(j == 0 && dIsSolid(TargetSpace) && !TargetSpace.IsWhole() && AboveTargetSpace.GetType() == dBlockType_Air)
-                    TargetValid = true;
-            }
-            // Start on a half-block
-            else
-            {
-                // We can go adjacent if it is empty and below is full solid
-                if(j == 0 && dIsSolid(BelowTargetSpace) && BelowTargetSpace.IsWhole() && TargetSpace.GetType() == dBlockType_Air)
-                    TargetValid = true;
-                // We can go adjacent if it is a step
-                else if(j == 0 && dIsSolid(BelowTargetSpace) && BelowTargetSpace.IsWhole() && dIsSolid(TargetSpace) && !TargetSpace.IsWhole())
-                    TargetValid = true;
-                // We can go up if adjacent is a full solid
-                else if(j == 1 && dIsSolid(BelowTargetSpace) && BelowTargetSpace.IsWhole() && TargetSpace.GetType() == dBlockType_Air)
-                    TargetValid = true;
-            }
-            
-            // Correct next position; if we are above 
-            Vector3<int> NextPos(Adjacent.x, Adjacent.y + j, Adjacent.z);
-            
-            // If the target position we want to move into is valid and unique, then push
-            if(TargetValid && IsUnique(NextPos, ToVisit, Visited))
-            {
-                // Added new node to our visiting list
-                NodeCount++;
-                ToVisit->push_back(NodeType(NextPos, GetDistance(NextPos, Sink)));
-                
-                // Add our node to our "comes from" list to build the path later on
-                ComesFrom->push_back(ComesFromType(NextPos, Position));
-                
-                // Done searching valid paths in this column; move on to next adjacent
-                break;
-            }
-        }
-        
-        // End of adjacency check
+        UnsolvedPath.Push(Sink);
+        Path = &UnsolvedPath;
     }
     
-    // All done and checked
-    return NodeCount;
+    // Mutex lock, post data, wake up any waiting
+    pthread_mutex_lock(&PathComputed);
+    IsComputed = true;
+    ComputedPath = *Path;
+    SolvedPath = Solved;
+    if(Sinks == NULL || IsVolume)
+        SolvedSink = Solved ? 0 : -1;
+    else if(!Solved)
+        SolvedSink = -1;
+    pthread_cond_broadcast(&PathDone);
+    pthread_mutex_unlock(&PathComputed);
 }
@@ -7,18 +7,43 @@
  + Jeremy Bridon jbridon@cores2.com
  
  File: EntityPath.h/cpp
- Desc: Given a source and sink, applies a custom A* path-planning
- search function. In total it takes O(n^2) time; n being the number
- of traversable tiles.
+ Desc: Given a source and sink, applies an A* path-planning search
+ function. Open nodes are kept in a binary heap, ordered by cost so
+ far plus the estimated cost left (then by the estimate alone, so
+ ties favor nodes closer to the sink); visited state and parents
+ are kept in a flat array of one node per world block. In total it
+ takes O(n log n) time; n being the number of traversable tiles.
+ 
+ The node array is never cleared: each search stamps the nodes it
+ touches with its own generation number, so anything stamped by an
+ older search is simply treated as unvisited. Search states are
+ pooled and reused between searches, so the array is only ever
+ allocated once per concurrent search.
+ 
+ A search may also be given several sinks at once (i.e. the spaces
+ around all candidate jobs), in which case it runs without any
+ estimate (Dijkstra's search) and stops at whichever sink is reached
+ first: the nearest one, found in a single search. A path may also
+ lead to any space of a whole volume (i.e. a stockpile or a zone), in
+ which case it follows the volume's shared flow field (see PathField)
+ when the world has one, or else searches towards all of its spaces.
  
  To use, you must pass the world geometry, source, sink, and then
- called the "compute" function. This function is threaded and thus
- needs to be queried over time for completion. The thread will
- keep running until either a path is found, or a hard limit of
- elapsed time is reached. Current hard-limit is 5 seconds.
+ called the "compute" function. This queues the request on the
+ shared path service (see PathService), whose worker threads do the
+ actual search; it needs to be queried over time for completion (or
+ waited on). The search keeps running until either a path is found,
+ the request is cancelled, or a hard limit of elapsed time is
+ reached. Current hard-limit is 8 seconds. If the world has a path
+ graph (see PathGraph), searches between chunks run over it instead.
+ Requests may instead be searched a slice at a time on the simulation
+ thread, as they are pumped each frame (see PathSlicer); searches can
+ be paused after any number of visited nodes and resumed later.
  
  This path-planner also assumes that the entity can only move
  foward / back / left / right and up / down at half-step distances.
+ Where an entity may step is looked up in the world's walkability
+ map (see PathWalkMap) if it has one, else checked on the blocks.
  
  Note: all paths, source, and sinks blocks are ALL through space,
  meaning it is a series of blocks that are above solid blocks (or
@@ -34,73 +59,290 @@
 #ifndef __ENTITYPATH_H__
 #define __ENTITYPATH_H__
 
-#include <list>
-#include <utility>
 #include <limits.h>
 #include "Queue.h"
 #include "Stack.h"
 #include "Vector3.h"
 #include "WorldContainer.h"
+#include "PathService.h"
 #include <pthread.h>
 
-// Hard time limit for the thread
+// Hard time limit of a single search, in seconds
 static const float EntityPath_MaxThreadTime = 8.0f;
 
+// Number of nodes visited between each check for cancellation and the time limit
+static const int EntityPath_CheckInterval = 1024;
+
+// State of a resumable search
+enum EntityPath_Status
+{
+    EntityPath_Status_Searching = 0,
+    EntityPath_Status_Found,
+    EntityPath_Status_Failed,
+};
+
+// Request priorities; higher priorities are searched first
+enum EntityPath_Priority
+{
+    EntityPath_Priority_Low = 0,
+    EntityPath_Priority_Normal,
+    EntityPath_Priority_High,
+};
+
+// Max number of spaces an entity can move into from any one space
+static const int EntityPath_MaxAdjacent = 4;
+
+// Step directions, and their offsets on the x and z axis
+enum EntityPath_Direction
+{
+    EntityPath_Direction_PosX = 0,
+    EntityPath_Direction_NegX,
+    EntityPath_Direction_PosZ,
+    EntityPath_Direction_NegZ,
+};
+static const int EntityPath_OffsetX[EntityPath_MaxAdjacent] = {1, -1, 0, 0};
+static const int EntityPath_OffsetZ[EntityPath_MaxAdjacent] = {0, 0, 1, -1};
+
+// A search node, one per world block; only meaningful if stamped by the current search
+struct EntityPath_Node
+{
+    // Generation of the search that last touched this node
+    unsigned int Stamp;
+    
+    // Steps from the source, and the block index we came from (-1 at the source)
+    int Cost;
+    int Parent;
+    
+    // Index in the open heap, or -1 once visited
+    int HeapIndex;
+};
+
+// An entry of the open heap: a block index, its total estimated cost
+// (cost so far plus the estimate left), and the estimate left alone
+struct EntityPath_HeapEntry
+{
+    int Index;
+    int Total;
+    int Estimate;
+};
+
+// A sink of a multi-sink search: its block index, and its index among the given sinks
+struct EntityPath_Target
+{
+    int Index;
+    int Sink;
+};
+
+// Forward declare
+class PathWalkMap;
+class PathSlicer;
+
+// A reusable A* search over a given world
+class EntityPath_Search
+{
+public:
+    
+    // Allocates a node per block of the given world
+    EntityPath_Search(WorldContainer* WorldData);
+    ~EntityPath_Search();
+    
+    // Find the shortest path from the source to the sink; on success, the path is pushed
+    // from the sink back to the source (so the source is on top) and returns true
+    // Gives up (returns false) once the given flag is set, or after the given time (if positive) in seconds
+    bool FindPath(Vector3<int> Source, Vector3<int> Sink, Stack< Vector3<int> >* PathOut, const volatile bool* IsCancelled = NULL, float MaxTime = 0.0f);
+    
+    // Same as FindPath(...), but to whichever of the given sinks is nearest to the source, whose index is written to SinkOut
+    bool FindNearest(Vector3<int> Source, const Vector3<int>* Sinks, int SinkCount, Stack< Vector3<int> >* PathOut, int* SinkOut, const volatile bool* IsCancelled = NULL, float MaxTime = 0.0f);
+    
+    // Start a search the same as FindPath(...) or FindNearest(...) would, without searching yet; returns false if there is nothing to search
+    bool StartPath(Vector3<int> Source, Vector3<int> Sink);
+    bool StartNearest(Vector3<int> Source, const Vector3<int>* Sinks, int SinkCount);
+    
+    // Keep searching the started search, visiting at most the given number of nodes; returns its state
+    EntityPath_Status Resume(int MaxVisits);
+    
+    // Once found, push the path (same as FindPath(...)) and return the index of the sink it goes to
+    int GetResult(Stack< Vector3<int> >* PathOut);
+    
+    // Get the world this searches
+    WorldContainer* GetWorld();
+    
+    // Number of nodes visited by the last search, and by all searches so far
+    int GetVisitedCount();
+    int GetTotalVisitedCount();
+    
+    // Bytes allocated by this search state
+    int GetMemoryUsage();
+    
+    // Get all spaces an entity can move into from the given space; returns the count
+    int GetAdjacent(Vector3<int> Position, Vector3<int>* AdjacentOut);
+    
+    // Get the space an entity moves into when stepping in the given direction (see EntityPath_Direction); returns false if it can't
+    // Both this and IsSpace(...) check the world's blocks; searches look them up in the world's PathWalkMap instead, if it has one
+    static bool GetStep(WorldContainer* WorldData, Vector3<int> Position, int Direction, Vector3<int>* StepOut);
+    
+    // Returns true if an entity can stand in the given space (i.e. any step into it could be valid)
+    static bool IsSpace(WorldContainer* WorldData, Vector3<int> Position);
+    
+private:
+    
+    // Start a search from the source towards the first given number of targets (sorted by block index);
+    // estimates are towards the given sink, or all zero if none is given
+    void Start(Vector3<int> Source, int TargetCount, const Vector3<int>* EstimateSink);
+    
+    // Keep searching until any target is visited, at most the given number of nodes are (no limit if
+    // not positive), or it gives up (once the given flag is set, or after the given time if positive)
+    EntityPath_Status Run(int MaxVisits, const volatile bool* IsCancelled, float MaxTime);
+    
+    // Back-trace from the given block index onto the path, so the source ends up on top
+    void PushPath(int Index, Stack< Vector3<int> >* PathOut);
+    
+    // Estimated steps left: every step moves one block horizontally and at most one vertically
+    inline int GetEstimate(Vector3<int> Pos, Vector3<int> Sink);
+    
+    // Returns true if heap entry A should be visited before B
+    inline bool IsBefore(const EntityPath_HeapEntry& A, const EntityPath_HeapEntry& B);
+    
+    // Heap operations; both keep each node's heap index up to date
+    void HeapUp(int HeapIndex);
+    void HeapDown(int HeapIndex);
+    
+    // Block index of a position, and back
+    inline int GetIndex(Vector3<int> Pos);
+    inline Vector3<int> GetPosition(int Index);
+    
+    // World data handle and short-hand sizes
+    WorldContainer* WorldData;
+    int WorldWidth, WorldHeight;
+    
+    // One node per block, and the current search's generation
+    EntityPath_Node* Nodes;
+    unsigned int Generation;
+    
+    // Open heap
+    EntityPath_HeapEntry* Heap;
+    int HeapCount, HeapCapacity;
+    
+    // Targets of the current search
+    EntityPath_Target* Targets;
+    int TargetCount, TargetCapacity;
+    
+    // Sink estimates are towards (if any), the target found, and the current search's state
+    Vector3<int> EstimateSink;
+    bool HasEstimate;
+    const EntityPath_Target* FoundTarget;
+    EntityPath_Status Status;
+    
+    // Walkability map of the world, if it has one, while searching (see PathWalkMap)
+    PathWalkMap* WalkMap;
+    
+    // Statistics
+    int VisitedCount, TotalVisitedCount;
+};
+
 class EntityPath
 {
 public:
     
-    // Standard constructor and destructor
+    // Standard constructor and destructor; the destructor cancels the request and waits for any search of it to stop
     EntityPath(WorldContainer* WorldData, Vector3<int> Source, Vector3<int> Sink);
+    
+    // Same, but the path goes to whichever of the given sinks (copied) is nearest; see GetSinkIndex()
+    EntityPath(WorldContainer* WorldData, Vector3<int> Source, const Vector3<int>* Sinks, int SinkCount);
+    
+    // Same, but the path goes to the nearest space within the given volume (global, inclusive)
+    EntityPath(WorldContainer* WorldData, Vector3<int> Source, Vector3<int> Min, Vector3<int> Max);
     ~EntityPath();
     
-    // Compute a path; launches a thread that will give up after a hard-limit of time
-    void ComputePath();
+    // Compute a path; queues the request on the shared path service, which gives up after a hard-limit of time
+    void ComputePath(EntityPath_Priority Priority = EntityPath_Priority_Normal);
+    
+    // Same, but queues the request on the world's slicer (see PathSlicer), searched a slice at a time as it is
+    // pumped; on the path service if the world has no slicer. Only ever use on the simulation thread
+    void ComputeSliced(EntityPath_Priority Priority = EntityPath_Priority_Normal);
     
     // Retrieve the currently computed path; the calling function must compute the path first
-    // Returns true when the thread is done; Posts the path data into the given buffer, else
+    // Returns true when the search is done; Posts the path data into the given buffer, else
     // returns an empty list.
     bool GetPath(Stack< Vector3<int> >* Path, bool* IsSolved);
     
-    // Define the type that is associated with a node
-    // It is both a position and a value; used so we can sort more easily
-    // Note that if the second (distance) is set to a INT_MAX value if it was visited
-    typedef std::pair< Vector3<int>, int > NodeType;
+    // Same as GetPath(...), but blocks until the search is done
+    void WaitPath(Stack< Vector3<int> >* Path, bool* IsSolved);
+    
+    // Same as GetPath(...), but first searches a slice of a sliced request (see ComputeSliced(...))
+    bool PumpPath(Stack< Vector3<int> >* Path, bool* IsSolved);
     
-    // Define a "comes from" relationship to back-trace the correct path after a path is found
-    // First is "this node", secon is "comes from"
-    typedef std::pair< Vector3<int>, Vector3<int> > ComesFromType;
+    // Index of the sink the computed path goes to (always 0 with a single sink or a volume); -1 if not solved
+    int GetSinkIndex();
+    
+    // Number of nodes visited searching the path once done (of the blocks; the path graph's own nodes aren't counted)
+    int GetVisitedCount();
+    
+    // Give up on this request; it completes (as unsolved) as soon as possible
+    void Cancel();
+    
+    // Take a pooled search state for the given world (allocating one if none are free), and give it back
+    static EntityPath_Search* AcquireSearch(WorldContainer* WorldData);
+    static void ReleaseSearch(EntityPath_Search* Search);
     
 private:
     
-    // Internal, threaded, compute-path function
-    static void* ComputePath(void* Data);
+    // The path service and the slicer do the search, and post results
+    friend class PathService;
+    friend class PathSlicer;
+    
+    // Search the path (on a path service worker thread) and post the result
+    void Search();
     
-    // Returns the street-distance which is the summation of component-deltas
-    int GetDistance(Vector3<int> A, Vector3<int> B);
+    // Search helpers: towards the nearest of the sinks, and towards the volume
+    bool SearchNearest(Stack< Vector3<int> >* Path);
+    bool SearchVolume(Stack< Vector3<int> >* Path);
     
-    // Returns true ig the given position doesn't exist in either lists
-    bool IsUnique(Vector3<int> Position, std::list<NodeType>* ToVisit, std::list<NodeType>* Visited);
+    // Volume helpers: follow the volume's shared field, if any reaches the source; and make all of its spaces the sinks
+    bool FollowField(Stack< Vector3<int> >* Path);
+    void GatherSinks();
     
-    // Add all valid adjacent positions into the given queue
-    // May or may not add new positions, based on accessibility
-    // Returns the number of nodes we are adding to the new positions list
-    int AddAdjacent(Vector3<int> Position, std::list<ComesFromType>* ComesFrom, std::list<NodeType>* ToVisit, std::list<NodeType>* Visited);
+    // Returns false if the world's path graph (if any) knows the sink, or all of the sinks, can't be reached
+    bool IsReachable();
+    
+    // Sliced searches (see PathSlicer): start searching, returns false if already done (and posted) instead;
+    // search at most the given number of nodes, returns true once done (and posted); and drop the search
+    bool StartSlices();
+    bool SearchSlice(int MaxVisits, int* VisitedOut);
+    void StopSlices();
+    
+    // Post the result and wake up anything waiting; the path must not be touched by the poster after this
+    void PostPath(bool Solved, Stack< Vector3<int> >* Path);
     
     // World data handle
     WorldContainer* WorldData;
     
-    // Source (origin) and sink (target)
+    // Source (origin) and sink (target); with several sinks, the sink is the first of them
     Vector3<int> Source, Sink;
+    Vector3<int>* Sinks;
+    int SinkCount;
     
-    // Lock associated with the result boolean
+    // True if the path goes to a volume instead (whose spaces become the sinks if searched)
+    bool IsVolume;
+    Vector3<int> VolumeMin, VolumeMax;
+    
+    // Lock associated with the result boolean, signaled once computed
     pthread_mutex_t PathComputed;
+    pthread_cond_t PathDone;
     bool IsComputed;
     Stack< Vector3<int> > ComputedPath;
     bool SolvedPath;
+    int SolvedSink;
+    int VisitedCount;
+    
+    // True once submitted to the path service (or a slicer), and once cancelled
+    bool IsSubmitted;
+    volatile bool IsCancelled;
     
-    // Main thread handle
-    pthread_t MainThread;
+    // True if sliced; the slicer while queued or searched on it, and the search state while searched
+    bool IsSliced;
+    PathSlicer* Slicer;
+    EntityPath_Search* SliceSearch;
 };
 
 #endif
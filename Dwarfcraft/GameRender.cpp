@@ -78,6 +78,24 @@ GameRender::GameRender(GrfxWindow* Parent, Glui2* GluiHandle)
     Clock.Stop();
     printf(" Total time: %.3fs\n", Clock.GetTime());
     
+    // Light the world; kept up to date as the world changes from now on
+    printf("Lighting world data...");
+    Clock.Start();
+    WorldLighting = new WorldLight(WorldData);
+    Clock.Stop();
+    printf(" Total time: %.3fs\n", Clock.GetTime());
+    
+    // Build the walkability map, then the path graph over it; both kept up to date, and used by all path searches from now on
+    printf("Building path graph...");
+    Clock.Start();
+    WorldWalkMap = new PathWalkMap(WorldData);
+    WorldPaths = new PathGraph(WorldData);
+    Clock.Stop();
+    printf(" Total time: %.3fs\n", Clock.GetTime());
+    WorldFields = new PathFieldCache(WorldData);
+    WorldRepairs = new PathRepairList(WorldData);
+    WorldSlicer = new PathSlicer(WorldData);
+    
     /*** Prepare the renderables ***/
     
     // Create all of the special views
@@ -87,7 +105,7 @@ GameRender::GameRender(GrfxWindow* Parent, Glui2* GluiHandle)
     EntitiesList = new Entities(WorldData, Designations, Items);
     
     // Create the world renderer mechanism
-    WorldRender = new WorldView(WorldData, Designations, Items, Structs, EntitiesList);
+    WorldRender = new WorldView(WorldData, WorldLighting, Designations, Items, Structs, EntitiesList);
     
     // Allocate the GUI
     WorldUI = new UserInterface(this, GluiHandle);
@@ -158,11 +176,23 @@ GameRender::GameRender(GrfxWindow* Parent, Glui2* GluiHandle)
     }
     Clock.Stop();
     printf("Time to generate AI: %.3fs\n", Clock.GetTime());
+    
+    // All sprite sheets used so far are packed; keep the atlas for the next start
+    TextureAtlas::GetShared()->SaveCache();
 }
 
 GameRender::~GameRender()
 {
-    // Release world map
+    // Keep any sprite sheets packed since startup
+    TextureAtlas::GetShared()->SaveCache();
+    
+    // Release the path slicer, lighting, the path graph, fields, repairs and walkability (all stop listening to the world) and world map
+    delete WorldSlicer;
+    delete WorldRepairs;
+    delete WorldFields;
+    delete WorldPaths;
+    delete WorldWalkMap;
+    delete WorldLighting;
     delete WorldData;
 }
 
@@ -211,9 +241,12 @@ void GameRender::Render()
     
     /*** Render World ***/
     
+    // Light the terrain for the current time of day
+    WorldRender->SetDaylight(Background->GetDaylight());
+    
     // Draw the world about the camera (note that we move the camera further away a little more)
-    Vector3<float> RightDirection(cos(CameraRotation - UtilPI / 2.0f), 0, sin(CameraRotation - UtilPI / 2.0f));
-    WorldRender->Render(CameraBacked, RightDirection, LayerCutoff, CameraAngle);
+    // The world is frustum-culled against the matrices we have just set up
+    WorldRender->Render(CameraBacked, LayerCutoff, CameraAngle);
     
     /*** Render Breaking Blocks ***/
     
@@ -397,7 +430,8 @@ void GameRender::Update(float dT)
     
     /*** Data Updates ***/
     
-    // Update renderer if needed
+    // Hand out this frame's path search budget, then update renderer if needed (entities search their paths as they update)
+    WorldSlicer->Update();
     WorldRender->Update(dT);
 }
 
@@ -20,6 +20,12 @@
 #include "Globals.h"
 #include "MGrfx.h"
 #include "WorldContainer.h"
+#include "WorldLight.h"
+#include "PathWalkMap.h"
+#include "PathGraph.h"
+#include "PathField.h"
+#include "PathRepair.h"
+#include "PathSlicer.h"
 
 #include "WorldGenerator.h"
 #include "BackgroundView.h"
@@ -29,6 +35,7 @@
 #include "ItemsView.h"
 #include "Entities.h"
 #include "StructsView.h"
+#include "TextureAtlas.h"
 
 class GameRender : public GrfxObject
 {
@@ -95,6 +102,24 @@ private:
     // The main world volume (i.e. data)
     WorldContainer* WorldData;
     
+    // Sky and block light of the world
+    WorldLight* WorldLighting;
+    
+    // Walkability of the world's spaces, looked up by all path searches
+    PathWalkMap* WorldWalkMap;
+    
+    // Path-planning graph of the world
+    PathGraph* WorldPaths;
+    
+    // Shared flow fields towards stockpiles, zones and such (computed as entities head there)
+    PathFieldCache* WorldFields;
+    
+    // Repairs of the paths entities are moving along, notified as the world changes
+    PathRepairList* WorldRepairs;
+    
+    // Searches entities' path requests a slice per frame
+    PathSlicer* WorldSlicer;
+    
     // The rendering mechanism
     WorldView* WorldRender;
     
@@ -21,11 +21,14 @@ ItemsView::ItemsView(WorldContainer* WorldData)
     
     // Load the terrain texture
     TextureID = dGetItemTextureID();
+    
+    // Sprite batch
+    Billboards = new BillboardBatch();
 }
 
 ItemsView::~ItemsView()
 {
-    // Nothing to release
+    delete Billboards;
 }
 
 void ItemsView::AddItem(dItem Item, Vector3<int> Pos)
@@ -106,6 +109,9 @@ void ItemsView::Render(int LayerCutoff, float CameraAngle)
         if((int)GroundSurface <= LayerCutoff)
             RenderShadow(Vector3<float>(ItemView->Pos.x, GroundSurface, ItemView->Pos.z), 0.2f);
     }
+    
+    // Draw all queued sprites and shadows
+    Billboards->Render(CameraAngle);
 }
 
 void ItemsView::Update(float dT)
@@ -148,75 +154,14 @@ void ItemsView::Update(float dT)
 
 void ItemsView::RenderBillboard(Vector3<float> pos, float srcx, float srcy, float srcwidth, float srcheight, float doffset)
 {
-    // Define texture structs
-    float TextureCoords[4][2] =
-    {
-        {srcx + srcwidth, srcy + srcheight},
-        {srcx, srcy + srcheight},
-        {srcx, srcy},
-        {srcx + srcwidth, srcy},
-    };
-    
-    // Define geometry size
+    // A 0.4 x 0.4 billboard at the target position
     static const float outwidth = 0.4f;
     static const float outheight = 0.4f;
-    
-    // Enable texture
-    glEnable(GL_TEXTURE_2D);
-    glBindTexture(GL_TEXTURE_2D, TextureID);
-    
-    // Render a 0.5 0.5 bilboard at the target position
-    glPushMatrix();
-    {
-        // Initialize color, rotation, and location
-        glColor3f(1, 1, 1);
-        
-        // Center position
-        glTranslatef(pos.x, pos.y, pos.z);
-        glRotatef(UtilRadToDeg * (CameraAngle  - UtilPI / 2.0f), 0, 1, 0);
-        
-        // Front facing sprite
-        glBegin(GL_QUADS);
-        {
-            glTexCoord2f(TextureCoords[0][0], TextureCoords[0][1]);
-            glVertex3f(-outwidth / 2.0f, 0, 0);
-            
-            glTexCoord2f(TextureCoords[1][0], TextureCoords[1][1]);
-            glVertex3f(outwidth / 2.0f, 0, 0);
-            
-            glTexCoord2f(TextureCoords[2][0], TextureCoords[2][1]);
-            glVertex3f(outwidth / 2.0f, outheight, 0);
-            
-            glTexCoord2f(TextureCoords[3][0], TextureCoords[3][1]);
-            glVertex3f(-outwidth / 2.0f, outheight, 0);
-        }
-        glEnd();
-    }
-    glPopMatrix();
-    glDisable(GL_TEXTURE_2D);
+    Billboards->AddSprite(TextureID, pos, outwidth, outheight, srcx, srcy, srcwidth, srcheight);
 }
 
 void ItemsView::RenderShadow(Vector3<float> pos, float radius)
 {
-    // Total segments
-    static const int Segments = 12;
-    
-    // Start a circle at the face
-    glPushMatrix();
-        glTranslatef(pos.x, pos.y + 0.01f, pos.z);
-        glColor4f(0, 0, 0, 0.5f);
-        
-        glBegin(GL_TRIANGLE_FAN);
-        
-        glVertex3f(0, 0, 0); // Center point
-        for(int i = 0; i <= Segments; i++)
-        {
-            float n = float(i) * (UtilPI / (Segments * 0.5f));
-            glVertex3f(-cos(n) * radius, 0, sin(n) * radius);
-        }
-        
-        glEnd();
-        
-    // Finished
-    glPopMatrix();
+    // Slightly above the ground
+    Billboards->AddShadow(Vector3<float>(pos.x, pos.y + 0.01f, pos.z), radius);
 }
@@ -21,6 +21,7 @@
 #include "dBlocks.h"
 #include "Vector3.h"
 #include "WorldContainer.h"
+#include "BillboardBatch.h"
 
 // Renderable item structure
 struct ItemsView_Item // Renderable item
@@ -56,10 +57,10 @@ public:
     
 private:
     
-    // Render a billboard
+    // Queue a billboard
     void RenderBillboard(Vector3<float> pos, float srcx, float srcy, float srcwidth, float srcheight, float doffset = 0.0f);
     
-    // Render a circle beneath the item
+    // Queue a circle beneath the item
     void RenderShadow(Vector3<float> pos, float radius);
     
     // World data
@@ -73,6 +74,9 @@ private:
     
     // World camera angle
     float CameraAngle;
+    
+    // All item sprites and shadows, drawn in one batch
+    BillboardBatch* Billboards;
 };
 
 #endif
@@ -0,0 +1,330 @@
+/***************************************************************
+ 
+ DwarfCraft - Dwarf Fortress / Minecraft clone
+ Copyright 2011 Jeremy Bridon - See License.txt for info
+ 
+ This source file is developed and maintained by:
+ + Jeremy Bridon jbridon@cores2.com
+ 
+***************************************************************/
+
+#include "ModelFile.h"
+#include <sys/stat.h>
+
+#ifndef _WIN32
+    #include <sys/mman.h>
+    #include <fcntl.h>
+#endif
+
+// Internal: returns the modification time of the given file, or 0 if not found
+static unsigned int __ModelFile_GetTime(const char* FileName)
+{
+    struct stat FileInfo;
+    if(stat(FileName, &FileInfo) != 0)
+        return 0;
+    return (unsigned int)FileInfo.st_mtime;
+}
+
+// Internal: hash of a vertex, bit-exact (only identical vertices are merged)
+static unsigned int __ModelFile_Hash(const float* Vertex)
+{
+    unsigned int Hash = 2166136261u;
+    const unsigned char* Bytes = (const unsigned char*)Vertex;
+    for(int i = 0; i < int(sizeof(float)) * ModelFile_FloatsPerVertex; i++)
+        Hash = (Hash ^ Bytes[i]) * 16777619u;
+    return Hash;
+}
+
+ModelFile::ModelFile()
+{
+    // Nothing loaded
+    Image = NULL;
+    ImageLength = 0;
+    ImageMapped = false;
+}
+
+ModelFile::~ModelFile()
+{
+    Unload();
+}
+
+bool ModelFile::Load(const char* ObxFile)
+{
+    // Release anything previously loaded
+    Unload();
+    
+    // The binary must be built from this exact source
+    unsigned int SourceTime = __ModelFile_GetTime(ObxFile);
+    char BinaryFile[512];
+    GetBinaryName(ObxFile, BinaryFile, sizeof(BinaryFile));
+    
+    // Map the binary if it is up to date
+    if(Map(BinaryFile, SourceTime))
+        return true;
+    
+    // Else, (re)build the binary and map it
+    if(Convert(ObxFile, BinaryFile) && Map(BinaryFile, SourceTime))
+        return true;
+    
+    // If the binary can't be written (i.e. read-only resources), just keep the image in memory
+    Image = BuildImage(ObxFile, SourceTime, &ImageLength);
+    ImageMapped = false;
+    return Image != NULL;
+}
+
+bool ModelFile::Convert(const char* ObxFile, const char* BinaryFile)
+{
+    // Build the image in memory
+    int Length = 0;
+    char* Data = BuildImage(ObxFile, __ModelFile_GetTime(ObxFile), &Length);
+    if(Data == NULL)
+        return false;
+    
+    // Write it out in one go
+    bool Success = false;
+    FILE* BinaryData = fopen(BinaryFile, "wb");
+    if(BinaryData != NULL)
+    {
+        Success = (fwrite(Data, 1, Length, BinaryData) == size_t(Length));
+        Success = (fclose(BinaryData) == 0) && Success;
+    }
+    
+    // Never leave a partial file around
+    if(!Success)
+        remove(BinaryFile);
+    
+    delete[] Data;
+    return Success;
+}
+
+void ModelFile::GetBinaryName(const char* ObxFile, char* NameOut, int NameLength)
+{
+    // Copy, then replace the extension (if any, and only in the file name itself)
+    strncpy(NameOut, ObxFile, NameLength - 5);
+    NameOut[NameLength - 5] = 0;
+    
+    char* Extension = strrchr(NameOut, '.');
+    if(Extension == NULL || strchr(Extension, '/') != NULL || strchr(Extension, '\\') != NULL)
+        Extension = NameOut + strlen(NameOut);
+    strcpy(Extension, ".dcm");
+}
+
+int ModelFile::GetVertexCount()
+{
+    return (Image == NULL) ? 0 : ((ModelFile_Header*)Image)->VertexCount;
+}
+
+const float* ModelFile::GetVertices()
+{
+    return (const float*)(Image + sizeof(ModelFile_Header));
+}
+
+int ModelFile::GetIndexCount()
+{
+    return (Image == NULL) ? 0 : ((ModelFile_Header*)Image)->IndexCount;
+}
+
+const unsigned short* ModelFile::GetIndices()
+{
+    return (const unsigned short*)(GetVertices() + GetVertexCount() * ModelFile_FloatsPerVertex);
+}
+
+void ModelFile::Unload()
+{
+    // Ignore if nothing loaded
+    if(Image == NULL)
+        return;
+    
+    // Unmap or release
+    if(ImageMapped)
+    {
+        #ifdef _WIN32
+        UnmapViewOfFile(Image);
+        CloseHandle(MappingHandle);
+        CloseHandle(FileHandle);
+        #else
+        munmap(Image, ImageLength);
+        #endif
+    }
+    else
+        delete[] Image;
+    
+    Image = NULL;
+    ImageLength = 0;
+    ImageMapped = false;
+}
+
+char* ModelFile::BuildImage(const char* ObxFile, unsigned int SourceTime, int* LengthOut)
+{
+    /*** Read Source ***/
+    
+    // Load the model file
+    FILE* ModelData = fopen(ObxFile, "r");
+    if(ModelData == NULL)
+        return NULL;
+    
+    // Growing list of all vertices, as read (thus three per triangle)
+    int VertexCount = 0, VertexCapacity = 64;
+    float* Vertices = new float[VertexCapacity * ModelFile_FloatsPerVertex];
+    
+    // Keep reading until eof
+    float Pos[3], UV[2];
+    while(fscanf(ModelData, "%f %f %f %f %f", &Pos[0], &Pos[1], &Pos[2], &UV[0], &UV[1]) == 5)
+    {
+        // Grow as needed
+        if(VertexCount >= VertexCapacity)
+        {
+            float* NewVertices = new float[VertexCapacity * 2 * ModelFile_FloatsPerVertex];
+            memcpy(NewVertices, Vertices, sizeof(float) * VertexCapacity * ModelFile_FloatsPerVertex);
+            delete[] Vertices;
+            Vertices = NewVertices;
+            VertexCapacity *= 2;
+        }
+        
+        // Position, UV (inverted because of texture offsets), then white color
+        float* Vertex = &Vertices[VertexCount++ * ModelFile_FloatsPerVertex];
+        Vertex[0] = Pos[0]; Vertex[1] = Pos[1]; Vertex[2] = Pos[2];
+        Vertex[3] = UV[0]; Vertex[4] = 1.0f - UV[1];
+        Vertex[5] = 1.0f; Vertex[6] = 1.0f; Vertex[7] = 1.0f;
+    }
+    fclose(ModelData);
+    
+    /*** Merge Vertices ***/
+    
+    // Only index if short indices can address every vertex; else keep the vertices as they are
+    int UniqueCount = VertexCount;
+    int IndexCount = 0;
+    unsigned short* Indices = NULL;
+    if(VertexCount > 0 && VertexCount <= 65536)
+    {
+        // Open-addressing hash table of unique vertex indices (at most half full)
+        int TableSize = 1;
+        while(TableSize < VertexCount * 2)
+            TableSize *= 2;
+        int* Table = new int[TableSize];
+        for(int i = 0; i < TableSize; i++)
+            Table[i] = -1;
+        
+        // Compact unique vertices to the front, and write an index for each source vertex
+        UniqueCount = 0;
+        IndexCount = VertexCount;
+        Indices = new unsigned short[IndexCount];
+        for(int i = 0; i < VertexCount; i++)
+        {
+            const float* Vertex = &Vertices[i * ModelFile_FloatsPerVertex];
+            int Slot = __ModelFile_Hash(Vertex) & (TableSize - 1);
+            while(Table[Slot] >= 0 && memcmp(&Vertices[Table[Slot] * ModelFile_FloatsPerVertex], Vertex, sizeof(float) * ModelFile_FloatsPerVertex) != 0)
+                Slot = (Slot + 1) & (TableSize - 1);
+            
+            // New vertex
+            if(Table[Slot] < 0)
+            {
+                memmove(&Vertices[UniqueCount * ModelFile_FloatsPerVertex], Vertex, sizeof(float) * ModelFile_FloatsPerVertex);
+                Table[Slot] = UniqueCount++;
+            }
+            Indices[i] = (unsigned short)Table[Slot];
+        }
+        
+        delete[] Table;
+    }
+    
+    /*** Write Image ***/
+    
+    // Header, vertices, then indices
+    int VertexBytes = sizeof(float) * UniqueCount * ModelFile_FloatsPerVertex;
+    int IndexBytes = sizeof(unsigned short) * IndexCount;
+    *LengthOut = sizeof(ModelFile_Header) + VertexBytes + IndexBytes;
+    char* Data = new char[*LengthOut];
+    
+    ModelFile_Header* Header = (ModelFile_Header*)Data;
+    memcpy(Header->Magic, ModelFile_Magic, sizeof(ModelFile_Magic));
+    Header->Version = ModelFile_Version;
+    Header->SourceTime = SourceTime;
+    Header->VertexCount = UniqueCount;
+    Header->IndexCount = IndexCount;
+    
+    memcpy(Data + sizeof(ModelFile_Header), Vertices, VertexBytes);
+    if(IndexCount > 0)
+        memcpy(Data + sizeof(ModelFile_Header) + VertexBytes, Indices, IndexBytes);
+    
+    // Done with the working buffers
+    delete[] Vertices;
+    delete[] Indices;
+    return Data;
+}
+
+bool ModelFile::Map(const char* BinaryFile, unsigned int SourceTime)
+{
+    #ifdef _WIN32
+    
+    // Open and map the whole file, read-only
+    FileHandle = CreateFileA(BinaryFile, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(FileHandle == INVALID_HANDLE_VALUE)
+        return false;
+    
+    MappingHandle = CreateFileMappingA(FileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if(MappingHandle == NULL)
+    {
+        CloseHandle(FileHandle);
+        return false;
+    }
+    
+    Image = (char*)MapViewOfFile(MappingHandle, FILE_MAP_READ, 0, 0, 0);
+    ImageLength = (int)GetFileSize(FileHandle, NULL);
+    if(Image == NULL)
+    {
+        CloseHandle(MappingHandle);
+        CloseHandle(FileHandle);
+        return false;
+    }
+    
+    #else
+    
+    // Open and map the whole file, read-only; the mapping stays valid once the file is closed
+    int FileHandle = open(BinaryFile, O_RDONLY);
+    if(FileHandle < 0)
+        return false;
+    
+    struct stat FileInfo;
+    if(fstat(FileHandle, &FileInfo) != 0 || FileInfo.st_size <= 0)
+    {
+        close(FileHandle);
+        return false;
+    }
+    
+    ImageLength = (int)FileInfo.st_size;
+    void* Mapping = mmap(NULL, ImageLength, PROT_READ, MAP_PRIVATE, FileHandle, 0);
+    close(FileHandle);
+    if(Mapping == MAP_FAILED)
+        return false;
+    Image = (char*)Mapping;
+    
+    #endif
+    
+    // Make sure this is a complete, up-to-date binary
+    ImageMapped = true;
+    if(!IsValid(Image, ImageLength, SourceTime))
+    {
+        Unload();
+        return false;
+    }
+    
+    return true;
+}
+
+bool ModelFile::IsValid(const char* Image, int Length, unsigned int SourceTime)
+{
+    // Must at least hold a header
+    if(Image == NULL || Length < int(sizeof(ModelFile_Header)))
+        return false;
+    
+    // Must be our format, of this version, and built from this source
+    const ModelFile_Header* Header = (const ModelFile_Header*)Image;
+    if(memcmp(Header->Magic, ModelFile_Magic, sizeof(ModelFile_Magic)) != 0 || Header->Version != ModelFile_Version || Header->SourceTime != SourceTime)
+        return false;
+    
+    // Must hold all vertices and indices
+    if(Header->VertexCount < 0 || Header->IndexCount < 0)
+        return false;
+    return Length == int(sizeof(ModelFile_Header) + sizeof(float) * Header->VertexCount * ModelFile_FloatsPerVertex + sizeof(unsigned short) * Header->IndexCount);
+}
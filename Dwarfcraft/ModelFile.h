@@ -0,0 +1,104 @@
+/***************************************************************
+ 
+ DwarfCraft - Dwarf Fortress / Minecraft clone
+ Copyright 2011 Jeremy Bridon - See License.txt for info
+ 
+ This source file is developed and maintained by:
+ + Jeremy Bridon jbridon@cores2.com
+ 
+ File: ModelFile.h/cpp
+ Desc: A binary, memory-mappable model format, built from the text
+ *.obx model files. The file is laid out exactly as the VBO wants
+ it, so loading is only a map and an upload:
+ 
+ [Header][Vertices: VertexCount x ((x,y,z)(u,v)(r,g,b))][Indices]
+ 
+ Indices are optional (IndexCount may be zero) and are unsigned
+ shorts; duplicate vertices of the source model are merged.
+ 
+ A binary file is kept next to each source model (same name, with
+ a ".dcm" extension) and is tagged with the source's modification
+ time; if the source changes, the binary is rebuilt on the next
+ load. Binaries may also be built offline with:
+ "Dwarfcraft --convertmodel <model.obx> ..."
+ 
+***************************************************************/
+
+// Inclusion guard
+#ifndef __MODELFILE_H__
+#define __MODELFILE_H__
+
+#include "MUtil.h"
+
+// Binary file magic number and version; bump the version on any layout change
+static const char ModelFile_Magic[4] = {'D', 'C', 'M', 'F'};
+static const int ModelFile_Version = 1;
+
+// Number of floats per vertex; same layout as VBuffer ((x,y,z)(u,v)(r,g,b))
+static const int ModelFile_FloatsPerVertex = 8;
+
+// Binary file header, directly followed by the vertices and then the indices
+struct ModelFile_Header
+{
+    char Magic[4];
+    int Version;
+    
+    // Modification time of the source *.obx this was built from
+    unsigned int SourceTime;
+    
+    // Number of vertices and indices (zero if the model isn't indexed)
+    int VertexCount;
+    int IndexCount;
+};
+
+class ModelFile
+{
+public:
+    
+    // Constructor and destructor (releases any mapping)
+    ModelFile();
+    ~ModelFile();
+    
+    // Load the given source model through its binary file, (re)building the binary
+    // if it is missing or older than the source; returns false on failure
+    bool Load(const char* ObxFile);
+    
+    // Build the binary file from the given source model; returns false on failure
+    static bool Convert(const char* ObxFile, const char* BinaryFile);
+    
+    // Write the binary file name of the given source model (i.e. "a.obx" to "a.dcm")
+    static void GetBinaryName(const char* ObxFile, char* NameOut, int NameLength);
+    
+    // Model data access; only valid while loaded
+    int GetVertexCount();
+    const float* GetVertices();
+    int GetIndexCount();
+    const unsigned short* GetIndices();
+    
+    // Release the model data
+    void Unload();
+    
+private:
+    
+    // Build the binary image of the given source model in memory; the caller owns the buffer
+    static char* BuildImage(const char* ObxFile, unsigned int SourceTime, int* LengthOut);
+    
+    // Map the given binary file, only if valid and built from the given source time
+    bool Map(const char* BinaryFile, unsigned int SourceTime);
+    
+    // Returns true if the given image is complete and built from the given source time
+    static bool IsValid(const char* Image, int Length, unsigned int SourceTime);
+    
+    // The binary image, either mapped or (if the binary file can't be written) on the heap
+    char* Image;
+    int ImageLength;
+    bool ImageMapped;
+    
+    #ifdef _WIN32
+    // Windows file and mapping handles
+    HANDLE FileHandle, MappingHandle;
+    #endif
+};
+
+// End of inclusion guard
+#endif
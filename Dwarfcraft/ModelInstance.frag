@@ -0,0 +1,8 @@
+// Block model instancing: same as the fixed-function texture modulation
+
+uniform sampler2D ModelTexture;
+
+void main()
+{
+    gl_FragColor = texture2D(ModelTexture, gl_TexCoord[0].st) * gl_Color;
+}
@@ -0,0 +1,18 @@
+// Block model instancing: each instance is translated, and rotated
+// about the y axis through the block's center, by its instance data
+// InstanceData is (x, y, z, y-rotation in radians)
+
+attribute vec4 InstanceData;
+
+void main()
+{
+    // Rotate about the block center, then move into place
+    float c = cos(InstanceData.w);
+    float s = sin(InstanceData.w);
+    vec3 Local = gl_Vertex.xyz - vec3(0.5, 0.0, 0.5);
+    vec3 Pos = vec3(c * Local.x + s * Local.z, Local.y, -s * Local.x + c * Local.z) + vec3(0.5, 0.0, 0.5) + InstanceData.xyz;
+    
+    gl_Position = gl_ModelViewProjectionMatrix * vec4(Pos, 1.0);
+    gl_FrontColor = gl_Color;
+    gl_TexCoord[0] = gl_MultiTexCoord0;
+}
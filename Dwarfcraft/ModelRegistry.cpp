@@ -0,0 +1,113 @@
+/***************************************************************
+ 
+ DwarfCraft - Dwarf Fortress / Minecraft clone
+ Copyright 2011 Jeremy Bridon - See License.txt for info
+ 
+ This source file is developed and maintained by:
+ + Jeremy Bridon jbridon@cores2.com
+ 
+***************************************************************/
+
+#include "ModelRegistry.h"
+
+ModelRegistry::ModelRegistry()
+{
+    // No models yet
+    Models = NULL;
+    ModelCount = ModelCapacity = 0;
+    
+    // Only use the instancing shader if the hardware can do instanced arrays
+    InstanceShader = NULL;
+    InstanceAttribute = -1;
+    if(glutExtensionSupported("GL_ARB_instanced_arrays") && glutExtensionSupported("GL_ARB_draw_instanced"))
+    {
+        InstanceShader = new Shader("ModelInstance.vert", "ModelInstance.frag");
+        InstanceShader->Uniform("ModelTexture", 0);
+        InstanceAttribute = InstanceShader->GetAttribute("InstanceData");
+    }
+}
+
+ModelRegistry::~ModelRegistry()
+{
+    // Release all models
+    for(int i = 0; i < ModelCount; i++)
+    {
+        delete Models[i].ModelData;
+        delete[] Models[i].Instances;
+    }
+    delete[] Models;
+    
+    // Release shader
+    delete InstanceShader;
+}
+
+int ModelRegistry::GetModelID(const char* ConfigName)
+{
+    // Already loaded?
+    for(int i = 0; i < ModelCount; i++)
+    {
+        if(strcmp(Models[i].ConfigName, ConfigName) == 0)
+            return i;
+    }
+    
+    // Grow the model list if needed
+    if(ModelCount >= ModelCapacity)
+    {
+        ModelCapacity = (ModelCapacity == 0) ? 4 : (ModelCapacity * 2);
+        ModelRegistry_Model* NewModels = new ModelRegistry_Model[ModelCapacity];
+        for(int i = 0; i < ModelCount; i++)
+            NewModels[i] = Models[i];
+        delete[] Models;
+        Models = NewModels;
+    }
+    
+    // Load the model, with no instances
+    ModelRegistry_Model& Model = Models[ModelCount];
+    strncpy(Model.ConfigName, ConfigName, ModelRegistry_MaxNameLength - 1);
+    Model.ConfigName[ModelRegistry_MaxNameLength - 1] = 0;
+    Model.ModelData = new VBuffer(ConfigName);
+    Model.Instances = NULL;
+    Model.InstanceCount = Model.InstanceCapacity = 0;
+    
+    return ModelCount++;
+}
+
+void ModelRegistry::AddInstance(int ModelID, Vector3<int> Position, dFacing Facing)
+{
+    // Grow the instance list if needed
+    ModelRegistry_Model& Model = Models[ModelID];
+    if(Model.InstanceCount >= Model.InstanceCapacity)
+    {
+        Model.InstanceCapacity = (Model.InstanceCapacity == 0) ? 64 : (Model.InstanceCapacity * 2);
+        float* NewInstances = new float[Model.InstanceCapacity * 4];
+        if(Model.Instances != NULL)
+            memcpy(NewInstances, Model.Instances, sizeof(float) * 4 * Model.InstanceCount);
+        delete[] Model.Instances;
+        Model.Instances = NewInstances;
+    }
+    
+    // Push the translation and the facing as a rotation (a quarter-turn per facing)
+    float* Instance = &Model.Instances[Model.InstanceCount * 4];
+    Instance[0] = Position.x;
+    Instance[1] = Position.y;
+    Instance[2] = Position.z;
+    Instance[3] = float(Facing) * float(UtilPI) / 2.0f;
+    Model.InstanceCount++;
+}
+
+void ModelRegistry::Render()
+{
+    // Use the instancing shader for all models
+    if(InstanceShader != NULL)
+        InstanceShader->Activate();
+    
+    // Draw and reset each model's instances
+    for(int i = 0; i < ModelCount; i++)
+    {
+        Models[i].ModelData->RenderInstances(Models[i].Instances, Models[i].InstanceCount, InstanceAttribute);
+        Models[i].InstanceCount = 0;
+    }
+    
+    if(InstanceShader != NULL)
+        InstanceShader->Deactivate();
+}
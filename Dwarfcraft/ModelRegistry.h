@@ -0,0 +1,76 @@
+/***************************************************************
+ 
+ DwarfCraft - Dwarf Fortress / Minecraft clone
+ Copyright 2011 Jeremy Bridon - See License.txt for info
+ 
+ This source file is developed and maintained by:
+ + Jeremy Bridon jbridon@cores2.com
+ 
+ File: ModelRegistry.h/cpp
+ Desc: Loads each 3D model (described by a model configuration
+ file, see VBuffer) only once, and draws all instances of a model
+ as a single batch. Instances are queued every frame, each with
+ only a position and facing, then drawn through "Render()".
+ 
+ If the hardware supports instanced arrays, each model is drawn
+ with one instanced draw call through the "ModelInstance" shader,
+ else each instance is drawn in turn, with the model's states set
+ only once.
+ 
+***************************************************************/
+
+// Inclusion guard
+#ifndef __MODELREGISTRY_H__
+#define __MODELREGISTRY_H__
+
+#include "Globals.h"
+#include "VBuffer.h"
+#include "Shader.h"
+
+// Max length of a model's configuration file name
+static const int ModelRegistry_MaxNameLength = 256;
+
+// A single loaded model, and the instances queued for drawing this frame
+struct ModelRegistry_Model
+{
+    // Configuration file name the model was loaded from
+    char ConfigName[ModelRegistry_MaxNameLength];
+    
+    // The shared model geometry and texture
+    VBuffer* ModelData;
+    
+    // Queued instances, as (x, y, z, y-rotation) tuples
+    float* Instances;
+    int InstanceCount, InstanceCapacity;
+};
+
+class ModelRegistry
+{
+public:
+    
+    // Constructor and destructor (releases all models)
+    ModelRegistry();
+    ~ModelRegistry();
+    
+    // Returns the ID of the model described by the given configuration file; only loaded on first request
+    int GetModelID(const char* ConfigName);
+    
+    // Queue an instance of the given model to be drawn during the next render
+    void AddInstance(int ModelID, Vector3<int> Position, dFacing Facing);
+    
+    // Draw all queued instances, model by model, then empty the queues
+    void Render();
+    
+private:
+    
+    // All loaded models
+    ModelRegistry_Model* Models;
+    int ModelCount, ModelCapacity;
+    
+    // Instancing shader, and its per-instance attribute; NULL / -1 if instancing isn't supported
+    Shader* InstanceShader;
+    GLint InstanceAttribute;
+};
+
+// End of inclusion guard
+#endif
@@ -0,0 +1,622 @@
+/***************************************************************
+ 
+ DwarfCraft - Dwarf Fortress / Minecraft clone
+ Copyright 2011 Jeremy Bridon - See License.txt for info
+ 
+ This source file is developed and maintained by:
+ + Jeremy Bridon jbridon@cores2.com
+ 
+***************************************************************/
+
+#include "PathBench.h"
+#include "PathWalkMap.h"
+#include "PathGraph.h"
+#include "PathField.h"
+#include "PathSlicer.h"
+#include "WorldGenerator.h"
+
+// Internal: seeds of the generated worlds when none are given (the first is the default world's)
+static const char* __PathBench_DefaultSeeds[] = {"derp", "Dwarfcraft", "Benchmark"};
+static const int __PathBench_DefaultSeedCount = 3;
+
+// Internal: sorts floats and ints in increasing order
+static int __PathBench_CompareFloats(const void* A, const void* B)
+{
+    float ValueA = *(const float*)A;
+    float ValueB = *(const float*)B;
+    return (ValueA < ValueB) ? -1 : ((ValueA > ValueB) ? 1 : 0);
+}
+
+static int __PathBench_CompareInts(const void* A, const void* B)
+{
+    return *(const int*)A - *(const int*)B;
+}
+
+// Internal: a random number below the given count (the generator's low bits are poor)
+static int __PathBench_Random(UtilRand* Random, int Count)
+{
+    return int((Random->Rand() >> 8) % (unsigned int)Count);
+}
+
+// Internal: write a string as a JSON string
+static void __PathBench_WriteString(FILE* Output, const char* String)
+{
+    fputc('"', Output);
+    for(; *String != 0; String++)
+    {
+        if(*String == '"' || *String == '\\')
+            fputc('\\', Output);
+        fputc(*String, Output);
+    }
+    fputc('"', Output);
+}
+
+// Internal: sort the latencies, nodes and frames of a kind of request's queries, and save their percentiles
+static void __PathBench_Summarize(PathBench_Stats* Stats, float* Latencies, int* Nodes, int* Frames)
+{
+    double LatencySum = 0.0, NodesSum = 0.0;
+    for(int i = 0; i < PathBench_QueryCount; i++)
+    {
+        LatencySum += Latencies[i];
+        NodesSum += Nodes[i];
+    }
+    
+    qsort(Latencies, PathBench_QueryCount, sizeof(float), __PathBench_CompareFloats);
+    qsort(Nodes, PathBench_QueryCount, sizeof(int), __PathBench_CompareInts);
+    qsort(Frames, PathBench_QueryCount, sizeof(int), __PathBench_CompareInts);
+    Stats->LatencyP50 = Latencies[(PathBench_QueryCount - 1) * 50 / 100];
+    Stats->LatencyP99 = Latencies[(PathBench_QueryCount - 1) * 99 / 100];
+    Stats->LatencyMax = Latencies[PathBench_QueryCount - 1];
+    Stats->LatencyMean = float(LatencySum / PathBench_QueryCount);
+    Stats->NodesP50 = Nodes[(PathBench_QueryCount - 1) * 50 / 100];
+    Stats->NodesP99 = Nodes[(PathBench_QueryCount - 1) * 99 / 100];
+    Stats->NodesMax = Nodes[PathBench_QueryCount - 1];
+    Stats->NodesMean = float(NodesSum / PathBench_QueryCount);
+    Stats->FramesP50 = Frames[(PathBench_QueryCount - 1) * 50 / 100];
+    Stats->FramesP99 = Frames[(PathBench_QueryCount - 1) * 99 / 100];
+    Stats->FramesMax = Frames[PathBench_QueryCount - 1];
+}
+
+PathBench::PathBench(const char* FileName)
+{
+    // Open the results file
+    Output = fopen(FileName, "w");
+    IsFirstWorld = true;
+    
+    // Reference walk buffers, nothing reached yet
+    int SpaceCount = PathBench_WorldWidth * PathBench_WorldWidth * PathBench_WorldHeight;
+    Distances = new int[SpaceCount];
+    Reached = new int[SpaceCount];
+    for(int i = 0; i < SpaceCount; i++)
+        Distances[i] = -1;
+    ReachedCount = 0;
+}
+
+PathBench::~PathBench()
+{
+    if(Output != NULL)
+        fclose(Output);
+    delete[] Distances;
+    delete[] Reached;
+}
+
+bool PathBench::Run(const char** Seeds, int SeedCount)
+{
+    // Nothing can be written
+    if(Output == NULL)
+        return false;
+    
+    // Default seeds if none given
+    if(SeedCount <= 0)
+    {
+        Seeds = __PathBench_DefaultSeeds;
+        SeedCount = __PathBench_DefaultSeedCount;
+    }
+    
+    fprintf(Output, "{\n  \"queries_per_world\": %d,\n  \"worlds\": [", PathBench_QueryCount);
+    bool Passed = true;
+    
+    // Generated worlds
+    for(int i = 0; i < SeedCount; i++)
+    {
+        WorldContainer WorldData(PathBench_WorldWidth, PathBench_WorldHeight, PathBench_ChunkSize);
+        {
+            WorldGenerator Generator;
+            Generator.Generate(&WorldData, Seeds[i]);
+        }
+        
+        char Name[256];
+        sprintf(Name, "generated/%.200s", Seeds[i]);
+        if(!RunWorld(Name, &WorldData, i))
+            Passed = false;
+    }
+    
+    // Mazes
+    for(int i = 0; i < PathBench_MazeCount; i++)
+    {
+        WorldContainer WorldData(PathBench_WorldWidth, PathBench_WorldHeight, PathBench_ChunkSize);
+        GenerateMaze(&WorldData, i + 1);
+        
+        char Name[256];
+        sprintf(Name, "maze/%d", i + 1);
+        if(!RunWorld(Name, &WorldData, i + 1))
+            Passed = false;
+    }
+    
+    // Staircases
+    for(int i = 0; i < PathBench_StairsCount; i++)
+    {
+        WorldContainer WorldData(PathBench_WorldWidth, PathBench_WorldHeight, PathBench_ChunkSize);
+        GenerateStairs(&WorldData, i + 1);
+        
+        char Name[256];
+        sprintf(Name, "stairs/%d", i + 1);
+        if(!RunWorld(Name, &WorldData, i + 1))
+            Passed = false;
+    }
+    
+    fprintf(Output, "\n  ],\n  \"passed\": %s\n}\n", Passed ? "true" : "false");
+    return Passed && !ferror(Output);
+}
+
+void PathBench::GenerateMaze(WorldContainer* WorldData, unsigned int Seed)
+{
+    // Solid floor, and walls two blocks high everywhere but in the corridors carved below
+    int Width = WorldData->GetWorldWidth();
+    for(int z = 0; z < Width; z++)
+    for(int x = 0; x < Width; x++)
+    {
+        WorldData->SetBlock(x, 0, z, dBlockType_Stone);
+        WorldData->SetBlock(x, 1, z, dBlockType_Stone);
+        WorldData->SetBlock(x, 2, z, dBlockType_Stone);
+    }
+    
+    // Cells are the spaces of odd coordinates; carve a random spanning tree between them (depth-first)
+    UtilRand Random(Seed);
+    int CellWidth = (Width - 1) / 2;
+    bool* IsCarved = new bool[CellWidth * CellWidth];
+    int* CellStack = new int[CellWidth * CellWidth];
+    for(int i = 0; i < CellWidth * CellWidth; i++)
+        IsCarved[i] = false;
+    
+    int StackCount = 0;
+    CellStack[StackCount++] = 0;
+    IsCarved[0] = true;
+    WorldData->SetBlock(1, 1, 1, dBlockType_Air);
+    WorldData->SetBlock(1, 2, 1, dBlockType_Air);
+    while(StackCount > 0)
+    {
+        // Gather all uncarved neighbors of the cell on top
+        int Cell = CellStack[StackCount - 1];
+        int CellX = Cell % CellWidth, CellZ = Cell / CellWidth;
+        int Neighbors[EntityPath_MaxAdjacent];
+        int NeighborCount = 0;
+        for(int i = 0; i < EntityPath_MaxAdjacent; i++)
+        {
+            int NextX = CellX + EntityPath_OffsetX[i], NextZ = CellZ + EntityPath_OffsetZ[i];
+            if(NextX >= 0 && NextX < CellWidth && NextZ >= 0 && NextZ < CellWidth && !IsCarved[NextZ * CellWidth + NextX])
+                Neighbors[NeighborCount++] = i;
+        }
+        
+        // Dead end: back up
+        if(NeighborCount <= 0)
+        {
+            StackCount--;
+            continue;
+        }
+        
+        // Carve the cell and the wall between
+        int Direction = Neighbors[__PathBench_Random(&Random, NeighborCount)];
+        int NextX = CellX + EntityPath_OffsetX[Direction], NextZ = CellZ + EntityPath_OffsetZ[Direction];
+        for(int y = 1; y <= 2; y++)
+        {
+            WorldData->SetBlock(CellX * 2 + 1 + EntityPath_OffsetX[Direction], y, CellZ * 2 + 1 + EntityPath_OffsetZ[Direction], dBlockType_Air);
+            WorldData->SetBlock(NextX * 2 + 1, y, NextZ * 2 + 1, dBlockType_Air);
+        }
+        IsCarved[NextZ * CellWidth + NextX] = true;
+        CellStack[StackCount++] = NextZ * CellWidth + NextX;
+    }
+    
+    // Knock down a few more walls, so there are loops (and paths to choose from)
+    for(int i = 0; i < CellWidth * CellWidth / 16; i++)
+    {
+        int x = 1 + __PathBench_Random(&Random, Width - 2), z = 1 + __PathBench_Random(&Random, Width - 2);
+        if((x + z) % 2 == 1)
+        {
+            WorldData->SetBlock(x, 1, z, dBlockType_Air);
+            WorldData->SetBlock(x, 2, z, dBlockType_Air);
+        }
+    }
+    
+    // Some corridor spaces become half-block steps
+    dBlock HalfBlock(dBlockType_Stone);
+    HalfBlock.SetWhole(false);
+    for(int i = 0; i < Width * Width / 32; i++)
+    {
+        int x = __PathBench_Random(&Random, Width), z = __PathBench_Random(&Random, Width);
+        if(WorldData->GetBlock(x, 1, z).GetType() == dBlockType_Air)
+            WorldData->SetBlock(x, 1, z, HalfBlock);
+    }
+    
+    delete[] IsCarved;
+    delete[] CellStack;
+}
+
+void PathBench::GenerateStairs(WorldContainer* WorldData, unsigned int Seed)
+{
+    // Terraces rise by one block every eight columns along x; whole blocks can't be climbed directly
+    int Width = WorldData->GetWorldWidth();
+    const int TerraceWidth = 8;
+    for(int z = 0; z < Width; z++)
+    for(int x = 0; x < Width; x++)
+    {
+        for(int y = 0; y < 4 + x / TerraceWidth; y++)
+            WorldData->SetBlock(x, y, z, dBlockType_Stone);
+    }
+    
+    // A few half-block stairs along each rise, on the lower terrace
+    UtilRand Random(Seed);
+    dBlock HalfBlock(dBlockType_Stone);
+    HalfBlock.SetWhole(false);
+    for(int x = TerraceWidth - 1; x + 1 < Width; x += TerraceWidth)
+    {
+        for(int i = 0; i < 3; i++)
+            WorldData->SetBlock(x, 4 + x / TerraceWidth, __PathBench_Random(&Random, Width), HalfBlock);
+    }
+    
+    // Scatter half-block bumps and whole-block pillars on the terraces
+    for(int i = 0; i < Width * Width / 16; i++)
+    {
+        int x = __PathBench_Random(&Random, Width), z = __PathBench_Random(&Random, Width);
+        int y = 4 + x / TerraceWidth;
+        if(x % TerraceWidth == TerraceWidth - 1)
+            continue;
+        
+        if(__PathBench_Random(&Random, 4) == 0)
+        {
+            WorldData->SetBlock(x, y, z, dBlockType_Stone);
+            WorldData->SetBlock(x, y + 1, z, dBlockType_Stone);
+        }
+        else
+            WorldData->SetBlock(x, y, z, HalfBlock);
+    }
+}
+
+bool PathBench::RunWorld(const char* Name, WorldContainer* WorldData, unsigned int Seed)
+{
+    printf("Path benchmark: %s...", Name);
+    fflush(stdout);
+    
+    // Same planning structures as in the game, built in the same order
+    PathBench_Result Result;
+    UtilHighresClock Clock(true);
+    PathWalkMap* WalkMap = new PathWalkMap(WorldData);
+    Clock.Stop();
+    Result.WalkMapTime = Clock.GetTime() * 1000.0f;
+    
+    Clock.Start();
+    PathGraph* Graph = new PathGraph(WorldData);
+    Clock.Stop();
+    Result.GraphTime = Clock.GetTime() * 1000.0f;
+    
+    PathFieldCache* Fields = new PathFieldCache(WorldData);
+    PathSlicer* Slicer = new PathSlicer(WorldData);
+    
+    // Volumes, around random spaces (clipped to the world)
+    UtilRand Random(Seed * 7919 + 1);
+    Vector3<int> VolumeMins[PathBench_VolumeCount], VolumeMaxs[PathBench_VolumeCount];
+    for(int i = 0; i < PathBench_VolumeCount; i++)
+    {
+        Vector3<int> Center(0, 0, 0);
+        for(int Tries = 0; Tries < 16; Tries++)
+        {
+            if(PickSpace(WorldData, &Random, &Center))
+                break;
+        }
+        
+        VolumeMins[i] = Vector3<int>(max(Center.x - PathBench_VolumeRadius, 0), max(Center.y - PathBench_VolumeHalfHeight, 0), max(Center.z - PathBench_VolumeRadius, 0));
+        VolumeMaxs[i] = Vector3<int>(min(Center.x + PathBench_VolumeRadius, WorldData->GetWorldWidth() - 1), min(Center.y + PathBench_VolumeHalfHeight, WorldData->GetWorldHeight() - 1), min(Center.z + PathBench_VolumeRadius, WorldData->GetWorldWidth() - 1));
+    }
+    
+    // All queries, one at a time, each as every kind of request
+    float* Latencies = new float[PathBench_KindCount * PathBench_QueryCount];
+    int* Nodes = new int[PathBench_KindCount * PathBench_QueryCount];
+    int* Frames = new int[PathBench_KindCount * PathBench_QueryCount];
+    double StretchSums[PathBench_KindCount];
+    int StretchCounts[PathBench_KindCount];
+    for(int Kind = 0; Kind < PathBench_KindCount; Kind++)
+    {
+        PathBench_Stats* Stats = &Result.Requests[Kind];
+        Stats->QueryCount = PathBench_QueryCount;
+        Stats->ReachableCount = Stats->SolvedCount = 0;
+        Stats->MismatchCount = Stats->InvalidCount = 0;
+        Stats->OptimalCount = Stats->MaxExtraSteps = 0;
+        StretchSums[Kind] = 0.0;
+        StretchCounts[Kind] = 0;
+    }
+    double ReferenceSum = 0.0;
+    
+    for(int i = 0; i < PathBench_QueryCount; i++)
+    {
+        // Pick a source that can go somewhere (unless none is found)
+        Vector3<int> Source(0, 0, 0);
+        for(int Tries = 0; Tries < 16; Tries++)
+        {
+            if(PickSpace(WorldData, &Random, &Source) && Walk(WorldData, Source) > 1)
+                break;
+        }
+        Walk(WorldData, Source);
+        ReferenceSum += ReachedCount;
+        
+        // Every other sink is known to be reachable, the others are anywhere; so are the other sinks of nearest sink requests
+        Vector3<int> Sink = Source;
+        if(i % 2 == 0 && ReachedCount > 0)
+            Sink = PickReached(&Random);
+        else
+            PickSpace(WorldData, &Random, &Sink);
+        
+        Vector3<int> Sinks[PathBench_SinkCount];
+        Sinks[0] = Sink;
+        for(int j = 1; j < PathBench_SinkCount; j++)
+        {
+            if(!PickSpace(WorldData, &Random, &Sinks[j]))
+                Sinks[j] = Sink;
+        }
+        int Volume = i % PathBench_VolumeCount;
+        
+        for(int Kind = 0; Kind < PathBench_KindCount; Kind++)
+        {
+            // Plan, and time the whole request (for sliced requests, every frame until done)
+            Stack< Vector3<int> > Path;
+            bool Solved = false;
+            int Index = Kind * PathBench_QueryCount + i;
+            Frames[Index] = 0;
+            Clock.Start();
+            EntityPath* Planner = NULL;
+            if(Kind == PathBench_Kind_Nearest)
+                Planner = new EntityPath(WorldData, Source, Sinks, PathBench_SinkCount);
+            else if(Kind == PathBench_Kind_Volume)
+                Planner = new EntityPath(WorldData, Source, VolumeMins[Volume], VolumeMaxs[Volume]);
+            else
+                Planner = new EntityPath(WorldData, Source, Sink);
+            
+            if(Kind == PathBench_Kind_Sliced)
+            {
+                Planner->ComputeSliced();
+                do
+                {
+                    Slicer->Update();
+                    Frames[Index]++;
+                }
+                while(!Planner->PumpPath(&Path, &Solved));
+            }
+            else
+            {
+                Planner->ComputePath();
+                Planner->WaitPath(&Path, &Solved);
+            }
+            Clock.Stop();
+            Latencies[Index] = Clock.GetTime() * 1000.0f;
+            Nodes[Index] = Planner->GetVisitedCount();
+            
+            // Where the path must end, and the reference's steps to there
+            Vector3<int> Min = Sink, Max = Sink;
+            int Steps = FindSteps(Source, Sink, Sink);
+            if(Kind == PathBench_Kind_Nearest)
+            {
+                for(int j = 1; j < PathBench_SinkCount; j++)
+                {
+                    int SinkSteps = FindSteps(Source, Sinks[j], Sinks[j]);
+                    if(SinkSteps >= 0 && (Steps < 0 || SinkSteps < Steps))
+                        Steps = SinkSteps;
+                }
+                
+                int SinkIndex = Planner->GetSinkIndex();
+                if(SinkIndex >= 0 && SinkIndex < PathBench_SinkCount)
+                    Min = Max = Sinks[SinkIndex];
+                else
+                    Min = Max = Vector3<int>(-1, -1, -1);
+            }
+            else if(Kind == PathBench_Kind_Volume)
+            {
+                Min = VolumeMins[Volume];
+                Max = VolumeMaxs[Volume];
+                Steps = FindSteps(Source, Min, Max);
+            }
+            delete Planner;
+            
+            // Check against the reference
+            PathBench_Stats* Stats = &Result.Requests[Kind];
+            if(Steps >= 0)
+                Stats->ReachableCount++;
+            if(Solved)
+                Stats->SolvedCount++;
+            if(Solved != (Steps >= 0))
+                Stats->MismatchCount++;
+            if(!Solved || Steps < 0)
+                continue;
+            
+            // The path must go from the source to a sink, and can't be shorter than the reference's
+            int ExtraSteps = Path.GetSize() - 1 - Steps;
+            if(!IsValid(WorldData, &Path, Source, Min, Max) || ExtraSteps < 0)
+            {
+                Stats->InvalidCount++;
+                continue;
+            }
+            
+            if(ExtraSteps == 0)
+                Stats->OptimalCount++;
+            Stats->MaxExtraSteps = max(Stats->MaxExtraSteps, ExtraSteps);
+            if(Steps > 0)
+            {
+                StretchSums[Kind] += double(Steps + ExtraSteps) / double(Steps);
+                StretchCounts[Kind]++;
+            }
+        }
+    }
+    
+    // Percentiles
+    bool Passed = true;
+    for(int Kind = 0; Kind < PathBench_KindCount; Kind++)
+    {
+        PathBench_Stats* Stats = &Result.Requests[Kind];
+        __PathBench_Summarize(Stats, Latencies + Kind * PathBench_QueryCount, Nodes + Kind * PathBench_QueryCount, Frames + Kind * PathBench_QueryCount);
+        Stats->MeanStretch = (StretchCounts[Kind] > 0) ? float(StretchSums[Kind] / StretchCounts[Kind]) : 1.0f;
+        if(Stats->MismatchCount != 0 || Stats->InvalidCount != 0)
+            Passed = false;
+    }
+    Result.ReferenceNodesMean = float(ReferenceSum / PathBench_QueryCount);
+    
+    // Memory, once all buffers grew as needed
+    EntityPath_Search* Search = EntityPath::AcquireSearch(WorldData);
+    Result.SearchBytes = Search->GetMemoryUsage();
+    EntityPath::ReleaseSearch(Search);
+    Result.WalkMapBytes = WalkMap->GetMemoryUsage();
+    Result.GraphBytes = Graph->GetMemoryUsage();
+    
+    // Fields hold the walkability map, so are released first
+    delete Slicer;
+    delete Fields;
+    delete Graph;
+    delete WalkMap;
+    delete[] Latencies;
+    delete[] Nodes;
+    delete[] Frames;
+    
+    WriteResult(Name, WorldData, &Result);
+    PathBench_Stats* Stats = Result.Requests;
+    printf(" p50 %.3fms (sliced %.3fms, nearest %.3fms, volume %.3fms), %d/%d solved, %d optimal\n", Stats[PathBench_Kind_Path].LatencyP50, Stats[PathBench_Kind_Sliced].LatencyP50,
+           Stats[PathBench_Kind_Nearest].LatencyP50, Stats[PathBench_Kind_Volume].LatencyP50, Stats[PathBench_Kind_Path].SolvedCount, PathBench_QueryCount, Stats[PathBench_Kind_Path].OptimalCount);
+    return Passed;
+}
+
+int PathBench::Walk(WorldContainer* WorldData, Vector3<int> Source)
+{
+    // Forget the last walk
+    for(int i = 0; i < ReachedCount; i++)
+        Distances[Reached[i]] = -1;
+    ReachedCount = 0;
+    if(!EntityPath_Search::IsSpace(WorldData, Source))
+        return 0;
+    
+    // Breadth-first: every step costs the same, so spaces are reached in order of steps
+    Distances[GetIndex(Source)] = 0;
+    Reached[ReachedCount++] = GetIndex(Source);
+    for(int Next = 0; Next < ReachedCount; Next++)
+    {
+        Vector3<int> Pos = GetPosition(Reached[Next]);
+        for(int Direction = 0; Direction < EntityPath_MaxAdjacent; Direction++)
+        {
+            Vector3<int> Step;
+            if(!EntityPath_Search::GetStep(WorldData, Pos, Direction, &Step) || Distances[GetIndex(Step)] >= 0)
+                continue;
+            
+            Distances[GetIndex(Step)] = Distances[Reached[Next]] + 1;
+            Reached[ReachedCount++] = GetIndex(Step);
+        }
+    }
+    return ReachedCount;
+}
+
+int PathBench::FindSteps(Vector3<int> Source, Vector3<int> Min, Vector3<int> Max)
+{
+    // A request from its single sink is solved as is (even if not a space)
+    if(Min == Max && Source == Min)
+        return 0;
+    
+    int Steps = -1;
+    for(int y = max(Min.y, 0); y <= min(Max.y, PathBench_WorldHeight - 1); y++)
+    for(int z = max(Min.z, 0); z <= min(Max.z, PathBench_WorldWidth - 1); z++)
+    for(int x = max(Min.x, 0); x <= min(Max.x, PathBench_WorldWidth - 1); x++)
+    {
+        int Distance = Distances[GetIndex(Vector3<int>(x, y, z))];
+        if(Distance >= 0 && (Steps < 0 || Distance < Steps))
+            Steps = Distance;
+    }
+    return Steps;
+}
+
+bool PathBench::PickSpace(WorldContainer* WorldData, UtilRand* Random, Vector3<int>* SpaceOut)
+{
+    // Within a half block on the surface, or above it
+    int Width = WorldData->GetWorldWidth();
+    int x = __PathBench_Random(Random, Width), z = __PathBench_Random(Random, Width);
+    int y = WorldData->GetSurfaceDepth(x, z);
+    for(int i = 0; i <= 1; i++)
+    {
+        if(EntityPath_Search::IsSpace(WorldData, Vector3<int>(x, y + i, z)))
+        {
+            *SpaceOut = Vector3<int>(x, y + i, z);
+            return true;
+        }
+    }
+    return false;
+}
+
+Vector3<int> PathBench::PickReached(UtilRand* Random)
+{
+    return GetPosition(Reached[__PathBench_Random(Random, ReachedCount)]);
+}
+
+bool PathBench::IsValid(WorldContainer* WorldData, Stack< Vector3<int> >* Path, Vector3<int> Source, Vector3<int> Min, Vector3<int> Max)
+{
+    // Walk the path (a copy, since the stack is popped) from the source
+    Stack< Vector3<int> > Steps = *Path;
+    if(Steps.IsEmpty() || !(Steps.Peek() == Source))
+        return false;
+    
+    Vector3<int> Pos = Steps.Pop();
+    while(!Steps.IsEmpty())
+    {
+        Vector3<int> Next = Steps.Pop();
+        bool IsStep = false;
+        for(int Direction = 0; Direction < EntityPath_MaxAdjacent && !IsStep; Direction++)
+        {
+            Vector3<int> Step;
+            IsStep = EntityPath_Search::GetStep(WorldData, Pos, Direction, &Step) && Step == Next;
+        }
+        if(!IsStep)
+            return false;
+        Pos = Next;
+    }
+    
+    // Up to a sink
+    return Pos.x >= Min.x && Pos.x <= Max.x && Pos.y >= Min.y && Pos.y <= Max.y && Pos.z >= Min.z && Pos.z <= Max.z;
+}
+
+void PathBench::WriteResult(const char* Name, WorldContainer* WorldData, PathBench_Result* Result)
+{
+    fprintf(Output, "%s\n    {\n      \"name\": ", IsFirstWorld ? "" : ",");
+    IsFirstWorld = false;
+    __PathBench_WriteString(Output, Name);
+    fprintf(Output, ",\n      \"width\": %d,\n      \"height\": %d,\n", WorldData->GetWorldWidth(), WorldData->GetWorldHeight());
+    fprintf(Output, "      \"build_ms\": {\"walk_map\": %.3f, \"graph\": %.3f},\n", Result->WalkMapTime, Result->GraphTime);
+    fprintf(Output, "      \"reference_nodes_mean\": %.1f,\n", Result->ReferenceNodesMean);
+    fprintf(Output, "      \"memory_bytes\": {\"search\": %d, \"walk_map\": %d, \"graph\": %d},\n", Result->SearchBytes, Result->WalkMapBytes, Result->GraphBytes);
+    fprintf(Output, "      \"requests\": {");
+    
+    // Each kind of request
+    for(int Kind = 0; Kind < PathBench_KindCount; Kind++)
+    {
+        PathBench_Stats* Stats = &Result->Requests[Kind];
+        fprintf(Output, "%s\n        \"%s\": {\n", (Kind > 0) ? "," : "", PathBench_KindNames[Kind]);
+        fprintf(Output, "          \"queries\": %d,\n          \"reachable\": %d,\n          \"solved\": %d,\n", Stats->QueryCount, Stats->ReachableCount, Stats->SolvedCount);
+        fprintf(Output, "          \"mismatched\": %d,\n          \"invalid\": %d,\n", Stats->MismatchCount, Stats->InvalidCount);
+        fprintf(Output, "          \"optimal\": %d,\n          \"max_extra_steps\": %d,\n          \"mean_stretch\": %.4f,\n", Stats->OptimalCount, Stats->MaxExtraSteps, Stats->MeanStretch);
+        fprintf(Output, "          \"latency_ms\": {\"p50\": %.3f, \"p99\": %.3f, \"max\": %.3f, \"mean\": %.3f},\n", Stats->LatencyP50, Stats->LatencyP99, Stats->LatencyMax, Stats->LatencyMean);
+        if(Kind == PathBench_Kind_Sliced)
+            fprintf(Output, "          \"frames\": {\"p50\": %d, \"p99\": %d, \"max\": %d},\n", Stats->FramesP50, Stats->FramesP99, Stats->FramesMax);
+        fprintf(Output, "          \"nodes_visited\": {\"p50\": %d, \"p99\": %d, \"max\": %d, \"mean\": %.1f}\n        }", Stats->NodesP50, Stats->NodesP99, Stats->NodesMax, Stats->NodesMean);
+    }
+    fprintf(Output, "\n      }\n    }");
+}
+
+inline int PathBench::GetIndex(Vector3<int> Pos)
+{
+    return (Pos.y * PathBench_WorldWidth + Pos.z) * PathBench_WorldWidth + Pos.x;
+}
+
+inline Vector3<int> PathBench::GetPosition(int Index)
+{
+    return Vector3<int>(Index % PathBench_WorldWidth, Index / (PathBench_WorldWidth * PathBench_WorldWidth), (Index / PathBench_WorldWidth) % PathBench_WorldWidth);
+}
@@ -0,0 +1,176 @@
+/***************************************************************
+ 
+ DwarfCraft - Dwarf Fortress / Minecraft clone
+ Copyright 2011 Jeremy Bridon - See License.txt for info
+ 
+ This source file is developed and maintained by:
+ + Jeremy Bridon jbridon@cores2.com
+ 
+ File: PathBench.h/cpp
+ Desc: Headless benchmark and regression suite of path planning,
+ run as "Dwarfcraft --pathbench <results.json> [seed ...]". Builds a
+ set of worlds: some generated (see WorldGenerator) from fixed seeds,
+ or from the given ones; synthetic mazes; and terraced worlds only
+ climbable by half-block stairs (exercising the step up and down
+ rules). Each world gets the same walkability map, path graph, flow
+ field cache and slicer as in the game, then a fixed batch of queries
+ is run through EntityPath, one at a time, as each kind of request the
+ game makes: a single sink searched by the path service, the same sink
+ searched in slices on this thread (see PathSlicer), the nearest of a
+ few sinks, and the nearest space of a volume (one of a few per world,
+ as stockpiles are, so their flow fields get reused; see PathField).
+ 
+ Every path is checked against a reference Dijkstra search (steps
+ all cost the same, so a breadth-first walk over the blocks, not the
+ walkability map): it must be solved exactly when the sink can be
+ reached, go from the source to a sink with every step valid, and
+ be no shorter than the shortest one. Its length is compared to the
+ shortest one (paths over the path graph may be a bit longer).
+ 
+ Results are written as JSON, so planner performance can be tracked
+ across changes: per world and kind of request, the p50 / p99 latency
+ of each request (and the frames it took, if sliced), the nodes it
+ visited, and how many paths were optimal; and per world, the memory
+ used by the planner's structures. The run fails if any path is wrong.
+ 
+***************************************************************/
+
+// Inclusion guard
+#ifndef __PATHBENCH_H__
+#define __PATHBENCH_H__
+
+#include "EntityPath.h"
+#include <stdio.h>
+
+// Number of queries run in each world; half of them are given sinks known to be reachable
+static const int PathBench_QueryCount = 200;
+
+// Size of all worlds (the same as the default world), and of their chunks
+static const int PathBench_WorldWidth = 128;
+static const int PathBench_WorldHeight = 64;
+static const int PathBench_ChunkSize = 16;
+
+// Number of each kind of synthetic world
+static const int PathBench_MazeCount = 2;
+static const int PathBench_StairsCount = 2;
+
+// Number of sinks of each nearest sink request, and of volumes per world
+static const int PathBench_SinkCount = 4;
+static const int PathBench_VolumeCount = 4;
+
+// Half the width (in x and z) and half the height of volumes, around their center
+static const int PathBench_VolumeRadius = 2;
+static const int PathBench_VolumeHalfHeight = 1;
+
+// Kinds of requests run for every query
+enum PathBench_Kind
+{
+    PathBench_Kind_Path = 0,    // A single sink, searched by the path service
+    PathBench_Kind_Sliced,      // The same sink, searched in slices on this thread
+    PathBench_Kind_Nearest,     // The nearest of a few sinks (the first being the same sink)
+    PathBench_Kind_Volume,      // The nearest space of a volume
+};
+static const int PathBench_KindCount = 4;
+static const char PathBench_KindNames[PathBench_KindCount][16] =
+{
+    "path",
+    "sliced",
+    "nearest",
+    "volume",
+};
+
+// Results of one kind of request in one world
+struct PathBench_Stats
+{
+    // Queries run, those the reference search could solve, and those the planner did
+    int QueryCount, ReachableCount, SolvedCount;
+    
+    // Paths solved when they shouldn't (or the other way around), and those with a step that can't be taken, not
+    // ending at a sink, or shorter than the reference
+    int MismatchCount, InvalidCount;
+    
+    // Paths as short as the reference, the most steps any path had over it, and the average ratio of steps to the reference's
+    int OptimalCount, MaxExtraSteps;
+    float MeanStretch;
+    
+    // Latency of requests in milliseconds, nodes they visited, and frames they took (only if sliced)
+    float LatencyP50, LatencyP99, LatencyMax, LatencyMean;
+    int NodesP50, NodesP99, NodesMax;
+    float NodesMean;
+    int FramesP50, FramesP99, FramesMax;
+};
+
+// Results of one world's queries
+struct PathBench_Result
+{
+    // Results of each kind of request
+    PathBench_Stats Requests[PathBench_KindCount];
+    
+    // Mean nodes visited by the reference search (all of the source's reachable spaces)
+    float ReferenceNodesMean;
+    
+    // Time to build the walkability map and path graph, in milliseconds
+    float WalkMapTime, GraphTime;
+    
+    // Bytes used by a search state, the walkability map and the path graph
+    int SearchBytes, WalkMapBytes, GraphBytes;
+};
+
+class PathBench
+{
+public:
+    
+    // Prepare a benchmark writing its results to the given file
+    PathBench(const char* FileName);
+    ~PathBench();
+    
+    // Run all worlds: one generated per given seed (the default seeds if none are given), then all synthetic
+    // worlds; returns false if the results couldn't be written, or any path was wrong
+    bool Run(const char** Seeds, int SeedCount);
+    
+protected:
+    
+    // Fill the given (all air) world with a maze of one-block corridors, from the given seed
+    void GenerateMaze(WorldContainer* WorldData, unsigned int Seed);
+    
+    // Fill the given (all air) world with terraces a block apart, joined by a few half-block stairs, from the given seed
+    void GenerateStairs(WorldContainer* WorldData, unsigned int Seed);
+    
+    // Run all queries on the given world and write its results; returns false if any path was wrong
+    bool RunWorld(const char* Name, WorldContainer* WorldData, unsigned int Seed);
+    
+    // Walk from the source over all reachable spaces (the reference search); returns the number of spaces reached
+    int Walk(WorldContainer* WorldData, Vector3<int> Source);
+    
+    // Steps of the last walk (from the given source) to the nearest space of the given volume (global, inclusive), or -1 if none was reached
+    int FindSteps(Vector3<int> Source, Vector3<int> Min, Vector3<int> Max);
+    
+    // Pick a random space of the given world (on the surface of a random column), or a random space reached by the last walk
+    bool PickSpace(WorldContainer* WorldData, UtilRand* Random, Vector3<int>* SpaceOut);
+    Vector3<int> PickReached(UtilRand* Random);
+    
+    // Returns true if the given path (source on top) starts at the source, steps from each space to the next, and ends within
+    // the given volume (global, inclusive; the sink itself if a single one)
+    bool IsValid(WorldContainer* WorldData, Stack< Vector3<int> >* Path, Vector3<int> Source, Vector3<int> Min, Vector3<int> Max);
+    
+    // Write a world's results
+    void WriteResult(const char* Name, WorldContainer* WorldData, PathBench_Result* Result);
+    
+    // Block index of a position, and back
+    inline int GetIndex(Vector3<int> Pos);
+    inline Vector3<int> GetPosition(int Index);
+    
+private:
+    
+    // Results file, and true once any world was written
+    FILE* Output;
+    bool IsFirstWorld;
+    
+    // Reference walk: steps to each space (-1 if not reached), and the spaces reached in order
+    int* Distances;
+    int* Reached;
+    int ReachedCount;
+};
+
+// End of inclusion guard
+#endif
@@ -0,0 +1,582 @@
+/***************************************************************
+ 
+ DwarfCraft - Dwarf Fortress / Minecraft clone
+ Copyright 2011 Jeremy Bridon - See License.txt for info
+ 
+ This source file is developed and maintained by:
+ + Jeremy Bridon jbridon@cores2.com
+ 
+***************************************************************/
+
+#include "PathField.h"
+#include "PathWalkMap.h"
+
+// Internal: all caches (so paths can find the cache of their world), and the release counter; also guards all fields' users
+static List<PathFieldCache*> __PathField_Caches;
+static pthread_mutex_t __PathField_CachesLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t __PathField_Released = PTHREAD_COND_INITIALIZER;
+static unsigned int __PathField_ReleaseCount = 0;
+
+PathField::PathField(WorldContainer* WorldData, Vector3<int> Min, Vector3<int> Max)
+{
+    // Save world and sizes
+    this->WorldData = WorldData;
+    WorldWidth = WorldData->GetWorldWidth();
+    WorldHeight = WorldData->GetWorldHeight();
+    ColumnWidth = WorldData->GetColumnWidth();
+    ChunkCount = WorldWidth / ColumnWidth;
+    
+    // Save the destination, and how far from it the field may reach (full height)
+    this->Min = Min;
+    this->Max = Max;
+    RangeMin = Vector3<int>(max(Min.x - PathField_MaxSteps, 0), 0, max(Min.z - PathField_MaxSteps, 0));
+    RangeMax = Vector3<int>(min(Max.x + PathField_MaxSteps, WorldWidth - 1), WorldHeight - 1, min(Max.z + PathField_MaxSteps, WorldWidth - 1));
+    
+    // No chunk reached yet
+    Distances = new unsigned short*[ChunkCount * ChunkCount];
+    DirtyChunks = new PathField_Chunk[ChunkCount * ChunkCount];
+    for(int i = 0; i < ChunkCount * ChunkCount; i++)
+    {
+        Distances[i] = NULL;
+        DirtyChunks[i].IsDirty = false;
+    }
+    ReachedMin = RangeMin;
+    ReachedMax = RangeMax;
+    
+    // Steps are looked up in the world's walkability map, if it has one, for as long as the field exists
+    WalkMap = PathWalkMap::Acquire(WorldData);
+    
+    // Computed on first use
+    pthread_rwlock_init(&FieldLock, NULL);
+    pthread_mutex_init(&DirtyLock, NULL);
+    IsDirty = true;
+    WatchMin = RangeMin;
+    WatchMax = RangeMax;
+    
+    UserCount = 0;
+    LastUse = 0;
+    BuildCount = 0;
+}
+
+PathField::~PathField()
+{
+    for(int i = 0; i < ChunkCount * ChunkCount; i++)
+        delete[] Distances[i];
+    delete[] Distances;
+    delete[] DirtyChunks;
+    if(WalkMap != NULL)
+        WalkMap->Release();
+    
+    pthread_rwlock_destroy(&FieldLock);
+    pthread_mutex_destroy(&DirtyLock);
+}
+
+bool PathField::FindPath(Vector3<int> Source, Stack< Vector3<int> >* PathOut)
+{
+    // Bring the field up to date, then keep it as-is while following it
+    Update();
+    pthread_rwlock_rdlock(&FieldLock);
+    
+    // Ignore if not reached
+    int Distance = FindDistance(Source);
+    if(Distance < 0)
+    {
+        pthread_rwlock_unlock(&FieldLock);
+        return false;
+    }
+    
+    // Step down the field, one step closer each time
+    Vector3<int>* Path = new Vector3<int>[Distance + 1];
+    Path[0] = Source;
+    bool Solved = true;
+    for(int i = 1; i <= Distance && Solved; i++)
+        Solved = FindNext(Path[i - 1], &Path[i]);
+    pthread_rwlock_unlock(&FieldLock);
+    
+    // Push from the destination back, so the source ends up on top
+    if(Solved)
+    {
+        for(int i = Distance; i >= 0; i--)
+            PathOut->Push(Path[i]);
+    }
+    
+    delete[] Path;
+    return Solved;
+}
+
+bool PathField::GetNext(Vector3<int> Pos, Vector3<int>* NextOut)
+{
+    Update();
+    pthread_rwlock_rdlock(&FieldLock);
+    bool Found = FindNext(Pos, NextOut);
+    pthread_rwlock_unlock(&FieldLock);
+    return Found;
+}
+
+int PathField::GetDistance(Vector3<int> Pos)
+{
+    Update();
+    pthread_rwlock_rdlock(&FieldLock);
+    int Distance = FindDistance(Pos);
+    pthread_rwlock_unlock(&FieldLock);
+    return Distance;
+}
+
+bool PathField::IsInRange(Vector3<int> Pos)
+{
+    return Pos.x >= RangeMin.x && Pos.x <= RangeMax.x && Pos.y >= RangeMin.y && Pos.y <= RangeMax.y && Pos.z >= RangeMin.z && Pos.z <= RangeMax.z;
+}
+
+void PathField::BlocksChanged(Vector3<int> Min, Vector3<int> Max)
+{
+    // Changed blocks change the steps of the spaces around them, which matter if they step into (or from) a space reached
+    PathWalkMap::GetDependentVolume(Min, Max, &Min, &Max);
+    pthread_mutex_lock(&DirtyLock);
+    if(Max.x + 1 < WatchMin.x || Min.x - 1 > WatchMax.x || Max.z + 1 < WatchMin.z || Min.z - 1 > WatchMax.z)
+    {
+        pthread_mutex_unlock(&DirtyLock);
+        return;
+    }
+    
+    // Clip to the world
+    Min = Vector3<int>(max(Min.x, 0), max(Min.y, 0), max(Min.z, 0));
+    Max = Vector3<int>(min(Max.x, WorldWidth - 1), min(Max.y, WorldHeight - 1), min(Max.z, WorldWidth - 1));
+
+    // Flag the chunk of every space whose steps changed, growing its area
+    for(int z = Min.z / ColumnWidth; z <= Max.z / ColumnWidth; z++)
+    for(int x = Min.x / ColumnWidth; x <= Max.x / ColumnWidth; x++)
+    {
+        Vector3<int> ChunkMin(max(Min.x, x * ColumnWidth), Min.y, max(Min.z, z * ColumnWidth));
+        Vector3<int> ChunkMax(min(Max.x, x * ColumnWidth + ColumnWidth - 1), Max.y, min(Max.z, z * ColumnWidth + ColumnWidth - 1));
+        
+        PathField_Chunk& Chunk = DirtyChunks[z * ChunkCount + x];
+        if(!Chunk.IsDirty)
+        {
+            Chunk.DirtyMin = ChunkMin;
+            Chunk.DirtyMax = ChunkMax;
+        }
+        else
+        {
+            Chunk.DirtyMin = Vector3<int>(min(Chunk.DirtyMin.x, ChunkMin.x), min(Chunk.DirtyMin.y, ChunkMin.y), min(Chunk.DirtyMin.z, ChunkMin.z));
+            Chunk.DirtyMax = Vector3<int>(max(Chunk.DirtyMax.x, ChunkMax.x), max(Chunk.DirtyMax.y, ChunkMax.y), max(Chunk.DirtyMax.z, ChunkMax.z));
+        }
+        Chunk.IsDirty = true;
+        IsDirty = true;
+    }
+    pthread_mutex_unlock(&DirtyLock);
+}
+
+void PathField::Update()
+{
+    // Ignore if up to date
+    pthread_mutex_lock(&DirtyLock);
+    bool WasDirty = IsDirty;
+    pthread_mutex_unlock(&DirtyLock);
+    if(!WasDirty)
+        return;
+    
+    // Take the flags only once nothing reads the field, so no lookup sees it half-computed
+    pthread_rwlock_wrlock(&FieldLock);
+    pthread_mutex_lock(&DirtyLock);
+    WasDirty = IsDirty;
+    IsDirty = false;
+    
+    int TotalCount = ChunkCount * ChunkCount;
+    PathField_Chunk* Changed = new PathField_Chunk[TotalCount];
+    for(int i = 0; i < TotalCount; i++)
+    {
+        Changed[i] = DirtyChunks[i];
+        DirtyChunks[i].IsDirty = false;
+    }
+    
+    // Changes made meanwhile may be near any space the field ends up reaching
+    WatchMin = RangeMin;
+    WatchMax = RangeMax;
+    pthread_mutex_unlock(&DirtyLock);
+    
+    // Computed in whole the first time, then only where changed
+    if(WasDirty && BuildCount <= 0)
+        Compute();
+    else if(WasDirty)
+        ComputeChunks(Changed);
+    delete[] Changed;
+    
+    // From now on, only watch around the spaces reached
+    pthread_mutex_lock(&DirtyLock);
+    WatchMin = ReachedMin;
+    WatchMax = ReachedMax;
+    pthread_mutex_unlock(&DirtyLock);
+    pthread_rwlock_unlock(&FieldLock);
+}
+
+int PathField::GetBuildCount()
+{
+    return BuildCount;
+}
+
+void PathField::Compute()
+{
+    // Forget all distances (keeping the chunks allocated), and the area reached
+    ReachedMin = Vector3<int>(WorldWidth, 0, WorldWidth);
+    ReachedMax = Vector3<int>(-1, WorldHeight - 1, -1);
+    
+    int SpaceCount = ColumnWidth * ColumnWidth * WorldHeight;
+    for(int i = 0; i < ChunkCount * ChunkCount; i++)
+    {
+        if(Distances[i] != NULL)
+        {
+            for(int j = 0; j < SpaceCount; j++)
+                Distances[i][j] = PathField_Unreached;
+        }
+    }
+    
+    // Start from every space of the destination
+    Queue< Vector3<int> > Open;
+    for(int y = max(Min.y, 0); y <= min(Max.y, WorldHeight - 1); y++)
+    for(int z = max(Min.z, 0); z <= min(Max.z, WorldWidth - 1); z++)
+    for(int x = max(Min.x, 0); x <= min(Max.x, WorldWidth - 1); x++)
+    {
+        Vector3<int> Pos(x, y, z);
+        if(PathWalkMap::IsSpace(WalkMap, WorldData, Pos))
+        {
+            SetDistance(Pos, 0);
+            Open.Enqueue(Pos);
+        }
+    }
+    
+    // Walk backwards: open every space that steps into the current one
+    while(!Open.IsEmpty())
+    {
+        Vector3<int> Pos = Open.Dequeue();
+        int Distance = FindDistance(Pos);
+        if(Distance >= PathField_MaxSteps)
+            continue;
+        
+        Vector3<int> Previous[PathField_MaxPrevious];
+        int PreviousCount = FindPrevious(Pos, Previous);
+        for(int i = 0; i < PreviousCount; i++)
+        {
+            if(!IsInRange(Previous[i]) || FindDistance(Previous[i]) >= 0)
+                continue;
+            
+            SetDistance(Previous[i], Distance + 1);
+            Open.Enqueue(Previous[i]);
+        }
+    }
+    
+    BuildCount++;
+}
+
+void PathField::ComputeChunks(const PathField_Chunk* Changed)
+{
+    // Spaces to walk from, by distance, so both passes below go nearest first
+    Queue< Vector3<int> >* Open = new Queue< Vector3<int> >[PathField_MaxSteps + 1];
+    Queue< Vector3<int> > Forgotten;
+    
+    // Forget the distances of all spaces whose steps may have changed
+    for(int i = 0; i < ChunkCount * ChunkCount; i++)
+    {
+        if(!Changed[i].IsDirty || Distances[i] == NULL)
+            continue;
+        
+        for(int y = Changed[i].DirtyMin.y; y <= Changed[i].DirtyMax.y; y++)
+        for(int z = Changed[i].DirtyMin.z; z <= Changed[i].DirtyMax.z; z++)
+        for(int x = Changed[i].DirtyMin.x; x <= Changed[i].DirtyMax.x; x++)
+        {
+            Vector3<int> Pos(x, y, z);
+            int Distance = FindDistance(Pos);
+            if(Distance < 0)
+                continue;
+            
+            Open[Distance].Enqueue(Pos);
+            SetDistance(Pos, PathField_Unreached);
+        }
+    }
+    
+    // Then forget every space left with no step one closer (i.e. all of its steps went through forgotten spaces)
+    for(int Distance = 0; Distance <= PathField_MaxSteps; Distance++)
+    {
+        while(!Open[Distance].IsEmpty())
+        {
+            Vector3<int> Previous[PathField_MaxPrevious];
+            int PreviousCount = FindPrevious(Open[Distance].Dequeue(), Previous);
+            for(int i = 0; i < PreviousCount; i++)
+            {
+                if(FindDistance(Previous[i]) != Distance + 1 || FindStepDistance(Previous[i]) == Distance + 1)
+                    continue;
+                
+                SetDistance(Previous[i], PathField_Unreached);
+                Open[Distance + 1].Enqueue(Previous[i]);
+                Forgotten.Enqueue(Previous[i]);
+            }
+        }
+    }
+    
+    // Start again from every space left without a distance (changed or forgotten) that is next to one with
+    for(int i = 0; i < ChunkCount * ChunkCount; i++)
+    {
+        if(!Changed[i].IsDirty)
+            continue;
+        
+        for(int y = Changed[i].DirtyMin.y; y <= Changed[i].DirtyMax.y; y++)
+        for(int z = Changed[i].DirtyMin.z; z <= Changed[i].DirtyMax.z; z++)
+        for(int x = Changed[i].DirtyMin.x; x <= Changed[i].DirtyMax.x; x++)
+            Reopen(Vector3<int>(x, y, z), Open);
+    }
+    while(!Forgotten.IsEmpty())
+        Reopen(Forgotten.Dequeue(), Open);
+    
+    // Walk backwards as Compute() does, also lowering spaces now closer than they were
+    for(int Distance = 0; Distance <= PathField_MaxSteps; Distance++)
+    {
+        while(!Open[Distance].IsEmpty())
+        {
+            // Skip spaces lowered since queued
+            Vector3<int> Pos = Open[Distance].Dequeue();
+            if(FindDistance(Pos) != Distance || Distance >= PathField_MaxSteps)
+                continue;
+            
+            Vector3<int> Previous[PathField_MaxPrevious];
+            int PreviousCount = FindPrevious(Pos, Previous);
+            for(int i = 0; i < PreviousCount; i++)
+            {
+                int PreviousDistance = FindDistance(Previous[i]);
+                if(!IsInRange(Previous[i]) || (PreviousDistance >= 0 && PreviousDistance <= Distance + 1))
+                    continue;
+                
+                SetDistance(Previous[i], Distance + 1);
+                Open[Distance + 1].Enqueue(Previous[i]);
+            }
+        }
+    }
+    
+    delete[] Open;
+    BuildCount++;
+}
+
+void PathField::Reopen(Vector3<int> Pos, Queue< Vector3<int> >* Open)
+{
+    // Ignore if not a space, or already done
+    if(!IsInRange(Pos) || !PathWalkMap::IsSpace(WalkMap, WorldData, Pos) || FindDistance(Pos) >= 0)
+        return;
+    
+    // Spaces of the destination start over from none, the others from their closest step
+    int Distance = FindStepDistance(Pos);
+    if(Pos.x >= Min.x && Pos.x <= Max.x && Pos.y >= Min.y && Pos.y <= Max.y && Pos.z >= Min.z && Pos.z <= Max.z)
+        Distance = 0;
+    if(Distance < 0 || Distance > PathField_MaxSteps)
+        return;
+    
+    SetDistance(Pos, Distance);
+    Open[Distance].Enqueue(Pos);
+}
+
+int PathField::FindPrevious(Vector3<int> Pos, Vector3<int>* PreviousOut)
+{
+    // A step in a direction may go up or down by one
+    int PreviousCount = 0;
+    for(int Direction = 0; Direction < EntityPath_MaxAdjacent; Direction++)
+    {
+        for(int j = -1; j <= 1; j++)
+        {
+            Vector3<int> Previous(Pos.x - EntityPath_OffsetX[Direction], Pos.y + j, Pos.z - EntityPath_OffsetZ[Direction]);
+            
+            Vector3<int> Step;
+            if(PathWalkMap::IsSpace(WalkMap, WorldData, Previous) && PathWalkMap::GetStep(WalkMap, WorldData, Previous, Direction, &Step) && Step == Pos)
+                PreviousOut[PreviousCount++] = Previous;
+        }
+    }
+    return PreviousCount;
+}
+
+int PathField::FindStepDistance(Vector3<int> Pos)
+{
+    int Closest = -1;
+    for(int Direction = 0; Direction < EntityPath_MaxAdjacent; Direction++)
+    {
+        Vector3<int> Next;
+        if(!PathWalkMap::GetStep(WalkMap, WorldData, Pos, Direction, &Next))
+            continue;
+        
+        int Distance = FindDistance(Next);
+        if(Distance >= 0 && (Closest < 0 || Distance + 1 < Closest))
+            Closest = Distance + 1;
+    }
+    return Closest;
+}
+
+bool PathField::FindNext(Vector3<int> Pos, Vector3<int>* NextOut)
+{
+    // Any step one closer will do
+    int Distance = FindDistance(Pos);
+    if(Distance <= 0)
+        return false;
+    
+    for(int Direction = 0; Direction < EntityPath_MaxAdjacent; Direction++)
+    {
+        if(PathWalkMap::GetStep(WalkMap, WorldData, Pos, Direction, NextOut) && FindDistance(*NextOut) == Distance - 1)
+            return true;
+    }
+    return false;
+}
+
+int PathField::FindDistance(Vector3<int> Pos)
+{
+    // Ignore if out of the world, or in a chunk never reached
+    if(!WorldData->IsWithinWorld(Pos))
+        return -1;
+    
+    unsigned short* ChunkDistances = Distances[(Pos.z / ColumnWidth) * ChunkCount + Pos.x / ColumnWidth];
+    if(ChunkDistances == NULL)
+        return -1;
+    
+    unsigned short Distance = ChunkDistances[(Pos.y * ColumnWidth + Pos.z % ColumnWidth) * ColumnWidth + Pos.x % ColumnWidth];
+    return (Distance == PathField_Unreached) ? -1 : int(Distance);
+}
+
+void PathField::SetDistance(Vector3<int> Pos, int Distance)
+{
+    // Allocate the chunk when first reached
+    unsigned short*& ChunkDistances = Distances[(Pos.z / ColumnWidth) * ChunkCount + Pos.x / ColumnWidth];
+    if(ChunkDistances == NULL)
+    {
+        int SpaceCount = ColumnWidth * ColumnWidth * WorldHeight;
+        ChunkDistances = new unsigned short[SpaceCount];
+        for(int i = 0; i < SpaceCount; i++)
+            ChunkDistances[i] = PathField_Unreached;
+    }
+    
+    ChunkDistances[(Pos.y * ColumnWidth + Pos.z % ColumnWidth) * ColumnWidth + Pos.x % ColumnWidth] = (unsigned short)Distance;
+    
+    ReachedMin.x = min(ReachedMin.x, Pos.x);
+    ReachedMin.z = min(ReachedMin.z, Pos.z);
+    ReachedMax.x = max(ReachedMax.x, Pos.x);
+    ReachedMax.z = max(ReachedMax.z, Pos.z);
+}
+
+PathFieldCache::PathFieldCache(WorldContainer* WorldData)
+{
+    // Listen to block changes
+    this->WorldData = WorldData;
+    WorldData->AddListener(this);
+    
+    // Register, so paths in this world find their fields
+    pthread_mutex_lock(&__PathField_CachesLock);
+    int CacheCount = __PathField_Caches.GetSize();
+    __PathField_Caches.Resize(CacheCount + 1);
+    __PathField_Caches[CacheCount] = this;
+    pthread_mutex_unlock(&__PathField_CachesLock);
+}
+
+PathFieldCache::~PathFieldCache()
+{
+    // No new paths may use this cache; wait for all fields in use to be released
+    pthread_mutex_lock(&__PathField_CachesLock);
+    for(int i = 0; i < __PathField_Caches.GetSize(); i++)
+    {
+        if(__PathField_Caches[i] == this)
+        {
+            __PathField_Caches.Remove(i);
+            break;
+        }
+    }
+    
+    for(int i = 0; i < Fields.GetSize(); i++)
+    {
+        while(Fields[i]->UserCount > 0)
+            pthread_cond_wait(&__PathField_Released, &__PathField_CachesLock);
+    }
+    pthread_mutex_unlock(&__PathField_CachesLock);
+    
+    // Stop listening, and release all fields
+    WorldData->RemoveListener(this);
+    for(int i = 0; i < Fields.GetSize(); i++)
+        delete Fields[i];
+}
+
+PathField* PathFieldCache::Acquire(WorldContainer* WorldData, Vector3<int> Min, Vector3<int> Max)
+{
+    pthread_mutex_lock(&__PathField_CachesLock);
+    
+    // Find the cache of this world
+    PathFieldCache* Cache = NULL;
+    for(int i = 0; i < __PathField_Caches.GetSize() && Cache == NULL; i++)
+    {
+        if(__PathField_Caches[i]->WorldData == WorldData)
+            Cache = __PathField_Caches[i];
+    }
+    if(Cache == NULL)
+    {
+        pthread_mutex_unlock(&__PathField_CachesLock);
+        return NULL;
+    }
+    
+    // Find the field of this destination
+    PathField* Field = NULL;
+    for(int i = 0; i < Cache->Fields.GetSize() && Field == NULL; i++)
+    {
+        PathField* Cached = Cache->Fields[i];
+        if(Cached->Min == Min && Cached->Max == Max)
+            Field = Cached;
+    }
+    
+    // Else, create it, dropping the least recently used unused fields beyond the limit
+    if(Field == NULL)
+    {
+        int UnusedCount = 0;
+        for(int i = 0; i < Cache->Fields.GetSize(); i++)
+        {
+            if(Cache->Fields[i]->UserCount <= 0)
+                UnusedCount++;
+        }
+        
+        while(UnusedCount >= PathField_MaxCached)
+        {
+            int Oldest = -1;
+            for(int i = 0; i < Cache->Fields.GetSize(); i++)
+            {
+                if(Cache->Fields[i]->UserCount <= 0 && (Oldest < 0 || Cache->Fields[i]->LastUse < Cache->Fields[Oldest]->LastUse))
+                    Oldest = i;
+            }
+            
+            delete Cache->Fields[Oldest];
+            Cache->Fields.Remove(Oldest);
+            UnusedCount--;
+        }
+        
+        Field = new PathField(WorldData, Min, Max);
+        int FieldCount = Cache->Fields.GetSize();
+        Cache->Fields.Resize(FieldCount + 1);
+        Cache->Fields[FieldCount] = Field;
+    }
+    
+    Field->UserCount++;
+    pthread_mutex_unlock(&__PathField_CachesLock);
+    return Field;
+}
+
+void PathFieldCache::Release(PathField* Field)
+{
+    pthread_mutex_lock(&__PathField_CachesLock);
+    Field->UserCount--;
+    Field->LastUse = ++__PathField_ReleaseCount;
+    pthread_cond_broadcast(&__PathField_Released);
+    pthread_mutex_unlock(&__PathField_CachesLock);
+}
+
+void PathFieldCache::BlocksChanged(Vector3<int> Min, Vector3<int> Max)
+{
+    // Fields may be added or dropped by other threads meanwhile
+    pthread_mutex_lock(&__PathField_CachesLock);
+    for(int i = 0; i < Fields.GetSize(); i++)
+        Fields[i]->BlocksChanged(Min, Max);
+    pthread_mutex_unlock(&__PathField_CachesLock);
+}
+
+int PathFieldCache::GetFieldCount()
+{
+    pthread_mutex_lock(&__PathField_CachesLock);
+    int FieldCount = Fields.GetSize();
+    pthread_mutex_unlock(&__PathField_CachesLock);
+    return FieldCount;
+}
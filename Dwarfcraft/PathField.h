@@ -0,0 +1,188 @@
+/***************************************************************
+ 
+ DwarfCraft - Dwarf Fortress / Minecraft clone
+ Copyright 2011 Jeremy Bridon - See License.txt for info
+ 
+ This source file is developed and maintained by:
+ + Jeremy Bridon jbridon@cores2.com
+ 
+ File: PathField.h/cpp
+ Desc: Flow fields towards shared destinations, such as stockpiles,
+ the meeting hall zone or a designation volume. A field holds, for
+ every space around the destination, its steps to the nearest space
+ within the destination; computed once by a breadth-first walk going
+ backwards from the destination. Entities heading there just step
+ into any adjacent space one step closer, so any number of them can
+ share a single field instead of each running its own search.
+ 
+ Fields only reach as far as PathField_MaxSteps from their
+ destination (searches from further away are done as usual), and
+ their distances are only allocated chunk by chunk, as reached.
+ 
+ The fields of a world are kept in its cache (PathFieldCache), which
+ is the one listening to block changes. A field ignores changes away
+ from the spaces it actually reached; else it flags the changed chunks
+ and, on next use, only recomputes their spaces and those whose steps
+ went through them (spaces made closer by the change are lowered as
+ the walk goes back out). Unused fields stay cached (up to
+ PathField_MaxCached of them) as entities tend to head to the same
+ places over and over.
+ 
+***************************************************************/
+
+// Inclusion guard
+#ifndef __PATHFIELD_H__
+#define __PATHFIELD_H__
+
+#include "EntityPath.h"
+#include "List.h"
+
+// Furthest steps a field reaches from its destination
+static const int PathField_MaxSteps = 256;
+
+// Max number of unused fields kept per world
+static const int PathField_MaxCached = 8;
+
+// Distance of spaces not reached by a field
+static const unsigned short PathField_Unreached = 0xFFFF;
+
+// Most spaces with a step into a given one (a step in each direction may go up or down by one)
+static const int PathField_MaxPrevious = EntityPath_MaxAdjacent * 3;
+
+// Changes to a chunk since its distances were last computed
+struct PathField_Chunk
+{
+    // True if blocks changed, and the area of the spaces whose steps may have changed (global, inclusive)
+    bool IsDirty;
+    Vector3<int> DirtyMin, DirtyMax;
+};
+
+class PathField
+{
+public:
+    
+    // A field towards all spaces within the given volume (global, inclusive); computed on first use
+    PathField(WorldContainer* WorldData, Vector3<int> Min, Vector3<int> Max);
+    ~PathField();
+    
+    // Find a path from the source to the nearest space of the destination, by following the field; on
+    // success, the path is pushed from the destination back to the source (so the source is on top)
+    // and returns true. Returns false if the source isn't reached by the field
+    bool FindPath(Vector3<int> Source, Stack< Vector3<int> >* PathOut);
+    
+    // Get the space one step closer to the destination; returns false if there is none
+    bool GetNext(Vector3<int> Pos, Vector3<int>* NextOut);
+    
+    // Get the steps from the given space to the destination, or -1 if not reached
+    int GetDistance(Vector3<int> Pos);
+    
+    // Returns true if the given position is close enough to the destination to be reached at all
+    bool IsInRange(Vector3<int> Pos);
+    
+    // Flag the chunks of the given volume (global, inclusive) for recomputing, if near any space reached
+    void BlocksChanged(Vector3<int> Min, Vector3<int> Max);
+    
+    // Recompute now if flagged (done anyway before each use)
+    void Update();
+    
+    // Number of times this field was computed, in whole or in part
+    int GetBuildCount();
+    
+protected:
+    
+    // Walk back from the destination, writing the steps to every space reached
+    void Compute();
+    
+    // Recompute the changed spaces of the given chunks, and all those whose steps went through them
+    void ComputeChunks(const PathField_Chunk* Changed);
+    
+    // Give a space left without a distance (changed, or forgotten) its closest step's, and queue it by distance
+    void Reopen(Vector3<int> Pos, Queue< Vector3<int> >* Open);
+    
+    // Get the spaces with a step into the given one; returns their count (at most PathField_MaxPrevious)
+    int FindPrevious(Vector3<int> Pos, Vector3<int>* PreviousOut);
+    
+    // Get the steps to the destination through the closest adjacent space, or -1 if none is reached
+    int FindStepDistance(Vector3<int> Pos);
+    
+    // Same as GetNext(...) and GetDistance(...), not locking the field
+    bool FindNext(Vector3<int> Pos, Vector3<int>* NextOut);
+    int FindDistance(Vector3<int> Pos);
+    
+    // Set the distance of a space, allocating its chunk's distances as needed (and growing the area reached)
+    void SetDistance(Vector3<int> Pos, int Distance);
+    
+private:
+    
+    // The cache finds and counts users of its fields
+    friend class PathFieldCache;
+    
+    // World data handle and short-hand sizes
+    WorldContainer* WorldData;
+    int WorldWidth, WorldHeight, ColumnWidth, ChunkCount;
+    
+    // Walkability map of the world (NULL if it has none), held until the field is released
+    PathWalkMap* WalkMap;
+    
+    // Destination volume, and the volume within reach (both global, inclusive)
+    Vector3<int> Min, Max;
+    Vector3<int> RangeMin, RangeMax;
+    
+    // Steps of each space of each chunk to the destination, as [(y * ColumnWidth + z) * ColumnWidth + x]
+    // (local to the chunk); NULL for chunks never reached
+    unsigned short** Distances;
+    
+    // Lookups hold the read lock; computing holds the write lock
+    pthread_rwlock_t FieldLock;
+    
+    // Area of all spaces ever reached (global, inclusive; x and z only) since last computed in whole
+    Vector3<int> ReachedMin, ReachedMax;
+    
+    // Lock of the flags set when blocks near the area reached changed: any chunk, and each chunk
+    pthread_mutex_t DirtyLock;
+    bool IsDirty;
+    PathField_Chunk* DirtyChunks;
+    
+    // Area watched for changes (the area reached, or the whole range while computing), under the dirty lock
+    Vector3<int> WatchMin, WatchMax;
+    
+    // Number of users (see PathFieldCache::Acquire(...)) and when it was last released
+    int UserCount;
+    unsigned int LastUse;
+    
+    // Statistics
+    int BuildCount;
+};
+
+class PathFieldCache : public WorldContainer_Listener
+{
+public:
+    
+    // Keep the flow fields of the given world, and flag them as the world changes
+    PathFieldCache(WorldContainer* WorldData);
+    
+    // Stops listening, and waits for all fields to be released
+    ~PathFieldCache();
+    
+    // Get the shared field towards the given volume (global, inclusive) in the given world, creating it
+    // as needed; NULL if the world has no cache. Must be released once done
+    static PathField* Acquire(WorldContainer* WorldData, Vector3<int> Min, Vector3<int> Max);
+    static void Release(PathField* Field);
+    
+    // Flag all fields reaching the given volume (global, inclusive)
+    void BlocksChanged(Vector3<int> Min, Vector3<int> Max);
+    
+    // Number of fields currently cached (used or not)
+    int GetFieldCount();
+    
+private:
+    
+    // World data handle
+    WorldContainer* WorldData;
+    
+    // All fields of this world
+    List<PathField*> Fields;
+};
+
+// End of inclusion guard
+#endif
@@ -0,0 +1,1100 @@
+/***************************************************************
+ 
+ DwarfCraft - Dwarf Fortress / Minecraft clone
+ Copyright 2011 Jeremy Bridon - See License.txt for info
+ 
+ This source file is developed and maintained by:
+ + Jeremy Bridon jbridon@cores2.com
+ 
+***************************************************************/
+
+#include "PathGraph.h"
+#include "PathWalkMap.h"
+
+// Internal: all graphs, so searches can find the graph of their world
+static List<PathGraph*> __PathGraph_Graphs;
+static pthread_mutex_t __PathGraph_GraphsLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t __PathGraph_Released = PTHREAD_COND_INITIALIZER;
+
+// Internal: estimated steps between two spaces (same as EntityPath_Search)
+static inline int __PathGraph_GetEstimate(Vector3<int> A, Vector3<int> B)
+{
+    int Horizontal = abs(A.x - B.x) + abs(A.z - B.z);
+    int Vertical = abs(A.y - B.y);
+    return (Horizontal > Vertical) ? Horizontal : Vertical;
+}
+
+// Internal: find the root of the given element of a union-find set (halving the path along the way)
+static inline int __PathGraph_FindRoot(int* Parents, int Index)
+{
+    while(Parents[Index] != Index)
+    {
+        Parents[Index] = Parents[Parents[Index]];
+        Index = Parents[Index];
+    }
+    return Index;
+}
+
+// Internal: join the sets of both given elements; the root is always the lowest element of a set
+static inline void __PathGraph_Join(int* Parents, int A, int B)
+{
+    A = __PathGraph_FindRoot(Parents, A);
+    B = __PathGraph_FindRoot(Parents, B);
+    if(A < B)
+        Parents[B] = A;
+    else if(B < A)
+        Parents[A] = B;
+}
+
+// Internal: returns true if open heap entry A should be visited before B
+static inline bool __PathGraph_IsBefore(const PathGraph_HeapEntry& A, const PathGraph_HeapEntry& B)
+{
+    return A.Total < B.Total || (A.Total == B.Total && A.Estimate < B.Estimate);
+}
+
+PathGraph::PathGraph(WorldContainer* WorldData)
+{
+    // Save world and sizes
+    this->WorldData = WorldData;
+    WorldWidth = WorldData->GetWorldWidth();
+    WorldHeight = WorldData->GetWorldHeight();
+    ColumnWidth = WorldData->GetColumnWidth();
+    ChunkCount = WorldWidth / ColumnWidth;
+    
+    // Allocate all chunks and borders, all empty
+    Chunks = new PathGraph_Chunk[ChunkCount * ChunkCount];
+    for(int i = 0; i < ChunkCount * ChunkCount; i++)
+    {
+        Chunks[i].NodeCount = 0;
+        Chunks[i].Nodes = NULL;
+        Chunks[i].Costs = NULL;
+        Chunks[i].Regions = NULL;
+        Chunks[i].RegionCount = 0;
+        Chunks[i].IsDirty = false;
+    }
+    Borders = new PathGraph_Border[ChunkCount * ChunkCount * 2];
+    for(int i = 0; i < ChunkCount * ChunkCount * 2; i++)
+    {
+        Borders[i].Transitions = NULL;
+        Borders[i].TransitionCount = 0;
+    }
+    
+    // Scratch buffers; distances are always left at -1 (unreached) between walks
+    int SpaceCount = ColumnWidth * ColumnWidth * WorldHeight;
+    BuildDistances = new int[SpaceCount];
+    BuildQueue = new int[SpaceCount];
+    BuildParents = new int[SpaceCount];
+    SourceDistances = new int[SpaceCount];
+    SinkDistances = new int[SpaceCount];
+    SourceQueue = new int[SpaceCount];
+    SinkQueue = new int[SpaceCount];
+    for(int i = 0; i < SpaceCount; i++)
+        BuildDistances[i] = SourceDistances[i] = SinkDistances[i] = -1;
+    
+    // No nodes yet; start with small search buffers, grown as needed
+    ChunkFirstNode = new int[ChunkCount * ChunkCount + 1];
+    NodeChunks = NULL;
+    ChunkFirstRegion = new int[ChunkCount * ChunkCount + 1];
+    RegionLabels = NULL;
+    RegionCapacity = 0;
+    StateCapacity = 0;
+    States = NULL;
+    Generation = 0;
+    HeapCapacity = 1024;
+    HeapCount = 0;
+    Heap = new PathGraph_HeapEntry[HeapCapacity];
+    
+    // Locks
+    pthread_rwlock_init(&GraphLock, NULL);
+    pthread_mutex_init(&DirtyLock, NULL);
+    pthread_mutex_init(&SearchLock, NULL);
+    IsDirty = false;
+    UserCount = 0;
+    
+    // No stats yet
+    NodeCount = 0;
+    RebuildCount = 0;
+    VisitedCount = 0;
+    
+    // Steps are looked up in the world's walkability map, if it has one, for as long as the graph exists
+    WalkMap = PathWalkMap::Acquire(WorldData);
+    
+    // Build all borders, then all chunks from them
+    for(int z = 0; z < ChunkCount; z++)
+    for(int x = 0; x < ChunkCount; x++)
+    {
+        BuildBorder(x, z, 0);
+        BuildBorder(x, z, 1);
+    }
+    for(int z = 0; z < ChunkCount; z++)
+    for(int x = 0; x < ChunkCount; x++)
+        BuildChunk(x, z);
+    IndexNodes();
+    JoinRegions();
+    
+    // Keep up to date, and make this graph available to searches
+    WorldData->AddListener(this);
+    
+    pthread_mutex_lock(&__PathGraph_GraphsLock);
+    int GraphCount = __PathGraph_Graphs.GetSize();
+    __PathGraph_Graphs.Resize(GraphCount + 1);
+    __PathGraph_Graphs[GraphCount] = this;
+    pthread_mutex_unlock(&__PathGraph_GraphsLock);
+}
+
+PathGraph::~PathGraph()
+{
+    // No new searches may start on this graph; wait for those running to be done
+    pthread_mutex_lock(&__PathGraph_GraphsLock);
+    for(int i = 0; i < __PathGraph_Graphs.GetSize(); i++)
+    {
+        if(__PathGraph_Graphs[i] == this)
+        {
+            __PathGraph_Graphs.Remove(i);
+            break;
+        }
+    }
+    while(UserCount > 0)
+        pthread_cond_wait(&__PathGraph_Released, &__PathGraph_GraphsLock);
+    pthread_mutex_unlock(&__PathGraph_GraphsLock);
+    
+    // Stop listening
+    WorldData->RemoveListener(this);
+    if(WalkMap != NULL)
+        WalkMap->Release();
+    
+    // Release all chunks and borders
+    for(int i = 0; i < ChunkCount * ChunkCount; i++)
+    {
+        delete[] Chunks[i].Nodes;
+        delete[] Chunks[i].Costs;
+        delete[] Chunks[i].Regions;
+    }
+    delete[] Chunks;
+    for(int i = 0; i < ChunkCount * ChunkCount * 2; i++)
+        delete[] Borders[i].Transitions;
+    delete[] Borders;
+    
+    // Release buffers
+    delete[] BuildDistances;
+    delete[] BuildQueue;
+    delete[] BuildParents;
+    delete[] SourceDistances;
+    delete[] SinkDistances;
+    delete[] SourceQueue;
+    delete[] SinkQueue;
+    delete[] ChunkFirstNode;
+    delete[] NodeChunks;
+    delete[] ChunkFirstRegion;
+    delete[] RegionLabels;
+    delete[] States;
+    delete[] Heap;
+    
+    // Release locks
+    pthread_rwlock_destroy(&GraphLock);
+    pthread_mutex_destroy(&DirtyLock);
+    pthread_mutex_destroy(&SearchLock);
+}
+
+PathGraph* PathGraph::Acquire(WorldContainer* WorldData)
+{
+    PathGraph* Graph = NULL;
+    pthread_mutex_lock(&__PathGraph_GraphsLock);
+    for(int i = 0; i < __PathGraph_Graphs.GetSize() && Graph == NULL; i++)
+    {
+        if(__PathGraph_Graphs[i]->WorldData == WorldData)
+        {
+            Graph = __PathGraph_Graphs[i];
+            Graph->UserCount++;
+        }
+    }
+    pthread_mutex_unlock(&__PathGraph_GraphsLock);
+    return Graph;
+}
+
+void PathGraph::Release()
+{
+    pthread_mutex_lock(&__PathGraph_GraphsLock);
+    UserCount--;
+    pthread_cond_broadcast(&__PathGraph_Released);
+    pthread_mutex_unlock(&__PathGraph_GraphsLock);
+}
+
+bool PathGraph::FindPath(Vector3<int> Source, Vector3<int> Sink, Stack< Vector3<int> >* PathOut, EntityPath_Search* Search, const volatile bool* IsCancelled, float MaxTime)
+{
+    // Ignore if either end is out of the world
+    VisitedCount = 0;
+    if(!WorldData->IsWithinWorld(Source) || !WorldData->IsWithinWorld(Sink))
+        return false;
+    
+    // Start the internal timer (measures real-time, not thread-time, elapsed)
+    UtilHighresClock SearchClock(true);
+    
+    // Bring the graph up to date, then keep it as-is during the search
+    Update();
+    pthread_rwlock_rdlock(&GraphLock);
+    
+    // Never search between different regions
+    int SourceRegion = FindRegion(Source);
+    int SinkRegion = FindRegion(Sink);
+    if(SourceRegion >= 0 && SinkRegion >= 0 && SourceRegion != SinkRegion)
+    {
+        pthread_rwlock_unlock(&GraphLock);
+        return false;
+    }
+    
+    // Within a single chunk, or starting off a space (which the graph can't link in), just search directly
+    int SourceX = Source.x / ColumnWidth, SourceZ = Source.z / ColumnWidth;
+    int SinkX = Sink.x / ColumnWidth, SinkZ = Sink.z / ColumnWidth;
+    if((SourceX == SinkX && SourceZ == SinkZ) || SourceRegion < 0)
+    {
+        pthread_rwlock_unlock(&GraphLock);
+        return Search->FindPath(Source, Sink, PathOut, IsCancelled, MaxTime);
+    }
+    
+    /*** Abstract Search ***/
+    
+    pthread_mutex_lock(&SearchLock);
+    
+    // Walk the source's chunk from the source; the sink's chunk is walked (towards the sink) once reached
+    PathGraph_Chunk* SourceChunk = &Chunks[SourceZ * ChunkCount + SourceX];
+    int SourceReached = Walk(SourceX, SourceZ, Source, false, SourceDistances, SourceQueue);
+    int SinkReached = 0;
+    bool SinkWalked = false;
+    
+    // New generation; on wrap-around, reset all stamps so no stale state looks current
+    Generation++;
+    if(Generation == 0)
+    {
+        for(int i = 0; i < StateCapacity; i++)
+            States[i].Stamp = 0;
+        Generation = 1;
+    }
+    
+    // Start from the source (numbered right after all nodes, then the sink)
+    int SourceNode = NodeCount, SinkNode = NodeCount + 1;
+    bool Solved = false;
+    HeapCount = 0;
+    Open(SourceNode, 0, -1, Sink);
+    
+    // Keep visiting the most promising node until the sink is reached
+    while(HeapCount > 0)
+    {
+        // Every so often, give up if cancelled or out of time
+        if(VisitedCount % EntityPath_CheckInterval == EntityPath_CheckInterval - 1)
+        {
+            if(IsCancelled != NULL && *IsCancelled)
+                break;
+            
+            SearchClock.Stop();
+            if(MaxTime > 0.0f && SearchClock.GetTime() > MaxTime)
+                break;
+        }
+        
+        // Pop the best entry; ignore if stale
+        PathGraph_HeapEntry Entry = Heap[0];
+        Heap[0] = Heap[--HeapCount];
+        for(int Index = 0; ; )
+        {
+            int Child = Index * 2 + 1;
+            if(Child >= HeapCount)
+                break;
+            if(Child + 1 < HeapCount && __PathGraph_IsBefore(Heap[Child + 1], Heap[Child]))
+                Child++;
+            if(!__PathGraph_IsBefore(Heap[Child], Heap[Index]))
+                break;
+            
+            PathGraph_HeapEntry Swap = Heap[Index];
+            Heap[Index] = Heap[Child];
+            Heap[Child] = Swap;
+            Index = Child;
+        }
+        
+        PathGraph_State* State = &States[Entry.Node];
+        if(State->IsVisited || Entry.Cost != State->Cost)
+            continue;
+        State->IsVisited = true;
+        VisitedCount++;
+        
+        // Done once the sink itself is visited
+        int Cost = State->Cost;
+        if(Entry.Node == SinkNode)
+        {
+            Solved = true;
+            break;
+        }
+        
+        // The source links to all nodes of its chunk it can walk to
+        if(Entry.Node == SourceNode)
+        {
+            int FirstNode = ChunkFirstNode[SourceZ * ChunkCount + SourceX];
+            for(int i = 0; i < SourceChunk->NodeCount; i++)
+            {
+                int Steps = SourceDistances[GetLocalIndex(SourceChunk->Nodes[i])];
+                if(Steps >= 0)
+                    Open(FirstNode + i, Steps, SourceNode, Sink);
+            }
+            continue;
+        }
+        
+        // Node's chunk, and the node within it
+        int ChunkIndex = NodeChunks[Entry.Node];
+        int FirstNode = ChunkFirstNode[ChunkIndex];
+        int Node = Entry.Node - FirstNode;
+        PathGraph_Chunk* Chunk = &Chunks[ChunkIndex];
+        int ChunkX = ChunkIndex % ChunkCount;
+        int ChunkZ = ChunkIndex / ChunkCount;
+        
+        // Link to all other nodes of the same chunk
+        int* Costs = &Chunk->Costs[Node * Chunk->NodeCount];
+        for(int i = 0; i < Chunk->NodeCount; i++)
+        {
+            if(i != Node && Costs[i] >= 0)
+                Open(FirstNode + i, Cost + Costs[i], Entry.Node, Sink);
+        }
+        
+        // Link to the node across the border, if the transition goes that way
+        int Side = 0;
+        while(Node >= Chunk->SideOffset[Side + 1])
+            Side++;
+        bool IsInside = false;
+        PathGraph_Border* Border = GetBorder(ChunkX, ChunkZ, Side, &IsInside);
+        PathGraph_Transition& Transition = Border->Transitions[Node - Chunk->SideOffset[Side]];
+        if(IsInside ? Transition.CanLeave : Transition.CanEnter)
+        {
+            int NextIndex = (ChunkZ + EntityPath_OffsetZ[Side]) * ChunkCount + (ChunkX + EntityPath_OffsetX[Side]);
+            int NextNode = Chunks[NextIndex].SideOffset[Side ^ 1] + (Node - Chunk->SideOffset[Side]);
+            Open(ChunkFirstNode[NextIndex] + NextNode, Cost + 1, Entry.Node, Sink);
+        }
+        
+        // Nodes of the sink's chunk link to the sink; walked once first reached
+        if(ChunkX == SinkX && ChunkZ == SinkZ)
+        {
+            if(!SinkWalked)
+            {
+                SinkReached = Walk(SinkX, SinkZ, Sink, true, SinkDistances, SinkQueue);
+                SinkWalked = true;
+            }
+            
+            int Steps = SinkDistances[GetLocalIndex(Chunk->Nodes[Node])];
+            if(Steps >= 0)
+                Open(SinkNode, Cost + Steps, Entry.Node, Sink);
+        }
+    }
+    
+    // Reset the walks
+    for(int i = 0; i < SourceReached; i++)
+        SourceDistances[SourceQueue[i]] = -1;
+    for(int i = 0; i < SinkReached; i++)
+        SinkDistances[SinkQueue[i]] = -1;
+    
+    // Back-trace the abstract path from the sink, so the source ends up on top
+    Stack< Vector3<int> > Waypoints;
+    if(Solved)
+    {
+        for(int Node = SinkNode; Node != SourceNode; Node = States[Node].Parent)
+            Waypoints.Push(GetNodePosition(Node, Sink));
+        Waypoints.Push(Source);
+    }
+    
+    pthread_mutex_unlock(&SearchLock);
+    
+    /*** Refine ***/
+    
+    // Search each leg; the full path is gathered from the source on, so the sink ends up on top
+    Stack< Vector3<int> > Path;
+    if(Solved)
+    {
+        Vector3<int> From = Waypoints.Pop();
+        Path.Push(From);
+        while(Solved && !Waypoints.IsEmpty())
+        {
+            // Ignore nodes that share a space
+            Vector3<int> To = Waypoints.Pop();
+            if(To == From)
+                continue;
+            
+            // Legs across a border are a single step
+            if(From.x / ColumnWidth != To.x / ColumnWidth || From.z / ColumnWidth != To.z / ColumnWidth)
+            {
+                Path.Push(To);
+                From = To;
+                continue;
+            }
+            
+            // Leg is pushed from To back to From, thus From is on top (and already in the path)
+            Stack< Vector3<int> > Leg;
+            Solved = Search->FindPath(From, To, &Leg, IsCancelled, MaxTime);
+            if(Solved)
+            {
+                Leg.Pop();
+                while(!Leg.IsEmpty())
+                    Path.Push(Leg.Pop());
+            }
+            From = To;
+        }
+    }
+    
+    pthread_rwlock_unlock(&GraphLock);
+    
+    // Reverse into the output, so the source is on top
+    if(Solved)
+    {
+        while(!Path.IsEmpty())
+            PathOut->Push(Path.Pop());
+    }
+    
+    return Solved;
+}
+
+void PathGraph::BlocksChanged(Vector3<int> Min, Vector3<int> Max)
+{
+    // Clamp to the world
+    int MinX = max(Min.x, 0) / ColumnWidth, MaxX = min(Max.x, WorldWidth - 1) / ColumnWidth;
+    int MinZ = max(Min.z, 0) / ColumnWidth, MaxZ = min(Max.z, WorldWidth - 1) / ColumnWidth;
+    
+    // Flag every touched chunk
+    pthread_mutex_lock(&DirtyLock);
+    for(int z = MinZ; z <= MaxZ; z++)
+    for(int x = MinX; x <= MaxX; x++)
+    {
+        Chunks[z * ChunkCount + x].IsDirty = true;
+        IsDirty = true;
+    }
+    pthread_mutex_unlock(&DirtyLock);
+}
+
+void PathGraph::Update()
+{
+    // Take all flagged chunks
+    pthread_mutex_lock(&DirtyLock);
+    if(!IsDirty)
+    {
+        pthread_mutex_unlock(&DirtyLock);
+        return;
+    }
+    
+    int TotalCount = ChunkCount * ChunkCount;
+    bool* IsChanged = new bool[TotalCount];
+    for(int i = 0; i < TotalCount; i++)
+    {
+        IsChanged[i] = Chunks[i].IsDirty;
+        Chunks[i].IsDirty = false;
+    }
+    IsDirty = false;
+    pthread_mutex_unlock(&DirtyLock);
+    
+    // No search may run during the rebuild
+    pthread_rwlock_wrlock(&GraphLock);
+    
+    // Rebuild all borders of the changed chunks (each only once); chunks whose border changed must be rebuilt too
+    bool* IsRebuilt = new bool[TotalCount];
+    bool* IsBorderBuilt = new bool[TotalCount * 2];
+    for(int i = 0; i < TotalCount; i++)
+        IsRebuilt[i] = IsChanged[i];
+    for(int i = 0; i < TotalCount * 2; i++)
+        IsBorderBuilt[i] = false;
+    
+    for(int i = 0; i < TotalCount; i++)
+    {
+        if(!IsChanged[i])
+            continue;
+        
+        for(int Side = 0; Side < EntityPath_MaxAdjacent; Side++)
+        {
+            // The border's own chunk (a border is owned by the chunk on its -x or -z side)
+            int x = i % ChunkCount, z = i / ChunkCount;
+            int Axis = (Side == EntityPath_Direction_PosX || Side == EntityPath_Direction_NegX) ? 0 : 1;
+            if(Side == EntityPath_Direction_NegX)
+                x--;
+            else if(Side == EntityPath_Direction_NegZ)
+                z--;
+            if(x < 0 || z < 0)
+                continue;
+            
+            int BorderIndex = (z * ChunkCount + x) * 2 + Axis;
+            if(IsBorderBuilt[BorderIndex])
+                continue;
+            IsBorderBuilt[BorderIndex] = true;
+            
+            // Both chunks of a changed border have different nodes
+            if(BuildBorder(x, z, Axis))
+            {
+                IsRebuilt[z * ChunkCount + x] = true;
+                if(Axis == 0 && x + 1 < ChunkCount)
+                    IsRebuilt[z * ChunkCount + x + 1] = true;
+                else if(Axis == 1 && z + 1 < ChunkCount)
+                    IsRebuilt[(z + 1) * ChunkCount + x] = true;
+            }
+        }
+    }
+    
+    // Rebuild all affected chunks
+    for(int i = 0; i < TotalCount; i++)
+    {
+        if(IsRebuilt[i])
+        {
+            BuildChunk(i % ChunkCount, i / ChunkCount);
+            RebuildCount++;
+        }
+    }
+    IndexNodes();
+    JoinRegions();
+    
+    pthread_rwlock_unlock(&GraphLock);
+    
+    delete[] IsChanged;
+    delete[] IsRebuilt;
+    delete[] IsBorderBuilt;
+}
+
+int PathGraph::GetNodeCount()
+{
+    return NodeCount;
+}
+
+int PathGraph::GetRebuildCount()
+{
+    return RebuildCount;
+}
+
+int PathGraph::GetVisitedCount()
+{
+    return VisitedCount;
+}
+
+int PathGraph::GetMemoryUsage()
+{
+    // Fixed buffers: chunks, borders, per-chunk offsets and the seven per-space scratch buffers
+    int TotalCount = ChunkCount * ChunkCount;
+    int SpaceCount = ColumnWidth * ColumnWidth * WorldHeight;
+    int Bytes = TotalCount * sizeof(PathGraph_Chunk) + TotalCount * 2 * sizeof(PathGraph_Border) + (TotalCount + 1) * 2 * sizeof(int);
+    Bytes += SpaceCount * 7 * sizeof(int);
+    
+    // Grown buffers
+    Bytes += StateCapacity * (sizeof(int) + sizeof(PathGraph_State)) + RegionCapacity * sizeof(int) + HeapCapacity * sizeof(PathGraph_HeapEntry);
+    
+    // Nodes, costs and regions of each chunk, and transitions of each border
+    pthread_rwlock_rdlock(&GraphLock);
+    for(int i = 0; i < TotalCount; i++)
+    {
+        Bytes += max(Chunks[i].NodeCount, 1) * sizeof(Vector3<int>) + max(Chunks[i].NodeCount * Chunks[i].NodeCount, 1) * sizeof(int);
+        if(Chunks[i].Regions != NULL)
+            Bytes += SpaceCount * sizeof(unsigned short);
+        for(int Axis = 0; Axis < 2; Axis++)
+            Bytes += Borders[i * 2 + Axis].TransitionCount * sizeof(PathGraph_Transition);
+    }
+    pthread_rwlock_unlock(&GraphLock);
+    return Bytes;
+}
+
+int PathGraph::GetRegion(Vector3<int> Pos)
+{
+    // Ignore if out of the world
+    if(!WorldData->IsWithinWorld(Pos))
+        return -1;
+    
+    Update();
+    pthread_rwlock_rdlock(&GraphLock);
+    int Region = FindRegion(Pos);
+    pthread_rwlock_unlock(&GraphLock);
+    return Region;
+}
+
+bool PathGraph::IsReachable(Vector3<int> Source, Vector3<int> Sink)
+{
+    Update();
+    return IsReachableBuilt(Source, Sink);
+}
+
+bool PathGraph::IsReachableBuilt(Vector3<int> Source, Vector3<int> Sink)
+{
+    // Nothing out of the world is ever reached
+    if(!WorldData->IsWithinWorld(Source) || !WorldData->IsWithinWorld(Sink))
+        return false;
+    
+    pthread_rwlock_rdlock(&GraphLock);
+    int SourceRegion = FindRegion(Source);
+    int SinkRegion = FindRegion(Sink);
+    pthread_rwlock_unlock(&GraphLock);
+    return SourceRegion < 0 || SinkRegion < 0 || SourceRegion == SinkRegion;
+}
+
+bool PathGraph::IsReachable(WorldContainer* WorldData, Vector3<int> Source, Vector3<int> Sink)
+{
+    // Without a graph, anything may be reachable
+    PathGraph* Graph = Acquire(WorldData);
+    if(Graph == NULL)
+        return true;
+    
+    bool Reachable = Graph->IsReachable(Source, Sink);
+    Graph->Release();
+    return Reachable;
+}
+
+bool PathGraph::BuildBorder(int ChunkX, int ChunkZ, int Axis)
+{
+    // Step across the border, and along it
+    int Direction = (Axis == 0) ? EntityPath_Direction_PosX : EntityPath_Direction_PosZ;
+    int Lateral = (Axis == 0) ? EntityPath_Direction_PosZ : EntityPath_Direction_PosX;
+    
+    // Nothing beyond the world's edge
+    int Span = ColumnWidth;
+    if((Axis == 0 ? ChunkX : ChunkZ) == ChunkCount - 1)
+        Span = 0;
+    
+    /*** Find Transitions ***/
+    
+    // All transitions, ordered along the border; FoundStart[t] is the first one at t
+    int FoundCapacity = 2 * Span * WorldHeight;
+    PathGraph_Transition* Found = new PathGraph_Transition[max(FoundCapacity, 1)];
+    int* FoundStart = new int[Span + 2];
+    int FoundCount = 0;
+    
+    for(int t = 0; t < Span; t++)
+    {
+        FoundStart[t] = FoundCount;
+        
+        // The pair of columns across the border at t
+        Vector3<int> Inside, Outside, Step;
+        if(Axis == 0)
+            Inside = Vector3<int>(ChunkX * ColumnWidth + ColumnWidth - 1, 0, ChunkZ * ColumnWidth + t);
+        else
+            Inside = Vector3<int>(ChunkX * ColumnWidth + t, 0, ChunkZ * ColumnWidth + ColumnWidth - 1);
+        Outside = Vector3<int>(Inside.x + EntityPath_OffsetX[Direction], 0, Inside.z + EntityPath_OffsetZ[Direction]);
+        
+        // Steps leaving the chunk
+        for(int y = 0; y < WorldHeight; y++)
+        {
+            Inside.y = y;
+            if(PathWalkMap::IsSpace(WalkMap, WorldData, Inside) && PathWalkMap::GetStep(WalkMap, WorldData, Inside, Direction, &Step))
+            {
+                PathGraph_Transition Transition = {Inside, Step, true, false};
+                Found[FoundCount++] = Transition;
+            }
+        }
+        
+        // Steps entering the chunk; merged with the matching step leaving it, if any
+        int LeaveCount = FoundCount;
+        for(int y = 0; y < WorldHeight; y++)
+        {
+            Outside.y = y;
+            if(!PathWalkMap::IsSpace(WalkMap, WorldData, Outside) || !PathWalkMap::GetStep(WalkMap, WorldData, Outside, Direction ^ 1, &Step))
+                continue;
+            
+            int Match = FoundStart[t];
+            while(Match < LeaveCount && !(Found[Match].Inside == Step && Found[Match].Outside == Outside))
+                Match++;
+            
+            if(Match < LeaveCount)
+                Found[Match].CanEnter = true;
+            else
+            {
+                PathGraph_Transition Transition = {Step, Outside, false, true};
+                Found[FoundCount++] = Transition;
+            }
+        }
+    }
+    FoundStart[Span] = FoundCount;
+    FoundStart[Span + 1] = FoundCount;
+    
+    /*** Group Entrances ***/
+    
+    // Group consecutive transitions going the same way, where entities can walk along
+    // the border (both ways) on both sides; only the middle one of each group is kept
+    bool* IsGrouped = new bool[max(FoundCount, 1)];
+    for(int i = 0; i < FoundCount; i++)
+        IsGrouped[i] = false;
+    int* Group = new int[max(Span, 1)];
+    PathGraph_Transition* Kept = new PathGraph_Transition[max(FoundCount, 1)];
+    int KeptCount = 0;
+    
+    for(int t = 0; t < Span; t++)
+    for(int i = FoundStart[t]; i < FoundStart[t + 1]; i++)
+    {
+        // Ignore if already part of a group
+        if(IsGrouped[i])
+            continue;
+        
+        // Grow the group along the border
+        int GroupCount = 0;
+        Group[GroupCount++] = i;
+        IsGrouped[i] = true;
+        for(int Last = i, LastT = t; LastT + 1 < Span; LastT++)
+        {
+            // Spaces next to the last transition, along the border
+            Vector3<int> NextInside, NextOutside, Back;
+            if(!PathWalkMap::GetStep(WalkMap, WorldData, Found[Last].Inside, Lateral, &NextInside) || !PathWalkMap::GetStep(WalkMap, WorldData, Found[Last].Outside, Lateral, &NextOutside))
+                break;
+            
+            // Must be a transition going the same way
+            int Next = FoundStart[LastT + 1];
+            while(Next < FoundStart[LastT + 2] && (IsGrouped[Next] || !(Found[Next].Inside == NextInside && Found[Next].Outside == NextOutside) || Found[Next].CanLeave != Found[Last].CanLeave || Found[Next].CanEnter != Found[Last].CanEnter))
+                Next++;
+            if(Next >= FoundStart[LastT + 2])
+                break;
+            
+            // Must be able to walk back, on both sides
+            if(!PathWalkMap::GetStep(WalkMap, WorldData, NextInside, Lateral ^ 1, &Back) || !(Back == Found[Last].Inside))
+                break;
+            if(!PathWalkMap::GetStep(WalkMap, WorldData, NextOutside, Lateral ^ 1, &Back) || !(Back == Found[Last].Outside))
+                break;
+            
+            Group[GroupCount++] = Next;
+            IsGrouped[Next] = true;
+            Last = Next;
+        }
+        
+        Kept[KeptCount++] = Found[Group[GroupCount / 2]];
+    }
+    
+    /*** Save ***/
+    
+    // Compare to the border as it was
+    PathGraph_Border* Border = &Borders[(ChunkZ * ChunkCount + ChunkX) * 2 + Axis];
+    bool Changed = (KeptCount != Border->TransitionCount);
+    for(int i = 0; i < KeptCount && !Changed; i++)
+    {
+        PathGraph_Transition& Old = Border->Transitions[i];
+        Changed = !(Old.Inside == Kept[i].Inside) || !(Old.Outside == Kept[i].Outside) || Old.CanLeave != Kept[i].CanLeave || Old.CanEnter != Kept[i].CanEnter;
+    }
+    
+    // Replace if changed
+    if(Changed)
+    {
+        delete[] Border->Transitions;
+        Border->Transitions = NULL;
+        Border->TransitionCount = KeptCount;
+        if(KeptCount > 0)
+        {
+            Border->Transitions = new PathGraph_Transition[KeptCount];
+            for(int i = 0; i < KeptCount; i++)
+                Border->Transitions[i] = Kept[i];
+        }
+    }
+    
+    delete[] Found;
+    delete[] FoundStart;
+    delete[] IsGrouped;
+    delete[] Group;
+    delete[] Kept;
+    return Changed;
+}
+
+void PathGraph::BuildChunk(int ChunkX, int ChunkZ)
+{
+    PathGraph_Chunk* Chunk = &Chunks[ChunkZ * ChunkCount + ChunkX];
+    
+    // Count the nodes of each side
+    PathGraph_Border* SideBorders[EntityPath_MaxAdjacent];
+    bool IsInside[EntityPath_MaxAdjacent];
+    int Count = 0;
+    for(int Side = 0; Side < EntityPath_MaxAdjacent; Side++)
+    {
+        Chunk->SideOffset[Side] = Count;
+        SideBorders[Side] = GetBorder(ChunkX, ChunkZ, Side, &IsInside[Side]);
+        if(SideBorders[Side] != NULL)
+            Count += SideBorders[Side]->TransitionCount;
+    }
+    Chunk->SideOffset[EntityPath_MaxAdjacent] = Count;
+    
+    // Release the old nodes and costs, and gather the new nodes (the space on this chunk's side)
+    NodeCount += Count - Chunk->NodeCount;
+    delete[] Chunk->Nodes;
+    delete[] Chunk->Costs;
+    Chunk->NodeCount = Count;
+    Chunk->Nodes = new Vector3<int>[max(Count, 1)];
+    Chunk->Costs = new int[max(Count * Count, 1)];
+    
+    for(int Side = 0; Side < EntityPath_MaxAdjacent; Side++)
+    {
+        for(int k = 0; SideBorders[Side] != NULL && k < SideBorders[Side]->TransitionCount; k++)
+        {
+            PathGraph_Transition& Transition = SideBorders[Side]->Transitions[k];
+            Chunk->Nodes[Chunk->SideOffset[Side] + k] = IsInside[Side] ? Transition.Inside : Transition.Outside;
+        }
+    }
+    
+    // Label regions first (needs no nodes)
+    BuildRegions(ChunkX, ChunkZ);
+    
+    // Walk from each node, saving the steps to all others
+    for(int i = 0; i < Count; i++)
+    {
+        int Reached = Walk(ChunkX, ChunkZ, Chunk->Nodes[i], false, BuildDistances, BuildQueue);
+        for(int j = 0; j < Count; j++)
+            Chunk->Costs[i * Count + j] = BuildDistances[GetLocalIndex(Chunk->Nodes[j])];
+        for(int j = 0; j < Reached; j++)
+            BuildDistances[BuildQueue[j]] = -1;
+    }
+}
+
+void PathGraph::BuildRegions(int ChunkX, int ChunkZ)
+{
+    // Allocate the labels on first use
+    PathGraph_Chunk* Chunk = &Chunks[ChunkZ * ChunkCount + ChunkX];
+    int SpaceCount = ColumnWidth * ColumnWidth * WorldHeight;
+    if(Chunk->Regions == NULL)
+        Chunk->Regions = new unsigned short[SpaceCount];
+    
+    // Each space starts as its own set; anything else is in none
+    for(int i = 0; i < SpaceCount; i++)
+        BuildParents[i] = PathWalkMap::IsSpace(WalkMap, WorldData, GetLocalPosition(ChunkX, ChunkZ, i)) ? i : -1;
+    
+    // Join each space with all spaces it steps into, within the chunk
+    for(int i = 0; i < SpaceCount; i++)
+    {
+        if(BuildParents[i] < 0)
+            continue;
+        
+        Vector3<int> Pos = GetLocalPosition(ChunkX, ChunkZ, i);
+        for(int Direction = 0; Direction < EntityPath_MaxAdjacent; Direction++)
+        {
+            Vector3<int> Next;
+            if(!PathWalkMap::GetStep(WalkMap, WorldData, Pos, Direction, &Next))
+                continue;
+            if(Next.x / ColumnWidth != ChunkX || Next.z / ColumnWidth != ChunkZ)
+                continue;
+            
+            int NextIndex = GetLocalIndex(Next);
+            if(BuildParents[NextIndex] >= 0)
+                __PathGraph_Join(BuildParents, i, NextIndex);
+        }
+    }
+    
+    // Number each set; roots are the lowest element of their set, thus always numbered first
+    int Count = 0;
+    for(int i = 0; i < SpaceCount; i++)
+    {
+        if(BuildParents[i] < 0)
+            Chunk->Regions[i] = 0;
+        else
+        {
+            int Root = __PathGraph_FindRoot(BuildParents, i);
+            Chunk->Regions[i] = (Root == i) ? (unsigned short)++Count : Chunk->Regions[Root];
+        }
+    }
+    UtilAssert(Count <= USHRT_MAX, "Too many regions in chunk (%d, %d).", ChunkX, ChunkZ);
+    Chunk->RegionCount = Count;
+}
+
+void PathGraph::IndexNodes()
+{
+    // Number nodes chunk by chunk
+    int TotalCount = ChunkCount * ChunkCount;
+    ChunkFirstNode[0] = 0;
+    for(int i = 0; i < TotalCount; i++)
+        ChunkFirstNode[i + 1] = ChunkFirstNode[i] + Chunks[i].NodeCount;
+    
+    // Grow the search states as needed (with room for the source and sink); new states are unstamped
+    if(NodeCount + 2 > StateCapacity)
+    {
+        delete[] NodeChunks;
+        delete[] States;
+        StateCapacity = max(NodeCount + 2, StateCapacity * 2);
+        NodeChunks = new int[StateCapacity];
+        States = new PathGraph_State[StateCapacity];
+        for(int i = 0; i < StateCapacity; i++)
+            States[i].Stamp = 0;
+    }
+    
+    // Chunk of each node
+    for(int i = 0; i < TotalCount; i++)
+    {
+        for(int j = ChunkFirstNode[i]; j < ChunkFirstNode[i + 1]; j++)
+            NodeChunks[j] = i;
+    }
+}
+
+void PathGraph::JoinRegions()
+{
+    // Number regions chunk by chunk
+    int TotalCount = ChunkCount * ChunkCount;
+    ChunkFirstRegion[0] = 0;
+    for(int i = 0; i < TotalCount; i++)
+        ChunkFirstRegion[i + 1] = ChunkFirstRegion[i] + Chunks[i].RegionCount;
+    
+    // Grow the labels as needed
+    int RegionCount = ChunkFirstRegion[TotalCount];
+    if(RegionCount > RegionCapacity)
+    {
+        delete[] RegionLabels;
+        RegionCapacity = max(RegionCount, RegionCapacity * 2);
+        RegionLabels = new int[RegionCapacity];
+    }
+    
+    // Each region starts as its own set
+    for(int i = 0; i < RegionCount; i++)
+        RegionLabels[i] = i;
+    
+    // Join the regions on both sides of each transition (only kept transitions are needed: all
+    // transitions of an entrance are joined to the kept one on both sides)
+    for(int i = 0; i < TotalCount * 2; i++)
+    {
+        for(int j = 0; j < Borders[i].TransitionCount; j++)
+        {
+            PathGraph_Transition& Transition = Borders[i].Transitions[j];
+            int InsideChunk = (Transition.Inside.z / ColumnWidth) * ChunkCount + Transition.Inside.x / ColumnWidth;
+            int OutsideChunk = (Transition.Outside.z / ColumnWidth) * ChunkCount + Transition.Outside.x / ColumnWidth;
+            int Inside = Chunks[InsideChunk].Regions[GetLocalIndex(Transition.Inside)];
+            int Outside = Chunks[OutsideChunk].Regions[GetLocalIndex(Transition.Outside)];
+            if(Inside > 0 && Outside > 0)
+                __PathGraph_Join(RegionLabels, ChunkFirstRegion[InsideChunk] + Inside - 1, ChunkFirstRegion[OutsideChunk] + Outside - 1);
+        }
+    }
+    
+    // Label each region by the root of its set
+    for(int i = 0; i < RegionCount; i++)
+        RegionLabels[i] = __PathGraph_FindRoot(RegionLabels, i);
+}
+
+int PathGraph::FindRegion(Vector3<int> Pos)
+{
+    int ChunkIndex = (Pos.z / ColumnWidth) * ChunkCount + Pos.x / ColumnWidth;
+    int Region = Chunks[ChunkIndex].Regions[GetLocalIndex(Pos)];
+    return (Region == 0) ? -1 : RegionLabels[ChunkFirstRegion[ChunkIndex] + Region - 1];
+}
+
+PathGraph_Border* PathGraph::GetBorder(int ChunkX, int ChunkZ, int Direction, bool* IsInside)
+{
+    // Chunks own their +x and +z borders; the -x and -z borders are owned by the neighbors
+    *IsInside = (Direction == EntityPath_Direction_PosX || Direction == EntityPath_Direction_PosZ);
+    int Axis = (Direction == EntityPath_Direction_PosX || Direction == EntityPath_Direction_NegX) ? 0 : 1;
+    if(!*IsInside)
+    {
+        ChunkX += EntityPath_OffsetX[Direction];
+        ChunkZ += EntityPath_OffsetZ[Direction];
+        if(ChunkX < 0 || ChunkZ < 0)
+            return NULL;
+    }
+    
+    return &Borders[(ChunkZ * ChunkCount + ChunkX) * 2 + Axis];
+}
+
+int PathGraph::Walk(int ChunkX, int ChunkZ, Vector3<int> Start, bool Reversed, int* Distances, int* WalkQueue)
+{
+    // Chunk bounds
+    int MinX = ChunkX * ColumnWidth, MaxX = MinX + ColumnWidth - 1;
+    int MinZ = ChunkZ * ColumnWidth, MaxZ = MinZ + ColumnWidth - 1;
+    
+    // Start at the given space
+    int QueueCount = 0;
+    int StartIndex = GetLocalIndex(Start);
+    Distances[StartIndex] = 0;
+    WalkQueue[QueueCount++] = StartIndex;
+    
+    for(int Head = 0; Head < QueueCount; Head++)
+    {
+        int Index = WalkQueue[Head];
+        Vector3<int> Pos = GetLocalPosition(ChunkX, ChunkZ, Index);
+        int Steps = Distances[Index] + 1;
+        
+        for(int Direction = 0; Direction < EntityPath_MaxAdjacent; Direction++)
+        {
+            // Forward: the space we step into, if within the chunk
+            if(!Reversed)
+            {
+                Vector3<int> Next;
+                if(!PathWalkMap::GetStep(WalkMap, WorldData, Pos, Direction, &Next))
+                    continue;
+                if(Next.x < MinX || Next.x > MaxX || Next.z < MinZ || Next.z > MaxZ)
+                    continue;
+                
+                int NextIndex = GetLocalIndex(Next);
+                if(Distances[NextIndex] < 0)
+                {
+                    Distances[NextIndex] = Steps;
+                    WalkQueue[QueueCount++] = NextIndex;
+                }
+            }
+            // Reversed: any space (within the chunk) that steps into this one
+            else
+            {
+                Vector3<int> Prev(Pos.x - EntityPath_OffsetX[Direction], 0, Pos.z - EntityPath_OffsetZ[Direction]);
+                if(Prev.x < MinX || Prev.x > MaxX || Prev.z < MinZ || Prev.z > MaxZ)
+                    continue;
+                
+                for(int j = -1; j <= 1; j++)
+                {
+                    Prev.y = Pos.y + j;
+                    if(Prev.y < 0 || Prev.y >= WorldHeight)
+                        continue;
+                    
+                    int PrevIndex = GetLocalIndex(Prev);
+                    Vector3<int> Step;
+                    if(Distances[PrevIndex] < 0 && PathWalkMap::IsSpace(WalkMap, WorldData, Prev) && PathWalkMap::GetStep(WalkMap, WorldData, Prev, Direction, &Step) && Step == Pos)
+                    {
+                        Distances[PrevIndex] = Steps;
+                        WalkQueue[QueueCount++] = PrevIndex;
+                    }
+                }
+            }
+        }
+    }
+    
+    return QueueCount;
+}
+
+inline int PathGraph::GetLocalIndex(Vector3<int> Pos)
+{
+    return (Pos.y * ColumnWidth + Pos.z % ColumnWidth) * ColumnWidth + Pos.x % ColumnWidth;
+}
+
+inline Vector3<int> PathGraph::GetLocalPosition(int ChunkX, int ChunkZ, int LocalIndex)
+{
+    return Vector3<int>(ChunkX * ColumnWidth + LocalIndex % ColumnWidth, LocalIndex / (ColumnWidth * ColumnWidth), ChunkZ * ColumnWidth + (LocalIndex / ColumnWidth) % ColumnWidth);
+}
+
+void PathGraph::Open(int Node, int Cost, int Parent, Vector3<int> Sink)
+{
+    // First seen by this search: nothing known yet
+    PathGraph_State& State = States[Node];
+    if(State.Stamp != Generation)
+    {
+        State.Stamp = Generation;
+        State.Cost = INT_MAX;
+        State.IsVisited = false;
+    }
+    
+    // Ignore if already visited, or no better than before
+    if(State.IsVisited || Cost >= State.Cost)
+        return;
+    State.Cost = Cost;
+    State.Parent = Parent;
+    
+    // Grow the heap as needed
+    if(HeapCount >= HeapCapacity)
+    {
+        PathGraph_HeapEntry* NewHeap = new PathGraph_HeapEntry[HeapCapacity * 2];
+        memcpy(NewHeap, Heap, sizeof(PathGraph_HeapEntry) * HeapCount);
+        delete[] Heap;
+        Heap = NewHeap;
+        HeapCapacity *= 2;
+    }
+    
+    // Push a new entry (any older entry of this node becomes stale)
+    PathGraph_HeapEntry Entry;
+    Entry.Node = Node;
+    Entry.Cost = Cost;
+    Entry.Estimate = __PathGraph_GetEstimate(GetNodePosition(Node, Sink), Sink);
+    Entry.Total = Cost + Entry.Estimate;
+    
+    int HeapIndex = HeapCount++;
+    while(HeapIndex > 0)
+    {
+        int ParentIndex = (HeapIndex - 1) / 2;
+        if(!__PathGraph_IsBefore(Entry, Heap[ParentIndex]))
+            break;
+        Heap[HeapIndex] = Heap[ParentIndex];
+        HeapIndex = ParentIndex;
+    }
+    Heap[HeapIndex] = Entry;
+}
+
+inline Vector3<int> PathGraph::GetNodePosition(int Node, Vector3<int> Sink)
+{
+    // The source is never looked up (it is never estimated, and always the top of the path)
+    if(Node >= NodeCount)
+        return Sink;
+    return Chunks[NodeChunks[Node]].Nodes[Node - ChunkFirstNode[NodeChunks[Node]]];
+}
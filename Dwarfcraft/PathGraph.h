@@ -0,0 +1,241 @@
+/***************************************************************
+ 
+ DwarfCraft - Dwarf Fortress / Minecraft clone
+ Copyright 2011 Jeremy Bridon - See License.txt for info
+ 
+ This source file is developed and maintained by:
+ + Jeremy Bridon jbridon@cores2.com
+ 
+ File: PathGraph.h/cpp
+ Desc: Hierarchical path-planning (HPA*) over the world's chunks.
+ Each chunk (a full-height column) is a cluster; wherever entities
+ can step from one chunk into the next, the border has a transition
+ (one space on each side). Consecutive transitions that entities can
+ also walk along, on both sides, form a single entrance, of which
+ only the middle transition is kept. The spaces of all kept
+ transitions are the nodes of an abstract graph: within a chunk,
+ nodes are linked by their precomputed walking cost inside of that
+ chunk, and across a border by a single step.
+ 
+ Long-range searches run A* on the abstract graph (with the source
+ and sink linked into their own chunks by a local search), then
+ refine each leg of the abstract path with a short regular search
+ (see EntityPath_Search). Paths found this way are always valid, but
+ may be slightly longer than the shortest path.
+ 
+ When blocks change, only the changed chunks are flagged; before the
+ next search, their borders and costs are rebuilt. A neighbor chunk
+ is only rebuilt if the border it shares with a changed chunk did
+ change.
+ 
+ All spaces are also labeled by region: two spaces are in the same
+ region if entities can step from one to the other, one way or the
+ other, through any number of spaces. Spaces of different regions
+ can never reach each other, which rejects such searches right away.
+ Regions are labeled within each chunk as it is built, then joined
+ across all kept transitions.
+ 
+***************************************************************/
+
+// Inclusion guard
+#ifndef __PATHGRAPH_H__
+#define __PATHGRAPH_H__
+
+#include "EntityPath.h"
+
+// A step across a chunk border: the space on the border's own chunk side (inside), the
+// space on the next chunk's side (outside), and which way entities may step
+struct PathGraph_Transition
+{
+    Vector3<int> Inside, Outside;
+    bool CanLeave, CanEnter;
+};
+
+// All kept transitions of a chunk border
+struct PathGraph_Border
+{
+    PathGraph_Transition* Transitions;
+    int TransitionCount;
+};
+
+// A chunk's abstract nodes and the walking costs between them
+struct PathGraph_Chunk
+{
+    // Nodes, grouped by side (in the order of EntityPath_Direction): node SideOffset[i] + k
+    // is the space, on this chunk's side, of transition k of the border on side i
+    int NodeCount;
+    Vector3<int>* Nodes;
+    int SideOffset[EntityPath_MaxAdjacent + 1];
+    
+    // Steps from node i to node j as Costs[i * NodeCount + j], within this chunk; -1 if unreachable
+    int* Costs;
+    
+    // Region of each space within this chunk (by local index), from 1 to RegionCount; 0 if not a space
+    unsigned short* Regions;
+    int RegionCount;
+    
+    // True if blocks changed since last built
+    bool IsDirty;
+};
+
+// The abstract search state of a node (or of the source / sink), only meaningful if stamped by
+// the current search: its steps from the source, the node it came from, and if visited
+struct PathGraph_State
+{
+    unsigned int Stamp;
+    int Cost;
+    int Parent;
+    bool IsVisited;
+};
+
+// An entry of the abstract search's open heap; may be stale (the node has since improved)
+struct PathGraph_HeapEntry
+{
+    int Node;
+    int Cost;
+    int Total;
+    int Estimate;
+};
+
+class PathGraph : public WorldContainer_Listener
+{
+public:
+    
+    // Build the graph of the whole world, and keep it up to date as the world changes
+    // Searches of paths in this world use the graph as long as it exists
+    PathGraph(WorldContainer* WorldData);
+    
+    // Stops listening, and waits for all searches using this graph to be done
+    ~PathGraph();
+    
+    // Get the graph of the given world, or NULL if it has none; must be released once done
+    static PathGraph* Acquire(WorldContainer* WorldData);
+    void Release();
+    
+    // Find a path from the source to the sink; on success, the path is pushed from the sink
+    // back to the source (so the source is on top) and returns true. The given search is
+    // used to refine the path, and for searches within a single chunk
+    // Gives up (returns false) once the given flag is set, or after the given time (if positive) in seconds
+    bool FindPath(Vector3<int> Source, Vector3<int> Sink, Stack< Vector3<int> >* PathOut, EntityPath_Search* Search, const volatile bool* IsCancelled = NULL, float MaxTime = 0.0f);
+    
+    // Flag all chunks touching the given volume (global, inclusive) for rebuilding
+    void BlocksChanged(Vector3<int> Min, Vector3<int> Max);
+    
+    // Rebuild all flagged chunks now (done anyway before each search)
+    void Update();
+    
+    // Total number of abstract nodes, and of chunks rebuilt since creation (on top of the first build)
+    int GetNodeCount();
+    int GetRebuildCount();
+    
+    // Number of abstract nodes visited by the last search
+    int GetVisitedCount();
+    
+    // Bytes allocated by this graph (chunks, borders, and build and search buffers)
+    int GetMemoryUsage();
+    
+    // Get the region of the given space, or -1 if it isn't a space
+    int GetRegion(Vector3<int> Pos);
+    
+    // Returns false if the sink surely can't be reached from the source (i.e. they are in different
+    // regions); true otherwise, or if either end isn't a space (which may still be reachable)
+    bool IsReachable(Vector3<int> Source, Vector3<int> Sink);
+    
+    // Same as IsReachable(...), but only reads the graph as last built (flagged chunks aren't rebuilt); for callers
+    // holding locks of their own, which should call Update() before taking them
+    bool IsReachableBuilt(Vector3<int> Source, Vector3<int> Sink);
+    
+    // Same as IsReachable(...), on the graph of the given world (always true if it has none)
+    static bool IsReachable(WorldContainer* WorldData, Vector3<int> Source, Vector3<int> Sink);
+    
+protected:
+    
+    // Scan the given border (the +x or +z side of the given chunk) for transitions; returns true if they changed
+    bool BuildBorder(int ChunkX, int ChunkZ, int Axis);
+    
+    // Gather the nodes of the given chunk from its borders, then compute all costs between them and its regions
+    void BuildChunk(int ChunkX, int ChunkZ);
+    
+    // Label the regions of the given chunk on its own (see PathGraph_Chunk::Regions)
+    void BuildRegions(int ChunkX, int ChunkZ);
+    
+    // Get the border on the given side of a chunk (NULL at the world's edge), and if the chunk is on its inside
+    PathGraph_Border* GetBorder(int ChunkX, int ChunkZ, int Direction, bool* IsInside);
+    
+    // Breadth-first walk within the given chunk from (or, reversed, towards) the given space; the steps
+    // of every reached space are written to Distances (by local index, which must all start at -1), and
+    // the local index of every reached space to WalkQueue; returns the number of reached spaces
+    int Walk(int ChunkX, int ChunkZ, Vector3<int> Start, bool Reversed, int* Distances, int* WalkQueue);
+    
+    // Local index of a space within its chunk, and back to the space (given the chunk)
+    inline int GetLocalIndex(Vector3<int> Pos);
+    inline Vector3<int> GetLocalPosition(int ChunkX, int ChunkZ, int LocalIndex);
+    
+    // Number all nodes, chunk by chunk, once chunks are rebuilt (growing the search states as needed)
+    void IndexNodes();
+    
+    // Join the regions of all chunks across their borders, once chunks are rebuilt
+    void JoinRegions();
+    
+    // Get the region of a space (not locking the graph); -1 if it isn't a space
+    int FindRegion(Vector3<int> Pos);
+    
+    // Abstract search helpers: open (or improve) a node, and get a node's space (the sink's beyond the last node)
+    void Open(int Node, int Cost, int Parent, Vector3<int> Sink);
+    inline Vector3<int> GetNodePosition(int Node, Vector3<int> Sink);
+    
+private:
+    
+    // World data handle and short-hand sizes
+    WorldContainer* WorldData;
+    int WorldWidth, WorldHeight, ColumnWidth, ChunkCount;
+    
+    // Walkability map of the world (NULL if it has none), held until the graph is released
+    PathWalkMap* WalkMap;
+    
+    // Chunks, and their +x and +z borders, as [(z * ChunkCount + x) * 2 + Axis]
+    PathGraph_Chunk* Chunks;
+    PathGraph_Border* Borders;
+    
+    // Number of the first node of each chunk (and the total), and the chunk of each node
+    int* ChunkFirstNode;
+    int* NodeChunks;
+    
+    // Number of the first region of each chunk (and the total), and the label of each region
+    // (regions of different chunks joined across borders share the same label)
+    int* ChunkFirstRegion;
+    int* RegionLabels;
+    int RegionCapacity;
+    
+    // Searches hold the read lock; rebuilds hold the write lock
+    pthread_rwlock_t GraphLock;
+    
+    // Lock of the dirty flags and of the flag set when any chunk is dirty
+    pthread_mutex_t DirtyLock;
+    bool IsDirty;
+    
+    // Number of searches currently using this graph (see Acquire(...))
+    int UserCount;
+    
+    // Build scratch buffers: per-space distances and walk queue
+    int* BuildDistances;
+    int* BuildQueue;
+    int* BuildParents;
+    
+    // Abstract search buffers: source and sink walks, a state per node (then the source and
+    // sink), and the open heap; only used by one search at a time (see SearchLock)
+    pthread_mutex_t SearchLock;
+    int *SourceDistances, *SinkDistances;
+    int *SourceQueue, *SinkQueue;
+    PathGraph_State* States;
+    int StateCapacity;
+    unsigned int Generation;
+    PathGraph_HeapEntry* Heap;
+    int HeapCount, HeapCapacity;
+    
+    // Statistics
+    int NodeCount, RebuildCount, VisitedCount;
+};
+
+// End of inclusion guard
+#endif
@@ -0,0 +1,665 @@
+/***************************************************************
+ 
+ DwarfCraft - Dwarf Fortress / Minecraft clone
+ Copyright 2011 Jeremy Bridon - See License.txt for info
+ 
+ This source file is developed and maintained by:
+ + Jeremy Bridon jbridon@cores2.com
+ 
+***************************************************************/
+
+#include "PathRepair.h"
+#include "PathGraph.h"
+#include "PathWalkMap.h"
+
+// Internal: all lists (so repairs can find the list of their world); also guards all repairs' changes
+static List<PathRepairList*> __PathRepair_Lists;
+static pthread_mutex_t __PathRepair_Lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Internal: estimated steps between two spaces (see EntityPath_Search::GetEstimate(...))
+static inline int __PathRepair_GetEstimate(Vector3<int> A, Vector3<int> B)
+{
+    int Horizontal = abs(A.x - B.x) + abs(A.z - B.z);
+    int Vertical = abs(A.y - B.y);
+    return (Horizontal > Vertical) ? Horizontal : Vertical;
+}
+
+// Internal: returns true if the first key is lower than the second
+static inline bool __PathRepair_IsLower(int Key, int SubKey, int OtherKey, int OtherSubKey)
+{
+    return Key < OtherKey || (Key == OtherKey && SubKey < OtherSubKey);
+}
+
+// Internal: returns true if there is a step from one space to the next
+static bool __PathRepair_IsStep(PathWalkMap* WalkMap, WorldContainer* WorldData, Vector3<int> Pos, Vector3<int> Next)
+{
+    Vector3<int> Step;
+    for(int Direction = 0; Direction < EntityPath_MaxAdjacent; Direction++)
+    {
+        if(PathWalkMap::GetStep(WalkMap, WorldData, Pos, Direction, &Step) && Step == Next)
+            return true;
+    }
+    return false;
+}
+
+PathRepair::PathRepair(WorldContainer* WorldData, Vector3<int> Source, Stack< Vector3<int> >* Path)
+{
+    // Save world and sizes
+    this->WorldData = WorldData;
+    WorldWidth = WorldData->GetWorldWidth();
+    WorldHeight = WorldData->GetWorldHeight();
+    
+    // The destination is the path's end (the bottom of the stack)
+    Stack< Vector3<int> > Steps = *Path;
+    Sink = Source;
+    while(!Steps.IsEmpty())
+        Sink = Steps.Pop();
+    
+    // Nothing searched yet
+    this->Source = LastSource = Source;
+    KeyOffset = 0;
+    IsSearched = false;
+    IsUnfinished = false;
+    
+    StateCount = 0;
+    StateCapacity = 256;
+    States = new PathRepair_State[StateCapacity];
+    BucketCapacity = 512;
+    Buckets = new int[BucketCapacity];
+    for(int i = 0; i < BucketCapacity; i++)
+        Buckets[i] = 0;
+    
+    HeapCount = 0;
+    HeapCapacity = 256;
+    Heap = new PathRepair_HeapEntry[HeapCapacity];
+    
+    RepairCount = 0;
+    WalkMap = NULL;
+    
+    // Start watching (nothing else is using this repair yet)
+    Watch(Source, Path);
+    PathRepairList::Add(this, WorldData);
+}
+
+PathRepair::~PathRepair()
+{
+    PathRepairList::Remove(this, WorldData);
+    
+    delete[] States;
+    delete[] Buckets;
+    delete[] Heap;
+}
+
+bool PathRepair::IsChanged()
+{
+    pthread_mutex_lock(&__PathRepair_Lock);
+    bool Changed = Changes.GetSize() > 0;
+    pthread_mutex_unlock(&__PathRepair_Lock);
+    return Changed;
+}
+
+bool PathRepair::IsRepairing()
+{
+    return IsUnfinished;
+}
+
+bool PathRepair::Repair(Vector3<int> Source, Stack< Vector3<int> >* Path)
+{
+    // Look steps up in the world's walkability map (if it has one) while repairing
+    WalkMap = PathWalkMap::Acquire(WorldData);
+    bool Repaired = RepairPath(Source, Path);
+    if(WalkMap != NULL)
+        WalkMap->Release();
+    WalkMap = NULL;
+    return Repaired;
+}
+
+bool PathRepair::RepairPath(Vector3<int> Source, Stack< Vector3<int> >* Path)
+{
+    // Take all changes noted so far
+    pthread_mutex_lock(&__PathRepair_Lock);
+    List< Vector3<int> > Changed = Changes;
+    Changes.Resize(0);
+    pthread_mutex_unlock(&__PathRepair_Lock);
+    
+    // Bring the spaces held up to date (starting over if too much changed)
+    for(int i = 0; i + 1 < Changed.GetSize() && IsSearched; i += 2)
+    {
+        if(!ApplyChange(Changed[i], Changed[i + 1]))
+            Reset();
+    }
+    
+    // Nothing to do if the path still holds (dropping any unfinished search)
+    IsUnfinished = false;
+    if(IsValid(Source, Path))
+    {
+        Watch(Source, Path);
+        return true;
+    }
+    
+    // Broken for good if the destination is now out of reach (see PathGraph)
+    if(!PathGraph::IsReachable(WorldData, Source, Sink))
+        return false;
+    
+    // First search: open the destination
+    this->Source = Source;
+    if(!IsSearched)
+    {
+        KeyOffset = 0;
+        IsSearched = true;
+        UpdateState(Sink);
+    }
+    // Else, later keys have to make up for the source having moved
+    else
+        KeyOffset += __PathRepair_GetEstimate(LastSource, Source);
+    LastSource = Source;
+    
+    // Give up (and start over next time) if too far
+    if(!ComputePath(PathRepair_FrameVisits))
+    {
+        Reset();
+        return false;
+    }
+    
+    // Out of visits for now: keep the path as is until the search is resumed
+    if(IsUnfinished)
+        return true;
+    
+    // None if the source can't reach the destination
+    if(GetSteps(Source) >= PathRepair_Unreached)
+    {
+        Reset();
+        return false;
+    }
+    
+    // Walk down the steps, to the best next space each time
+    int StepCount = GetSteps(Source);
+    Vector3<int>* Steps = new Vector3<int>[StepCount];
+    Vector3<int> Pos = Source;
+    bool Solved = true;
+    for(int i = 0; i < StepCount; i++)
+    {
+        int BestSteps = PathRepair_Unreached;
+        for(int Direction = 0; Direction < EntityPath_MaxAdjacent; Direction++)
+        {
+            Vector3<int> Next;
+            if(PathWalkMap::GetStep(WalkMap, WorldData, Pos, Direction, &Next) && GetSteps(Next) < BestSteps)
+            {
+                BestSteps = GetSteps(Next);
+                Steps[i] = Next;
+            }
+        }
+        
+        // Stuck if no next space gets any closer
+        if(BestSteps >= PathRepair_Unreached)
+        {
+            Solved = false;
+            break;
+        }
+        Pos = Steps[i];
+    }
+    Solved = Solved && (Pos == Sink);
+    
+    // Replace the path, next space on top
+    if(Solved)
+    {
+        while(!Path->IsEmpty())
+            Path->Pop();
+        for(int i = StepCount - 1; i >= 0; i--)
+            Path->Push(Steps[i]);
+        
+        RepairCount++;
+        Watch(Source, Path);
+    }
+    
+    delete[] Steps;
+    return Solved;
+}
+
+void PathRepair::BlocksChanged(Vector3<int> Min, Vector3<int> Max)
+{
+    // Called with the list lock held
+    if(Max.x < WatchMin.x || Min.x > WatchMax.x || Max.y < WatchMin.y || Min.y > WatchMax.y || Max.z < WatchMin.z || Min.z > WatchMax.z)
+        return;
+    
+    int ChangeCount = Changes.GetSize();
+    Changes.Resize(ChangeCount + 2);
+    Changes[ChangeCount] = Min;
+    Changes[ChangeCount + 1] = Max;
+}
+
+int PathRepair::GetRepairCount()
+{
+    return RepairCount;
+}
+
+int PathRepair::GetStateCount()
+{
+    return StateCount;
+}
+
+bool PathRepair::IsValid(Vector3<int> Source, Stack< Vector3<int> >* Path)
+{
+    // Every space has to be stepped into from the previous one
+    Stack< Vector3<int> > Steps = *Path;
+    Vector3<int> Pos = Source;
+    while(!Steps.IsEmpty())
+    {
+        Vector3<int> Next = Steps.Pop();
+        if(!PathWalkMap::IsSpace(WalkMap, WorldData, Next) || !__PathRepair_IsStep(WalkMap, WorldData, Pos, Next))
+            return false;
+        Pos = Next;
+    }
+    return true;
+}
+
+void PathRepair::Watch(Vector3<int> Source, Stack< Vector3<int> >* Path)
+{
+    // Volume of the path and all spaces held
+    Vector3<int> Min = Source, Max = Source;
+    Stack< Vector3<int> > Steps = *Path;
+    while(!Steps.IsEmpty())
+    {
+        Vector3<int> Pos = Steps.Pop();
+        Min = Vector3<int>(min(Min.x, Pos.x), min(Min.y, Pos.y), min(Min.z, Pos.z));
+        Max = Vector3<int>(max(Max.x, Pos.x), max(Max.y, Pos.y), max(Max.z, Pos.z));
+    }
+    if(StateCount > 0)
+    {
+        Min = Vector3<int>(min(Min.x, StatesMin.x), min(Min.y, StatesMin.y), min(Min.z, StatesMin.z));
+        Max = Vector3<int>(max(Max.x, StatesMax.x), max(Max.y, StatesMax.y), max(Max.z, StatesMax.z));
+    }
+    
+    // Watch all blocks the steps of those spaces depend on (the same volume, as the dependency is symmetric)
+    pthread_mutex_lock(&__PathRepair_Lock);
+    PathWalkMap::GetDependentVolume(Min, Max, &WatchMin, &WatchMax);
+    pthread_mutex_unlock(&__PathRepair_Lock);
+}
+
+void PathRepair::Reset()
+{
+    StateCount = 0;
+    for(int i = 0; i < BucketCapacity; i++)
+        Buckets[i] = 0;
+    HeapCount = 0;
+    IsSearched = false;
+    IsUnfinished = false;
+}
+
+bool PathRepair::ApplyChange(Vector3<int> Min, Vector3<int> Max)
+{
+    // Ignore if nothing held
+    if(StateCount <= 0)
+        return true;
+    
+    // Same reach as watched (see Watch(...)), clipped to the spaces held and those stepping into them
+    Vector3<int> UpdateMin, UpdateMax;
+    PathWalkMap::GetDependentVolume(Min, Max, &UpdateMin, &UpdateMax);
+    UpdateMin = Vector3<int>(max(UpdateMin.x, StatesMin.x - 1), max(UpdateMin.y, StatesMin.y - 1), max(UpdateMin.z, StatesMin.z - 1));
+    UpdateMax = Vector3<int>(min(UpdateMax.x, StatesMax.x + 1), min(UpdateMax.y, StatesMax.y + 1), min(UpdateMax.z, StatesMax.z + 1));
+    if(UpdateMin.x > UpdateMax.x || UpdateMin.y > UpdateMax.y || UpdateMin.z > UpdateMax.z)
+        return true;
+    
+    // Too large a change is cheaper to search from scratch
+    int Volume = (UpdateMax.x - UpdateMin.x + 1) * (UpdateMax.y - UpdateMin.y + 1) * (UpdateMax.z - UpdateMin.z + 1);
+    if(Volume > PathRepair_MaxStates)
+        return false;
+    
+    // Spaces not held yet may now step into held ones, so all are updated
+    for(int y = UpdateMin.y; y <= UpdateMax.y; y++)
+    for(int z = UpdateMin.z; z <= UpdateMax.z; z++)
+    for(int x = UpdateMin.x; x <= UpdateMax.x; x++)
+        UpdateState(Vector3<int>(x, y, z));
+    
+    return StateCount < PathRepair_MaxStates;
+}
+
+bool PathRepair::ComputePath(int MaxVisits)
+{
+    int Visits = 0;
+    while(HeapCount > 0)
+    {
+        // Done once the source is consistent and no open space may improve it
+        int SourceState = FindState(Source, false);
+        int SourceKey = PathRepair_Unreached, SourceSubKey = PathRepair_Unreached;
+        bool IsSourceConsistent = true;
+        if(SourceState >= 0)
+        {
+            GetKey(SourceState, &SourceKey, &SourceSubKey);
+            IsSourceConsistent = (States[SourceState].G == States[SourceState].Rhs);
+        }
+        
+        if(IsSourceConsistent && !__PathRepair_IsLower(Heap[0].Key, Heap[0].SubKey, SourceKey, SourceSubKey))
+            break;
+        
+        // Resume next time if out of visits
+        if(Visits >= MaxVisits)
+        {
+            IsUnfinished = true;
+            break;
+        }
+        Visits++;
+        
+        // Ignore stale entries; reopen those whose key has since grown
+        PathRepair_HeapEntry Entry = Pop();
+        PathRepair_State& State = States[Entry.State];
+        if(State.G == State.Rhs)
+            continue;
+        
+        int Key, SubKey;
+        GetKey(Entry.State, &Key, &SubKey);
+        if(__PathRepair_IsLower(Entry.Key, Entry.SubKey, Key, SubKey))
+        {
+            Push(Entry.State);
+            continue;
+        }
+        
+        // Fewer steps than before: take them, and let the previous spaces know
+        Vector3<int> Pos = State.Pos;
+        int OldSteps = State.G;
+        if(State.G > State.Rhs)
+            State.G = State.Rhs;
+        // More steps than before: forget them, then recompute them along with the previous spaces
+        else
+        {
+            State.G = PathRepair_Unreached;
+            UpdateState(Pos);
+        }
+        UpdatePrevious(Pos, OldSteps);
+        
+        // Give up if too far
+        if(StateCount >= PathRepair_MaxStates)
+            return false;
+    }
+    
+    return true;
+}
+
+void PathRepair::UpdateState(Vector3<int> Pos)
+{
+    // Steps through the best next space (none from anything but a space)
+    int Rhs = PathRepair_Unreached;
+    if(!WorldData->IsWithinWorld(Pos) || !PathWalkMap::IsSpace(WalkMap, WorldData, Pos))
+        Rhs = PathRepair_Unreached;
+    else if(Pos == Sink)
+        Rhs = 0;
+    else
+    {
+        for(int Direction = 0; Direction < EntityPath_MaxAdjacent; Direction++)
+        {
+            Vector3<int> Next;
+            if(PathWalkMap::GetStep(WalkMap, WorldData, Pos, Direction, &Next))
+                Rhs = min(Rhs, GetSteps(Next) + 1);
+        }
+        Rhs = min(Rhs, PathRepair_Unreached);
+    }
+    
+    // Spaces not held are unreached, so only hold those that changed
+    int State = FindState(Pos, Rhs < PathRepair_Unreached);
+    if(State < 0)
+        return;
+    
+    States[State].Rhs = Rhs;
+    if(States[State].G != States[State].Rhs)
+        Push(State);
+}
+
+void PathRepair::UpdatePrevious(Vector3<int> Pos, int OldSteps)
+{
+    int Steps = GetSteps(Pos);
+    
+    // A step in a direction may go up or down by one (see PathField::Compute())
+    for(int Direction = 0; Direction < EntityPath_MaxAdjacent; Direction++)
+    {
+        for(int j = -1; j <= 1; j++)
+        {
+            Vector3<int> Previous(Pos.x - EntityPath_OffsetX[Direction], Pos.y + j, Pos.z - EntityPath_OffsetZ[Direction]);
+            Vector3<int> Step;
+            if(Previous == Sink || !WorldData->IsWithinWorld(Previous) || !PathWalkMap::IsSpace(WalkMap, WorldData, Previous) || !PathWalkMap::GetStep(WalkMap, WorldData, Previous, Direction, &Step) || !(Step == Pos))
+                continue;
+            
+            // Fewer steps: the previous space may simply step through here
+            if(Steps < OldSteps)
+            {
+                int State = FindState(Previous, true);
+                if(State >= 0 && Steps + 1 < States[State].Rhs)
+                {
+                    States[State].Rhs = Steps + 1;
+                    if(States[State].G != States[State].Rhs)
+                        Push(State);
+                }
+            }
+            // More steps: only previous spaces that were stepping through here have to look for another way
+            else
+            {
+                int State = FindState(Previous, false);
+                if(State >= 0 && States[State].Rhs == OldSteps + 1)
+                    UpdateState(Previous);
+            }
+        }
+    }
+}
+
+int PathRepair::FindState(Vector3<int> Pos, bool Create)
+{
+    // Find the space's bucket (or the empty one it would be in)
+    int Index = (Pos.y * WorldWidth + Pos.z) * WorldWidth + Pos.x;
+    int Bucket = int((unsigned int)Index * 2654435761u) & (BucketCapacity - 1);
+    while(Buckets[Bucket] != 0)
+    {
+        if(States[Buckets[Bucket] - 1].Pos == Pos)
+            return Buckets[Bucket] - 1;
+        Bucket = (Bucket + 1) & (BucketCapacity - 1);
+    }
+    
+    if(!Create || StateCount >= PathRepair_MaxStates)
+        return -1;
+    
+    // Grow the states as needed
+    if(StateCount >= StateCapacity)
+    {
+        StateCapacity *= 2;
+        PathRepair_State* NewStates = new PathRepair_State[StateCapacity];
+        for(int i = 0; i < StateCount; i++)
+            NewStates[i] = States[i];
+        delete[] States;
+        States = NewStates;
+    }
+    
+    // New states are unreached
+    int State = StateCount++;
+    States[State].Pos = Pos;
+    States[State].G = States[State].Rhs = PathRepair_Unreached;
+    Buckets[Bucket] = State + 1;
+    
+    if(State == 0)
+        StatesMin = StatesMax = Pos;
+    else
+    {
+        StatesMin = Vector3<int>(min(StatesMin.x, Pos.x), min(StatesMin.y, Pos.y), min(StatesMin.z, Pos.z));
+        StatesMax = Vector3<int>(max(StatesMax.x, Pos.x), max(StatesMax.y, Pos.y), max(StatesMax.z, Pos.z));
+    }
+    
+    // Keep buckets at most half full, rehashing all states
+    if(StateCount * 2 > BucketCapacity)
+    {
+        delete[] Buckets;
+        BucketCapacity *= 2;
+        Buckets = new int[BucketCapacity];
+        for(int i = 0; i < BucketCapacity; i++)
+            Buckets[i] = 0;
+        
+        for(int i = 0; i < StateCount; i++)
+        {
+            Vector3<int> StatePos = States[i].Pos;
+            int StateIndex = (StatePos.y * WorldWidth + StatePos.z) * WorldWidth + StatePos.x;
+            int NewBucket = int((unsigned int)StateIndex * 2654435761u) & (BucketCapacity - 1);
+            while(Buckets[NewBucket] != 0)
+                NewBucket = (NewBucket + 1) & (BucketCapacity - 1);
+            Buckets[NewBucket] = i + 1;
+        }
+    }
+    
+    return State;
+}
+
+int PathRepair::GetSteps(Vector3<int> Pos)
+{
+    int State = FindState(Pos, false);
+    return (State < 0) ? PathRepair_Unreached : States[State].G;
+}
+
+void PathRepair::GetKey(int State, int* KeyOut, int* SubKeyOut)
+{
+    // Lowest steps first (as estimated through the space to the source), then closest to the destination
+    int Steps = min(States[State].G, States[State].Rhs);
+    if(Steps >= PathRepair_Unreached)
+    {
+        *KeyOut = *SubKeyOut = PathRepair_Unreached;
+        return;
+    }
+    
+    *KeyOut = Steps + __PathRepair_GetEstimate(Source, States[State].Pos) + KeyOffset;
+    *SubKeyOut = Steps;
+}
+
+void PathRepair::Push(int State)
+{
+    // Grow as needed
+    if(HeapCount >= HeapCapacity)
+    {
+        HeapCapacity *= 2;
+        PathRepair_HeapEntry* NewHeap = new PathRepair_HeapEntry[HeapCapacity];
+        for(int i = 0; i < HeapCount; i++)
+            NewHeap[i] = Heap[i];
+        delete[] Heap;
+        Heap = NewHeap;
+    }
+    
+    // Sift up
+    PathRepair_HeapEntry Entry;
+    Entry.State = State;
+    GetKey(State, &Entry.Key, &Entry.SubKey);
+    
+    int Index = HeapCount++;
+    while(Index > 0)
+    {
+        int Parent = (Index - 1) / 2;
+        if(!__PathRepair_IsLower(Entry.Key, Entry.SubKey, Heap[Parent].Key, Heap[Parent].SubKey))
+            break;
+        Heap[Index] = Heap[Parent];
+        Index = Parent;
+    }
+    Heap[Index] = Entry;
+}
+
+PathRepair_HeapEntry PathRepair::Pop()
+{
+    PathRepair_HeapEntry Top = Heap[0];
+    PathRepair_HeapEntry Last = Heap[--HeapCount];
+    
+    // Sift the last entry down from the top
+    int Index = 0;
+    while(true)
+    {
+        int Child = Index * 2 + 1;
+        if(Child >= HeapCount)
+            break;
+        if(Child + 1 < HeapCount && __PathRepair_IsLower(Heap[Child + 1].Key, Heap[Child + 1].SubKey, Heap[Child].Key, Heap[Child].SubKey))
+            Child++;
+        if(!__PathRepair_IsLower(Heap[Child].Key, Heap[Child].SubKey, Last.Key, Last.SubKey))
+            break;
+        Heap[Index] = Heap[Child];
+        Index = Child;
+    }
+    if(HeapCount > 0)
+        Heap[Index] = Last;
+    
+    return Top;
+}
+
+PathRepairList::PathRepairList(WorldContainer* WorldData)
+{
+    // Listen to block changes
+    this->WorldData = WorldData;
+    WorldData->AddListener(this);
+    
+    // Register, so repairs in this world find their list
+    pthread_mutex_lock(&__PathRepair_Lock);
+    int ListCount = __PathRepair_Lists.GetSize();
+    __PathRepair_Lists.Resize(ListCount + 1);
+    __PathRepair_Lists[ListCount] = this;
+    pthread_mutex_unlock(&__PathRepair_Lock);
+}
+
+PathRepairList::~PathRepairList()
+{
+    // No repair is notified from now on
+    pthread_mutex_lock(&__PathRepair_Lock);
+    for(int i = 0; i < __PathRepair_Lists.GetSize(); i++)
+    {
+        if(__PathRepair_Lists[i] == this)
+        {
+            __PathRepair_Lists.Remove(i);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&__PathRepair_Lock);
+    
+    WorldData->RemoveListener(this);
+}
+
+void PathRepairList::Add(PathRepair* Repair, WorldContainer* WorldData)
+{
+    pthread_mutex_lock(&__PathRepair_Lock);
+    for(int i = 0; i < __PathRepair_Lists.GetSize(); i++)
+    {
+        PathRepairList* RepairList = __PathRepair_Lists[i];
+        if(RepairList->WorldData == WorldData)
+        {
+            int RepairCount = RepairList->Repairs.GetSize();
+            RepairList->Repairs.Resize(RepairCount + 1);
+            RepairList->Repairs[RepairCount] = Repair;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&__PathRepair_Lock);
+}
+
+void PathRepairList::Remove(PathRepair* Repair, WorldContainer* WorldData)
+{
+    pthread_mutex_lock(&__PathRepair_Lock);
+    for(int i = 0; i < __PathRepair_Lists.GetSize(); i++)
+    {
+        PathRepairList* RepairList = __PathRepair_Lists[i];
+        if(RepairList->WorldData != WorldData)
+            continue;
+        
+        for(int j = 0; j < RepairList->Repairs.GetSize(); j++)
+        {
+            if(RepairList->Repairs[j] == Repair)
+            {
+                RepairList->Repairs.Remove(j);
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&__PathRepair_Lock);
+}
+
+void PathRepairList::BlocksChanged(Vector3<int> Min, Vector3<int> Max)
+{
+    // Repairs may be added or removed by other threads meanwhile
+    pthread_mutex_lock(&__PathRepair_Lock);
+    for(int i = 0; i < Repairs.GetSize(); i++)
+        Repairs[i]->BlocksChanged(Min, Max);
+    pthread_mutex_unlock(&__PathRepair_Lock);
+}
+
+int PathRepairList::GetRepairCount()
+{
+    pthread_mutex_lock(&__PathRepair_Lock);
+    int RepairCount = Repairs.GetSize();
+    pthread_mutex_unlock(&__PathRepair_Lock);
+    return RepairCount;
+}
@@ -0,0 +1,199 @@
+/***************************************************************
+ 
+ DwarfCraft - Dwarf Fortress / Minecraft clone
+ Copyright 2011 Jeremy Bridon - See License.txt for info
+ 
+ This source file is developed and maintained by:
+ + Jeremy Bridon jbridon@cores2.com
+ 
+ File: PathRepair.h/cpp
+ Desc: Incremental repair of an entity's path as the world changes
+ (D* Lite). Each moving entity keeps a repair of its path, which
+ notes every block change near the path (or near the spaces it has
+ searched so far). As long as the changes don't break the path,
+ nothing is done; once they do, the repair searches backwards from
+ the path's destination towards the entity, keeping the steps of
+ every space it visits. Later breaks only fix up the spaces whose
+ steps changed, instead of searching all over again, which matters
+ when dwarves keep digging around each other's paths.
+ 
+ Repairs of a world are notified by its repair list (PathRepairList),
+ the one listening to block changes. A repair gives up once it holds
+ PathRepair_MaxStates spaces; the entity then plans from scratch.
+ Searches are resumed across frames, visiting at most
+ PathRepair_FrameVisits spaces each time, so a long search never
+ stalls the simulation; the entity waits in place until it is done.
+ 
+***************************************************************/
+
+// Inclusion guard
+#ifndef __PATHREPAIR_H__
+#define __PATHREPAIR_H__
+
+#include "EntityPath.h"
+#include "List.h"
+
+// Most spaces a repair may hold the steps of
+static const int PathRepair_MaxStates = 65536;
+
+// Most spaces a repair may visit per call (i.e. per frame) before resuming on the next one
+static const int PathRepair_FrameVisits = 4096;
+
+// Steps of spaces that can't reach the destination
+static const int PathRepair_Unreached = 0x3FFFFFFF;
+
+// The search state of a space: its steps to the destination (G), and its steps through the best of
+// its next spaces (Rhs); the space is consistent when both are the same
+struct PathRepair_State
+{
+    Vector3<int> Pos;
+    int G, Rhs;
+};
+
+// An entry of the open heap; may be stale (the state has since changed)
+struct PathRepair_HeapEntry
+{
+    int State;
+    int Key, SubKey;
+};
+
+class PathRepair
+{
+public:
+    
+    // Watch the path going from the given source to the given path's end (the path being what is left
+    // of it past the source, the next space on top) for changes in the given world
+    PathRepair(WorldContainer* WorldData, Vector3<int> Source, Stack< Vector3<int> >* Path);
+    
+    // Stops watching
+    ~PathRepair();
+    
+    // Returns true if blocks near the path changed since the last repair
+    bool IsChanged();
+    
+    // Take all changes since the last repair; if they broke the given path (same as given on creation),
+    // replace it by the shortest path from the given source to its end. Returns false if there is none; if
+    // still searching (see IsRepairing()), the path is left as is and the repair has to be called again
+    bool Repair(Vector3<int> Source, Stack< Vector3<int> >* Path);
+    
+    // Returns true if the last repair ran out of visits before finding the path
+    bool IsRepairing();
+    
+    // Note the given volume (global, inclusive) changed, if near the path or the spaces searched
+    void BlocksChanged(Vector3<int> Min, Vector3<int> Max);
+    
+    // Number of times the path was broken and repaired, and of spaces currently held
+    int GetRepairCount();
+    int GetStateCount();
+    
+protected:
+    
+    // Same as Repair(...), once the walkability map is held
+    bool RepairPath(Vector3<int> Source, Stack< Vector3<int> >* Path);
+    
+    // Returns true if every step of the given path (past the given source) can still be taken
+    bool IsValid(Vector3<int> Source, Stack< Vector3<int> >* Path);
+    
+    // Watch the volume around the given path and all spaces held
+    void Watch(Vector3<int> Source, Stack< Vector3<int> >* Path);
+    
+    // Forget all spaces, so the next search starts over
+    void Reset();
+    
+    // Update the state of all spaces whose steps the given changed volume may have changed; returns false if too many
+    bool ApplyChange(Vector3<int> Min, Vector3<int> Max);
+    
+    // Bring the steps of all spaces up to date until those of the source are, visiting at most the given
+    // number of spaces; returns false if given up, and sets IsUnfinished if out of visits
+    bool ComputePath(int MaxVisits);
+    
+    // Recompute the steps through the best next space, and open the space if not consistent
+    void UpdateState(Vector3<int> Pos);
+    
+    // Update all spaces that step into the given space, once its steps changed from the given ones
+    void UpdatePrevious(Vector3<int> Pos, int OldSteps);
+    
+    // Get the state of a space, creating it as needed (-1 if not held, or if no more may be held)
+    int FindState(Vector3<int> Pos, bool Create);
+    
+    // Steps to the destination as last computed (PathRepair_Unreached if not held)
+    int GetSteps(Vector3<int> Pos);
+    
+    // Open heap helpers: the key of a state, and push / pop the lowest key
+    void GetKey(int State, int* KeyOut, int* SubKeyOut);
+    void Push(int State);
+    PathRepair_HeapEntry Pop();
+    
+private:
+    
+    // World data handle and short-hand sizes
+    WorldContainer* WorldData;
+    int WorldWidth, WorldHeight;
+    
+    // Walkability map of the world, if it has one, while repairing
+    PathWalkMap* WalkMap;
+    
+    // Destination of the path
+    Vector3<int> Sink;
+    
+    // Source of the current search, the one of the last search, and the sum of the estimates between
+    // all sources (keeps keys of states opened before the source moved comparable); true once searched
+    Vector3<int> Source, LastSource;
+    int KeyOffset;
+    bool IsSearched;
+    
+    // True if the last search ran out of visits (resumed by the next repair)
+    bool IsUnfinished;
+    
+    // All states held, and the hash of their spaces' indices to their numbers (+1; 0 if empty)
+    PathRepair_State* States;
+    int StateCount, StateCapacity;
+    int* Buckets;
+    int BucketCapacity;
+    
+    // Volume of all spaces held (global, inclusive)
+    Vector3<int> StatesMin, StatesMax;
+    
+    // Open heap
+    PathRepair_HeapEntry* Heap;
+    int HeapCount, HeapCapacity;
+    
+    // Volume watched, and the changed volumes (min then max) since the last repair; guarded by the list lock
+    Vector3<int> WatchMin, WatchMax;
+    List< Vector3<int> > Changes;
+    
+    // Statistics
+    int RepairCount;
+};
+
+class PathRepairList : public WorldContainer_Listener
+{
+public:
+    
+    // Notify all repairs of paths in the given world as it changes
+    PathRepairList(WorldContainer* WorldData);
+    
+    // Stops listening (repairs left are no longer notified)
+    ~PathRepairList();
+    
+    // Add or remove a repair to the list of its world (ignored if the world has no list)
+    static void Add(PathRepair* Repair, WorldContainer* WorldData);
+    static void Remove(PathRepair* Repair, WorldContainer* WorldData);
+    
+    // Notify all repairs
+    void BlocksChanged(Vector3<int> Min, Vector3<int> Max);
+    
+    // Number of repairs currently listed
+    int GetRepairCount();
+    
+private:
+    
+    // World data handle
+    WorldContainer* WorldData;
+    
+    // All repairs of this world
+    List<PathRepair*> Repairs;
+};
+
+// End of inclusion guard
+#endif
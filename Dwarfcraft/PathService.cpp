@@ -0,0 +1,197 @@
+/***************************************************************
+ 
+ DwarfCraft - Dwarf Fortress / Minecraft clone
+ Copyright 2011 Jeremy Bridon - See License.txt for info
+ 
+ This source file is developed and maintained by:
+ + Jeremy Bridon jbridon@cores2.com
+ 
+***************************************************************/
+
+#include "PathService.h"
+#include "EntityPath.h"
+
+PathService* PathService::GetShared()
+{
+    // Created once, lives for the rest of the application
+    static PathService* Shared = NULL;
+    static pthread_mutex_t SharedLock = PTHREAD_MUTEX_INITIALIZER;
+    
+    // Paths may be requested from any thread
+    pthread_mutex_lock(&SharedLock);
+    if(Shared == NULL)
+        Shared = new PathService(PathService_ThreadCount);
+    pthread_mutex_unlock(&SharedLock);
+    return Shared;
+}
+
+PathService::PathService(int ThreadCount)
+{
+    // Empty queue
+    pthread_mutex_init(&QueueLock, NULL);
+    pthread_cond_init(&QueueChanged, NULL);
+    RequestCapacity = 64;
+    RequestCount = 0;
+    Requests = new PathService_Request[RequestCapacity];
+    NextSequence = 0;
+    
+    // Launch all workers
+    IsStopping = false;
+    WorkerCount = ThreadCount;
+    Workers = new pthread_t[WorkerCount];
+    for(int i = 0; i < WorkerCount; i++)
+        pthread_create(&Workers[i], NULL, WorkerMain, (void*)this);
+}
+
+PathService::~PathService()
+{
+    // Drop all queued requests; they complete as unsolved
+    pthread_mutex_lock(&QueueLock);
+    IsStopping = true;
+    while(RequestCount > 0)
+        Requests[--RequestCount].Path->PostPath(false, NULL);
+    pthread_cond_broadcast(&QueueChanged);
+    pthread_mutex_unlock(&QueueLock);
+    
+    // Wait for the workers to finish their current request
+    for(int i = 0; i < WorkerCount; i++)
+        pthread_join(Workers[i], NULL);
+    
+    delete[] Workers;
+    delete[] Requests;
+    pthread_cond_destroy(&QueueChanged);
+    pthread_mutex_destroy(&QueueLock);
+}
+
+void PathService::Submit(EntityPath* Path, int Priority)
+{
+    pthread_mutex_lock(&QueueLock);
+    
+    // Grow the queue as needed
+    if(RequestCount >= RequestCapacity)
+    {
+        PathService_Request* NewRequests = new PathService_Request[RequestCapacity * 2];
+        memcpy(NewRequests, Requests, sizeof(PathService_Request) * RequestCount);
+        delete[] Requests;
+        Requests = NewRequests;
+        RequestCapacity *= 2;
+    }
+    
+    // Queue and wake up a worker
+    Requests[RequestCount].Path = Path;
+    Requests[RequestCount].Priority = Priority;
+    Requests[RequestCount].Sequence = NextSequence++;
+    HeapUp(RequestCount++);
+    pthread_cond_signal(&QueueChanged);
+    
+    pthread_mutex_unlock(&QueueLock);
+}
+
+bool PathService::Cancel(EntityPath* Path)
+{
+    pthread_mutex_lock(&QueueLock);
+    
+    // Find the request and replace it with the last one
+    bool Found = false;
+    for(int i = 0; i < RequestCount && !Found; i++)
+    {
+        if(Requests[i].Path == Path)
+        {
+            Found = true;
+            Requests[i] = Requests[--RequestCount];
+            if(i < RequestCount)
+            {
+                HeapUp(i);
+                HeapDown(i);
+            }
+        }
+    }
+    
+    pthread_mutex_unlock(&QueueLock);
+    return Found;
+}
+
+int PathService::GetQueuedCount()
+{
+    pthread_mutex_lock(&QueueLock);
+    int Count = RequestCount;
+    pthread_mutex_unlock(&QueueLock);
+    return Count;
+}
+
+int PathService::GetThreadCount()
+{
+    return WorkerCount;
+}
+
+void* PathService::WorkerMain(void* Data)
+{
+    PathService* self = (PathService*)Data;
+    
+    while(true)
+    {
+        // Wait for the next request
+        pthread_mutex_lock(&self->QueueLock);
+        while(self->RequestCount <= 0 && !self->IsStopping)
+            pthread_cond_wait(&self->QueueChanged, &self->QueueLock);
+        
+        // Shutting down
+        if(self->IsStopping)
+        {
+            pthread_mutex_unlock(&self->QueueLock);
+            break;
+        }
+        
+        // Take the best request
+        EntityPath* Path = self->Requests[0].Path;
+        self->Requests[0] = self->Requests[--self->RequestCount];
+        if(self->RequestCount > 0)
+            self->HeapDown(0);
+        pthread_mutex_unlock(&self->QueueLock);
+        
+        // Search (posts its own result); the path may be released as soon as it is posted
+        Path->Search();
+    }
+    
+    return NULL;
+}
+
+inline bool PathService::IsBefore(const PathService_Request& A, const PathService_Request& B)
+{
+    // Sequence numbers are compared as a difference, so wrap-around keeps the order
+    return A.Priority > B.Priority || (A.Priority == B.Priority && int(A.Sequence - B.Sequence) < 0);
+}
+
+void PathService::HeapUp(int Index)
+{
+    // Swap with the parent while better than it
+    PathService_Request Request = Requests[Index];
+    while(Index > 0)
+    {
+        int ParentIndex = (Index - 1) / 2;
+        if(!IsBefore(Request, Requests[ParentIndex]))
+            break;
+        Requests[Index] = Requests[ParentIndex];
+        Index = ParentIndex;
+    }
+    Requests[Index] = Request;
+}
+
+void PathService::HeapDown(int Index)
+{
+    // Swap with the best child while worse than it
+    PathService_Request Request = Requests[Index];
+    while(true)
+    {
+        int ChildIndex = Index * 2 + 1;
+        if(ChildIndex >= RequestCount)
+            break;
+        if(ChildIndex + 1 < RequestCount && IsBefore(Requests[ChildIndex + 1], Requests[ChildIndex]))
+            ChildIndex++;
+        if(!IsBefore(Requests[ChildIndex], Request))
+            break;
+        Requests[Index] = Requests[ChildIndex];
+        Index = ChildIndex;
+    }
+    Requests[Index] = Request;
+}
@@ -0,0 +1,95 @@
+/***************************************************************
+ 
+ DwarfCraft - Dwarf Fortress / Minecraft clone
+ Copyright 2011 Jeremy Bridon - See License.txt for info
+ 
+ This source file is developed and maintained by:
+ + Jeremy Bridon jbridon@cores2.com
+ 
+ File: PathService.h/cpp
+ Desc: A fixed pool of worker threads that compute all path
+ requests (see EntityPath). Requests wait in a queue, ordered by
+ priority and then by the order they were submitted; each worker
+ takes the next request, searches, and posts the result back into
+ the request. The number of threads never depends on the number of
+ requests or entities.
+ 
+ Queued requests may be cancelled (simply dropped from the queue);
+ requests already being searched see their cancellation flag and
+ stop early.
+ 
+***************************************************************/
+
+// Inclusion guard
+#ifndef __PATHSERVICE_H__
+#define __PATHSERVICE_H__
+
+#include "MUtil.h"
+#include <pthread.h>
+
+// Forward declare
+class EntityPath;
+
+// Number of worker threads of the shared service
+static const int PathService_ThreadCount = 2;
+
+// A queued request, its priority, and its submission order (earlier first on equal priority)
+struct PathService_Request
+{
+    EntityPath* Path;
+    int Priority;
+    unsigned int Sequence;
+};
+
+class PathService
+{
+public:
+    
+    // The service used by all paths; created (and its threads launched) on first use
+    static PathService* GetShared();
+    
+    // Launches the given number of worker threads
+    PathService(int ThreadCount);
+    
+    // Drops all queued requests and waits for all workers to finish
+    ~PathService();
+    
+    // Queue a path request; higher priorities are searched first
+    void Submit(EntityPath* Path, int Priority);
+    
+    // Remove the given request from the queue; returns false if it isn't queued (i.e. already taken by a worker)
+    bool Cancel(EntityPath* Path);
+    
+    // Number of queued requests, and of worker threads
+    int GetQueuedCount();
+    int GetThreadCount();
+    
+private:
+    
+    // Worker thread main loop
+    static void* WorkerMain(void* Data);
+    
+    // Returns true if request A should be searched before B
+    inline bool IsBefore(const PathService_Request& A, const PathService_Request& B);
+    
+    // Queue (binary heap) operations
+    void HeapUp(int Index);
+    void HeapDown(int Index);
+    
+    // Queue lock, signaled when a request is queued or the service stops
+    pthread_mutex_t QueueLock;
+    pthread_cond_t QueueChanged;
+    
+    // Queued requests (as a heap) and the next submission number
+    PathService_Request* Requests;
+    int RequestCount, RequestCapacity;
+    unsigned int NextSequence;
+    
+    // Worker threads, and true once the service is shutting down
+    pthread_t* Workers;
+    int WorkerCount;
+    bool IsStopping;
+};
+
+// End of inclusion guard
+#endif
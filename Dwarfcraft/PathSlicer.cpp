@@ -0,0 +1,202 @@
+/***************************************************************
+ 
+ DwarfCraft - Dwarf Fortress / Minecraft clone
+ Copyright 2011 Jeremy Bridon - See License.txt for info
+ 
+ This source file is developed and maintained by:
+ + Jeremy Bridon jbridon@cores2.com
+ 
+***************************************************************/
+
+#include "PathSlicer.h"
+
+// Internal: all slicers, so paths can find the slicer of their world
+static List<PathSlicer*> __PathSlicer_Slicers;
+static pthread_mutex_t __PathSlicer_SlicersLock = PTHREAD_MUTEX_INITIALIZER;
+
+PathSlicer::PathSlicer(WorldContainer* WorldData, int FrameBudget)
+{
+    // Save world and budget
+    this->WorldData = WorldData;
+    this->FrameBudget = FrameBudget;
+    
+    // Nothing queued yet
+    NextSequence = 0;
+    ActiveCount = 0;
+    FrameVisits = 0;
+    Spare = 0;
+    
+    // Make this slicer available to paths
+    pthread_mutex_lock(&__PathSlicer_SlicersLock);
+    int SlicerCount = __PathSlicer_Slicers.GetSize();
+    __PathSlicer_Slicers.Resize(SlicerCount + 1);
+    __PathSlicer_Slicers[SlicerCount] = this;
+    pthread_mutex_unlock(&__PathSlicer_SlicersLock);
+}
+
+PathSlicer::~PathSlicer()
+{
+    // No new requests may find this slicer
+    pthread_mutex_lock(&__PathSlicer_SlicersLock);
+    for(int i = 0; i < __PathSlicer_Slicers.GetSize(); i++)
+    {
+        if(__PathSlicer_Slicers[i] == this)
+        {
+            __PathSlicer_Slicers.Remove(i);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&__PathSlicer_SlicersLock);
+    
+    // Drop all requests; they complete as unsolved
+    while(ActiveCount > 0)
+    {
+        EntityPath* Path = Active[--ActiveCount].Path;
+        Path->StopSlices();
+        Path->Slicer = NULL;
+        Path->PostPath(false, NULL);
+    }
+    while(Queued.GetSize() > 0)
+    {
+        EntityPath* Path = Queued[0].Path;
+        Queued.Remove(0);
+        Path->Slicer = NULL;
+        Path->PostPath(false, NULL);
+    }
+}
+
+PathSlicer* PathSlicer::Get(WorldContainer* WorldData)
+{
+    PathSlicer* Slicer = NULL;
+    pthread_mutex_lock(&__PathSlicer_SlicersLock);
+    for(int i = 0; i < __PathSlicer_Slicers.GetSize() && Slicer == NULL; i++)
+    {
+        if(__PathSlicer_Slicers[i]->WorldData == WorldData)
+            Slicer = __PathSlicer_Slicers[i];
+    }
+    pthread_mutex_unlock(&__PathSlicer_SlicersLock);
+    return Slicer;
+}
+
+void PathSlicer::Submit(EntityPath* Path, int Priority)
+{
+    // Insert after all requests of the same or a higher priority
+    int QueuedCount = Queued.GetSize();
+    Queued.Resize(QueuedCount + 1);
+    int Index = QueuedCount;
+    for(; Index > 0 && Queued[Index - 1].Priority < Priority; Index--)
+        Queued[Index] = Queued[Index - 1];
+    
+    Queued[Index].Path = Path;
+    Queued[Index].Priority = Priority;
+    Queued[Index].Sequence = NextSequence++;
+    Path->Slicer = this;
+    
+    // Start searching it right away if there is room
+    Activate();
+}
+
+bool PathSlicer::Cancel(EntityPath* Path)
+{
+    // Stop searching it, and search the next one in its place
+    for(int i = 0; i < ActiveCount; i++)
+    {
+        if(Active[i].Path == Path)
+        {
+            Spare += max(Active[i].Share, 0);
+            Active[i] = Active[--ActiveCount];
+            Path->StopSlices();
+            Path->Slicer = NULL;
+            Activate();
+            return true;
+        }
+    }
+    
+    // Else, simply drop it from the queue
+    for(int i = 0; i < Queued.GetSize(); i++)
+    {
+        if(Queued[i].Path == Path)
+        {
+            Queued.Remove(i);
+            Path->Slicer = NULL;
+            return true;
+        }
+    }
+    return false;
+}
+
+void PathSlicer::Update()
+{
+    // Split the whole budget evenly, the first requests getting what is left over
+    FrameVisits = 0;
+    Spare = 0;
+    if(ActiveCount <= 0)
+    {
+        Spare = FrameBudget;
+        return;
+    }
+    
+    for(int i = 0; i < ActiveCount; i++)
+        Active[i].Share = FrameBudget / ActiveCount + ((i < FrameBudget % ActiveCount) ? 1 : 0);
+}
+
+void PathSlicer::Pump(EntityPath* Path)
+{
+    // Find the request, ignored if not being searched
+    int Index = 0;
+    while(Index < ActiveCount && Active[Index].Path != Path)
+        Index++;
+    if(Index >= ActiveCount || Active[Index].Share <= 0)
+        return;
+    
+    // Search for its share; once done, its unused share goes to the next request searched
+    int Visited = 0;
+    bool Done = Path->SearchSlice(Active[Index].Share, &Visited);
+    FrameVisits += Visited;
+    Active[Index].Share -= Visited;
+    if(Done)
+    {
+        Spare += max(Active[Index].Share, 0);
+        Active[Index] = Active[--ActiveCount];
+        Path->Slicer = NULL;
+        Activate();
+    }
+}
+
+int PathSlicer::GetQueuedCount()
+{
+    return Queued.GetSize();
+}
+
+int PathSlicer::GetActiveCount()
+{
+    return ActiveCount;
+}
+
+int PathSlicer::GetFrameVisits()
+{
+    return FrameVisits;
+}
+
+void PathSlicer::Activate()
+{
+    while(ActiveCount < PathSlicer_MaxActive && Queued.GetSize() > 0)
+    {
+        // Take the first queued request
+        EntityPath* Path = Queued[0].Path;
+        Queued.Remove(0);
+        
+        // Some are done without searching (i.e. trivial or unreachable)
+        if(!Path->StartSlices())
+        {
+            Path->Slicer = NULL;
+            continue;
+        }
+        
+        // Hand it whatever is spare of this frame
+        Active[ActiveCount].Path = Path;
+        Active[ActiveCount].Share = Spare;
+        Spare = 0;
+        ActiveCount++;
+    }
+}
@@ -0,0 +1,105 @@
+/***************************************************************
+ 
+ DwarfCraft - Dwarf Fortress / Minecraft clone
+ Copyright 2011 Jeremy Bridon - See License.txt for info
+ 
+ This source file is developed and maintained by:
+ + Jeremy Bridon jbridon@cores2.com
+ 
+ File: PathSlicer.h/cpp
+ Desc: Time-sliced path requests, searched on the simulation thread
+ instead of by the path service's threads (see PathService). Each
+ frame has a fixed budget of visited nodes, split evenly between the
+ requests being searched; every entity pumps its own request as it
+ executes, searching at most its share before resuming next frame.
+ Frame times stay the same however many entities are planning, and
+ since nothing depends on timing or threads, the same frames always
+ give the same paths (i.e. for replays).
+ 
+ Only PathSlicer_MaxActive requests are searched at once, as each
+ holds a search state (a node per block) until done; the others
+ wait in a queue, ordered by priority and then by the order they
+ were submitted. Sliced searches never run over the path graph, but
+ give up right away if the graph knows the sink is unreachable.
+ 
+ A slicer, and all of its requests, may only ever be used on the
+ simulation thread.
+ 
+***************************************************************/
+
+// Inclusion guard
+#ifndef __PATHSLICER_H__
+#define __PATHSLICER_H__
+
+#include "EntityPath.h"
+#include "List.h"
+
+// Nodes visited per frame, across all requests
+static const int PathSlicer_FrameBudget = 8192;
+
+// Most requests searched at once
+static const int PathSlicer_MaxActive = 4;
+
+// A request being searched, and the number of nodes it may still visit this frame
+struct PathSlicer_Slot
+{
+    EntityPath* Path;
+    int Share;
+};
+
+class PathSlicer
+{
+public:
+    
+    // Search the requests of the given world, visiting at most the given number of nodes per frame
+    PathSlicer(WorldContainer* WorldData, int FrameBudget = PathSlicer_FrameBudget);
+    
+    // Drops all requests left; they complete as unsolved
+    ~PathSlicer();
+    
+    // Get the slicer of the given world, or NULL if it has none
+    static PathSlicer* Get(WorldContainer* WorldData);
+    
+    // Queue a path request; higher priorities are searched first
+    void Submit(EntityPath* Path, int Priority);
+    
+    // Remove the given request (queued or being searched); returns false if it is neither (i.e. already done)
+    bool Cancel(EntityPath* Path);
+    
+    // Start a new frame: split the frame's budget between the requests being searched
+    void Update();
+    
+    // Search the given request for what is left of its share of this frame, if it is being searched
+    void Pump(EntityPath* Path);
+    
+    // Number of queued requests, and of those being searched
+    int GetQueuedCount();
+    int GetActiveCount();
+    
+    // Nodes visited so far this frame
+    int GetFrameVisits();
+    
+private:
+    
+    // Start searching queued requests until as many as allowed are (or none are left)
+    void Activate();
+    
+    // World data handle and the per-frame budget
+    WorldContainer* WorldData;
+    int FrameBudget;
+    
+    // Queued requests, in search order, and the next submission number
+    List<PathService_Request> Queued;
+    unsigned int NextSequence;
+    
+    // Requests being searched
+    PathSlicer_Slot Active[PathSlicer_MaxActive];
+    int ActiveCount;
+    
+    // Nodes visited this frame, and those of the budget not yet handed out (i.e. freed by requests done early)
+    int FrameVisits;
+    int Spare;
+};
+
+// End of inclusion guard
+#endif
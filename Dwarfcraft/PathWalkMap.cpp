@@ -0,0 +1,133 @@
+/***************************************************************
+ 
+ DwarfCraft - Dwarf Fortress / Minecraft clone
+ Copyright 2011 Jeremy Bridon - See License.txt for info
+ 
+ This source file is developed and maintained by:
+ + Jeremy Bridon jbridon@cores2.com
+ 
+***************************************************************/
+
+#include "PathWalkMap.h"
+
+// Internal: all maps, so searches can find the map of their world
+static List<PathWalkMap*> __PathWalkMap_Maps;
+static pthread_mutex_t __PathWalkMap_MapsLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t __PathWalkMap_Released = PTHREAD_COND_INITIALIZER;
+
+PathWalkMap::PathWalkMap(WorldContainer* WorldData)
+{
+    // Save world and sizes
+    this->WorldData = WorldData;
+    WorldWidth = WorldData->GetWorldWidth();
+    WorldHeight = WorldData->GetWorldHeight();
+    
+    // A byte of steps and a bit of space per block
+    int SpaceCount = WorldWidth * WorldWidth * WorldHeight;
+    Steps = new unsigned char[SpaceCount];
+    Spaces = new unsigned int[(SpaceCount + 31) / 32];
+    for(int i = 0; i < (SpaceCount + 31) / 32; i++)
+        Spaces[i] = 0;
+    UserCount = 0;
+    
+    // Compute all spaces
+    Compute(Vector3<int>(0, 0, 0), Vector3<int>(WorldWidth - 1, WorldHeight - 1, WorldWidth - 1));
+    
+    // Keep up to date, and make this map available to searches
+    WorldData->AddListener(this);
+    
+    pthread_mutex_lock(&__PathWalkMap_MapsLock);
+    int MapCount = __PathWalkMap_Maps.GetSize();
+    __PathWalkMap_Maps.Resize(MapCount + 1);
+    __PathWalkMap_Maps[MapCount] = this;
+    pthread_mutex_unlock(&__PathWalkMap_MapsLock);
+}
+
+PathWalkMap::~PathWalkMap()
+{
+    // No new users may acquire this map; wait for those left to be done
+    pthread_mutex_lock(&__PathWalkMap_MapsLock);
+    for(int i = 0; i < __PathWalkMap_Maps.GetSize(); i++)
+    {
+        if(__PathWalkMap_Maps[i] == this)
+        {
+            __PathWalkMap_Maps.Remove(i);
+            break;
+        }
+    }
+    while(UserCount > 0)
+        pthread_cond_wait(&__PathWalkMap_Released, &__PathWalkMap_MapsLock);
+    pthread_mutex_unlock(&__PathWalkMap_MapsLock);
+    
+    // Stop listening
+    WorldData->RemoveListener(this);
+    
+    delete[] Steps;
+    delete[] Spaces;
+}
+
+PathWalkMap* PathWalkMap::Acquire(WorldContainer* WorldData)
+{
+    PathWalkMap* WalkMap = NULL;
+    pthread_mutex_lock(&__PathWalkMap_MapsLock);
+    for(int i = 0; i < __PathWalkMap_Maps.GetSize() && WalkMap == NULL; i++)
+    {
+        if(__PathWalkMap_Maps[i]->WorldData == WorldData)
+        {
+            WalkMap = __PathWalkMap_Maps[i];
+            WalkMap->UserCount++;
+        }
+    }
+    pthread_mutex_unlock(&__PathWalkMap_MapsLock);
+    return WalkMap;
+}
+
+void PathWalkMap::Release()
+{
+    pthread_mutex_lock(&__PathWalkMap_MapsLock);
+    UserCount--;
+    pthread_cond_broadcast(&__PathWalkMap_Released);
+    pthread_mutex_unlock(&__PathWalkMap_MapsLock);
+}
+
+void PathWalkMap::BlocksChanged(Vector3<int> Min, Vector3<int> Max)
+{
+    GetDependentVolume(Min, Max, &Min, &Max);
+    Compute(Min, Max);
+}
+
+int PathWalkMap::GetMemoryUsage()
+{
+    int SpaceCount = WorldWidth * WorldWidth * WorldHeight;
+    return SpaceCount * sizeof(unsigned char) + (SpaceCount + 31) / 32 * sizeof(unsigned int);
+}
+
+void PathWalkMap::Compute(Vector3<int> Min, Vector3<int> Max)
+{
+    // Clip to the world
+    Min = Vector3<int>(max(Min.x, 0), max(Min.y, 0), max(Min.z, 0));
+    Max = Vector3<int>(min(Max.x, WorldWidth - 1), min(Max.y, WorldHeight - 1), min(Max.z, WorldWidth - 1));
+    
+    for(int y = Min.y; y <= Max.y; y++)
+    for(int z = Min.z; z <= Max.z; z++)
+    for(int x = Min.x; x <= Max.x; x++)
+    {
+        Vector3<int> Pos(x, y, z);
+        int Index = GetIndex(Pos);
+        
+        // Code the height change of each step
+        unsigned char Code = 0;
+        for(int Direction = 0; Direction < EntityPath_MaxAdjacent; Direction++)
+        {
+            Vector3<int> Step;
+            if(EntityPath_Search::GetStep(WorldData, Pos, Direction, &Step))
+                Code |= (unsigned char)((Step.y - y + PathWalkMap_StepLevel) << (Direction * 2));
+        }
+        Steps[Index] = Code;
+        
+        if(EntityPath_Search::IsSpace(WorldData, Pos))
+            Spaces[Index >> 5] |= (1u << (Index & 31));
+        else
+            Spaces[Index >> 5] &= ~(1u << (Index & 31));
+    }
+}
@@ -0,0 +1,131 @@
+/***************************************************************
+ 
+ DwarfCraft - Dwarf Fortress / Minecraft clone
+ Copyright 2011 Jeremy Bridon - See License.txt for info
+ 
+ This source file is developed and maintained by:
+ + Jeremy Bridon jbridon@cores2.com
+ 
+ File: PathWalkMap.h/cpp
+ Desc: Precomputed walkability of every space of a world, so path
+ searches look up where an entity may step instead of checking the
+ surrounding blocks each time (see EntityPath_Search::GetStep(...)).
+ Each space has a byte of step codes, two bits per direction: can't
+ step, or step down, level or up by one; and a bit, packed 32 to a
+ word, set if an entity can stand there.
+ 
+ The map listens to block changes and recomputes only the spaces
+ whose steps depend on the changed blocks: those one column over,
+ from two below to two above. It has to be created before anything
+ else listening to the same world that searches paths (i.e. the path
+ graph), so it is always brought up to date first.
+ 
+***************************************************************/
+
+// Inclusion guard
+#ifndef __PATHWALKMAP_H__
+#define __PATHWALKMAP_H__
+
+#include "EntityPath.h"
+
+// Step codes, two bits per direction; the step's height change is the code minus PathWalkMap_StepLevel
+static const unsigned char PathWalkMap_StepNone = 0;
+static const unsigned char PathWalkMap_StepDown = 1;
+static const unsigned char PathWalkMap_StepLevel = 2;
+static const unsigned char PathWalkMap_StepUp = 3;
+
+class PathWalkMap : public WorldContainer_Listener
+{
+public:
+    
+    // Compute the walkability of the whole world, and keep it up to date as the world changes
+    PathWalkMap(WorldContainer* WorldData);
+    
+    // Stops listening, and waits for all users of this map to be done
+    ~PathWalkMap();
+    
+    // Get the map of the given world, or NULL if it has none; must be released once done
+    static PathWalkMap* Acquire(WorldContainer* WorldData);
+    void Release();
+    
+    // Recompute all spaces whose steps depend on the given volume (global, inclusive)
+    void BlocksChanged(Vector3<int> Min, Vector3<int> Max);
+    
+    // Bytes allocated by this map
+    int GetMemoryUsage();
+    
+    // Same as EntityPath_Search::GetStep(...) and IsSpace(...), looked up in the given map; from the
+    // blocks themselves if no map is given
+    static inline bool GetStep(PathWalkMap* WalkMap, WorldContainer* WorldData, Vector3<int> Position, int Direction, Vector3<int>* StepOut);
+    static inline bool IsSpace(PathWalkMap* WalkMap, WorldContainer* WorldData, Vector3<int> Position);
+    
+    // Get the volume of all spaces whose steps depend on the given changed volume (global, inclusive, not clipped
+    // to the world); a step depends on the blocks one column over, and from two below to two above
+    static inline void GetDependentVolume(Vector3<int> Min, Vector3<int> Max, Vector3<int>* MinOut, Vector3<int>* MaxOut);
+    
+protected:
+    
+    // Recompute the codes of all spaces within the given volume (global, inclusive, clipped to the world)
+    void Compute(Vector3<int> Min, Vector3<int> Max);
+    
+    // Block index of a space, or -1 if out of the world
+    inline int GetIndex(Vector3<int> Pos);
+    
+private:
+    
+    // World data handle and short-hand sizes
+    WorldContainer* WorldData;
+    int WorldWidth, WorldHeight;
+    
+    // Step codes of each space by block index (see EntityPath_Search::GetIndex(...)), two bits per
+    // direction (in the order of EntityPath_Direction)
+    unsigned char* Steps;
+    
+    // Bits of each space by block index, set if an entity can stand there
+    unsigned int* Spaces;
+    
+    // Number of users of this map (see Acquire(...))
+    int UserCount;
+};
+
+inline int PathWalkMap::GetIndex(Vector3<int> Pos)
+{
+    if(Pos.x < 0 || Pos.x >= WorldWidth || Pos.z < 0 || Pos.z >= WorldWidth || Pos.y < 0 || Pos.y >= WorldHeight)
+        return -1;
+    return (Pos.y * WorldWidth + Pos.z) * WorldWidth + Pos.x;
+}
+
+inline bool PathWalkMap::GetStep(PathWalkMap* WalkMap, WorldContainer* WorldData, Vector3<int> Position, int Direction, Vector3<int>* StepOut)
+{
+    if(WalkMap == NULL)
+        return EntityPath_Search::GetStep(WorldData, Position, Direction, StepOut);
+    
+    int Index = WalkMap->GetIndex(Position);
+    if(Index < 0)
+        return false;
+    
+    int Code = (WalkMap->Steps[Index] >> (Direction * 2)) & 3;
+    if(Code == PathWalkMap_StepNone)
+        return false;
+    
+    *StepOut = Vector3<int>(Position.x + EntityPath_OffsetX[Direction], Position.y + Code - PathWalkMap_StepLevel, Position.z + EntityPath_OffsetZ[Direction]);
+    return true;
+}
+
+inline bool PathWalkMap::IsSpace(PathWalkMap* WalkMap, WorldContainer* WorldData, Vector3<int> Position)
+{
+    if(WalkMap == NULL)
+        return EntityPath_Search::IsSpace(WorldData, Position);
+    
+    int Index = WalkMap->GetIndex(Position);
+    return Index >= 0 && (WalkMap->Spaces[Index >> 5] & (1u << (Index & 31))) != 0;
+}
+
+inline void PathWalkMap::GetDependentVolume(Vector3<int> Min, Vector3<int> Max, Vector3<int>* MinOut, Vector3<int>* MaxOut)
+{
+    *MinOut = Vector3<int>(Min.x - 1, Min.y - 2, Min.z - 1);
+    *MaxOut = Vector3<int>(Max.x + 1, Max.y + 2, Max.z + 1);
+}
+
+// End of inclusion guard
+#endif
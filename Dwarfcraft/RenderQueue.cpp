@@ -0,0 +1,132 @@
+/***************************************************************
+ 
+ DwarfCraft - Dwarf Fortress / Minecraft clone
+ Copyright 2011 Jeremy Bridon - See License.txt for info
+ 
+ This source file is developed and maintained by:
+ + Jeremy Bridon jbridon@cores2.com
+ 
+***************************************************************/
+
+#include "RenderQueue.h"
+
+// Internal: draw order of two items; pass, shader, texture, then front-to-back for opaque items,
+// but pass, back-to-front, then shader and texture for cut-out items (which have to blend in order)
+static int __RenderQueue_Compare(const void* A, const void* B)
+{
+    const RenderQueue_Item* ItemA = (const RenderQueue_Item*)A;
+    const RenderQueue_Item* ItemB = (const RenderQueue_Item*)B;
+    
+    if(ItemA->Pass != ItemB->Pass)
+        return (ItemA->Pass < ItemB->Pass) ? -1 : 1;
+    if(ItemA->Pass == RenderQueue_Pass_Cutout && ItemA->Depth != ItemB->Depth)
+        return (ItemA->Depth > ItemB->Depth) ? -1 : 1;
+    if(ItemA->ItemShader != ItemB->ItemShader)
+        return (size_t(ItemA->ItemShader) < size_t(ItemB->ItemShader)) ? -1 : 1;
+    if(ItemA->TextureID != ItemB->TextureID)
+        return (ItemA->TextureID < ItemB->TextureID) ? -1 : 1;
+    if(ItemA->Depth != ItemB->Depth)
+        return (ItemA->Depth < ItemB->Depth) ? -1 : 1;
+    return 0;
+}
+
+RenderQueue::RenderQueue()
+{
+    // Nothing queued
+    Items = NULL;
+    ItemCount = ItemCapacity = 0;
+    memset(&Stats, 0, sizeof(RenderQueue_Stats));
+}
+
+RenderQueue::~RenderQueue()
+{
+    delete[] Items;
+}
+
+void RenderQueue::Add(VBuffer* Buffer, Shader* ItemShader, float Depth, RenderQueue_Pass Pass)
+{
+    // Ignore if nothing to draw
+    if(Buffer == NULL || !Buffer->HasGeometry())
+        return;
+    
+    // Grow as needed
+    if(ItemCount >= ItemCapacity)
+    {
+        ItemCapacity = (ItemCapacity == 0) ? 256 : (ItemCapacity * 2);
+        RenderQueue_Item* NewItems = new RenderQueue_Item[ItemCapacity];
+        for(int i = 0; i < ItemCount; i++)
+            NewItems[i] = Items[i];
+        delete[] Items;
+        Items = NewItems;
+    }
+    
+    RenderQueue_Item& Item = Items[ItemCount++];
+    Item.Buffer = Buffer;
+    Item.ItemShader = ItemShader;
+    Item.TextureID = Buffer->GetTextureID();
+    Item.Pass = Pass;
+    Item.Depth = Depth;
+}
+
+void RenderQueue::Submit()
+{
+    // Reset stats
+    memset(&Stats, 0, sizeof(RenderQueue_Stats));
+    Stats.Items = ItemCount;
+    
+    // Group by state
+    qsort(Items, ItemCount, sizeof(RenderQueue_Item), __RenderQueue_Compare);
+    
+    // Current states; start from the fixed pipeline with texturing off
+    Shader* CurrentShader = NULL;
+    GLuint CurrentTexture = 0;
+    
+    for(int i = 0; i < ItemCount; i++)
+    {
+        RenderQueue_Item& Item = Items[i];
+        
+        // Change shader only when it differs
+        if(Item.ItemShader != CurrentShader)
+        {
+            if(Item.ItemShader != NULL)
+                Item.ItemShader->Activate();
+            else
+                CurrentShader->Deactivate();
+            CurrentShader = Item.ItemShader;
+            Stats.ShaderChanges++;
+        }
+        
+        // Change texture only when it differs
+        if(Item.TextureID != CurrentTexture)
+        {
+            if(Item.TextureID == 0)
+                glDisable(GL_TEXTURE_2D);
+            else
+            {
+                if(CurrentTexture == 0)
+                    glEnable(GL_TEXTURE_2D);
+                glBindTexture(GL_TEXTURE_2D, Item.TextureID);
+                Stats.TextureBinds++;
+            }
+            CurrentTexture = Item.TextureID;
+        }
+        
+        // Draw
+        Item.Buffer->RenderGeometry();
+        Stats.DrawCalls++;
+    }
+    
+    // Restore default states
+    if(CurrentShader != NULL)
+        CurrentShader->Deactivate();
+    if(CurrentTexture != 0)
+        glDisable(GL_TEXTURE_2D);
+    
+    // Done with this frame's items
+    ItemCount = 0;
+}
+
+RenderQueue_Stats RenderQueue::GetStats()
+{
+    return Stats;
+}
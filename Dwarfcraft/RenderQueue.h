@@ -0,0 +1,90 @@
+/***************************************************************
+ 
+ DwarfCraft - Dwarf Fortress / Minecraft clone
+ Copyright 2011 Jeremy Bridon - See License.txt for info
+ 
+ This source file is developed and maintained by:
+ + Jeremy Bridon jbridon@cores2.com
+ 
+ File: RenderQueue.h/cpp
+ Desc: Collects the geometry (VBuffers) to draw during a frame,
+ then draws it all in one go, sorted so that states change as
+ little as possible: by pass, then shader, then texture, then
+ depth. Opaque geometry is drawn front-to-back (so hidden pixels
+ are rejected early), then cut-out geometry (blocks with
+ see-through texels, such as leaves and glass) back-to-front, so
+ blended edges draw over what is behind them; there, depth comes
+ before shader and texture, as the order matters more than states.
+ 
+ Each shader and texture is thus set once per run of items that
+ share it, rather than once per item. Counts of items, draw calls,
+ and state changes of the last submission are kept for profiling.
+ 
+***************************************************************/
+
+// Inclusion guard
+#ifndef __RENDERQUEUE_H__
+#define __RENDERQUEUE_H__
+
+#include "VBuffer.h"
+#include "Shader.h"
+
+// Render passes, in drawing order
+enum RenderQueue_Pass
+{
+    RenderQueue_Pass_Opaque = 0,
+    RenderQueue_Pass_Cutout,
+};
+
+// A single queued draw
+struct RenderQueue_Item
+{
+    // Geometry to draw, with which shader (NULL for the fixed pipeline) and texture (0 for none)
+    VBuffer* Buffer;
+    Shader* ItemShader;
+    GLuint TextureID;
+    
+    // Pass and (squared) distance to the camera
+    RenderQueue_Pass Pass;
+    float Depth;
+};
+
+// Statistics of the last submission
+struct RenderQueue_Stats
+{
+    // Number of queued items and draw calls made
+    int Items, DrawCalls;
+    
+    // Number of texture binds and shader changes
+    int TextureBinds, ShaderChanges;
+};
+
+class RenderQueue
+{
+public:
+    
+    // Constructor and destructor
+    RenderQueue();
+    ~RenderQueue();
+    
+    // Queue the given geometry to draw on the next submission; empty buffers are ignored
+    void Add(VBuffer* Buffer, Shader* ItemShader, float Depth, RenderQueue_Pass Pass = RenderQueue_Pass_Opaque);
+    
+    // Sort and draw everything queued, then empty the queue; leaves no shader active and texturing off
+    void Submit();
+    
+    // Statistics of the last submission
+    RenderQueue_Stats GetStats();
+    
+private:
+    
+    // Queued items
+    RenderQueue_Item* Items;
+    int ItemCount, ItemCapacity;
+    
+    // Last submission statistics
+    RenderQueue_Stats Stats;
+};
+
+// End of inclusion guard
+#endif
@@ -85,6 +85,11 @@ void Shader::Deactivate()
     glUseProgram(0);
 }
 
+GLint Shader::GetAttribute(const char* Key)
+{
+    return glGetAttribLocation(ShaderHandle, Key);
+}
+
 void Shader::Uniform(const char* Key, GLint value)
 {
     GLint loc, oldprog;
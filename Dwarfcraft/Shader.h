@@ -35,6 +35,9 @@ public:
     void Activate();
     void Deactivate();
     
+    // Returns the location of the given vertex attribute, or -1 if not found
+    GLint GetAttribute(const char* Key);
+    
     // Variable accessors
     void Uniform(const char* Key, GLint value);
     void Uniform(const char* Key, GLfloat value);
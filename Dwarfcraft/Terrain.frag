@@ -0,0 +1,21 @@
+// Terrain lighting: sky light is colored by the time of day, block light (torches,
+// lava) by its own color; the brightest of both wins, never below the ambient light
+
+uniform sampler2D TerrainTexture;
+uniform vec3 Daylight;
+uniform vec3 BlockLightColor;
+uniform float AmbientLight;
+
+varying vec2 Light;
+
+void main()
+{
+    // Light levels are given from 0 to 1; each of the 15 steps is 80% as bright as the next
+    float Sky = pow(0.8, 15.0 * (1.0 - Light.x));
+    float Block = pow(0.8, 15.0 * (1.0 - Light.y));
+    vec3 Lit = max(max(Daylight * Sky, BlockLightColor * Block), vec3(AmbientLight));
+    
+    // Keep the texture's alpha, so see-through texels (leaves, glass) are still cut out
+    vec4 Texel = texture2D(TerrainTexture, gl_TexCoord[0].st);
+    gl_FragColor = vec4(Texel.rgb * gl_Color.rgb * Lit, Texel.a);
+}
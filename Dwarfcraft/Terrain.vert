@@ -0,0 +1,13 @@
+// Terrain lighting: the vertex color holds the texture tint, face shading, and
+// ambient occlusion; the (sky, block) light levels come in as the second texture
+// coordinate set, and are lit per-fragment against the time of day
+
+varying vec2 Light;
+
+void main()
+{
+    gl_Position = ftransform();
+    gl_FrontColor = gl_Color;
+    gl_TexCoord[0] = gl_MultiTexCoord0;
+    Light = gl_MultiTexCoord1.xy;
+}
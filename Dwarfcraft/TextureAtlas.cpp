@@ -0,0 +1,425 @@
+/***************************************************************
+ 
+ DwarfCraft - Dwarf Fortress / Minecraft clone
+ Copyright 2011 Jeremy Bridon - See License.txt for info
+ 
+ This source file is developed and maintained by:
+ + Jeremy Bridon jbridon@cores2.com
+ 
+***************************************************************/
+
+#include "TextureAtlas.h"
+#include <sys/stat.h>
+
+// Internal: returns the modification time of the given file, or 0 if not found
+static unsigned int __TextureAtlas_GetTime(const char* FileName)
+{
+    struct stat FileInfo;
+    if(stat(FileName, &FileInfo) != 0)
+        return 0;
+    return (unsigned int)FileInfo.st_mtime;
+}
+
+TextureAtlas* TextureAtlas::GetShared()
+{
+    // Created once, lives for the rest of the application
+    static TextureAtlas* Shared = NULL;
+    if(Shared == NULL)
+        Shared = new TextureAtlas("Sprites.dca");
+    return Shared;
+}
+
+TextureAtlas::TextureAtlas(const char* CacheFile)
+{
+    // Nothing packed yet
+    Pages = NULL;
+    PageCount = PageCapacity = 0;
+    Entries = NULL;
+    EntryCount = EntryCapacity = 0;
+    
+    // Reload the previous run's atlas, if still valid
+    strncpy(this->CacheFile, CacheFile, TextureAtlas_MaxNameLength - 1);
+    this->CacheFile[TextureAtlas_MaxNameLength - 1] = 0;
+    IsDirty = !LoadCache();
+}
+
+TextureAtlas::~TextureAtlas()
+{
+    // Release all pages
+    for(int i = 0; i < PageCount; i++)
+    {
+        glDeleteTextures(1, &Pages[i].TextureID);
+        delete[] Pages[i].Nodes;
+    }
+    delete[] Pages;
+    delete[] Entries;
+}
+
+bool TextureAtlas::GetImage(const char* ImagePath, TextureAtlas_Image* ImageOut)
+{
+    // Already packed?
+    for(int i = 0; i < EntryCount; i++)
+    {
+        if(strcmp(Entries[i].FileName, ImagePath) == 0)
+        {
+            GetEntryImage(Entries[i], ImageOut);
+            return true;
+        }
+    }
+    
+    // Load the source image
+    unsigned char* Source = NULL;
+    int Width = 0, Height = 0, Channels = 0;
+    g2LoadImageBuffer(ImagePath, &Source, &Width, &Height, &Channels);
+    if(Source == NULL)
+        return false;
+    
+    // Find a spot, including the border
+    int Page, x, y;
+    if(strlen(ImagePath) >= size_t(TextureAtlas_MaxNameLength) || !Pack(Width + 2, Height + 2, &Page, &x, &y))
+    {
+        g2UnloadImageBuffer(Source);
+        return false;
+    }
+    
+    // Convert to RGBA, with each border pixel a copy of the nearest edge pixel
+    int PaddedWidth = Width + 2, PaddedHeight = Height + 2;
+    unsigned char* Pixels = new unsigned char[PaddedWidth * PaddedHeight * 4];
+    for(int py = 0; py < PaddedHeight; py++)
+    for(int px = 0; px < PaddedWidth; px++)
+    {
+        int sx = (px == 0) ? 0 : ((px > Width) ? Width - 1 : px - 1);
+        int sy = (py == 0) ? 0 : ((py > Height) ? Height - 1 : py - 1);
+        const unsigned char* Texel = &Source[(sy * Width + sx) * Channels];
+        unsigned char* Pixel = &Pixels[(py * PaddedWidth + px) * 4];
+        
+        // Gray, gray-alpha, RGB, or RGBA
+        if(Channels < 3)
+            Pixel[0] = Pixel[1] = Pixel[2] = Texel[0];
+        else
+        {
+            Pixel[0] = Texel[0];
+            Pixel[1] = Texel[1];
+            Pixel[2] = Texel[2];
+        }
+        Pixel[3] = (Channels == 2 || Channels == 4) ? Texel[Channels - 1] : 255;
+    }
+    g2UnloadImageBuffer(Source);
+    
+    // Copy into the page
+    glBindTexture(GL_TEXTURE_2D, Pages[Page].TextureID);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, PaddedWidth, PaddedHeight, GL_RGBA, GL_UNSIGNED_BYTE, Pixels);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    delete[] Pixels;
+    
+    // Grow the entry list as needed
+    if(EntryCount >= EntryCapacity)
+    {
+        EntryCapacity = (EntryCapacity == 0) ? 16 : (EntryCapacity * 2);
+        TextureAtlas_Entry* NewEntries = new TextureAtlas_Entry[EntryCapacity];
+        for(int i = 0; i < EntryCount; i++)
+            NewEntries[i] = Entries[i];
+        delete[] Entries;
+        Entries = NewEntries;
+    }
+    
+    // Save where it went (inside the border)
+    TextureAtlas_Entry& Entry = Entries[EntryCount++];
+    strcpy(Entry.FileName, ImagePath);
+    Entry.SourceTime = __TextureAtlas_GetTime(ImagePath);
+    Entry.Page = Page;
+    Entry.x = x + 1;
+    Entry.y = y + 1;
+    Entry.Width = Width;
+    Entry.Height = Height;
+    IsDirty = true;
+    
+    GetEntryImage(Entry, ImageOut);
+    return true;
+}
+
+bool TextureAtlas::SaveCache()
+{
+    // Ignore if the cache is already up to date
+    if(!IsDirty)
+        return true;
+    
+    FILE* CacheData = fopen(CacheFile, "wb");
+    if(CacheData == NULL)
+        return false;
+    
+    // Header and entries
+    TextureAtlas_Header Header;
+    memcpy(Header.Magic, TextureAtlas_Magic, sizeof(TextureAtlas_Magic));
+    Header.Version = TextureAtlas_Version;
+    Header.PageSize = TextureAtlas_PageSize;
+    Header.PageCount = PageCount;
+    Header.EntryCount = EntryCount;
+    
+    bool Success = (fwrite(&Header, sizeof(TextureAtlas_Header), 1, CacheData) == 1);
+    if(Success && EntryCount > 0)
+        Success = (fwrite(Entries, sizeof(TextureAtlas_Entry), EntryCount, CacheData) == size_t(EntryCount));
+    
+    // Each page's skyline, then its pixels, read back from the GPU
+    unsigned char* Pixels = new unsigned char[TextureAtlas_PageSize * TextureAtlas_PageSize * 4];
+    for(int i = 0; Success && i < PageCount; i++)
+    {
+        Success = (fwrite(&Pages[i].NodeCount, sizeof(int), 1, CacheData) == 1);
+        Success = Success && (fwrite(Pages[i].Nodes, sizeof(TextureAtlas_Node), Pages[i].NodeCount, CacheData) == size_t(Pages[i].NodeCount));
+        
+        glBindTexture(GL_TEXTURE_2D, Pages[i].TextureID);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, Pixels);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        Success = Success && (fwrite(Pixels, TextureAtlas_PageSize * TextureAtlas_PageSize * 4, 1, CacheData) == 1);
+    }
+    delete[] Pixels;
+    
+    // Never leave a partial file around
+    Success = (fclose(CacheData) == 0) && Success;
+    if(!Success)
+        remove(CacheFile);
+    else
+        IsDirty = false;
+    return Success;
+}
+
+int TextureAtlas::GetPageCount()
+{
+    return PageCount;
+}
+
+int TextureAtlas::GetImageCount()
+{
+    return EntryCount;
+}
+
+bool TextureAtlas::Pack(int Width, int Height, int* PageOut, int* xOut, int* yOut)
+{
+    // Can never fit
+    if(Width > TextureAtlas_PageSize || Height > TextureAtlas_PageSize)
+        return false;
+    
+    // Fill pages in order; within a page, take the spot where the image's top is lowest
+    for(int PageIndex = 0; PageIndex <= PageCount; PageIndex++)
+    {
+        // Out of pages: start a new one (which always fits)
+        if(PageIndex == PageCount)
+            AddPage();
+        
+        TextureAtlas_Page* Page = &Pages[PageIndex];
+        int BestNode = -1, BestTop = TextureAtlas_PageSize + 1, BestY = 0;
+        for(int i = 0; i < Page->NodeCount; i++)
+        {
+            int y = GetFitHeight(Page, i, Width, Height);
+            if(y >= 0 && y + Height < BestTop)
+            {
+                BestNode = i;
+                BestTop = y + Height;
+                BestY = y;
+            }
+        }
+        
+        if(BestNode >= 0)
+        {
+            *PageOut = PageIndex;
+            *xOut = Page->Nodes[BestNode].x;
+            *yOut = BestY;
+            AddSkyline(Page, BestNode, *xOut, BestY, Width, Height);
+            return true;
+        }
+    }
+    
+    // Never reached; a new page always fits
+    return false;
+}
+
+int TextureAtlas::GetFitHeight(TextureAtlas_Page* Page, int NodeIndex, int Width, int Height)
+{
+    // Must fit horizontally
+    int x = Page->Nodes[NodeIndex].x;
+    if(x + Width > TextureAtlas_PageSize)
+        return -1;
+    
+    // Sits on the highest node it spans; must fit vertically there
+    int y = 0;
+    int Remaining = Width;
+    for(int i = NodeIndex; Remaining > 0 && i < Page->NodeCount; i++)
+    {
+        if(Page->Nodes[i].y > y)
+            y = Page->Nodes[i].y;
+        if(y + Height > TextureAtlas_PageSize)
+            return -1;
+        Remaining -= Page->Nodes[i].Width;
+    }
+    return y;
+}
+
+void TextureAtlas::AddSkyline(TextureAtlas_Page* Page, int NodeIndex, int x, int y, int Width, int Height)
+{
+    // Insert the new top edge before the node it was placed on
+    TextureAtlas_Node* Nodes = Page->Nodes;
+    for(int i = Page->NodeCount; i > NodeIndex; i--)
+        Nodes[i] = Nodes[i - 1];
+    Nodes[NodeIndex].x = x;
+    Nodes[NodeIndex].y = y + Height;
+    Nodes[NodeIndex].Width = Width;
+    Page->NodeCount++;
+    
+    // Cut away whatever the new edge now covers
+    int Right = x + Width;
+    int i = NodeIndex + 1;
+    while(i < Page->NodeCount && Nodes[i].x < Right)
+    {
+        int Overlap = Right - Nodes[i].x;
+        if(Overlap < Nodes[i].Width)
+        {
+            Nodes[i].x += Overlap;
+            Nodes[i].Width -= Overlap;
+            break;
+        }
+        
+        // Fully covered; remove it
+        for(int j = i; j < Page->NodeCount - 1; j++)
+            Nodes[j] = Nodes[j + 1];
+        Page->NodeCount--;
+    }
+    
+    // Merge neighbors of the same height
+    for(int j = 0; j < Page->NodeCount - 1; )
+    {
+        if(Nodes[j].y == Nodes[j + 1].y)
+        {
+            Nodes[j].Width += Nodes[j + 1].Width;
+            for(int k = j + 1; k < Page->NodeCount - 1; k++)
+                Nodes[k] = Nodes[k + 1];
+            Page->NodeCount--;
+        }
+        else
+            j++;
+    }
+}
+
+int TextureAtlas::AddPage(const unsigned char* Pixels)
+{
+    // Grow the page list as needed
+    if(PageCount >= PageCapacity)
+    {
+        PageCapacity = (PageCapacity == 0) ? 2 : (PageCapacity * 2);
+        TextureAtlas_Page* NewPages = new TextureAtlas_Page[PageCapacity];
+        for(int i = 0; i < PageCount; i++)
+            NewPages[i] = Pages[i];
+        delete[] Pages;
+        Pages = NewPages;
+    }
+    
+    // A flat, empty skyline; a skyline never has more nodes than the page has columns
+    TextureAtlas_Page& Page = Pages[PageCount];
+    Page.Nodes = new TextureAtlas_Node[TextureAtlas_PageSize + 1];
+    Page.Nodes[0].x = Page.Nodes[0].y = 0;
+    Page.Nodes[0].Width = TextureAtlas_PageSize;
+    Page.NodeCount = 1;
+    
+    // Empty pages are cleared to transparent, so unused areas are well defined in the cache
+    unsigned char* Cleared = NULL;
+    if(Pixels == NULL)
+    {
+        Cleared = new unsigned char[TextureAtlas_PageSize * TextureAtlas_PageSize * 4];
+        memset(Cleared, 0, TextureAtlas_PageSize * TextureAtlas_PageSize * 4);
+        Pixels = Cleared;
+    }
+    
+    // Sprites are pixel art; no filtering, no wrapping
+    glGenTextures(1, &Page.TextureID);
+    glBindTexture(GL_TEXTURE_2D, Page.TextureID);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, TextureAtlas_PageSize, TextureAtlas_PageSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, Pixels);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    
+    delete[] Cleared;
+    return PageCount++;
+}
+
+bool TextureAtlas::LoadCache()
+{
+    FILE* CacheData = fopen(CacheFile, "rb");
+    if(CacheData == NULL)
+        return false;
+    
+    // Must be our format, of this version and page size
+    TextureAtlas_Header Header;
+    if(fread(&Header, sizeof(TextureAtlas_Header), 1, CacheData) != 1 || memcmp(Header.Magic, TextureAtlas_Magic, sizeof(TextureAtlas_Magic)) != 0 ||
+       Header.Version != TextureAtlas_Version || Header.PageSize != TextureAtlas_PageSize || Header.PageCount < 0 || Header.EntryCount < 0)
+    {
+        fclose(CacheData);
+        return false;
+    }
+    
+    // Every source image must be unchanged since it was packed
+    TextureAtlas_Entry* CachedEntries = new TextureAtlas_Entry[Header.EntryCount > 0 ? Header.EntryCount : 1];
+    bool IsValid = (fread(CachedEntries, sizeof(TextureAtlas_Entry), Header.EntryCount, CacheData) == size_t(Header.EntryCount));
+    for(int i = 0; IsValid && i < Header.EntryCount; i++)
+    {
+        CachedEntries[i].FileName[TextureAtlas_MaxNameLength - 1] = 0;
+        IsValid = CachedEntries[i].Page >= 0 && CachedEntries[i].Page < Header.PageCount && CachedEntries[i].SourceTime == __TextureAtlas_GetTime(CachedEntries[i].FileName);
+    }
+    
+    // Read back each page
+    unsigned char* Pixels = new unsigned char[TextureAtlas_PageSize * TextureAtlas_PageSize * 4];
+    for(int i = 0; IsValid && i < Header.PageCount; i++)
+    {
+        int NodeCount = 0;
+        IsValid = (fread(&NodeCount, sizeof(int), 1, CacheData) == 1) && NodeCount > 0 && NodeCount <= TextureAtlas_PageSize;
+        if(!IsValid)
+            break;
+        
+        TextureAtlas_Node* Nodes = new TextureAtlas_Node[NodeCount];
+        IsValid = (fread(Nodes, sizeof(TextureAtlas_Node), NodeCount, CacheData) == size_t(NodeCount));
+        IsValid = IsValid && (fread(Pixels, TextureAtlas_PageSize * TextureAtlas_PageSize * 4, 1, CacheData) == 1);
+        if(IsValid)
+        {
+            int PageIndex = AddPage(Pixels);
+            memcpy(Pages[PageIndex].Nodes, Nodes, sizeof(TextureAtlas_Node) * NodeCount);
+            Pages[PageIndex].NodeCount = NodeCount;
+        }
+        delete[] Nodes;
+    }
+    delete[] Pixels;
+    fclose(CacheData);
+    
+    // Keep the entries, or throw everything away
+    if(IsValid)
+    {
+        Entries = CachedEntries;
+        EntryCount = EntryCapacity = Header.EntryCount;
+        if(EntryCapacity == 0)
+            EntryCapacity = 1;
+    }
+    else
+    {
+        delete[] CachedEntries;
+        for(int i = 0; i < PageCount; i++)
+        {
+            glDeleteTextures(1, &Pages[i].TextureID);
+            delete[] Pages[i].Nodes;
+        }
+        PageCount = 0;
+    }
+    return IsValid;
+}
+
+void TextureAtlas::GetEntryImage(const TextureAtlas_Entry& Entry, TextureAtlas_Image* ImageOut)
+{
+    ImageOut->TextureID = Pages[Entry.Page].TextureID;
+    ImageOut->u = float(Entry.x) / float(TextureAtlas_PageSize);
+    ImageOut->v = float(Entry.y) / float(TextureAtlas_PageSize);
+    ImageOut->Width = float(Entry.Width) / float(TextureAtlas_PageSize);
+    ImageOut->Height = float(Entry.Height) / float(TextureAtlas_PageSize);
+    ImageOut->PixelWidth = Entry.Width;
+    ImageOut->PixelHeight = Entry.Height;
+}
@@ -0,0 +1,150 @@
+/***************************************************************
+ 
+ DwarfCraft - Dwarf Fortress / Minecraft clone
+ Copyright 2011 Jeremy Bridon - See License.txt for info
+ 
+ This source file is developed and maintained by:
+ + Jeremy Bridon jbridon@cores2.com
+ 
+ File: TextureAtlas.h/cpp
+ Desc: Packs many small images (entity sprite sheets, wearables,
+ items) into a few large texture pages, so that everything drawn
+ from them shares a handful of textures: sprites of different
+ sheets can be batched into the same draw call, and each image is
+ on the GPU only once.
+ 
+ Images are packed on first request with a skyline packer (each
+ page keeps the outline of its packed area's top edge, and an
+ image goes wherever it would sit lowest). Each image has a one
+ pixel border, copied from its edge, so filtering never samples a
+ neighboring image.
+ 
+ The packed pages and image placements are cached in a binary file
+ and reloaded on the next start, as long as none of the source
+ images changed, so no image needs to be decoded or packed again.
+ 
+***************************************************************/
+
+// Inclusion guard
+#ifndef __TEXTUREATLAS_H__
+#define __TEXTUREATLAS_H__
+
+#include "MUtil.h"
+
+// Width and height of each atlas page, in pixels
+static const int TextureAtlas_PageSize = 2048;
+
+// Cache file magic number and version; bump the version on any layout change
+static const char TextureAtlas_Magic[4] = {'D', 'C', 'T', 'A'};
+static const int TextureAtlas_Version = 1;
+
+// Max length of a source image's file name
+static const int TextureAtlas_MaxNameLength = 256;
+
+// Where an image was packed: the source file and its modification time,
+// the page, and the image's pixel rectangle within the page (border excluded)
+struct TextureAtlas_Entry
+{
+    char FileName[TextureAtlas_MaxNameLength];
+    unsigned int SourceTime;
+    int Page;
+    int x, y, Width, Height;
+};
+
+// A segment of a page's skyline: the packed area's top edge, from x to x + Width, is at y
+struct TextureAtlas_Node
+{
+    int x, y, Width;
+};
+
+// A single atlas page
+struct TextureAtlas_Page
+{
+    GLuint TextureID;
+    
+    // Skyline, left to right, always covering the whole page width
+    TextureAtlas_Node* Nodes;
+    int NodeCount;
+};
+
+// An image's location in the atlas: its page's texture, its UV rectangle, and its size in pixels
+struct TextureAtlas_Image
+{
+    GLuint TextureID;
+    float u, v, Width, Height;
+    int PixelWidth, PixelHeight;
+};
+
+// Cache file header, directly followed by the entries, then each page's node count, nodes, and RGBA pixels
+struct TextureAtlas_Header
+{
+    char Magic[4];
+    int Version;
+    int PageSize;
+    int PageCount;
+    int EntryCount;
+};
+
+// Convert a UV rectangle within an image (0 to 1 across the image) into its UV rectangle within the atlas
+inline void TextureAtlas_ToAtlas(const TextureAtlas_Image& Image, float* x, float* y, float* width, float* height)
+{
+    *x = Image.u + *x * Image.Width;
+    *y = Image.v + *y * Image.Height;
+    *width *= Image.Width;
+    *height *= Image.Height;
+}
+
+class TextureAtlas
+{
+public:
+    
+    // The atlas shared by all sprites; created (and its cache loaded) on first use
+    static TextureAtlas* GetShared();
+    
+    // Creates an atlas, reloading the given cache file if it is still valid
+    TextureAtlas(const char* CacheFile);
+    ~TextureAtlas();
+    
+    // Find the given image in the atlas, packing it on the first request; returns false if it can't be loaded or packed
+    bool GetImage(const char* ImagePath, TextureAtlas_Image* ImageOut);
+    
+    // Write the cache file, only if any image was packed since it was loaded; returns false on failure
+    bool SaveCache();
+    
+    // Number of pages and images
+    int GetPageCount();
+    int GetImageCount();
+    
+private:
+    
+    // Find the lowest spot fitting the given size (border included) in any page, adding a page if needed
+    bool Pack(int Width, int Height, int* PageOut, int* xOut, int* yOut);
+    
+    // Returns the height the given size would sit at if placed on the given skyline node, or -1 if it doesn't fit
+    int GetFitHeight(TextureAtlas_Page* Page, int NodeIndex, int Width, int Height);
+    
+    // Raise the given page's skyline over a newly packed rectangle
+    void AddSkyline(TextureAtlas_Page* Page, int NodeIndex, int x, int y, int Width, int Height);
+    
+    // Add an empty page (with the given pixels, if any); returns its index
+    int AddPage(const unsigned char* Pixels = NULL);
+    
+    // Reload the cache file; returns false (and leaves the atlas empty) if missing or out of date
+    bool LoadCache();
+    
+    // Fill the given image from the given entry
+    void GetEntryImage(const TextureAtlas_Entry& Entry, TextureAtlas_Image* ImageOut);
+    
+    // Cache file name, and true if anything changed since it was loaded or saved
+    char CacheFile[TextureAtlas_MaxNameLength];
+    bool IsDirty;
+    
+    // All pages and packed images
+    TextureAtlas_Page* Pages;
+    int PageCount, PageCapacity;
+    TextureAtlas_Entry* Entries;
+    int EntryCount, EntryCapacity;
+};
+
+// End of inclusion guard
+#endif
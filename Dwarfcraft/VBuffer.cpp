@@ -9,16 +9,24 @@
 ***************************************************************/
 
 #include "VBuffer.h"
+#include "ModelFile.h"
 
-VBuffer::VBuffer(GLuint GeometryType, GLuint TextureID)
+VBuffer::VBuffer(GLuint GeometryType, GLuint TextureID, bool IsLit)
 {
     // Save the geometry type used for rendering and the texture ID
     this->GeometryType = GeometryType;
     this->TextureID = TextureID;
     
+    // Vertex layout
+    this->IsLit = IsLit;
+    FloatsPerVertex = IsLit ? VBuffer_FloatsPerLitVertex : VBuffer_FloatsPerVertex;
+    
     // Default to no allocation
     BufferID = 0;
     VertexCount = -1;
+    VertexCapacity = 0;
+    IndexBufferID = 0;
+    IndexCount = 0;
 }
 
 VBuffer::~VBuffer()
@@ -35,9 +43,16 @@ VBuffer::VBuffer(const char* ObxFile)
     GeometryType = GL_TRIANGLES;
     TextureID = -1;
     
+    // Same vertex layout as the binary model files
+    IsLit = false;
+    FloatsPerVertex = VBuffer_FloatsPerVertex;
+    
     // Default to no allocation
     BufferID = 0;
     VertexCount = -1;
+    VertexCapacity = 0;
+    IndexBufferID = 0;
+    IndexCount = 0;
     
     /*** Load Data ***/
     
@@ -51,25 +66,30 @@ VBuffer::VBuffer(const char* ObxFile)
     char* TextureFileName;
     Config.GetValue("General", "Texture", &TextureFileName);
     
-    // Load the model file and push all the vertices
-    FILE* ModelData = fopen(ModelFileName, "r");
-    UtilAssert(ModelData != NULL, "Unable to load \"%s\" as the source model data", ModelFileName);
+    // Map the binary model (built from the source model if needed)
+    ModelFile Model;
+    UtilAssert(Model.Load(ModelFileName), "Unable to load \"%s\" as the source model data", ModelFileName);
     
-    // Keep reading until eof
-    Vector3<float> Pos;
-    Vector2<float> UV;
-    while(fscanf(ModelData, "%f %f %f %f %f", &Pos.x, &Pos.y, &Pos.z, &UV.x, &UV.y) == 5)
+    // Upload the vertices straight from the mapping
+    VertexCount = Model.GetVertexCount();
+    if(VertexCount > 0)
     {
-        // Invert UV because of texture offsets
-        UV.y = 1.0f - UV.y;
-        
-        // Add vertex with white color
-        AddVertex(Pos, Vector3<float>(1, 1, 1), UV);
+        glGenBuffers(1, &BufferID);
+        glBindBuffer(GL_ARRAY_BUFFER, BufferID);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(float) * VertexCount * VBuffer_FloatsPerVertex, (void*)Model.GetVertices(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        VertexCapacity = VertexCount;
     }
-    fclose(ModelData);
     
-    // Build model
-    Generate();
+    // Upload the indices, if any
+    IndexCount = Model.GetIndexCount();
+    if(VertexCount > 0 && IndexCount > 0)
+    {
+        glGenBuffers(1, &IndexBufferID);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IndexBufferID);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned short) * IndexCount, (void*)Model.GetIndices(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    }
     
     // Load the texture
     TextureID = g2LoadImage(TextureFileName, NULL, NULL, NULL, false, false);
@@ -82,6 +102,21 @@ void VBuffer::AddVertex(Vector3<float> VertexPos, Vector3<float> ColorPos, Vecto
     VertexPositions.Enqueue(VertexPos);
     ColorValues.Enqueue(ColorPos);
     TexturePositions.Enqueue(TexturePos);
+    
+    // Fully sky-lit by default
+    if(IsLit)
+        LightValues.Enqueue(Vector2<float>(1, 0));
+}
+
+void VBuffer::AddVertex(Vector3<float> VertexPos, Vector3<float> ColorPos, Vector2<float> TexturePos, Vector2<float> LightVal)
+{
+    VertexPositions.Enqueue(VertexPos);
+    ColorValues.Enqueue(ColorPos);
+    TexturePositions.Enqueue(TexturePos);
+    
+    // Ignored if not lit
+    if(IsLit)
+        LightValues.Enqueue(LightVal);
 }
 
 void VBuffer::Clear()
@@ -93,29 +128,37 @@ void VBuffer::Clear()
         ColorValues.Dequeue();
     while(!TexturePositions.IsEmpty())
         TexturePositions.Dequeue();
+    while(!LightValues.IsEmpty())
+        LightValues.Dequeue();
     
     // Release the VBO itself
-    glDeleteBuffers(1, &BufferID);
+    if(BufferID != 0)
+        glDeleteBuffers(1, &BufferID);
+    BufferID = 0;
     VertexCount = -1;
+    VertexCapacity = 0;
+    
+    // Release the index buffer
+    if(IndexBufferID != 0)
+        glDeleteBuffers(1, &IndexBufferID);
+    IndexBufferID = 0;
+    IndexCount = 0;
 }
 
 void VBuffer::Generate()
 {
-    // Release the VBO itself
-    glDeleteBuffers(1, &BufferID);
-    
-    // Don't generate if no data
+    // Don't generate if no data, but keep the VBO around for re-use
     if(VertexPositions.IsEmpty())
     {
-        BufferID = -1;
+        VertexCount = 0;
         return;
     }
     
     // Number of vertices
     VertexCount = (int)VertexPositions.GetSize();
-    float* Vertices = new float[VertexCount * VBuffer_FloatsPerVertex];
+    float* Vertices = new float[VertexCount * FloatsPerVertex];
     
-    // Copy over each element's sub structures of ((x,y,z)(u,v)(r,g,b))
+    // Copy over each element's sub structures of ((x,y,z)(u,v)(r,g,b)), then (sky,block) if lit
     int Index = 0;
     for(int i = 0; i < VertexCount; i++)
     {
@@ -126,12 +169,31 @@ void VBuffer::Generate()
         Vertices[Index++] = VertexPos.x; Vertices[Index++] = VertexPos.y; Vertices[Index++] = VertexPos.z;
         Vertices[Index++] = TexturePos.x; Vertices[Index++] = TexturePos.y;
         Vertices[Index++] = ColorPos.x; Vertices[Index++] = ColorPos.y; Vertices[Index++] = ColorPos.z;
+        
+        if(IsLit)
+        {
+            Vector2<float> LightVal = LightValues.Dequeue();
+            Vertices[Index++] = LightVal.x; Vertices[Index++] = LightVal.y;
+        }
     }
     
-    // Ask for a vertex buffer and copy into it
-    glGenBuffers(1, &BufferID);
-    glBindBuffer(GL_ARRAY_BUFFER, BufferID);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * VertexCount * VBuffer_FloatsPerVertex, (void*)Vertices, GL_STATIC_DRAW);
+    // If it fits in the current buffer, just overwrite the front of it
+    if(BufferID != 0 && VertexCount <= VertexCapacity)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, BufferID);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(float) * VertexCount * FloatsPerVertex, (void*)Vertices);
+    }
+    // Else, release the old one (if any); ask for a vertex buffer and copy into it
+    else
+    {
+        if(BufferID != 0)
+            glDeleteBuffers(1, &BufferID);
+        
+        glGenBuffers(1, &BufferID);
+        glBindBuffer(GL_ARRAY_BUFFER, BufferID);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(float) * VertexCount * FloatsPerVertex, (void*)Vertices, GL_STATIC_DRAW);
+        VertexCapacity = VertexCount;
+    }
     
     // Unbind buffers
     glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -146,8 +208,76 @@ void VBuffer::Render()
     if(BufferID == 0 || VertexCount <= 0)
         return;
     
+    // Render based on a face index system
+    // Number of faces, not total floats (4 vertices per face)
+    BeginRender();
+    DrawGeometry();
+    EndRender();
+}
+
+void VBuffer::RenderGeometry()
+{
+    // Ignore if not yet generated
+    if(BufferID == 0 || VertexCount <= 0)
+        return;
+    
+    BeginRender(false);
+    DrawGeometry();
+    EndRender(false);
+}
+
+GLuint VBuffer::GetTextureID()
+{
+    return TextureID;
+}
+
+void VBuffer::RenderInstances(const float* Instances, int InstanceCount, GLint InstanceAttribute)
+{
+    // Ignore if not yet generated or nothing to draw
+    if(BufferID == 0 || VertexCount <= 0 || InstanceCount <= 0)
+        return;
+    
+    BeginRender();
+    
+    // Hardware instancing: the instance data is a client-side array, advanced once per instance
+    if(InstanceAttribute >= 0)
+    {
+        // Unbind the VBO only while pointing to the instance data (the vertex pointers keep their VBO)
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glEnableVertexAttribArray(InstanceAttribute);
+        glVertexAttribPointer(InstanceAttribute, 4, GL_FLOAT, GL_FALSE, sizeof(float) * 4, Instances);
+        glVertexAttribDivisorARB(InstanceAttribute, 1);
+        
+        if(IndexBufferID != 0)
+            glDrawElementsInstancedARB(GeometryType, IndexCount, GL_UNSIGNED_SHORT, 0, InstanceCount);
+        else
+            glDrawArraysInstancedARB(GeometryType, 0, VertexCount, InstanceCount);
+        
+        glVertexAttribDivisorARB(InstanceAttribute, 0);
+        glDisableVertexAttribArray(InstanceAttribute);
+    }
+    // Else, one draw call per instance, but no state changes in between
+    else
+    {
+        for(int i = 0; i < InstanceCount; i++)
+        {
+            const float* Instance = &Instances[i * 4];
+            glPushMatrix();
+                glTranslatef(Instance[0] + 0.5f, Instance[1], Instance[2] + 0.5f);
+                glRotatef(Instance[3] * 180.0f / UtilPI, 0.0f, 1.0f, 0.0f);
+                glTranslatef(-0.5f, 0.0f, -0.5f);
+                DrawGeometry();
+            glPopMatrix();
+        }
+    }
+    
+    EndRender();
+}
+
+void VBuffer::BeginRender(bool BindTexture)
+{
     // Enable texture
-    if(TextureID > 0)
+    if(BindTexture && TextureID > 0)
     {
         glEnable(GL_TEXTURE_2D);
         glBindTexture(GL_TEXTURE_2D, TextureID);
@@ -160,36 +290,67 @@ void VBuffer::Render()
     
     // Bind VBO as the active vertex data and vertex index
     glBindBuffer(GL_ARRAY_BUFFER, BufferID);
+    if(IndexBufferID != 0)
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IndexBufferID);
     
     // Set the vertex structure, which is a repeated pattern
     // of [(x,y,z),(u,v),(r,g,b)] with the first tuple being the actual
     // vertices (each element being a float)
-    glTexCoordPointer(2, GL_FLOAT, sizeof(float) * VBuffer_FloatsPerVertex, (char *)NULL + (sizeof(float) * 3));
+    glTexCoordPointer(2, GL_FLOAT, sizeof(float) * FloatsPerVertex, (char *)NULL + (sizeof(float) * 3));
     
     // Define color
-    glColorPointer(3, GL_FLOAT, sizeof(float) * VBuffer_FloatsPerVertex, (char *)NULL + (sizeof(float) * 5));
+    glColorPointer(3, GL_FLOAT, sizeof(float) * FloatsPerVertex, (char *)NULL + (sizeof(float) * 5));
     
     // Define vertices
-    glVertexPointer(3, GL_FLOAT, sizeof(float) * VBuffer_FloatsPerVertex, 0);
-    
-    // Render based on a face index system
-    // Number of faces, not total floats (4 vertices per face)
-    glDrawArrays(GeometryType, 0, VertexCount);
+    glVertexPointer(3, GL_FLOAT, sizeof(float) * FloatsPerVertex, 0);
     
+    // Define light values as the second texture coordinate set
+    if(IsLit)
+    {
+        glClientActiveTexture(GL_TEXTURE1);
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+        glTexCoordPointer(2, GL_FLOAT, sizeof(float) * FloatsPerVertex, (char *)NULL + (sizeof(float) * 8));
+        glClientActiveTexture(GL_TEXTURE0);
+    }
+}
+
+void VBuffer::EndRender(bool BindTexture)
+{
     // Done dwaring VBOs
+    if(IsLit)
+    {
+        glClientActiveTexture(GL_TEXTURE1);
+        glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+        glClientActiveTexture(GL_TEXTURE0);
+    }
     glDisableClientState(GL_VERTEX_ARRAY);
     glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-    glEnableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_COLOR_ARRAY);
     
     // Switch back to regular pointer operations
     glBindBuffer(GL_ARRAY_BUFFER, 0);
+    if(IndexBufferID != 0)
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     
     // Turn off texturing
-    if(TextureID > 0)
+    if(BindTexture && TextureID > 0)
         glDisable(GL_TEXTURE_2D);
 }
 
+void VBuffer::DrawGeometry()
+{
+    if(IndexBufferID != 0)
+        glDrawElements(GeometryType, IndexCount, GL_UNSIGNED_SHORT, 0);
+    else
+        glDrawArrays(GeometryType, 0, VertexCount);
+}
+
 bool VBuffer::IsEmpty()
 {
     return VertexPositions.IsEmpty();
 }
+
+bool VBuffer::HasGeometry()
+{
+    return BufferID != 0 && VertexCount > 0;
+}
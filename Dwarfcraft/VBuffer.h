@@ -30,44 +30,88 @@
 // Number of floats per vertex entry ((x,y,z)(u,v)(r,g,b))
 static const int VBuffer_FloatsPerVertex = 8;
 
+// Number of floats per vertex entry with light values ((x,y,z)(u,v)(r,g,b)(sky,block))
+static const int VBuffer_FloatsPerLitVertex = 10;
+
 class VBuffer
 {
 public:
     
     // Construct & release buffers
-    VBuffer(GLuint GeometryType, GLuint TextureID);
+    // If lit, every vertex also has a sky and block light value (0 to 1), given to
+    // shaders as the second texture coordinate set (gl_MultiTexCoord1.xy)
+    VBuffer(GLuint GeometryType, GLuint TextureID, bool IsLit = false);
     ~VBuffer();
     
     // Specialty constructor; takes the config-file name to load both a *.obx and texture file
+    // The model is loaded through its binary model file (see ModelFile), uploaded as-is,
+    // and drawn indexed; no working buffers are kept around
     VBuffer(const char* ObxFile);
     
     // Add a vertex to the object
     void AddVertex(Vector3<float> VertexPos, Vector3<float> ColorVal, Vector2<float> TexturePos);
     
-    // Clear all vertices
+    // Add a vertex with its (sky, block) light values; only for lit buffers
+    void AddVertex(Vector3<float> VertexPos, Vector3<float> ColorVal, Vector2<float> TexturePos, Vector2<float> LightVal);
+    
+    // Clear all vertices and release the VBO
     void Clear();
     
-    // Generate actual VBO (releasing any previous object in memory)
+    // Generate actual VBO; if a VBO was already generated and the new geometry fits
+    // within it, its memory is re-used (glBufferSubData), else it is re-allocated
     void Generate();
     
     // Render object
     void Render();
     
+    // Render object without touching any texture states; the caller enables and binds
+    // the texture (see RenderQueue, which sets it once for many buffers)
+    void RenderGeometry();
+    
+    // Returns the texture this object is drawn with (0 if none)
+    GLuint GetTextureID();
+    
+    // Render many copies of the object in one go; each instance is four floats: the (x, y, z)
+    // translation followed by the rotation (radians) about the y axis, through the block's center
+    // If an instance attribute (of the currently active shader) is given, the instances are drawn
+    // with a single instanced draw call, with the instance data bound to that attribute
+    // Else, each instance is drawn with its own transform, but with all states set only once
+    void RenderInstances(const float* Instances, int InstanceCount, GLint InstanceAttribute = -1);
+    
     // Returns true if there is no geometry content
     bool IsEmpty();
     
+    // Returns true if there is generated geometry to draw
+    bool HasGeometry();
+    
 private:
     
+    // Bind the texture (unless told not to), VBO, and vertex layout; and undo it all
+    void BeginRender(bool BindTexture = true);
+    void EndRender(bool BindTexture = true);
+    
+    // Issue the draw call for the bound geometry (indexed if there is an index buffer)
+    void DrawGeometry();
+    
     // Working buffer of vertex, color, and texture data (all in parallel)
     Queue< Vector3<float> > VertexPositions;
     Queue< Vector3<float> > ColorValues;
     Queue< Vector2<float> > TexturePositions;
+    Queue< Vector2<float> > LightValues;
+    
+    // True if the vertices have light values, and the number of floats per vertex
+    bool IsLit;
+    int FloatsPerVertex;
     
     // OpenGL VBO index, geometry type, and texture ID
     GLuint BufferID, GeometryType, TextureID;
     
-    // Total number of vertices in the vertex buffer
-    int VertexCount;
+    // Total number of vertices in the vertex buffer, and how many vertices it can hold
+    int VertexCount, VertexCapacity;
+    
+    // Optional index buffer (unsigned shorts) and its number of indices
+    GLuint IndexBufferID;
+    int IndexCount;
 };
 
 #endif
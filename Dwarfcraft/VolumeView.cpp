@@ -10,6 +10,7 @@
 
 #include "VolumeView.h"
 #include "DwarfEntity.h"
+#include "PathGraph.h"
 
 VolumeView::VolumeView(WorldContainer* MainWorld, g2Theme* MainTheme)
 {
@@ -19,10 +20,39 @@ VolumeView::VolumeView(WorldContainer* MainWorld, g2Theme* MainTheme)
     
     // Get the icon texture info
     MainTheme->GetComponent("IconsList", &IconSrcX, &IconSrcY, &IconSrcW, &IconSrcH, NULL, NULL, &IconTextureID);
+    
+    // No overlays or scratch data yet
+    Overlays = NULL;
+    OverlayCount = OverlayCapacity = 0;
+    Tiles = NULL;
+    TileCount = TileCapacity = 0;
+    Vertices = NULL;
+    VertexCapacity = 0;
+    NextVolumeID = 0;
+    NextJobID = 0;
+    
+    // Job tile shader; all icons are in the same texture
+    OverlayShader = new Shader("Designation.vert", "Designation.frag");
+    OverlayShader->Uniform("IconTexture", 0);
+    Phase = 0.0f;
+    
+    // Rebuild overlays as blocks under them change
+    WorldData->AddListener(this);
 }
 
 VolumeView::~VolumeView()
 {
+    // Stop listening to the world
+    WorldData->RemoveListener(this);
+    
+    // Release all overlays
+    for(int i = 0; i < OverlayCount; i++)
+        glDeleteBuffers(1, &Overlays[i].BufferID);
+    delete[] Overlays;
+    delete[] Tiles;
+    delete[] Vertices;
+    delete OverlayShader;
+    
     // Drop lock
     pthread_mutex_destroy(&VolumeLock);
 }
@@ -60,9 +90,7 @@ void VolumeView::AddBuilding(UI_BuildMenu Type, Vector3<int> Origin, Vector3<int
     if(Task->Jobs.GetSize() > 0)
     {
         pthread_mutex_lock(&VolumeLock);
-            int EndIndex = BuildingList.GetSize();
-            BuildingList.Resize(EndIndex + 1);
-            BuildingList[EndIndex] = Task;
+            AddVolume(&BuildingList, Task);
         pthread_mutex_unlock(&VolumeLock);
     }
     // Else, release
@@ -104,9 +132,7 @@ void VolumeView::AddDesignation(UI_DesignationMenu Type, Vector3<int> Origin, Ve
     if(Task->Jobs.GetSize() > 0)
     {
         pthread_mutex_lock(&VolumeLock);
-            int EndIndex = DesignationList.GetSize();
-            DesignationList.Resize(EndIndex + 1);
-            DesignationList[EndIndex] = Task;
+            AddVolume(&DesignationList, Task);
         pthread_mutex_unlock(&VolumeLock);
     }
     // Else, release
@@ -147,9 +173,7 @@ void VolumeView::AddStockpile(UI_StockpilesMenu Type, Vector3<int> Origin, Vecto
     if(Task->Jobs.GetSize() > 0)
     {
         pthread_mutex_lock(&VolumeLock);
-            int EndIndex = StockpileList.GetSize();
-            StockpileList.Resize(EndIndex + 1);
-            StockpileList[EndIndex] = Task;
+            AddVolume(&StockpileList, Task);
         pthread_mutex_unlock(&VolumeLock);
     }
     // Else, release
@@ -160,7 +184,7 @@ void VolumeView::AddStockpile(UI_StockpilesMenu Type, Vector3<int> Origin, Vecto
 void VolumeView::AddZone(UI_ZonesMenu Type, Vector3<int> Origin, Vector3<int> Volume)
 {
     // Allocate
-    VolumeTask* Task = new VolumeTask(UI_RootMenu_Stockpiles, (int)Type, Origin, Volume);
+    VolumeTask* Task = new VolumeTask(UI_RootMenu_Zones, (int)Type, Origin, Volume);
     
     // Create all the jobs
     for(int y = Origin.y; y < Origin.y + Volume.y; y++)
@@ -190,9 +214,7 @@ void VolumeView::AddZone(UI_ZonesMenu Type, Vector3<int> Origin, Vector3<int> Vo
     if(Task->Jobs.GetSize() > 0)
     {
         pthread_mutex_lock(&VolumeLock);
-            int EndIndex = ZoneList.GetSize();
-            ZoneList.Resize(EndIndex + 1);
-            ZoneList[EndIndex] = Task;
+            AddVolume(&ZoneList, Task);
         pthread_mutex_unlock(&VolumeLock);
     }
     // Else, release
@@ -200,6 +222,28 @@ void VolumeView::AddZone(UI_ZonesMenu Type, Vector3<int> Origin, Vector3<int> Vo
         delete Task;
 }
 
+bool VolumeView::GetZone(UI_ZonesMenu Type, Vector3<int>* MinOut, Vector3<int>* MaxOut)
+{
+    // Lock since we are going to read list data
+    pthread_mutex_lock(&VolumeLock);
+    
+    // First zone of this type
+    bool Found = false;
+    for(int i = 0; i < ZoneList.GetSize() && !Found; i++)
+    {
+        VolumeTask* Volume = ZoneList[i];
+        if(Volume->Category == UI_RootMenu_Zones && Volume->Type.Zone == Type)
+        {
+            *MinOut = Volume->Origin;
+            *MaxOut = Volume->Origin + Volume->Volume - Vector3<int>(1, 1, 1);
+            Found = true;
+        }
+    }
+    
+    pthread_mutex_unlock(&VolumeLock);
+    return Found;
+}
+
 bool VolumeView::GetJob(DwarfEntity* Dwarf, JobTask** JobOut)
 {
     // Build a list of highest preference to lowesr preference
@@ -216,6 +260,12 @@ bool VolumeView::GetJob(DwarfEntity* Dwarf, JobTask** JobOut)
         }
     }
     
+    // Jobs the dwarf can't reach at all are rejected (if the world has a path graph); bring the graph up
+    // to date first, so it is never rebuilt while the volumes are locked
+    PathGraph* Graph = PathGraph::Acquire(WorldData);
+    if(Graph != NULL)
+        Graph->Update();
+    
     // Lock since we are going to read list data
     pthread_mutex_lock(&VolumeLock);
     
@@ -229,18 +279,86 @@ bool VolumeView::GetJob(DwarfEntity* Dwarf, JobTask** JobOut)
         if(Job == DwarfJobs_Farmer)
             GotJob = GetFarmerJob(Dwarf, JobOut);
         else if(Job == DwarfJobs_Miner)
-            GotJob = GetMiningJob(Dwarf, JobOut);
+            GotJob = GetMiningJob(Dwarf, Graph, JobOut);
         else if(Job == DwarfJobs_Crafter)
             GotJob = GetCrafterJob(Dwarf, JobOut);
     }
     
     // Done working
     pthread_mutex_unlock(&VolumeLock);
+    if(Graph != NULL)
+        Graph->Release();
     
     // Returns true if we ever found a job
     return GotJob;
 }
 
+int VolumeView::GetJobCandidates(DwarfEntity* Dwarf, JobTask* JobsOut, int MaxJobs)
+{
+    // Build a list of highest preference to lowesr preference
+    Queue<DwarfJobs> JobPriority;
+    for(int j = DwarfJobPriority_High; j >= DwarfJobPriority_Low; j--)
+    {
+        for(int i = 0; i < DwarfJobsCount; i++)
+        {
+            if(Dwarf->GetJobPriority()[i] == j)
+                JobPriority.Enqueue((DwarfJobs)i);
+        }
+    }
+    
+    // Jobs the dwarf can't reach at all are rejected (if the world has a path graph); bring the graph up
+    // to date first, so it is never rebuilt while the volumes are locked
+    PathGraph* Graph = PathGraph::Acquire(WorldData);
+    if(Graph != NULL)
+        Graph->Update();
+    
+    // Lock since we are going to read list data
+    pthread_mutex_lock(&VolumeLock);
+    
+    // List the candidates of the first job type that has any (farmer and crafter jobs don't exist yet)
+    int JobCount = 0;
+    while(!JobPriority.IsEmpty() && JobCount <= 0)
+    {
+        DwarfJobs Job = JobPriority.Dequeue();
+        if(Job == DwarfJobs_Miner)
+            JobCount = GetMiningJobs(Dwarf, Graph, JobsOut, MaxJobs);
+    }
+    
+    // Done working
+    pthread_mutex_unlock(&VolumeLock);
+    if(Graph != NULL)
+        Graph->Release();
+    return JobCount;
+}
+
+bool VolumeView::TakeJob(int JobID, JobTask** JobOut)
+{
+    // Another dwarf may have taken it in the meantime
+    pthread_mutex_lock(&VolumeLock);
+    JobTask* Job = FindOpenJob(JobID);
+    if(Job != NULL)
+    {
+        AssignJob(Job);
+        *JobOut = Job;
+    }
+    pthread_mutex_unlock(&VolumeLock);
+    
+    return Job != NULL;
+}
+
+void VolumeView::PassJobs(JobTask* Jobs, int JobCount)
+{
+    // Count an attempt on each, so that other jobs are listed first next time
+    pthread_mutex_lock(&VolumeLock);
+    for(int i = 0; i < JobCount; i++)
+    {
+        JobTask* Job = FindOpenJob(Jobs[i].ID);
+        if(Job != NULL)
+            Job->Attempts++;
+    }
+    pthread_mutex_unlock(&VolumeLock);
+}
+
 void VolumeView::ResignJob(JobTask* Job)
 {
     // What is the job's working volume?
@@ -265,6 +383,7 @@ void VolumeView::ResignJob(JobTask* Job)
     
     // Put job back into the jobs list
     Volume->Jobs.Enqueue(Job);
+    Volume->Revision++;
     
     // Release lock
     Volume->UnlockData();
@@ -293,6 +412,7 @@ void VolumeView::CompleteJob(JobTask* Job)
     }
     
     // Check though if we are done with the volume
+    Volume->Revision++;
     bool VolumeComplete = Volume->AssignedJobs.GetSize() <= 0 && Volume->Jobs.GetSize() <= 0;
     
     // Release lock
@@ -332,15 +452,30 @@ void VolumeView::CompleteJob(JobTask* Job)
     }
 }
 
-bool VolumeView::GetMiningJob(DwarfEntity* Dwarf, JobTask** JobOut)
+bool VolumeView::GetMiningJob(DwarfEntity* Dwarf, PathGraph* Graph, JobTask** JobOut)
+{
+    // Take the least attempted job
+    JobTask Best;
+    if(GetMiningJobs(Dwarf, Graph, &Best, 1) <= 0)
+        return false;
+    
+    *JobOut = FindOpenJob(Best.ID);
+    AssignJob(*JobOut);
+    return true;
+}
+
+int VolumeView::GetMiningJobs(DwarfEntity* Dwarf, PathGraph* Graph, JobTask* JobsOut, int MaxJobs)
 {
     // Do any of the following jobs in order if possible:
     //   UI_DesignationMenu_Mine
     //   UI_DesignationMenu_Fill
     //   UI_DesignationMenu_Flood
     
-    // Best job we have (i.e. the lowest attempt count)
-    JobTask* BestJob = NULL;
+    // Best jobs we have so far (i.e. the lowest attempt counts), in order
+    int JobCount = 0;
+    
+    // Reject jobs the dwarf can't reach at all (if the world has a path graph)
+    Vector3<int> DwarfPosition = Dwarf->GetPositionBlock();
     
     // For each designation
     int DesignationCount = DesignationList.GetSize();
@@ -352,18 +487,26 @@ bool VolumeView::GetMiningJob(DwarfEntity* Dwarf, JobTask** JobOut)
         if(Volume->Category == UI_RootMenu_Designations && (Type == UI_DesignationMenu_Mine || Type == UI_DesignationMenu_Fill || Type == UI_DesignationMenu_Flood))
         {
             // For each job
-            int JobCount = Volume->Jobs.GetSize();
-            for(int JobIndex = 0; JobIndex < JobCount; JobIndex++)
+            int VolumeJobCount = Volume->Jobs.GetSize();
+            for(int JobIndex = 0; JobIndex < VolumeJobCount; JobIndex++)
             {
                 // Peek
                 JobTask* Job = Volume->Jobs.Dequeue();
                 
                 // See if this job position is trivial to reach (i.e. adjacently accessible)
-                if(AdjacentAccessible(Job->TargetBlock))
+                if(AdjacentAccessible(Job->TargetBlock) && (Graph == NULL || AdjacentReachable(Graph, DwarfPosition, Job->TargetBlock)))
                 {
-                    // Save job if either best job is null OR this job has a lower attempt count
-                    if(BestJob == NULL || BestJob->Attempts > Job->Attempts)
-                        BestJob = Job;
+                    // Insert after all jobs with as few attempts (dropping the last job if full)
+                    int Index = JobCount;
+                    while(Index > 0 && JobsOut[Index - 1].Attempts > Job->Attempts)
+                        Index--;
+                    if(Index < MaxJobs)
+                    {
+                        for(int i = min(JobCount, MaxJobs - 1); i > Index; i--)
+                            JobsOut[i] = JobsOut[i - 1];
+                        JobsOut[Index] = *Job;
+                        JobCount = min(JobCount + 1, MaxJobs);
+                    }
                 }
                 
                 // Putback
@@ -372,34 +515,60 @@ bool VolumeView::GetMiningJob(DwarfEntity* Dwarf, JobTask** JobOut)
         }
     }
     
-    // If found job, remove self from jobs queue and add self to assigned queue
-    if(BestJob != NULL)
+    return JobCount;
+}
+
+void VolumeView::AssignJob(JobTask* Job)
+{
+    // Volume we will work on
+    VolumeTask* Volume = Job->Volume;
+    
+    // Remove from jobs queue
+    int JobCount = Volume->Jobs.GetSize();
+    for(int JobIndex = 0; JobIndex < JobCount; JobIndex++)
     {
-        // Volume we will work on
-        VolumeTask* Volume = BestJob->Volume;
+        // Peek
+        JobTask* Task = Volume->Jobs.Dequeue();
+        
+        // If match, pop off from jobs queue
+        if(Task == Job)
+            break;
         
-        // Remove from 
-        int JobCount = Volume->Jobs.GetSize();
-        for(int JobIndex = 0; JobIndex < JobCount; JobIndex++)
+        // Putback
+        Volume->Jobs.Enqueue(Task);
+    }
+    
+    // Save self to assigned jobs queue
+    Volume->AssignedJobs.Enqueue(Job);
+    Volume->Revision++;
+}
+
+JobTask* VolumeView::FindOpenJob(int JobID)
+{
+    // Match by ID, as the job may have been released (and its memory reused)
+    List< VolumeTask* >* Lists[4] = {&BuildingList, &DesignationList, &StockpileList, &ZoneList};
+    for(int ListIndex = 0; ListIndex < 4; ListIndex++)
+    {
+        for(int VolumeIndex = 0; VolumeIndex < Lists[ListIndex]->GetSize(); VolumeIndex++)
         {
-            // Peek
-            JobTask* Job = Volume->Jobs.Dequeue();
-            
-            // If match, pop off from jobs queue
-            if(BestJob == Job)
-                break;
+            // For each job (peek and putback, keeping the order)
+            VolumeTask* Volume = (*Lists[ListIndex])[VolumeIndex];
+            JobTask* Found = NULL;
+            int JobCount = Volume->Jobs.GetSize();
+            for(int JobIndex = 0; JobIndex < JobCount; JobIndex++)
+            {
+                JobTask* Task = Volume->Jobs.Dequeue();
+                if(Task->ID == JobID)
+                    Found = Task;
+                Volume->Jobs.Enqueue(Task);
+            }
             
-            // Putback
-            Volume->Jobs.Enqueue(Job);
+            if(Found != NULL)
+                return Found;
         }
-        
-        // Save self to assigned jobs queue
-        BestJob->Volume->AssignedJobs.Enqueue(BestJob);
-        *JobOut = BestJob;
     }
     
-    // Return true if we found a job
-    return BestJob != NULL;
+    return NULL;
 }
 
 bool VolumeView::GetFarmerJob(DwarfEntity* Dwarf, JobTask** JobOut)
@@ -451,111 +620,314 @@ bool VolumeView::AdjacentAccessible(Vector3<int> Pos)
     return false;
 }
 
+bool VolumeView::AdjacentReachable(PathGraph* Graph, Vector3<int> Source, Vector3<int> Pos)
+{
+    // Any adjacent block in the same region may be reachable
+    for(int j = 0; j < AdjacentOffsetsCount; j++)
+    {
+        if(Graph->IsReachableBuilt(Source, Pos + AdjacentOffsets[j]))
+            return true;
+    }
+    return false;
+}
+
 void VolumeView::Update(float dT)
 {
-    // Do nothing...
+    // Animate the job tiles
+    Phase = fmod(Phase + dT * VolumeView_PulseSpeed, UtilPI * 4.0f);
 }
 
 void VolumeView::Render(int LayerCutoff)
 {
-    // Lock to copy date
+    /*** Copy Changed Volumes ***/
+    
+    // Every overlay still having a volume is flagged again while copying
+    for(int i = 0; i < OverlayCount; i++)
+        Overlays[i].IsLive = false;
+    TileCount = 0;
+    
+    // Only hold the lock while copying; no GL work
     pthread_mutex_lock(&VolumeLock);
+    CopyVolumes(&BuildingList);
+    CopyVolumes(&DesignationList);
+    CopyVolumes(&StockpileList);
+    CopyVolumes(&ZoneList);
+    pthread_mutex_unlock(&VolumeLock);
+    
+    /*** Rebuild Overlays ***/
+    
+    for(int i = 0; i < OverlayCount; )
+    {
+        // The volume is done: release its overlay
+        if(!Overlays[i].IsLive)
+        {
+            glDeleteBuffers(1, &Overlays[i].BufferID);
+            Overlays[i] = Overlays[--OverlayCount];
+            continue;
+        }
+        
+        // Rebuild if changed
+        if(Overlays[i].NeedsBuild)
+            BuildOverlay(&Overlays[i]);
+        i++;
+    }
+    
+    // Ignore if nothing to draw
+    if(OverlayCount <= 0)
+        return;
+    
+    /*** Draw ***/
     
-    // Render the given list of VolumeTasks
-    RenderVolume(&BuildingList);
-    RenderVolume(&DesignationList);
-    RenderVolume(&StockpileList);
-    RenderVolume(&ZoneList);
+    // Every volume's outline
+    glColor3f(0.2f, 0.2f, 0.2f);
+    glLineWidth(2.0f);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    for(int i = 0; i < OverlayCount; i++)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, Overlays[i].BufferID);
+        glVertexPointer(3, GL_FLOAT, sizeof(float) * VolumeView_VertexFloats, 0);
+        glDrawArrays(GL_LINES, 0, VolumeView_OutlineVertices);
+    }
     
-    // Done with data lock
+    // Every volume's job tiles, with the same texture and shader
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, IconTextureID);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    OverlayShader->Uniform("Phase", Phase);
+    OverlayShader->Activate();
+    for(int i = 0; i < OverlayCount; i++)
+    {
+        // Ignore if all tiles are covered
+        if(Overlays[i].QuadCount <= 0)
+            continue;
+        
+        glBindBuffer(GL_ARRAY_BUFFER, Overlays[i].BufferID);
+        glVertexPointer(3, GL_FLOAT, sizeof(float) * VolumeView_VertexFloats, 0);
+        glTexCoordPointer(2, GL_FLOAT, sizeof(float) * VolumeView_VertexFloats, (char*)NULL + sizeof(float) * 3);
+        glClientActiveTexture(GL_TEXTURE1);
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+        glTexCoordPointer(3, GL_FLOAT, sizeof(float) * VolumeView_VertexFloats, (char*)NULL + sizeof(float) * 5);
+        glClientActiveTexture(GL_TEXTURE0);
+        glDrawArrays(GL_QUADS, VolumeView_OutlineVertices, Overlays[i].QuadCount * 4);
+    }
+    OverlayShader->Deactivate();
+    
+    // Release states
+    glClientActiveTexture(GL_TEXTURE1);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glClientActiveTexture(GL_TEXTURE0);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glDisable(GL_TEXTURE_2D);
+}
+
+void VolumeView::BlocksChanged(Vector3<int> Min, Vector3<int> Max)
+{
+    // A job tile depends on its own block and the block right above it
+    List< VolumeTask* >* VolumeLists[4] = {&BuildingList, &DesignationList, &StockpileList, &ZoneList};
+    
+    pthread_mutex_lock(&VolumeLock);
+    for(int i = 0; i < 4; i++)
+    {
+        int VolumeCount = VolumeLists[i]->GetSize();
+        for(int VolumeIndex = 0; VolumeIndex < VolumeCount; VolumeIndex++)
+        {
+            VolumeTask* Volume = (*VolumeLists[i])[VolumeIndex];
+            Vector3<int> VolumeMax = Volume->Origin + Volume->Volume;
+            if(Max.x >= Volume->Origin.x && Min.x < VolumeMax.x && Max.z >= Volume->Origin.z && Min.z < VolumeMax.z &&
+               Max.y >= Volume->Origin.y && Min.y <= VolumeMax.y)
+            {
+                Volume->LockData();
+                Volume->Revision++;
+                Volume->UnlockData();
+            }
+        }
+    }
     pthread_mutex_unlock(&VolumeLock);
 }
 
-void VolumeView::RenderVolume(List< VolumeTask* >* VolumeList)
+void VolumeView::CopyVolumes(List< VolumeTask* >* VolumeList)
 {
-    // For each job
     int VolumeCount = VolumeList->GetSize();
     for(int VolumeIndex = 0; VolumeIndex < VolumeCount; VolumeIndex++)
     {
-        // Get volume
         VolumeTask* Volume = (*VolumeList)[VolumeIndex];
         
-        // Push what we will work on
-        glPushMatrix();
+        // Find this volume's overlay
+        VolumeView_Overlay* Overlay = NULL;
+        for(int i = 0; i < OverlayCount && Overlay == NULL; i++)
+        {
+            if(Overlays[i].VolumeID == Volume->ID)
+                Overlay = &Overlays[i];
+        }
         
-            // Move and scale as needed (shouldn't it scale first then translate?)
-            Vector3<float> VolumeCenter(Volume->Origin.x + Volume->Volume.x / 2.0f, Volume->Origin.y + Volume->Volume.y / 2.0f, Volume->Origin.z + Volume->Volume.z / 2.0f);
-            glTranslatef(VolumeCenter.x, VolumeCenter.y, VolumeCenter.z);
-            glScalef(Volume->Volume.x + 0.2f, Volume->Volume.y + 0.2f, Volume->Volume.z + 0.2f);
+        // New volume: new overlay, grow the list as needed
+        if(Overlay == NULL)
+        {
+            if(OverlayCount >= OverlayCapacity)
+            {
+                OverlayCapacity = (OverlayCapacity == 0) ? 8 : (OverlayCapacity * 2);
+                VolumeView_Overlay* NewOverlays = new VolumeView_Overlay[OverlayCapacity];
+                for(int i = 0; i < OverlayCount; i++)
+                    NewOverlays[i] = Overlays[i];
+                delete[] Overlays;
+                Overlays = NewOverlays;
+            }
             
-            // Draw cube
-            glColor3f(0.2f, 0.2f, 0.2f);
-            glLineWidth(2.0f);
-            glutWireCube(1.0f);
-        
-        // Pop this localized coordinate
-        glPopMatrix();
-        
-        // Get the texture for this job type
-        float tx, ty, tw, th;
-        GetIconInfo(GetIconType(Volume), &tx, &ty, &tw, &th);
-        
-        // Enable and set texture
-        glEnable(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, IconTextureID);
+            Overlay = &Overlays[OverlayCount++];
+            Overlay->VolumeID = Volume->ID;
+            Overlay->Revision = Volume->Revision - 1;
+            Overlay->Origin = Volume->Origin;
+            Overlay->Volume = Volume->Volume;
+            Overlay->Icon = GetIconType(Volume);
+            Overlay->BufferID = 0;
+            Overlay->QuadCount = 0;
+        }
+        Overlay->IsLive = true;
+        Overlay->NeedsBuild = false;
         
-        // Render each job queue
-        for(int QueueIndex = 0; QueueIndex < 2; QueueIndex++)
+        // Copy all job tiles if changed since the last build
+        Volume->LockData();
+        if(Overlay->Revision != Volume->Revision)
         {
-            // Set the global tile color
-            static float phase = 0.0f;
-            phase += 0.1f;
-            
-            glColor4f(1, 1, 1, 0.9f + 0.1f * sin(phase));
-            if(QueueIndex == 1)
-                glColor4f(1, 0.5f, 0.5f, 0.9f + 0.1f * cos(phase));
-            
-            // Tasks we need to render
-            Queue< JobTask* > JobList = Volume->Jobs;
-            if(QueueIndex == 1)
-                JobList = Volume->AssignedJobs;
+            // Grow the tile list as needed
+            int JobCount = Volume->Jobs.GetSize() + Volume->AssignedJobs.GetSize();
+            if(TileCount + JobCount > TileCapacity)
+            {
+                TileCapacity = (TileCount + JobCount) * 2;
+                VolumeView_Tile* NewTiles = new VolumeView_Tile[TileCapacity];
+                for(int i = 0; i < TileCount; i++)
+                    NewTiles[i] = Tiles[i];
+                delete[] Tiles;
+                Tiles = NewTiles;
+            }
             
-            // Copy all positions we are editing
-            while(!JobList.IsEmpty())
+            // Cycle through each queue (each job goes back where it was)
+            Overlay->FirstTile = TileCount;
+            for(int QueueIndex = 0; QueueIndex < 2; QueueIndex++)
             {
-                // Get the position
-                Vector3<int> TilePos = JobList.Dequeue()->TargetBlock;
-                
-                // Only render if we are right below air
-                if(WorldData->IsWithinWorld(TilePos + Vector3<int>(0, 1, 0)) && WorldData->GetBlock(TilePos + Vector3<int>(0, 1, 0)).GetType() == dBlockType_Air)
+                Queue< JobTask* >& JobList = (QueueIndex == 0) ? Volume->Jobs : Volume->AssignedJobs;
+                int JobListCount = JobList.GetSize();
+                for(int i = 0; i < JobListCount; i++)
                 {
-                    // Move down 0.5f if half block
-                    float VerticalOffset = 0.0f;
-                    if(!WorldData->GetBlock(TilePos).IsWhole())
-                        VerticalOffset = -0.5f;
-                    
-                    // Do a tiny oscilating offset
-                    VerticalOffset += 0.02f + 0.005f * sin(phase * 0.5f + TilePos.z) + 0.005f * cos(phase * 0.5f + TilePos.x);
-                    
-                    // Render a mining tile
-                    // Note the slight shift upwards because we want to render it ABOVE a block
-                    glBegin(GL_QUADS);
-                        glTexCoord2f(tx, ty);
-                        glVertex3f(TilePos.x + 0.0f, TilePos.y + 1.01f + VerticalOffset, TilePos.z + 0.0f);
-                        glTexCoord2f(tx + tw, ty);
-                        glVertex3f(TilePos.x + 0.0f, TilePos.y + 1.01f + VerticalOffset, TilePos.z + 1.0f);
-                        glTexCoord2f(tx + tw, ty + th);
-                        glVertex3f(TilePos.x + 1.0f, TilePos.y + 1.01f + VerticalOffset, TilePos.z + 1.0f);
-                        glTexCoord2f(tx, ty + th);
-                        glVertex3f(TilePos.x + 1.0f, TilePos.y + 1.01f + VerticalOffset, TilePos.z + 0.0f);
-                    glEnd();
+                    JobTask* Job = JobList.Dequeue();
+                    Tiles[TileCount].Pos = Job->TargetBlock;
+                    Tiles[TileCount].IsAssigned = (QueueIndex == 1);
+                    TileCount++;
+                    JobList.Enqueue(Job);
                 }
             }
+            Overlay->TileCount = TileCount - Overlay->FirstTile;
+            Overlay->Revision = Volume->Revision;
+            Overlay->NeedsBuild = true;
         }
+        Volume->UnlockData();
+    }
+}
+
+void VolumeView::BuildOverlay(VolumeView_Overlay* Overlay)
+{
+    // Grow the scratch vertices as needed
+    int FloatCount = (VolumeView_OutlineVertices + Overlay->TileCount * 4) * VolumeView_VertexFloats;
+    if(FloatCount > VertexCapacity)
+    {
+        delete[] Vertices;
+        VertexCapacity = FloatCount * 2;
+        Vertices = new float[VertexCapacity];
+    }
+    memset(Vertices, 0, sizeof(float) * VolumeView_OutlineVertices * VolumeView_VertexFloats);
+    
+    /*** Outline ***/
+    
+    // Slightly larger than the volume itself
+    float Min[3] = {Overlay->Origin.x - 0.1f, Overlay->Origin.y - 0.1f, Overlay->Origin.z - 0.1f};
+    float Max[3] = {Overlay->Origin.x + Overlay->Volume.x + 0.1f, Overlay->Origin.y + Overlay->Volume.y + 0.1f, Overlay->Origin.z + Overlay->Volume.z + 0.1f};
+    
+    // Each edge runs along one axis, from one of the four corners across the other two
+    float* Vertex = Vertices;
+    for(int Axis = 0; Axis < 3; Axis++)
+    for(int Corner = 0; Corner < 4; Corner++)
+    {
+        for(int End = 0; End < 2; End++)
+        {
+            int A = (Axis + 1) % 3, B = (Axis + 2) % 3;
+            Vertex[Axis] = (End == 0) ? Min[Axis] : Max[Axis];
+            Vertex[A] = (Corner & 1) ? Max[A] : Min[A];
+            Vertex[B] = (Corner & 2) ? Max[B] : Min[B];
+            Vertex += VolumeView_VertexFloats;
+        }
+    }
+    
+    /*** Job Tiles ***/
+    
+    // Get the texture for this job type
+    float tx, ty, tw, th;
+    GetIconInfo(Overlay->Icon, &tx, &ty, &tw, &th);
+    
+    Overlay->QuadCount = 0;
+    for(int i = 0; i < Overlay->TileCount; i++)
+    {
+        const VolumeView_Tile& Tile = Tiles[Overlay->FirstTile + i];
+        Vector3<int> TilePos = Tile.Pos;
+        
+        // Only render if we are right below air
+        if(!WorldData->IsWithinWorld(TilePos + Vector3<int>(0, 1, 0)) || WorldData->GetBlock(TilePos + Vector3<int>(0, 1, 0)).GetType() != dBlockType_Air)
+            continue;
         
-        // Done with texture
-        glDisable(GL_TEXTURE_2D);
+        // Note the slight shift upwards because we want to render it ABOVE a block; move down 0.5f if half block
+        float y = TilePos.y + 1.01f + 0.02f;
+        if(!WorldData->GetBlock(TilePos).IsWhole())
+            y -= 0.5f;
+        
+        // Same winding and texture coordinates as each corner of a mining tile
+        float Corners[4][4] =
+        {
+            {0.0f, 0.0f, tx, ty},
+            {0.0f, 1.0f, tx + tw, ty},
+            {1.0f, 1.0f, tx + tw, ty + th},
+            {1.0f, 0.0f, tx, ty + th},
+        };
+        for(int j = 0; j < 4; j++)
+        {
+            *Vertex++ = TilePos.x + Corners[j][0];
+            *Vertex++ = y;
+            *Vertex++ = TilePos.z + Corners[j][1];
+            *Vertex++ = Corners[j][2];
+            *Vertex++ = Corners[j][3];
+            *Vertex++ = float(TilePos.x);
+            *Vertex++ = float(TilePos.z);
+            *Vertex++ = Tile.IsAssigned ? 1.0f : 0.0f;
+        }
+        Overlay->QuadCount++;
+    }
+    
+    // Upload; only changes with the jobs
+    if(Overlay->BufferID == 0)
+        glGenBuffers(1, &Overlay->BufferID);
+    glBindBuffer(GL_ARRAY_BUFFER, Overlay->BufferID);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * (VolumeView_OutlineVertices + Overlay->QuadCount * 4) * VolumeView_VertexFloats, (void*)Vertices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    Overlay->NeedsBuild = false;
+}
+
+void VolumeView::AddVolume(List< VolumeTask* >* VolumeList, VolumeTask* Task)
+{
+    // Give a unique ID, so its overlay is never confused with that of a released volume
+    Task->ID = NextVolumeID++;
+    
+    // Same for each of its jobs (peek and putback, keeping the order)
+    int JobCount = Task->Jobs.GetSize();
+    for(int JobIndex = 0; JobIndex < JobCount; JobIndex++)
+    {
+        JobTask* Job = Task->Jobs.Dequeue();
+        Job->ID = NextJobID++;
+        Task->Jobs.Enqueue(Job);
     }
+    
+    int EndIndex = VolumeList->GetSize();
+    VolumeList->Resize(EndIndex + 1);
+    (*VolumeList)[EndIndex] = Task;
 }
 
 IconType VolumeView::GetIconType(VolumeTask* Volume)
@@ -19,6 +19,12 @@
  and not across multiple objects. This is why the object must
  be handled by address (pointers).
  
+ Each volume's overlay (outline and job tiles) is kept in its own
+ VBO, rebuilt only when the volume's jobs, or the blocks under
+ them, change. Job tiles are copied out under the locks, and all
+ GL work is done once the locks are released; the tiles' pulse
+ and bobbing is animated in a shader.
+ 
 ***************************************************************/
 
 #ifndef __VOLUMEVIEW_H__
@@ -27,11 +33,13 @@
 #include "WorldContainer.h"
 #include "Vector3.h"
 #include "List.h"
+#include "Shader.h"
 #include <pthread.h>
 
 // Forward declare structs as needed
 struct VolumeTask;
 class DwarfEntity;
+class PathGraph;
 
 // Define the job types that exist (closely related to designation types
 enum JobType
@@ -59,6 +67,10 @@ struct JobTask
     
     // Total attemps count (i.e. how many times attempted but resigned)
     int Attempts;
+    
+    // Unique ID (given when its volume is added to the view); jobs listed as candidates are
+    // looked up by it, never by their pointer, as they may have been released since
+    int ID;
 };
 
 // A task volume structure
@@ -83,11 +95,18 @@ struct VolumeTask
     Queue< JobTask* > Jobs;
     Queue< JobTask* > AssignedJobs;
     
+    // Unique ID (given when added to the view), and a count of changes to the jobs
+    // or to the blocks under them; the overlay is rebuilt whenever this changes
+    int ID;
+    unsigned int Revision;
+    
     /*** Helper Constructor ***/
     
     VolumeTask(UI_RootMenu Category, int Type, Vector3<int> Origin, Vector3<int> Volume)
     {
         LockInit();
+        this->ID = -1;
+        this->Revision = 0;
         this->Origin = Origin;
         this->Volume = Volume;
         this->Category = Category;
@@ -121,7 +140,46 @@ struct VolumeTask
     }
 };
 
-class VolumeView
+// Speed of the job tiles' pulse, in radians per second
+static const float VolumeView_PulseSpeed = 6.0f;
+
+// Floats per overlay vertex: (x, y, z)(u, v)(tile x, tile z, 1 if assigned else 0)
+static const int VolumeView_VertexFloats = 8;
+
+// Vertices of a volume's outline (12 edges as lines)
+static const int VolumeView_OutlineVertices = 24;
+
+// A job tile, as copied out of a volume
+struct VolumeView_Tile
+{
+    Vector3<int> Pos;
+    bool IsAssigned;
+};
+
+// A volume's overlay geometry; the outline, then all visible job tiles as quads
+struct VolumeView_Overlay
+{
+    // Volume this is of, and its revision when last built
+    int VolumeID;
+    unsigned int Revision;
+    
+    // Outline volume
+    Vector3<int> Origin, Volume;
+    
+    // Icon of the job tiles
+    IconType Icon;
+    
+    // Still has a volume this frame, and needs to be rebuilt from the
+    // copied tiles (the range in the view's tile list)
+    bool IsLive, NeedsBuild;
+    int FirstTile, TileCount;
+    
+    // Vertex buffer and number of tile quads in it
+    GLuint BufferID;
+    int QuadCount;
+};
+
+class VolumeView : public WorldContainer_Listener
 {
 public:
     
@@ -137,11 +195,24 @@ public:
     void AddStockpile(UI_StockpilesMenu Type, Vector3<int> Origin, Vector3<int> Volume);
     void AddZone(UI_ZonesMenu Type, Vector3<int> Origin, Vector3<int> Volume);
     
+    // Get the volume (global, inclusive) of the first zone of the given type; returns false if there is none
+    bool GetZone(UI_ZonesMenu Type, Vector3<int>* MinOut, Vector3<int>* MaxOut);
+    
     /*** Job Management ***/
     
     // Given an entity, find a job that fits the dwarf's preferences and current world needs
     bool GetJob(DwarfEntity* Dwarf, JobTask** JobOut);
     
+    // Same as GetJob(...), but copies up to the given count of candidate jobs (the least attempted first)
+    // without taking any of them; returns the count. The dwarf then takes the nearest one it can reach
+    int GetJobCandidates(DwarfEntity* Dwarf, JobTask* JobsOut, int MaxJobs);
+    
+    // Take the candidate job of the given ID; returns false if it was taken (or removed) since
+    bool TakeJob(int JobID, JobTask** JobOut);
+    
+    // None of the listed candidate jobs could be reached; counts an attempt on each one still open
+    void PassJobs(JobTask* Jobs, int JobCount);
+    
     // Unable to complete job
     void ResignJob(JobTask* Job);
     
@@ -152,13 +223,26 @@ public:
 private:
     
     // Job specific task management
-    bool GetMiningJob(DwarfEntity* Dwarf, JobTask** JobOut);
+    bool GetMiningJob(DwarfEntity* Dwarf, PathGraph* Graph, JobTask** JobOut);
     bool GetFarmerJob(DwarfEntity* Dwarf, JobTask** JobOut);
     bool GetCrafterJob(DwarfEntity* Dwarf, JobTask** JobOut);
     
+    // Copy the candidate mining jobs, least attempted first, rejecting those not reachable on the given graph
+    // (as last built; NULL if the world has none); returns the count
+    int GetMiningJobs(DwarfEntity* Dwarf, PathGraph* Graph, JobTask* JobsOut, int MaxJobs);
+    
+    // Move an open job to its volume's assigned jobs
+    void AssignJob(JobTask* Job);
+    
+    // Get the job of the given ID if it is still in the open jobs of any volume, else NULL
+    JobTask* FindOpenJob(int JobID);
+    
     // Returns true if this given block can be accessed by a dwarf
     bool AdjacentAccessible(Vector3<int> Pos);
     
+    // Returns false if no block adjacent to the given block is in the source's region (on the graph as last built)
+    bool AdjacentReachable(PathGraph* Graph, Vector3<int> Source, Vector3<int> Pos);
+    
 public:
     
     /*** Core Render & Update ***/
@@ -169,10 +253,20 @@ public:
     // Render this Volume (does all translations internally)
     void Render(int LayerCutoff);
     
+    // Flag the overlays of all volumes over the changed blocks to be rebuilt
+    void BlocksChanged(Vector3<int> Min, Vector3<int> Max);
+    
 private:
     
-    // Render an volume given a list
-    void RenderVolume(List< VolumeTask* >* VolumeList);
+    // Match each volume of the given list to its overlay, copying out the job tiles of
+    // those that changed; must hold the volume lock
+    void CopyVolumes(List< VolumeTask* >* VolumeList);
+    
+    // Rebuild the given overlay's vertex buffer from its copied tiles
+    void BuildOverlay(VolumeView_Overlay* Overlay);
+    
+    // Add a volume to the given list, giving it its unique ID; must hold the volume lock
+    void AddVolume(List< VolumeTask* >* VolumeList, VolumeTask* Task);
     
     // Get the UI icon type from a given category and sub-type of a job
     IconType GetIconType(VolumeTask* Volume);
@@ -184,6 +278,22 @@ private:
     float IconSrcW, IconSrcH, IconSrcX, IconSrcY;
     GLuint IconTextureID;
     
+    // Overlay of each volume, the tiles copied out this frame, and scratch vertices
+    VolumeView_Overlay* Overlays;
+    int OverlayCount, OverlayCapacity;
+    VolumeView_Tile* Tiles;
+    int TileCount, TileCapacity;
+    float* Vertices;
+    int VertexCapacity;
+    
+    // Job tile shader and its animation phase
+    Shader* OverlayShader;
+    float Phase;
+    
+    // ID of the next added volume, and of the next job
+    int NextVolumeID;
+    int NextJobID;
+    
     // List of each major data and associated lock
     List< VolumeTask* > BuildingList;
     List< VolumeTask* > DesignationList;
@@ -37,6 +37,8 @@ WorldContainer::WorldContainer(int Width, int Height, int ColumnWidth)
         {
             Levels[y].Allocated = false;
             Levels[y].Data.PlaneType = dBlockType_Air;
+            Levels[y].Revision = 0;
+            Levels[y].NeedsUpdate = false;
         }
     }
     
@@ -44,6 +46,9 @@ WorldContainer::WorldContainer(int Width, int Height, int ColumnWidth)
     int ViewDist;
     GetUserSetting("General", "ViewDistance", &ViewDist, 10000);
     MaxRenderDist = ViewDist;
+    
+    // No changes yet
+    EditCount = 0;
 }
 
 WorldContainer::~WorldContainer()
@@ -140,8 +145,9 @@ void WorldContainer::SetBlock(int x, int y, int z, dBlock Block)
     int dz = z % ColumnWidth;
     
     // Target plane (ref variable)
-    WorldChunks[cz * ChunkCount + cx].NeedsUpdate = true;
     WorldContainer_Plane& Plane = WorldChunks[cz * ChunkCount + cx].Planes[y];
+    Plane.Revision++;
+    EditCount++;
     
     // If allocated, just assign block
     if(Plane.Allocated)
@@ -150,25 +156,29 @@ void WorldContainer::SetBlock(int x, int y, int z, dBlock Block)
     // Else, only allocate if it is a new type
     else if(Plane.Data.PlaneType != Block.GetType())
     {
-        // Allocate and fill with air, then set the block
+        // Allocate and fill with the plane's previous type, then set the block
+        dBlockType PlaneType = Plane.Data.PlaneType;
         Plane.Allocated = true;
         Plane.Data.PlaneData = new dBlock[ColumnWidth * ColumnWidth];
         for(int i = 0; i < ColumnWidth * ColumnWidth; i++)
-            Plane.Data.PlaneData[i] = dBlock(dBlockType_Air);
+            Plane.Data.PlaneData[i] = dBlock(PlaneType);
         
         // Set the target block
         Plane.Data.PlaneData[dz * ColumnWidth + dx] = Block;
     }
     
-    // Note: if the changed block is on a column bound, update the adjacent
-    if(dx == 0 && cx > 0)
-        WorldChunks[cz * ChunkCount + (cx - 1)].NeedsUpdate = true;
-    if(dx == (ColumnWidth - 1) && cx < ChunkCount - 1)
-        WorldChunks[cz * ChunkCount + (cx + 1)].NeedsUpdate = true;
-    if(dz == 0 && cz > 0)
-        WorldChunks[(cz - 1) * ChunkCount + cx].NeedsUpdate = true;
-    if(dz == (ColumnWidth - 1) && cz < ChunkCount - 1)
-        WorldChunks[(cz + 1) * ChunkCount + cx].NeedsUpdate = true;
+    // Only re-render the planes that depend on this block: its own faces, the faces
+    // of adjacent blocks (including the top of the one below), and the ambient-occlusion
+    // corners, which sample up to two blocks back (note: may cross into other columns)
+    MarkForUpdate(Vector3<int>(x - 2, y - 2, z - 2), Vector3<int>(x + 1, y + 1, z + 1));
+    
+    // Blocks on the world edge are also part of the boundary strips of every layer above
+    if(x == 0 || z == 0 || x == WorldWidth - 1 || z == WorldWidth - 1)
+        MarkForUpdate(Vector3<int>(x, y, z), Vector3<int>(x, WorldHeight - 1, z));
+    
+    // Tell everyone else
+    for(int i = 0; i < Listeners.GetSize(); i++)
+        Listeners[i]->BlocksChanged(Vector3<int>(x, y, z), Vector3<int>(x, y, z));
 }
 
 void WorldContainer::SetBlock(Vector3<int> Pos, dBlock Block)
@@ -188,16 +198,27 @@ void WorldContainer::FillChunk(int x, int y, int z, dBlockType BlockType)
     int cz = z / ColumnWidth;
     
     // Target plane (ref variable)
-    WorldChunks[cz * ChunkCount + cx].NeedsUpdate = true;
     WorldContainer_Plane& Plane = WorldChunks[cz * ChunkCount + cx].Planes[y];
     
     // Release if needed
     if(Plane.Allocated)
         delete[] Plane.Data.PlaneData;
+    Plane.Revision++;
     
     // Set the type and allocation flag
     Plane.Allocated = false;
     Plane.Data.PlaneType = BlockType;
+    
+    // Re-render the same way a block change does, but for the entire plane
+    int OriginX = cx * ColumnWidth;
+    int OriginZ = cz * ColumnWidth;
+    MarkForUpdate(Vector3<int>(OriginX - 2, y - 2, OriginZ - 2), Vector3<int>(OriginX + ColumnWidth, y + 1, OriginZ + ColumnWidth));
+    if(cx == 0 || cz == 0 || cx == ChunkCount - 1 || cz == ChunkCount - 1)
+        MarkForUpdate(Vector3<int>(OriginX, y, OriginZ), Vector3<int>(OriginX + ColumnWidth - 1, WorldHeight - 1, OriginZ + ColumnWidth - 1));
+    
+    // Tell everyone else
+    for(int i = 0; i < Listeners.GetSize(); i++)
+        Listeners[i]->BlocksChanged(Vector3<int>(OriginX, y, OriginZ), Vector3<int>(OriginX + ColumnWidth - 1, y, OriginZ + ColumnWidth - 1));
 }
 
 void WorldContainer::FillChunk(Vector3<int> Pos, dBlockType BlockType)
@@ -210,6 +231,49 @@ void WorldContainer::FillChunk(Vector3<float> Pos, dBlockType BlockType)
     FillChunk(Pos.x, Pos.y, Pos.z, BlockType);
 }
 
+void WorldContainer::MarkForUpdate(Vector3<int> Min, Vector3<int> Max)
+{
+    // Clamp to the world
+    Min.x = max(Min.x, 0); Min.y = max(Min.y, 0); Min.z = max(Min.z, 0);
+    Max.x = min(Max.x, WorldWidth - 1); Max.y = min(Max.y, WorldHeight - 1); Max.z = min(Max.z, WorldWidth - 1);
+    
+    // For each column and each plane within the volume
+    for(int cz = Min.z / ColumnWidth; cz <= Max.z / ColumnWidth; cz++)
+    for(int cx = Min.x / ColumnWidth; cx <= Max.x / ColumnWidth; cx++)
+    {
+        WorldContainer_Column& Column = WorldChunks[cz * ChunkCount + cx];
+        Column.NeedsUpdate = true;
+        for(int y = Min.y; y <= Max.y; y++)
+            Column.Planes[y].NeedsUpdate = true;
+    }
+}
+
+int WorldContainer::GetEditCount()
+{
+    return EditCount;
+}
+
+void WorldContainer::AddListener(WorldContainer_Listener* Listener)
+{
+    int ListenerCount = Listeners.GetSize();
+    Listeners.Resize(ListenerCount + 1);
+    Listeners[ListenerCount] = Listener;
+}
+
+void WorldContainer::RemoveListener(WorldContainer_Listener* Listener)
+{
+    // Swap with the last one and shrink
+    for(int i = 0; i < Listeners.GetSize(); i++)
+    {
+        if(Listeners[i] == Listener)
+        {
+            Listeners[i] = Listeners[Listeners.GetSize() - 1];
+            Listeners.Resize(Listeners.GetSize() - 1);
+            break;
+        }
+    }
+}
+
 WorldContainer_Column* WorldContainer::GetChunk(int x, int z)
 {
     // Return the chunk
@@ -61,6 +61,14 @@ struct WorldContainer_Plane
         dBlockType PlaneType;
         dBlock* PlaneData;
     } Data;
+    
+    // Incremented on every change made to this plane; data derived
+    // from a plane can compare against it to know when to rebuild
+    unsigned int Revision;
+    
+    // True if this plane, or a block it depends on for rendering,
+    // has been updated and the plane should be re-rendered
+    bool NeedsUpdate;
 };
 
 // Column structure
@@ -71,11 +79,24 @@ struct WorldContainer_Column
     // to n-1 (top)
     WorldContainer_Plane* Planes;
     
-    // True if the column has been updated and should
-    // be re-rendered
+    // True if any plane of the column has been updated and
+    // should be re-rendered (see WorldContainer_Plane::NeedsUpdate)
     bool NeedsUpdate;
 };
 
+// Anything derived from the world's blocks (i.e. lighting) that has to react to
+// block changes; see WorldContainer::AddListener(...)
+class WorldContainer_Listener
+{
+public:
+    
+    // Virtual destructor for derived classes
+    virtual ~WorldContainer_Listener() { }
+    
+    // Called once the blocks of the given volume (global, inclusive) have been changed
+    virtual void BlocksChanged(Vector3<int> Min, Vector3<int> Max) = 0;
+};
+
 class WorldContainer
 {
 public:
@@ -115,6 +136,17 @@ public:
     void FillChunk(Vector3<int> Pos, dBlockType BlockType);
     void FillChunk(Vector3<float> Pos, dBlockType BlockType);
     
+    // Flag all planes intersecting the given volume (global, inclusive) to be re-rendered
+    // The volume is clamped to the world
+    void MarkForUpdate(Vector3<int> Min, Vector3<int> Max);
+    
+    // Number of block changes made since the world was created
+    int GetEditCount();
+    
+    // Add or remove a listener that is told about every block change (not owned by the world)
+    void AddListener(WorldContainer_Listener* Listener);
+    void RemoveListener(WorldContainer_Listener* Listener);
+    
     // Get a chunk at the given x, z location (returns the entire column)
     // Note: The given positions are CHUNK positions, not world positions
     WorldContainer_Column* GetChunk(int x, int z);
@@ -144,6 +176,12 @@ private:
     
     // Max render distance
     float MaxRenderDist;
+    
+    // Total number of block changes
+    int EditCount;
+    
+    // Everything told about block changes
+    List<WorldContainer_Listener*> Listeners;
 };
 
 #endif
@@ -247,8 +247,8 @@ void WorldGenerator::Generate(WorldContainer* WorldData, const char* Seed)
             // Apply x^2 on this normalized height
             NHeight = SeaLevel + 1 + pow(NHeight, 2.0f) * WorldDepth * (1.0f / 3.0f);
             
-            // Fill from bottom to top
-            for(int y = 0; y < (int)NHeight; y++)
+            // Fill from bottom to top (the highest heights may go past the world's top)
+            for(int y = 0; y < min((int)NHeight, WorldDepth); y++)
                 WorldData->SetBlock(x, y, z, dBlockType_Stone);
         }
     }
@@ -0,0 +1,353 @@
+/***************************************************************
+ 
+ DwarfCraft - Dwarf Fortress / Minecraft clone
+ Copyright 2011 Jeremy Bridon - See License.txt for info
+ 
+ This source file is developed and maintained by:
+ + Jeremy Bridon jbridon@cores2.com
+ 
+***************************************************************/
+
+#include "WorldLight.h"
+
+// Internal: passable flags; light may go through, and sky light may go straight down without loss
+static const unsigned char __WorldLight_PassLight = 0x01;
+static const unsigned char __WorldLight_PassSky = 0x02;
+
+// Internal: the six neighbor directions; the second one is straight down
+static const Vector3<int> __WorldLight_Offsets[6] =
+{
+    Vector3<int>(0, 1, 0),
+    Vector3<int>(0, -1, 0),
+    Vector3<int>(-1, 0, 0),
+    Vector3<int>(1, 0, 0),
+    Vector3<int>(0, 0, -1),
+    Vector3<int>(0, 0, 1),
+};
+
+// Internal: passable flags of the given block; water lets light through, but dims the sky
+static unsigned char __WorldLight_GetPassable(dBlock Block)
+{
+    if(Block.GetType() == dBlockType_Water)
+        return __WorldLight_PassLight;
+    else if(!dIsOpaque(Block))
+        return __WorldLight_PassLight | __WorldLight_PassSky;
+    else
+        return 0;
+}
+
+WorldLight::WorldLight(WorldContainer* WorldData)
+{
+    // Save world and sizes
+    this->WorldData = WorldData;
+    WorldWidth = WorldData->GetWorldWidth();
+    WorldHeight = WorldData->GetWorldHeight();
+    
+    // Allocate all blocks
+    Light = new unsigned char[WorldWidth * WorldWidth * WorldHeight];
+    Passable = new unsigned char[WorldWidth * WorldWidth * WorldHeight];
+    ChangeCount = 0;
+    
+    // Light everything, then keep up to date
+    ComputeAll();
+    WorldData->AddListener(this);
+}
+
+WorldLight::~WorldLight()
+{
+    // Stop listening before the data goes away
+    WorldData->RemoveListener(this);
+    delete[] Light;
+    delete[] Passable;
+}
+
+int WorldLight::GetSkyLight(int x, int y, int z)
+{
+    if(y >= WorldHeight)
+        return WorldLight_MaxLight;
+    else if(!WorldData->IsWithinWorld(x, y, z))
+        return 0;
+    return GetLight((y * WorldWidth + z) * WorldWidth + x, WorldLight_Channel_Sky);
+}
+
+int WorldLight::GetBlockLight(int x, int y, int z)
+{
+    if(!WorldData->IsWithinWorld(x, y, z))
+        return 0;
+    return GetLight((y * WorldWidth + z) * WorldWidth + x, WorldLight_Channel_Block);
+}
+
+int WorldLight::GetLight(int x, int y, int z)
+{
+    return max(GetSkyLight(x, y, z), GetBlockLight(x, y, z));
+}
+
+void WorldLight::BlocksChanged(Vector3<int> Min, Vector3<int> Max)
+{
+    // Nothing changed yet
+    ChangedMin = Vector3<int>(WorldWidth, WorldHeight, WorldWidth);
+    ChangedMax = Vector3<int>(-1, -1, -1);
+    
+    // Refresh the changed blocks' passable flags
+    for(int y = Min.y; y <= Max.y; y++)
+    for(int z = Min.z; z <= Max.z; z++)
+    for(int x = Min.x; x <= Max.x; x++)
+        Passable[(y * WorldWidth + z) * WorldWidth + x] = __WorldLight_GetPassable(WorldData->GetBlock(x, y, z));
+    
+    // Each channel on its own
+    for(int ChannelIndex = 0; ChannelIndex < 2; ChannelIndex++)
+    {
+        WorldLight_Channel Channel = WorldLight_Channel(ChannelIndex);
+        
+        // Remove the changed blocks' light, and everything that came from it
+        for(int y = Min.y; y <= Max.y; y++)
+        for(int z = Min.z; z <= Max.z; z++)
+        for(int x = Min.x; x <= Max.x; x++)
+        {
+            int Index = (y * WorldWidth + z) * WorldWidth + x;
+            int OldLight = GetLight(Index, Channel);
+            if(OldLight > 0)
+            {
+                SetLight(Index, Channel, 0);
+                WorldLight_Removal Removal = {Index, (unsigned char)OldLight};
+                Removals.Enqueue(Removal);
+            }
+        }
+        RunRemovals(Channel);
+        
+        // Light the changed blocks from their own sources, and let the surrounding light back in
+        for(int y = Min.y; y <= Max.y; y++)
+        for(int z = Min.z; z <= Max.z; z++)
+        for(int x = Min.x; x <= Max.x; x++)
+        {
+            int Index = (y * WorldWidth + z) * WorldWidth + x;
+            int Source = GetSource(x, y, z, Channel);
+            if(Source > GetLight(Index, Channel))
+            {
+                SetLight(Index, Channel, Source);
+                Adds.Enqueue(Index);
+            }
+            
+            for(int i = 0; i < 6; i++)
+            {
+                Vector3<int> Next = Vector3<int>(x, y, z) + __WorldLight_Offsets[i];
+                if(!WorldData->IsWithinWorld(Next))
+                    continue;
+                
+                int NextIndex = (Next.y * WorldWidth + Next.z) * WorldWidth + Next.x;
+                if(GetLight(NextIndex, Channel) > 0)
+                    Adds.Enqueue(NextIndex);
+            }
+        }
+        RunAdds(Channel);
+    }
+    
+    // Re-render all faces that read a changed block's light: the block itself, its sides, and the top of the one below
+    if(ChangedMax.x >= 0)
+        WorldData->MarkForUpdate(ChangedMin - Vector3<int>(1, 1, 1), ChangedMax + Vector3<int>(1, 0, 1));
+}
+
+int WorldLight::GetChangeCount()
+{
+    return ChangeCount;
+}
+
+int WorldLight::GetEmission(dBlock Block)
+{
+    if(Block.GetType() == dBlockType_Lava)
+        return WorldLight_MaxLight;
+    else if(Block.GetType() == dBlockType_Torch)
+        return WorldLight_MaxLight - 1;
+    else
+        return 0;
+}
+
+void WorldLight::ComputeAll()
+{
+    /*** Sources ***/
+    
+    // Dark, and read all passable flags
+    memset(Light, 0, WorldWidth * WorldWidth * WorldHeight);
+    ChangedMin = Vector3<int>(WorldWidth, WorldHeight, WorldWidth);
+    ChangedMax = Vector3<int>(-1, -1, -1);
+    for(int y = 0; y < WorldHeight; y++)
+    for(int z = 0; z < WorldWidth; z++)
+    for(int x = 0; x < WorldWidth; x++)
+    {
+        // Emitters are sources of the block channel
+        int Index = (y * WorldWidth + z) * WorldWidth + x;
+        dBlock Block = WorldData->GetBlock(x, y, z);
+        Passable[Index] = __WorldLight_GetPassable(Block);
+        
+        int Emission = GetEmission(Block);
+        if(Emission > 0)
+        {
+            SetLight(Index, WorldLight_Channel_Block, Emission);
+            Adds.Enqueue(Index);
+        }
+    }
+    RunAdds(WorldLight_Channel_Block);
+    
+    /*** Sky ***/
+    
+    // Full sky light straight down each column, until something is in the way;
+    // the lowest fully lit layer of each column is kept for seeding below
+    int* SkyFloor = new int[WorldWidth * WorldWidth];
+    for(int z = 0; z < WorldWidth; z++)
+    for(int x = 0; x < WorldWidth; x++)
+    {
+        int y = WorldHeight - 1;
+        for(; y >= 0; y--)
+        {
+            int Index = (y * WorldWidth + z) * WorldWidth + x;
+            if((Passable[Index] & __WorldLight_PassSky) == 0)
+                break;
+            SetLight(Index, WorldLight_Channel_Sky, WorldLight_MaxLight);
+        }
+        SkyFloor[z * WorldWidth + x] = y + 1;
+    }
+    
+    // Spread from the lit blocks that have a dark neighbor: sideways, where the neighboring
+    // column isn't lit as deep, and down from the lowest lit block (i.e. into water)
+    for(int z = 0; z < WorldWidth; z++)
+    for(int x = 0; x < WorldWidth; x++)
+    {
+        // Deepest neighboring sky floor
+        int Floor = SkyFloor[z * WorldWidth + x];
+        int NeighborFloor = 0;
+        for(int i = 2; i < 6; i++)
+        {
+            int nx = x + __WorldLight_Offsets[i].x;
+            int nz = z + __WorldLight_Offsets[i].z;
+            if(nx >= 0 && nz >= 0 && nx < WorldWidth && nz < WorldWidth)
+                NeighborFloor = max(NeighborFloor, SkyFloor[nz * WorldWidth + nx]);
+        }
+        
+        // Lowest lit block first, then all the ones with a dark side
+        if(Floor < WorldHeight)
+            Adds.Enqueue((Floor * WorldWidth + z) * WorldWidth + x);
+        for(int y = Floor + 1; y < NeighborFloor; y++)
+            Adds.Enqueue((y * WorldWidth + z) * WorldWidth + x);
+    }
+    delete[] SkyFloor;
+    RunAdds(WorldLight_Channel_Sky);
+    
+    // The initial computation isn't counted as changes
+    ChangeCount = 0;
+}
+
+void WorldLight::RunRemovals(WorldLight_Channel Channel)
+{
+    while(!Removals.IsEmpty())
+    {
+        // Localize the block
+        WorldLight_Removal Removal = Removals.Dequeue();
+        int x = Removal.Index % WorldWidth;
+        int z = (Removal.Index / WorldWidth) % WorldWidth;
+        int y = Removal.Index / (WorldWidth * WorldWidth);
+        
+        // For each neighbor
+        for(int i = 0; i < 6; i++)
+        {
+            Vector3<int> Next = Vector3<int>(x, y, z) + __WorldLight_Offsets[i];
+            if(!WorldData->IsWithinWorld(Next))
+                continue;
+            
+            int NextIndex = (Next.y * WorldWidth + Next.z) * WorldWidth + Next.x;
+            int NextLight = GetLight(NextIndex, Channel);
+            if(NextLight == 0)
+                continue;
+            
+            // Dimmer, or full sky light from straight above, must have come from here: remove as well
+            bool FromAbove = (Channel == WorldLight_Channel_Sky && i == 1 && Removal.Light == WorldLight_MaxLight);
+            if(NextLight < Removal.Light || FromAbove)
+            {
+                SetLight(NextIndex, Channel, 0);
+                WorldLight_Removal NextRemoval = {NextIndex, (unsigned char)NextLight};
+                Removals.Enqueue(NextRemoval);
+                
+                // Sources are lit again on their own
+                int Source = GetSource(Next.x, Next.y, Next.z, Channel);
+                if(Source > 0)
+                {
+                    SetLight(NextIndex, Channel, Source);
+                    Adds.Enqueue(NextIndex);
+                }
+            }
+            // Else, lit from somewhere else: spread that light back in
+            else
+                Adds.Enqueue(NextIndex);
+        }
+    }
+}
+
+void WorldLight::RunAdds(WorldLight_Channel Channel)
+{
+    while(!Adds.IsEmpty())
+    {
+        // Localize the block; ignore if it went dark since being queued
+        int Index = Adds.Dequeue();
+        int CurrentLight = GetLight(Index, Channel);
+        if(CurrentLight <= 1)
+            continue;
+        
+        int x = Index % WorldWidth;
+        int z = (Index / WorldWidth) % WorldWidth;
+        int y = Index / (WorldWidth * WorldWidth);
+        
+        // For each neighbor that lets light through
+        for(int i = 0; i < 6; i++)
+        {
+            Vector3<int> Next = Vector3<int>(x, y, z) + __WorldLight_Offsets[i];
+            if(!WorldData->IsWithinWorld(Next))
+                continue;
+            
+            int NextIndex = (Next.y * WorldWidth + Next.z) * WorldWidth + Next.x;
+            if((Passable[NextIndex] & __WorldLight_PassLight) == 0)
+                continue;
+            
+            // One level less, except full sky light going straight down through clear blocks
+            int NextLight = CurrentLight - 1;
+            if(Channel == WorldLight_Channel_Sky && i == 1 && CurrentLight == WorldLight_MaxLight && (Passable[NextIndex] & __WorldLight_PassSky) != 0)
+                NextLight = WorldLight_MaxLight;
+            
+            // Only if brighter than what it already has
+            if(GetLight(NextIndex, Channel) < NextLight)
+            {
+                SetLight(NextIndex, Channel, NextLight);
+                Adds.Enqueue(NextIndex);
+            }
+        }
+    }
+}
+
+int WorldLight::GetSource(int x, int y, int z, WorldLight_Channel Channel)
+{
+    // Sky light enters the top of the world
+    if(Channel == WorldLight_Channel_Sky)
+        return (y == WorldHeight - 1 && (Passable[(y * WorldWidth + z) * WorldWidth + x] & __WorldLight_PassSky) != 0) ? WorldLight_MaxLight : 0;
+    else
+        return GetEmission(WorldData->GetBlock(x, y, z));
+}
+
+inline int WorldLight::GetLight(int Index, WorldLight_Channel Channel)
+{
+    return (Channel == WorldLight_Channel_Sky) ? (Light[Index] >> 4) : (Light[Index] & 0x0F);
+}
+
+inline void WorldLight::SetLight(int Index, WorldLight_Channel Channel, int NewLight)
+{
+    // Write the channel's nibble
+    if(Channel == WorldLight_Channel_Sky)
+        Light[Index] = (unsigned char)((Light[Index] & 0x0F) | (NewLight << 4));
+    else
+        Light[Index] = (unsigned char)((Light[Index] & 0xF0) | NewLight);
+    ChangeCount++;
+    
+    // Grow the changed volume
+    int x = Index % WorldWidth;
+    int z = (Index / WorldWidth) % WorldWidth;
+    int y = Index / (WorldWidth * WorldWidth);
+    ChangedMin = Vector3<int>(min(ChangedMin.x, x), min(ChangedMin.y, y), min(ChangedMin.z, z));
+    ChangedMax = Vector3<int>(max(ChangedMax.x, x), max(ChangedMax.y, y), max(ChangedMax.z, z));
+}
@@ -0,0 +1,119 @@
+/***************************************************************
+ 
+ DwarfCraft - Dwarf Fortress / Minecraft clone
+ Copyright 2011 Jeremy Bridon - See License.txt for info
+ 
+ This source file is developed and maintained by:
+ + Jeremy Bridon jbridon@cores2.com
+ 
+ File: WorldLight.h/cpp
+ Desc: Per-block light levels of the world, in two channels: sky
+ light, coming straight down from above the world, and block light,
+ emitted by light sources such as torches and lava. Each channel
+ goes from 0 (dark) to 15 (full light); each level is drawn 80% as
+ bright as the next (see Terrain.frag).
+ 
+ Light spreads by a breadth-first flood fill through non-opaque
+ blocks, losing one level per step. Sky light is the exception:
+ it goes straight down without any loss, as long as nothing is in
+ the way (thus open ground is fully lit).
+ 
+ The light is computed once for the whole world, then kept up to
+ date incrementally: when blocks change, all light that depended on
+ them is removed (a "removal" flood fill), then the light around
+ the removed area is spread back in (an "add" flood fill). Only the
+ affected region is ever touched, and only the world-view planes
+ whose light changed are flagged for re-rendering.
+ 
+***************************************************************/
+
+// Inclusion guard
+#ifndef __WORLDLIGHT_H__
+#define __WORLDLIGHT_H__
+
+#include "WorldContainer.h"
+#include "Queue.h"
+
+// Highest light level
+static const int WorldLight_MaxLight = 15;
+
+// Light channels
+enum WorldLight_Channel
+{
+    WorldLight_Channel_Sky = 0,
+    WorldLight_Channel_Block,
+};
+
+// Internal: a block whose light is being removed, and the light it had
+struct WorldLight_Removal
+{
+    int Index;
+    unsigned char Light;
+};
+
+class WorldLight : public WorldContainer_Listener
+{
+public:
+    
+    // Compute the light of the whole world, and keep it up to date as the world changes
+    WorldLight(WorldContainer* WorldData);
+    ~WorldLight();
+    
+    // Get the light at the given block; out of the world is dark, except above it
+    int GetSkyLight(int x, int y, int z);
+    int GetBlockLight(int x, int y, int z);
+    
+    // Get the brightest of both channels at the given block
+    int GetLight(int x, int y, int z);
+    
+    // Re-light the given volume (global, inclusive) and everything depending on it
+    void BlocksChanged(Vector3<int> Min, Vector3<int> Max);
+    
+    // Number of blocks whose light changed since creation (on top of the first computation)
+    int GetChangeCount();
+    
+    // Light emitted by the given block itself (0 if none)
+    static int GetEmission(dBlock Block);
+    
+protected:
+    
+    // Compute everything from scratch
+    void ComputeAll();
+    
+    // Run the removal, then the add flood fill, of the given channel
+    void RunRemovals(WorldLight_Channel Channel);
+    void RunAdds(WorldLight_Channel Channel);
+    
+    // Light that the given block has on its own (emitted, or sky light at the top of the world)
+    int GetSource(int x, int y, int z, WorldLight_Channel Channel);
+    
+    // Get and set a block's light of the given channel; setting also grows the changed volume
+    inline int GetLight(int Index, WorldLight_Channel Channel);
+    inline void SetLight(int Index, WorldLight_Channel Channel, int Light);
+    
+private:
+    
+    // World data container and short-hand sizes
+    WorldContainer* WorldData;
+    int WorldWidth, WorldHeight;
+    
+    // Light levels, indexed as [(y * WorldWidth + z) * WorldWidth + x]; the
+    // high four bits are the sky light, the low four bits the block light
+    unsigned char* Light;
+    
+    // Per-block flag: light may pass through, and sky light may pass without loss
+    unsigned char* Passable;
+    
+    // Flood-fill queues
+    Queue<WorldLight_Removal> Removals;
+    Queue<int> Adds;
+    
+    // Volume of all light changes during an update
+    Vector3<int> ChangedMin, ChangedMax;
+    
+    // Statistics
+    int ChangeCount;
+};
+
+// End of inclusion guard
+#endif
@@ -11,10 +11,24 @@
 // Includes
 #include "WorldView.h"
 
-WorldView::WorldView(WorldContainer* WorldData, VolumeView* Designations, ItemsView* Items, StructsView* Structs, Entities* EntitiesList)
+// Internal: a deterministic lighting jitter (0 to 1) for the given vertex position, so
+// that re-building a mesh gives the exact same colors; vertices are on half-block steps
+static inline float __WorldView_Jitter(Vector3<float> Vertex)
 {
-    // Save the world data and all other renderables
+    unsigned int Hash = (unsigned int)int(floor(Vertex.x * 2.0f)) * 73856093u;
+    Hash ^= (unsigned int)int(floor(Vertex.y * 2.0f)) * 19349663u;
+    Hash ^= (unsigned int)int(floor(Vertex.z * 2.0f)) * 83492791u;
+    Hash ^= Hash >> 13;
+    Hash *= 0x5bd1e995u;
+    Hash ^= Hash >> 15;
+    return float(Hash & 0xFFFF) / 65535.0f;
+}
+
+WorldView::WorldView(WorldContainer* WorldData, WorldLight* Lighting, VolumeView* Designations, ItemsView* Items, StructsView* Structs, Entities* EntitiesList)
+{
+    // Save the world data, its lighting, and all other renderables
     this->WorldData = WorldData;
+    this->Lighting = Lighting;
     
     // Save all the references, but only used for rendering data
     this->Designations = Designations;
@@ -30,10 +44,60 @@ WorldView::WorldView(WorldContainer* WorldData, VolumeView* Designations, ItemsV
     GetUserSetting("General", "ViewDistance", &ViewDist, 10000);
     MaxRenderDist = ViewDist;
     
+    // Get the low-detail distance
+    int LODDist;
+    GetUserSetting("General", "LODDistance", &LODDist, 48);
+    LODDistance = LODDist;
+    
     // Allocate the chunks
     Chunks = new WorldView_Column[ChunkCount * ChunkCount];
     for(int i = 0; i < ChunkCount * ChunkCount; i++)
+    {
         Chunks[i].Planes = NULL;
+        Chunks[i].UsingLOD = false;
+        Chunks[i].LODGeometry = NULL;
+    }
+    
+    // Per-frame culling results
+    ColumnCull = new WorldView_CullResult[ChunkCount * ChunkCount];
+    ColumnInView = new bool[ChunkCount * ChunkCount];
+    
+    // Visibility graph, built lazily as sections are searched
+    Visibility = new WorldVisibility(WorldData);
+    
+    // Shared block models
+    Models = new ModelRegistry();
+    
+    // Terrain draw queue
+    TerrainQueue = new RenderQueue();
+    
+    // Terrain lighting; full daylight until told otherwise
+    TerrainShader = new Shader("Terrain.vert", "Terrain.frag");
+    TerrainShader->Uniform("TerrainTexture", 0);
+    TerrainShader->Uniform("BlockLightColor", WorldView_BlockLightColor.x, WorldView_BlockLightColor.y, WorldView_BlockLightColor.z);
+    TerrainShader->Uniform("AmbientLight", WorldView_AmbientLight);
+    SetDaylight(Vector3<float>(1, 1, 1));
+    
+    // No re-meshing done yet
+    memset(&MeshStats, 0, sizeof(WorldView_MeshStats));
+    LastEditCount = WorldData->GetEditCount();
+    
+    // Occlusion scratch buffers; a layer's corners sample up to two blocks above it
+    int PaddedWidth = WorldData->GetColumnWidth() + 2;
+    int CornerWidth = WorldData->GetColumnWidth() + 1;
+    OcclusionBlocks = new unsigned char[PaddedWidth * PaddedWidth * 3];
+    OcclusionCorners = new unsigned char[CornerWidth * CornerWidth * 2];
+    
+    // Face mask scratch buffers; each row holds the column plus its two x neighbors
+    int ColumnWidth = WorldData->GetColumnWidth();
+    FaceMaskWords = (PaddedWidth + WorldView_RowMaskBits - 1) / WorldView_RowMaskBits;
+    FaceMasks = new WorldView_RowMask[ColumnWidth * 5 * FaceMaskWords];
+    HalfFaceMasks = new WorldView_RowMask[ColumnWidth * 5 * FaceMaskWords];
+    OpenRows = new WorldView_RowMask[PaddedWidth * FaceMaskWords];
+    HalfRows = new WorldView_RowMask[PaddedWidth * FaceMaskWords];
+    CubeRows = new WorldView_RowMask[ColumnWidth * FaceMaskWords];
+    WholeRows = new WorldView_RowMask[ColumnWidth * FaceMaskWords];
+    TopRows = new WorldView_RowMask[ColumnWidth * FaceMaskWords];
 }
 
 WorldView::~WorldView()
@@ -43,21 +107,59 @@ WorldView::~WorldView()
     
     // Release the graphical list itself
     delete[] Chunks;
+    
+    // Release culling data
+    delete[] ColumnCull;
+    delete[] ColumnInView;
+    delete Visibility;
+    
+    // Release all models and shaders
+    delete Models;
+    delete TerrainShader;
+    delete TerrainQueue;
+    
+    // Release occlusion buffers
+    delete[] OcclusionBlocks;
+    delete[] OcclusionCorners;
+    
+    // Release face mask buffers
+    delete[] FaceMasks;
+    delete[] HalfFaceMasks;
+    delete[] OpenRows;
+    delete[] HalfRows;
+    delete[] CubeRows;
+    delete[] WholeRows;
+    delete[] TopRows;
 }
 
-void WorldView::Render(Vector3<float> CameraPos, Vector3<float> CameraRight, int LayerCutoff, float CameraAngle)
+void WorldView::Render(Vector3<float> CameraPos, int LayerCutoff, float CameraAngle)
 {
     // Ignore y components
     CameraPos.y = 0;
-    CameraRight.y = 0;
     
     // Helpful short-hand variable
     int ChunkWidth = WorldData->GetColumnWidth();
     
+    // Read back the frustum for this frame and reset the statistics
+    ExtractFrustum();
+    memset(&CullStats, 0, sizeof(WorldView_CullStats));
+    memset(&MeshStats, 0, sizeof(WorldView_MeshStats));
+    
+    // How many blocks changed since last frame?
+    MeshStats.BlockEdits = WorldData->GetEditCount() - LastEditCount;
+    LastEditCount = WorldData->GetEditCount();
+    
+    /*** Frustum Culling ***/
+    
     // For each chunk...
     for(int ChunkZ = 0; ChunkZ < ChunkCount; ChunkZ++)
     for(int ChunkX = 0; ChunkX < ChunkCount; ChunkX++)
     {
+        // Default to not visible
+        int ChunkIndex = ChunkZ * ChunkCount + ChunkX;
+        ColumnCull[ChunkIndex] = WorldView_CullResult_Outside;
+        ColumnInView[ChunkIndex] = false;
+        
         // What is the vector from our camera to the chunk (global pos)
         // Note we are measuring from the middle of the chunk
         Vector3<float> ChunkVector = Vector3<float>(ChunkX * ChunkWidth + ChunkWidth / 2, 0, ChunkZ * ChunkWidth + ChunkWidth / 2) - CameraPos;
@@ -66,22 +168,75 @@ void WorldView::Render(Vector3<float> CameraPos, Vector3<float> CameraRight, int
         if(ChunkVector.x * ChunkVector.x + ChunkVector.z * ChunkVector.z > MaxRenderDist)
             continue;
         
-        // Cross it, only render positive results
-        float Magnitude = Vector3Cross(CameraRight, ChunkVector).y;
-        if(Magnitude < 0.0f)
+        // Test the column's volume, from the bottom up to the top of the cutoff layer
+        Vector3<float> ColumnMin(ChunkX * ChunkWidth, 0, ChunkZ * ChunkWidth);
+        Vector3<float> ColumnMax(ColumnMin.x + ChunkWidth, LayerCutoff + 1, ColumnMin.z + ChunkWidth);
+        ColumnCull[ChunkIndex] = CullBox(ColumnMin, ColumnMax);
+        
+        CullStats.ColumnsTested++;
+        if(ColumnCull[ChunkIndex] == WorldView_CullResult_Outside)
+            CullStats.ColumnsCulled++;
+        else
+        {
+            CullStats.ColumnsVisible++;
+            ColumnInView[ChunkIndex] = true;
+        }
+        
+        // Switch detail levels, only once past the hysteresis band
+        float Distance = sqrt(ChunkVector.x * ChunkVector.x + ChunkVector.z * ChunkVector.z);
+        WorldView_Column& Column = Chunks[ChunkIndex];
+        if(!Column.UsingLOD && Distance > LODDistance + WorldView_LODHysteresis)
+            Column.UsingLOD = true;
+        else if(Column.UsingLOD && Distance < LODDistance - WorldView_LODHysteresis)
+            Column.UsingLOD = false;
+    }
+    
+    /*** Occlusion Culling ***/
+    
+    // Search for all sections visible from the eye, through the open (non-opaque) volumes
+    Visibility->Compute(FrustumEye, LayerCutoff, ColumnInView);
+    
+    /*** Render Chunks ***/
+    
+    // For each chunk in view...
+    for(int ChunkZ = 0; ChunkZ < ChunkCount; ChunkZ++)
+    for(int ChunkX = 0; ChunkX < ChunkCount; ChunkX++)
+    {
+        // Ignore if culled
+        WorldView_CullResult ColumnResult = ColumnCull[ChunkZ * ChunkCount + ChunkX];
+        if(ColumnResult == WorldView_CullResult_Outside)
             continue;
         
+        // Column volume, for per-layer tests
+        Vector3<float> ColumnMin(ChunkX * ChunkWidth, 0, ChunkZ * ChunkWidth);
+        Vector3<float> ColumnMax(ColumnMin.x + ChunkWidth, LayerCutoff + 1, ColumnMin.z + ChunkWidth);
+        
         // Get the chunk graphical data we are working on
         //WorldContainer_Column* ChunkData = WorldData->GetChunk(ChunkX, ChunkZ);
         WorldView_Column* ChunkGraphics = &Chunks[ChunkZ * ChunkCount + ChunkX];
         
-        // If this chunk is not yet built, build the chunk
-        if(ChunkGraphics->Planes == NULL || WorldData->GetChunk(ChunkX, ChunkZ)->NeedsUpdate)
+        // Far columns are only drawn as their low-detail surface
+        if(ChunkGraphics->UsingLOD)
         {
-            GenerateColumnVBO(ChunkX, ChunkZ);
-            WorldData->GetChunk(ChunkX, ChunkZ)->NeedsUpdate = false;
+            // (Re)build if never built, if the cutoff moved, or if the world changed here
+            unsigned int Revision = GetColumnRevision(ChunkX, ChunkZ);
+            if(ChunkGraphics->LODGeometry == NULL || ChunkGraphics->LODCutoff != LayerCutoff || ChunkGraphics->LODRevision != Revision)
+            {
+                GenerateColumnLOD(ChunkX, ChunkZ, LayerCutoff);
+                ChunkGraphics->LODCutoff = LayerCutoff;
+                ChunkGraphics->LODRevision = Revision;
+                MeshStats.ColumnsLODRebuilt++;
+            }
+            
+            TerrainQueue->Add(ChunkGraphics->LODGeometry, TerrainShader, GetDepth(ColumnMin, ColumnMax));
+            MeshStats.ColumnsLOD++;
+            continue;
         }
         
+        // If this chunk is not yet built or has changed layers, (re)build them
+        if(ChunkGraphics->Planes == NULL || WorldData->GetChunk(ChunkX, ChunkZ)->NeedsUpdate)
+            GenerateColumnVBO(ChunkX, ChunkZ);
+        
         // For this chunk's height
         for(int i = 0; i <= LayerCutoff; i++)
         {
@@ -90,38 +245,53 @@ void WorldView::Render(Vector3<float> CameraPos, Vector3<float> CameraRight, int
             if(Plane.WorldGeometry == NULL)
                 continue;
             
-            /*** Regular Layers ***/
-            
-            // Push local translation
-            glPushMatrix();
+            // If the column is only partially visible, test this layer's slab on its own
+            if(ColumnResult == WorldView_CullResult_Intersect)
+            {
+                CullStats.LayersTested++;
+                if(CullBox(Vector3<float>(ColumnMin.x, i, ColumnMin.z), Vector3<float>(ColumnMax.x, i + 1, ColumnMax.z)) == WorldView_CullResult_Outside)
+                {
+                    CullStats.LayersCulled++;
+                    continue;
+                }
+                CullStats.LayersVisible++;
+            }
             
-            // Only render if there is anything to render
-            if(Plane.WorldGeometry != NULL)
-                Plane.WorldGeometry->Render();
+            // Ignore if hidden behind solid rock
+            if(!Visibility->IsVisible(ChunkX, i, ChunkZ))
+            {
+                CullStats.LayersOccluded++;
+                continue;
+            }
             
-            // Render the hidden geometry
-            if(i == LayerCutoff && Plane.HiddenGeometry != NULL)
-                Plane.HiddenGeometry->Render();
+            /*** Regular Layers ***/
             
-            // Render the side geometry
-            if(i == LayerCutoff && Plane.SideGeometry != NULL)
-                Plane.SideGeometry->Render();
+            // Queue the layer's geometry, all lit by the terrain shader; the hidden and side
+            // geometry (black caps of the cut-away volume) are only drawn at the cutoff
+            float LayerDepth = GetDepth(Vector3<float>(ColumnMin.x, i, ColumnMin.z), Vector3<float>(ColumnMax.x, i + 1, ColumnMax.z));
+            TerrainQueue->Add(Plane.WorldGeometry, TerrainShader, LayerDepth);
+            TerrainQueue->Add(Plane.CutoutGeometry, TerrainShader, LayerDepth, RenderQueue_Pass_Cutout);
+            if(i == LayerCutoff)
+            {
+                TerrainQueue->Add(Plane.HiddenGeometry, TerrainShader, LayerDepth);
+                TerrainQueue->Add(Plane.SideGeometry, TerrainShader, LayerDepth);
+            }
             
-            // Render all models
+            // Queue all models; drawn once all chunks are done, batched per model
             for(int ModelIndex = 0; ModelIndex < Plane.Models.GetSize(); ModelIndex++)
             {
-                glPushMatrix();
-                    Vector3<int> ModelPos = Plane.Models[ModelIndex].Position;
-                    glTranslatef(ModelPos.x, ModelPos.y, ModelPos.z);
-                    Plane.Models[ModelIndex].ModelData->Render();
-                glPopMatrix();
+                WorldView_Model& Model = Plane.Models[ModelIndex];
+                Models->AddInstance(Model.ModelID, Model.Position, Model.Facing);
             }
-            
-            // Done rendering this layer
-            glPopMatrix();
         }
     }
     
+    // Draw all terrain, grouped by state and front-to-back (then cut-out blocks back-to-front)
+    TerrainQueue->Submit();
+    
+    // Render all block models
+    Models->Render();
+    
     // Render all other entities
     Items->Render(LayerCutoff, CameraAngle);
     Designations->Render(LayerCutoff);
@@ -138,67 +308,92 @@ void WorldView::Update(float dT)
     EntitiesList->Update(dT);
 }
 
+void WorldView::SetDaylight(Vector3<float> Color)
+{
+    // Only a single uniform change, no re-meshing
+    TerrainShader->Uniform("Daylight", Color.x, Color.y, Color.z);
+}
+
+WorldView_CullStats WorldView::GetCullStats()
+{
+    return CullStats;
+}
+
+WorldView_MeshStats WorldView::GetMeshStats()
+{
+    return MeshStats;
+}
+
+RenderQueue_Stats WorldView::GetRenderStats()
+{
+    return TerrainQueue->GetStats();
+}
+
 void WorldView::GenerateColumnVBO(int ChunkX, int ChunkZ)
 {
-    // Chunk we are working on and the world texture ID
+    // Chunk we are working on, its source data, and the world texture ID
     WorldView_Column* ChunkGraphics = &Chunks[ChunkZ * ChunkCount + ChunkX];
+    WorldContainer_Column* ChunkData = WorldData->GetChunk(ChunkX, ChunkZ);
     GLuint WorldTextureID = dGetTerrainTextureID();
     
-    // Release if already allocated
-    if(ChunkGraphics->Planes != NULL)
+    // Allocate all the layers (but default to NULL) if never built
+    bool IsNew = (ChunkGraphics->Planes == NULL);
+    if(IsNew)
     {
+        ChunkGraphics->Planes = new WorldView_Plane[WorldData->GetWorldHeight()];
         for(int j = 0; j < WorldData->GetWorldHeight(); j++)
         {
-            // Release all VBO data
-            if(ChunkGraphics->Planes[j].WorldGeometry != NULL)
-                ChunkGraphics->Planes[j].WorldGeometry->Clear();
-            
-            if(ChunkGraphics->Planes[j].HiddenGeometry != NULL)
-                ChunkGraphics->Planes[j].HiddenGeometry->Clear();
-            
-            if(ChunkGraphics->Planes[j].SideGeometry != NULL)
-                ChunkGraphics->Planes[j].SideGeometry->Clear();
-            
-            // Release all models
-            for(int ModelIndex = 0; ModelIndex < ChunkGraphics->Planes[j].Models.GetSize(); ModelIndex++)
-                delete ChunkGraphics->Planes[j].Models[ModelIndex].ModelData; // Internally releases VBO
+            ChunkGraphics->Planes[j].WorldGeometry = NULL;
+            ChunkGraphics->Planes[j].CutoutGeometry = NULL;
+            ChunkGraphics->Planes[j].HiddenGeometry = NULL;
+            ChunkGraphics->Planes[j].SideGeometry = NULL;
         }
     }
     
-    // Allocate all the layers (but default to NULL)
-    ChunkGraphics->Planes = new WorldView_Plane[WorldData->GetWorldHeight()];
-    for(int j = 0; j < WorldData->GetWorldHeight(); j++)
-    {
-        ChunkGraphics->Planes[j].WorldGeometry = NULL;
-        ChunkGraphics->Planes[j].HiddenGeometry = NULL;
-        ChunkGraphics->Planes[j].SideGeometry = NULL;
-    }
-    
     // For each layer, generate the VBO (game geometry and hidden volume)
     // Note: we are going from bottom (0) to top (depth - 1)
     for(int i = 0; i < WorldData->GetWorldHeight(); i++)
     {
+        // Only re-generate changed layers
+        if(!IsNew && !ChunkData->Planes[i].NeedsUpdate)
+            continue;
+        ChunkData->Planes[i].NeedsUpdate = false;
+        MeshStats.LayersRebuilt++;
+        
         // Prepare a layer buffer to work on
         WorldView_Plane& Layer = ChunkGraphics->Planes[i];
         
-        // Allocate geometry buffers (VBO-baseD)
-        Layer.WorldGeometry = new VBuffer(GL_QUADS, WorldTextureID);
-        Layer.HiddenGeometry = new VBuffer(GL_QUADS, WorldTextureID);
-        Layer.SideGeometry = new VBuffer(GL_QUADS, WorldTextureID);
+        // Release all model instances; they are re-created with the geometry
+        Layer.Models.Resize(0);
         
-        // Generate, but release if 
+        // Allocate geometry buffers (VBO-based) if the layer had none; else the
+        // buffers are re-used, and their VBO memory with them if the new geometry fits
+        if(Layer.WorldGeometry == NULL)
+        {
+            Layer.WorldGeometry = new VBuffer(GL_QUADS, WorldTextureID, true);
+            Layer.CutoutGeometry = new VBuffer(GL_QUADS, WorldTextureID, true);
+            Layer.HiddenGeometry = new VBuffer(GL_QUADS, WorldTextureID);
+            Layer.SideGeometry = new VBuffer(GL_QUADS, WorldTextureID);
+        }
+        
+        // Generate, but release if empty
         if(!GenerateLayerVBO(ChunkX, i, ChunkZ, &Layer))
         {
             // Release and null
             delete Layer.WorldGeometry;
+            delete Layer.CutoutGeometry;
             delete Layer.HiddenGeometry;
             delete Layer.SideGeometry;
             
             Layer.WorldGeometry = NULL;
+            Layer.CutoutGeometry = NULL;
             Layer.HiddenGeometry = NULL;
             Layer.SideGeometry = NULL;
         }
     }
+    
+    // All layers up to date
+    ChunkData->NeedsUpdate = false;
 }
 
 bool WorldView::GenerateLayerVBO(int ChunkX, int Y, int ChunkZ, WorldView_Plane* Layer)
@@ -226,6 +421,12 @@ bool WorldView::GenerateLayerVBO(int ChunkX, int Y, int ChunkZ, WorldView_Plane*
     // If the layer is just air, ignore the cube geometry
     if(!IsFilled || FillType != dBlockType_Air)
     {
+        // Occlusion of all corners of this layer, sampled once
+        BuildOcclusion(OriginX, OriginY, OriginZ);
+        
+        // Visible faces of every block of this layer
+        BuildFaceMasks(OriginX, OriginY, OriginZ);
+        
         // For each block
         for(int z = OriginZ; z < OriginZ + ColumnWidth; z++)
         for(int x = OriginX; x < OriginX + ColumnWidth; x++)
@@ -238,72 +439,71 @@ bool WorldView::GenerateLayerVBO(int ChunkX, int Y, int ChunkZ, WorldView_Plane*
             // Case 1: Regular block geometry
             if(!dHasSpecialGeometry(TargetBlock))
             {
+                // Blocks that don't fully hide what is behind them have see-through texels
+                VBuffer* Geometry = dHasProperty(TargetBlock, dBlockProperty_Opaque) ? Layer->WorldGeometry : Layer->CutoutGeometry;
+                
+                // This block's bit within its row's face masks
+                int Bit = x - OriginX + 1;
+                int RowOffset = (z - OriginZ) * 5 * FaceMaskWords + Bit / WorldView_RowMaskBits;
+                WorldView_RowMask BitMask = WorldView_RowMask(1) << (Bit % WorldView_RowMaskBits);
+                
                 // For each face of the block, is it facing an air block or is it the top-most?
                 // Six faces in total (Top, bottom, left, right, front, back)
                 for(int OffsetIndex = 0; OffsetIndex < 5; OffsetIndex++)
                 {
-                    // Pull out the offset
-                    Vector3<int> FaceOffset = GameRender_FaceOffsets[OffsetIndex];
-                    
-                    // Ignore if out of bounds
-                    if(!WorldData->IsWithinWorld(x + FaceOffset.x, y + FaceOffset.y, z + FaceOffset.z))
-                        continue;
-                    
-                    // Get block (we know it is in the world for sure)
-                    dBlock AdjacentBlock = WorldData->GetBlock(x + FaceOffset.x, y + FaceOffset.y, z + FaceOffset.z);
-                    
                     // Only render if next to a valid visible block
-                    if(!dAdjacentCheck(TargetBlock, AdjacentBlock))
+                    if((FaceMasks[RowOffset + OffsetIndex * FaceMaskWords] & BitMask) == 0)
                         continue;
                     
-                    // If we are checking the above-block, hide if above is a half-block (dAdjacentCheck can't do it...)
-                    if(OffsetIndex == 0 && !AdjacentBlock.IsWhole())
-                        continue;
+                    // Faces are lit by the block they look into; a half block's top is within the block itself
+                    Vector3<int> FaceOffset = GameRender_FaceOffsets[OffsetIndex];
+                    Vector2<float> LightLevel = (OffsetIndex == 0 && !TargetBlock.IsWhole()) ? GetFaceLight(x, y, z) : GetFaceLight(x + FaceOffset.x, y + FaceOffset.y, z + FaceOffset.z);
                     
                     // If we are a whole block next to a half block, only render the top half of the vertices
-                    if(OffsetIndex > 0 && TargetBlock.IsWhole() && !AdjacentBlock.IsWhole())
+                    if((HalfFaceMasks[RowOffset + OffsetIndex * FaceMaskWords] & BitMask) != 0)
                     {
                         // Top geometry
                         for(int i = 0; i < 2; i++)
-                            AddVertex(Layer->WorldGeometry, Vector3<float>(x, y, z) + WorldView_FaceQuads[OffsetIndex][i], WorldView_Normals[OffsetIndex], i, TargetBlock);
+                            AddVertex(Geometry, Vector3<float>(x, y, z) + WorldView_FaceQuads[OffsetIndex][i], WorldView_Normals[OffsetIndex], i, TargetBlock, LightLevel);
                         for(int i = 2; i < 4; i++)
-                            AddVertex(Layer->WorldGeometry, Vector3<float>(x, y + 0.5f, z) + WorldView_FaceQuads[OffsetIndex][i], WorldView_Normals[OffsetIndex], i, TargetBlock, true);
+                            AddVertex(Geometry, Vector3<float>(x, y + 0.5f, z) + WorldView_FaceQuads[OffsetIndex][i], WorldView_Normals[OffsetIndex], i, TargetBlock, LightLevel, true);
                     }
                     // Normal geometry
                     else
                     {
                         // If this is a face we should render, push geometry into the queue
                         for(int i = 0; i < 4; i++)
-                            AddVertex(Layer->WorldGeometry, Vector3<float>(x, y, z) + WorldView_FaceQuads[OffsetIndex][i], WorldView_Normals[OffsetIndex], i, TargetBlock);
+                            AddVertex(Geometry, Vector3<float>(x, y, z) + WorldView_FaceQuads[OffsetIndex][i], WorldView_Normals[OffsetIndex], i, TargetBlock, LightLevel);
                     }
                 }
             }
             
             // Case 2: Specialty 3D model (i.e. workbenches, mushrooms, etc.)
-            else if(TargetBlock.GetType() == dBlockType_Mushroom || TargetBlock.GetType() == dBlockType_Torch) // TORHC IS WORKBENCH DURING MODEL TESTING
+            else if(dGetBlockModel(TargetBlock) != NULL)
             {
-                // Allocate new model
+                // Allocate new model instance
                 WorldView_Model Model;
                 Model.Position = Vector3<int>(x, y, z);
                 Model.Facing = dFacing_North;
                 
-                // Load the model
-                Model.ModelData = new VBuffer("WorkBenchModel.cfg");
+                // Find the model (only loaded the first time it is seen)
+                Model.ModelID = Models->GetModelID(dGetBlockModel(TargetBlock));
                 
                 // Push to this layer's model list
                 int ModelCount = Layer->Models.GetSize();
                 Layer->Models.Resize(ModelCount + 1);
                 Layer->Models[ModelCount] = Model;
             }
-                
+            
             // Case 3: Generic 3D model (x-shape, for bushes, etc.)
             else
             {
-                // Render only the sides, not the top
+                // Render only the sides, not the top; lit by the block itself (see-through around the shape)
+                Vector2<float> LightLevel = GetFaceLight(x, y, z);
                 for(int OffsetIndex = 1; OffsetIndex < 5; OffsetIndex++)
                 {
                     for(int i = 0; i < 4; i++)
-                        AddVertex(Layer->WorldGeometry, Vector3<float>(x, y, z) + WorldView_FaceQuads[OffsetIndex][i], WorldView_Normals[OffsetIndex], i, TargetBlock);
+                        AddVertex(Layer->CutoutGeometry, Vector3<float>(x, y, z) + WorldView_FaceQuads[OffsetIndex][i], WorldView_Normals[OffsetIndex], i, TargetBlock, LightLevel);
                 }
             }
             
@@ -412,9 +612,10 @@ bool WorldView::GenerateLayerVBO(int ChunkX, int Y, int ChunkZ, WorldView_Plane*
     /*** Finalize Geometry ***/
     
     // Generate geometry if there is data in either one
-    if(!Layer->WorldGeometry->IsEmpty() || !Layer->HiddenGeometry->IsEmpty() || !Layer->SideGeometry->IsEmpty())
+    if(!Layer->WorldGeometry->IsEmpty() || !Layer->CutoutGeometry->IsEmpty() || !Layer->HiddenGeometry->IsEmpty() || !Layer->SideGeometry->IsEmpty())
     {
         Layer->WorldGeometry->Generate();
+        Layer->CutoutGeometry->Generate();
         Layer->HiddenGeometry->Generate();
         Layer->SideGeometry->Generate();
         return true;
@@ -424,10 +625,124 @@ bool WorldView::GenerateLayerVBO(int ChunkX, int Y, int ChunkZ, WorldView_Plane*
         return false;
 }
 
-void WorldView::AddVertex(VBuffer* Buffer, Vector3<float> Vertex, Vector3<float> Normal, int QuadCornerIndex, dBlock Block, bool BottomShiftedUp)
+void WorldView::GenerateColumnLOD(int ChunkX, int ChunkZ, int LayerCutoff)
+{
+    // Allocate, or re-use, the column's low-detail buffer
+    WorldView_Column* ChunkGraphics = &Chunks[ChunkZ * ChunkCount + ChunkX];
+    if(ChunkGraphics->LODGeometry == NULL)
+        ChunkGraphics->LODGeometry = new VBuffer(GL_QUADS, dGetTerrainTextureID(), true);
+    VBuffer* Buffer = ChunkGraphics->LODGeometry;
+    
+    // Short hand some data
+    const int ColumnWidth = WorldData->GetColumnWidth();
+    const int CellSize = WorldView_LODCellSize;
+    int OriginX = ChunkX * ColumnWidth;
+    int OriginZ = ChunkZ * ColumnWidth;
+    
+    // For each cell
+    for(int z = OriginZ; z < OriginZ + ColumnWidth; z += CellSize)
+    for(int x = OriginX; x < OriginX + ColumnWidth; x += CellSize)
+    {
+        // Get the cell's surface, ignore if there is none
+        dBlock SurfaceBlock;
+        int Height = GetLODHeight(x, z, LayerCutoff, &SurfaceBlock);
+        if(Height < 0)
+            continue;
+        
+        // Cells are scaled up on the x-z plane (clamped to the column, in case it isn't a multiple of the cell size)
+        float CellWidth = min(CellSize, OriginX + ColumnWidth - x);
+        float CellDepth = min(CellSize, OriginZ + ColumnWidth - z);
+        
+        // Top face, then each of the four sides (same order as the face offsets)
+        for(int OffsetIndex = 0; OffsetIndex < 5; OffsetIndex++)
+        {
+            // Sides drop down to the neighboring cell's surface; skip if that isn't lower
+            int BottomHeight = Height;
+            if(OffsetIndex > 0)
+            {
+                Vector3<int> FaceOffset = GameRender_FaceOffsets[OffsetIndex];
+                BottomHeight = GetLODHeight(x + FaceOffset.x * CellSize, z + FaceOffset.z * CellSize, LayerCutoff);
+                if(BottomHeight >= Height)
+                    continue;
+            }
+            
+            // Face texture; same face mapping as regular blocks
+            const dBlockFace Faces[5] = {dBlockFace_Top, dBlockFace_Front, dBlockFace_Back, dBlockFace_Left, dBlockFace_Right};
+            const dBlockFaceTexture& Texture = dGetBlockFaceTexture(SurfaceBlock, Faces[OffsetIndex]);
+            const Vector2<float>* FaceTexture = Texture.UV;
+            Vector3<float> TextureColor = Texture.Color;
+            
+            // Same lighting as regular blocks, minus the ambient occlusion (which would be lost at this size anyways),
+            // using the light right above the cell's surface
+            Vector2<float> LightLevel = GetFaceLight(x, Height + 1, z);
+            float LightNormal = 0.2f * Vector3Dot(Vector3<float>(1, 2, 4), WorldView_Normals[OffsetIndex]);
+            float LightFactor = fmin(1.0f, fmax(0.4f, 1.0f + LightNormal));
+            
+            // Scale the unit face quad to the cell: the top (y = 1) vertices sit on the surface, the
+            // bottom (y = 0) vertices on the lower neighbor's surface (or the world floor)
+            for(int i = 0; i < 4; i++)
+            {
+                Vector3<float> Corner = WorldView_FaceQuads[OffsetIndex][i];
+                Vector3<float> Vertex(x + Corner.x * CellWidth, (Corner.y > 0.0f) ? (Height + 1) : (BottomHeight + 1), z + Corner.z * CellDepth);
+                Buffer->AddVertex(Vertex, TextureColor * LightFactor, FaceTexture[i], LightLevel);
+            }
+        }
+    }
+    
+    // Upload (re-uses the previous VBO if possible)
+    Buffer->Generate();
+}
+
+int WorldView::GetLODHeight(int x, int z, int LayerCutoff, dBlock* SurfaceBlock)
+{
+    // Highest solid block, from the cutoff down, among all of the cell's blocks
+    int Height = -1;
+    for(int dz = 0; dz < WorldView_LODCellSize; dz++)
+    for(int dx = 0; dx < WorldView_LODCellSize; dx++)
+    {
+        // Ignore out of the world
+        if(!WorldData->IsWithinWorld(x + dx, 0, z + dz))
+            continue;
+        
+        // Only search above the current best
+        for(int y = LayerCutoff; y > Height; y--)
+        {
+            dBlock Block = WorldData->GetBlock(x + dx, y, z + dz);
+            if(dIsSolid(Block))
+            {
+                Height = y;
+                if(SurfaceBlock != NULL)
+                    *SurfaceBlock = Block;
+                break;
+            }
+        }
+    }
+    
+    return Height;
+}
+
+unsigned int WorldView::GetColumnRevision(int ChunkX, int ChunkZ)
+{
+    // Sum of all plane revisions of this column and its four neighbors (skirts depend on them)
+    const int Offsets[5][2] = { {0, 0}, {1, 0}, {-1, 0}, {0, 1}, {0, -1} };
+    unsigned int Revision = 0;
+    for(int i = 0; i < 5; i++)
+    {
+        int x = ChunkX + Offsets[i][0];
+        int z = ChunkZ + Offsets[i][1];
+        if(x < 0 || z < 0 || x >= ChunkCount || z >= ChunkCount)
+            continue;
+        
+        WorldContainer_Column* Column = WorldData->GetChunk(x, z);
+        for(int y = 0; y < WorldData->GetWorldHeight(); y++)
+            Revision += Column->Planes[y].Revision;
+    }
+    return Revision;
+}
+
+void WorldView::AddVertex(VBuffer* Buffer, Vector3<float> Vertex, Vector3<float> Normal, int QuadCornerIndex, dBlock Block, Vector2<float> LightLevel, bool BottomShiftedUp)
 {
     // UV-texture based on the block type
-    float x, y, width, height;
     dBlockFace Facing = dBlockFace_Top;
     
     if(Normal == WorldView_Normals[1])
@@ -439,29 +754,11 @@ void WorldView::AddVertex(VBuffer* Buffer, Vector3<float> Vertex, Vector3<float>
     else if(Normal == WorldView_Normals[4])
         Facing = dBlockFace_Right;
     
-    // Get the correct texture facing and details
-    Vector3<float> TextureColor;
-    int Rotations = 0;
-    dGetBlockTexture(Block, Facing, &x, &y, &width, &height, &TextureColor, &Rotations);
-    
-    // Generic texture map; note that the z (third element) is ignored (UV, not UVW)
-    Vector2<float> FaceTexture[4] =
-    {
-        Vector2<float>(x + width, y),
-        Vector2<float>(x, y),
-        Vector2<float>(x, y + height),
-        Vector2<float>(x + width, y + height),
-    };
-    
-    // How many rotations must we do?
-    for(int i = 0; i < Rotations; i++)
-    {
-        Vector2<float> Temp = FaceTexture[0];
-        FaceTexture[0] = FaceTexture[1];
-        FaceTexture[1] = FaceTexture[2];
-        FaceTexture[2] = FaceTexture[3];
-        FaceTexture[3] = Temp;
-    }
+    // Get the correct texture facing and details (already rotated)
+    const dBlockFaceTexture& Texture = dGetBlockFaceTexture(Block, Facing);
+    Vector3<float> TextureColor = Texture.Color;
+    float height = Texture.Height;
+    Vector2<float> FaceTexture[4] = {Texture.UV[0], Texture.UV[1], Texture.UV[2], Texture.UV[3]};
     
     // If this is the top-face, set the level as needed or if this is any of
     // the uppser-sides, apply height diff. Note: the 1st and 2nd verticies
@@ -478,20 +775,20 @@ void WorldView::AddVertex(VBuffer* Buffer, Vector3<float> Vertex, Vector3<float>
         FaceTexture[3].y -= height / 2.0f;
     }
     
-    // Compute the color as the dot product between the sun and the this normal
+    // Compute the color as the dot product between the sun and the this normal; the light
+    // level itself is applied by the terrain shader, against the time of day
     // Note: the constants were just test-and-compile derived
-    float LightRand = 0.12f * (float(rand()) / float(RAND_MAX));
-    float LightDepth = 1.0f + 0.32f * (Vertex.y - float(WorldData->GetWorldHeight() - 16)) / 16.0f;
+    float LightRand = 0.12f * __WorldView_Jitter(Vertex);
     float LightNormal = 0.2f * Vector3Dot(Vector3<float>(1, 2, 4), Normal);
     
-    float LightFactor = fmin(1.0f, fmax(0.4f, LightRand + LightDepth + LightNormal));
+    float LightFactor = fmin(1.0f, fmax(0.4f, LightRand + 1.0f + LightNormal));
     
     // Apply occlusion factor
     // Little hack: if it's a half block, we have to bump the vertex's y up a half
     if(Vertex.y - (int)Vertex.y > 0.0f)
-        LightFactor *= GetAmbientOcclusion(Vector3ftoi(Vertex) + Vector3<int>(0, 1, 0));
+        LightFactor *= GetCornerOcclusion(Vector3ftoi(Vertex) + Vector3<int>(0, 1, 0));
     else
-        LightFactor *= GetAmbientOcclusion(Vector3ftoi(Vertex));
+        LightFactor *= GetCornerOcclusion(Vector3ftoi(Vertex));
     
     // Add vertices
     if(dHasSpecialGeometry(Block))
@@ -508,7 +805,12 @@ void WorldView::AddVertex(VBuffer* Buffer, Vector3<float> Vertex, Vector3<float>
     }
     
     // Add the full data set for the given vertex into the buffer
-    Buffer->AddVertex(Vertex, TextureColor * LightFactor, FaceTexture[QuadCornerIndex]);
+    Buffer->AddVertex(Vertex, TextureColor * LightFactor, FaceTexture[QuadCornerIndex], LightLevel);
+}
+
+Vector2<float> WorldView::GetFaceLight(int x, int y, int z)
+{
+    return Vector2<float>(float(Lighting->GetSkyLight(x, y, z)) / float(WorldLight_MaxLight), float(Lighting->GetBlockLight(x, y, z)) / float(WorldLight_MaxLight));
 }
 
 void WorldView::AddVertex(VBuffer* Buffer, Vector3<float> Vertex)
@@ -523,16 +825,26 @@ void WorldView::ClearVBO()
     // For each column
     for(int i = 0; i < ChunkCount * ChunkCount; i++)
     {
+        // Release the low-detail geometry
+        delete Chunks[i].LODGeometry;
+        Chunks[i].LODGeometry = NULL;
+        
+        // Ignore if never built
+        if(Chunks[i].Planes == NULL)
+            continue;
+        
         // For each plane
         for(int j = 0; j < WorldData->GetWorldHeight(); j++)
         {
             // Release the pointers
             delete Chunks[i].Planes[j].WorldGeometry;
+            delete Chunks[i].Planes[j].CutoutGeometry;
             delete Chunks[i].Planes[j].HiddenGeometry;
             delete Chunks[i].Planes[j].SideGeometry;
             
             // Set to null
             Chunks[i].Planes[j].WorldGeometry = NULL;
+            Chunks[i].Planes[j].CutoutGeometry = NULL;
             Chunks[i].Planes[j].HiddenGeometry = NULL;
             Chunks[i].Planes[j].SideGeometry = NULL;
         }
@@ -562,3 +874,227 @@ float WorldView::GetAmbientOcclusion(Vector3<int> Pos)
     // Return the computed occlusion
     return Occlusion;
 }
+
+void WorldView::BuildOcclusion(int OriginX, int OriginY, int OriginZ)
+{
+    // Short-hand sizes
+    const int ColumnWidth = WorldData->GetColumnWidth();
+    const int PaddedWidth = ColumnWidth + 2;
+    const int CornerWidth = ColumnWidth + 1;
+    OcclusionOrigin = Vector3<int>(OriginX, OriginY, OriginZ);
+    
+    // Copy the neighborhood once; anything out of the world doesn't occlude
+    int Index = 0;
+    for(int y = 0; y < 3; y++)
+    for(int z = 0; z < PaddedWidth; z++)
+    for(int x = 0; x < PaddedWidth; x++)
+    {
+        Vector3<int> BlockPos(OriginX + x, OriginY + y, OriginZ + z);
+        OcclusionBlocks[Index++] = (WorldData->IsWithinWorld(BlockPos) && WorldData->GetBlock(BlockPos).GetType() != dBlockType_Air) ? 1 : 0;
+    }
+    
+    // Each corner counts the 2x2x2 blocks at and after it (same as GetAmbientOcclusion)
+    Index = 0;
+    for(int y = 0; y < 2; y++)
+    for(int z = 0; z < CornerWidth; z++)
+    for(int x = 0; x < CornerWidth; x++)
+    {
+        const unsigned char* Block = &OcclusionBlocks[(y * PaddedWidth + z) * PaddedWidth + x];
+        const unsigned char* Above = Block + PaddedWidth * PaddedWidth;
+        OcclusionCorners[Index++] = Block[0] + Block[1] + Block[PaddedWidth] + Block[PaddedWidth + 1] +
+                                    Above[0] + Above[1] + Above[PaddedWidth] + Above[PaddedWidth + 1];
+    }
+}
+
+void WorldView::BuildFaceMasks(int OriginX, int OriginY, int OriginZ)
+{
+    // Short-hand sizes
+    const int ColumnWidth = WorldData->GetColumnWidth();
+    const int PaddedWidth = ColumnWidth + 2;
+    const int Words = FaceMaskWords;
+    
+    /*** Occupancy ***/
+    
+    // Start with nothing set; anything out of the world is neither open nor half, so is never looked into
+    memset(OpenRows, 0, sizeof(WorldView_RowMask) * PaddedWidth * Words);
+    memset(HalfRows, 0, sizeof(WorldView_RowMask) * PaddedWidth * Words);
+    memset(CubeRows, 0, sizeof(WorldView_RowMask) * ColumnWidth * Words);
+    memset(WholeRows, 0, sizeof(WorldView_RowMask) * ColumnWidth * Words);
+    memset(TopRows, 0, sizeof(WorldView_RowMask) * ColumnWidth * Words);
+    
+    // Read the layer and its neighborhood once, one bit per block
+    for(int z = 0; z < PaddedWidth; z++)
+    for(int x = 0; x < PaddedWidth; x++)
+    {
+        // Bit of this block within the row
+        int Word = x / WorldView_RowMaskBits;
+        WorldView_RowMask BitMask = WorldView_RowMask(1) << (x % WorldView_RowMaskBits);
+        bool IsInterior = (x > 0 && x <= ColumnWidth && z > 0 && z <= ColumnWidth);
+        
+        // Layer itself, and its neighbors
+        Vector3<int> BlockPos(OriginX + x - 1, OriginY, OriginZ + z - 1);
+        if(WorldData->IsWithinWorld(BlockPos))
+        {
+            dBlock Block = WorldData->GetBlock(BlockPos);
+            bool IsOpen = Block.GetType() == dBlockType_Air || dHasSpecialGeometry(Block);
+            if(IsOpen)
+                OpenRows[z * Words + Word] |= BitMask;
+            if(!Block.IsWhole())
+                HalfRows[z * Words + Word] |= BitMask;
+            
+            if(IsInterior && !IsOpen)
+                CubeRows[(z - 1) * Words + Word] |= BitMask;
+            if(IsInterior && Block.IsWhole())
+                WholeRows[(z - 1) * Words + Word] |= BitMask;
+        }
+        
+        // Above the layer, only right above each block; a top face is hidden by any block but
+        // an open whole block (which includes half blocks of special geometry)
+        BlockPos.y++;
+        if(IsInterior && WorldData->IsWithinWorld(BlockPos))
+        {
+            dBlock Block = WorldData->GetBlock(BlockPos);
+            if((Block.GetType() == dBlockType_Air || dHasSpecialGeometry(Block)) && Block.IsWhole())
+                TopRows[(z - 1) * Words + Word] |= BitMask;
+        }
+    }
+    
+    /*** Visible Faces ***/
+    
+    // For each row, all of its blocks at once
+    for(int z = 0; z < ColumnWidth; z++)
+    {
+        const WorldView_RowMask* Cube = &CubeRows[z * Words];
+        const WorldView_RowMask* Whole = &WholeRows[z * Words];
+        
+        for(int Face = 0; Face < 5; Face++)
+        {
+            WorldView_RowMask* Visible = &FaceMasks[(z * 5 + Face) * Words];
+            WorldView_RowMask* HalfVisible = &HalfFaceMasks[(z * 5 + Face) * Words];
+            
+            // Top faces are only visible through open whole blocks
+            if(Face == 0)
+            {
+                for(int i = 0; i < Words; i++)
+                {
+                    Visible[i] = Cube[i] & TopRows[z * Words + i];
+                    HalfVisible[i] = 0;
+                }
+                continue;
+            }
+            
+            // Neighbor rows: the same row shifted by one block for the x neighbors, else the row before or after
+            int NeighborRow = z + 1 + GameRender_FaceOffsets[Face].z;
+            const WorldView_RowMask* Open = &OpenRows[NeighborRow * Words];
+            const WorldView_RowMask* Half = &HalfRows[NeighborRow * Words];
+            int Shift = GameRender_FaceOffsets[Face].x;
+            
+            for(int i = 0; i < Words; i++)
+            {
+                // Line up each block with its neighbor, carrying bits across masks
+                WorldView_RowMask NeighborOpen = Open[i], NeighborHalf = Half[i];
+                if(Shift > 0)
+                {
+                    NeighborOpen = (Open[i] >> 1) | ((i + 1 < Words) ? (Open[i + 1] << (WorldView_RowMaskBits - 1)) : 0);
+                    NeighborHalf = (Half[i] >> 1) | ((i + 1 < Words) ? (Half[i + 1] << (WorldView_RowMaskBits - 1)) : 0);
+                }
+                else if(Shift < 0)
+                {
+                    NeighborOpen = (Open[i] << 1) | ((i > 0) ? (Open[i - 1] >> (WorldView_RowMaskBits - 1)) : 0);
+                    NeighborHalf = (Half[i] << 1) | ((i > 0) ? (Half[i - 1] >> (WorldView_RowMaskBits - 1)) : 0);
+                }
+                
+                // Same rule as dAdjacentCheck: visible if the neighbor is open, or is a half block next to a whole block;
+                // the latter only shows the top half of the face
+                HalfVisible[i] = Cube[i] & Whole[i] & NeighborHalf;
+                Visible[i] = (Cube[i] & NeighborOpen) | HalfVisible[i];
+            }
+        }
+    }
+}
+
+float WorldView::GetCornerOcclusion(Vector3<int> Pos)
+{
+    // Fall back to sampling the world if not a corner of the last built layer
+    const int CornerWidth = WorldData->GetColumnWidth() + 1;
+    Vector3<int> Corner = Pos - OcclusionOrigin;
+    if(Corner.x < 0 || Corner.x >= CornerWidth || Corner.y < 0 || Corner.y >= 2 || Corner.z < 0 || Corner.z >= CornerWidth)
+        return GetAmbientOcclusion(Pos);
+    
+    // 8 blocks per corner
+    return 1.0f - float(OcclusionCorners[(Corner.y * CornerWidth + Corner.z) * CornerWidth + Corner.x]) / 8.0f;
+}
+
+void WorldView::ExtractFrustum()
+{
+    // Read back the current matrices (column-major)
+    float Projection[16], ModelView[16], Clip[16];
+    glGetFloatv(GL_PROJECTION_MATRIX, Projection);
+    glGetFloatv(GL_MODELVIEW_MATRIX, ModelView);
+    
+    // Clip = Projection * ModelView
+    for(int Col = 0; Col < 4; Col++)
+    for(int Row = 0; Row < 4; Row++)
+    {
+        Clip[Col * 4 + Row] = 0.0f;
+        for(int k = 0; k < 4; k++)
+            Clip[Col * 4 + Row] += Projection[k * 4 + Row] * ModelView[Col * 4 + k];
+    }
+    
+    // The eye is the inverse of the model-view's translation (rotation is orthonormal)
+    FrustumEye.x = -(ModelView[0] * ModelView[12] + ModelView[1] * ModelView[13] + ModelView[2] * ModelView[14]);
+    FrustumEye.y = -(ModelView[4] * ModelView[12] + ModelView[5] * ModelView[13] + ModelView[6] * ModelView[14]);
+    FrustumEye.z = -(ModelView[8] * ModelView[12] + ModelView[9] * ModelView[13] + ModelView[10] * ModelView[14]);
+    
+    // Each plane is the fourth row of the clip matrix plus or minus one of the other rows
+    // Left & right use the first row, bottom & top the second, and near & far the third
+    for(int i = 0; i < 6; i++)
+    {
+        int Row = i / 2;
+        float Sign = (i % 2 == 0) ? 1.0f : -1.0f;
+        for(int j = 0; j < 4; j++)
+            FrustumPlanes[i][j] = Clip[j * 4 + 3] + Sign * Clip[j * 4 + Row];
+        
+        // Normalize so that the plane distances are in world units
+        float Length = sqrt(FrustumPlanes[i][0] * FrustumPlanes[i][0] + FrustumPlanes[i][1] * FrustumPlanes[i][1] + FrustumPlanes[i][2] * FrustumPlanes[i][2]);
+        if(Length > 0.0f)
+        {
+            for(int j = 0; j < 4; j++)
+                FrustumPlanes[i][j] /= Length;
+        }
+    }
+}
+
+float WorldView::GetDepth(Vector3<float> BoxMin, Vector3<float> BoxMax)
+{
+    // Squared distance from the eye to the box's center
+    Vector3<float> Offset((BoxMin.x + BoxMax.x) * 0.5f - FrustumEye.x, (BoxMin.y + BoxMax.y) * 0.5f - FrustumEye.y, (BoxMin.z + BoxMax.z) * 0.5f - FrustumEye.z);
+    return Offset.x * Offset.x + Offset.y * Offset.y + Offset.z * Offset.z;
+}
+
+WorldView_CullResult WorldView::CullBox(Vector3<float> Min, Vector3<float> Max)
+{
+    // Start off assuming the box is fully inside
+    WorldView_CullResult Result = WorldView_CullResult_Inside;
+    
+    // For each plane, test the box corner furthest along the plane normal (positive vertex)
+    // and the corner furthest against it (negative vertex)
+    for(int i = 0; i < 6; i++)
+    {
+        const float* Plane = FrustumPlanes[i];
+        
+        Vector3<float> Positive((Plane[0] >= 0.0f) ? Max.x : Min.x, (Plane[1] >= 0.0f) ? Max.y : Min.y, (Plane[2] >= 0.0f) ? Max.z : Min.z);
+        Vector3<float> Negative((Plane[0] >= 0.0f) ? Min.x : Max.x, (Plane[1] >= 0.0f) ? Min.y : Max.y, (Plane[2] >= 0.0f) ? Min.z : Max.z);
+        
+        // Entirely behind this plane; we can stop here
+        if(Plane[0] * Positive.x + Plane[1] * Positive.y + Plane[2] * Positive.z + Plane[3] < 0.0f)
+            return WorldView_CullResult_Outside;
+        
+        // Straddling this plane
+        if(Plane[0] * Negative.x + Plane[1] * Negative.y + Plane[2] * Negative.z + Plane[3] < 0.0f)
+            Result = WorldView_CullResult_Intersect;
+    }
+    
+    // Done testing
+    return Result;
+}
@@ -22,21 +22,78 @@
 #include "WorldContainer.h"
 #include "VBuffer.h"
 #include "Stack.h"
+#include "WorldVisibility.h"
+#include "WorldLight.h"
+#include "ModelRegistry.h"
+#include "Shader.h"
+#include "RenderQueue.h"
 
 #include "VolumeView.h"
 #include "ItemsView.h"
 #include "Entities.h"
 #include "StructsView.h"
 
-// A single renderable model (Just a VBO and position)
+// Distance (in blocks) around the LOD distance within which columns keep their current detail
+// level, so columns near the switching distance don't flip every frame
+static const float WorldView_LODHysteresis = 8.0f;
+
+// Size (in blocks, on the x-z plane) of a single LOD cell
+static const int WorldView_LODCellSize = 2;
+
+// Lowest brightness of unlit blocks, so that dark caves can still be seen and designated
+static const float WorldView_AmbientLight = 0.3f;
+
+// Color of the block light (torches, lava)
+static const Vector3<float> WorldView_BlockLightColor(1.0f, 0.85f, 0.6f);
+
+// Per-row bit-mask of a layer's blocks (one bit per block along x); rows wider than
+// a single mask span several masks, lowest bits first
+typedef unsigned long long WorldView_RowMask;
+static const int WorldView_RowMaskBits = 64;
+
+// Frustum-test results of an axis-aligned bounding box
+enum WorldView_CullResult
+{
+    WorldView_CullResult_Outside = 0,
+    WorldView_CullResult_Intersect,
+    WorldView_CullResult_Inside,
+};
+
+// Frustum-culling statistics of the last rendered frame
+struct WorldView_CullStats
+{
+    // Columns tested against the frustum, and how many were visible or culled
+    int ColumnsTested, ColumnsVisible, ColumnsCulled;
+    
+    // Layers (of intersecting columns) tested, and how many were visible or culled
+    int LayersTested, LayersVisible, LayersCulled;
+    
+    // Layers within the frustum but skipped since they are hidden behind solid rock
+    int LayersOccluded;
+};
+
+// Re-meshing statistics of the last rendered frame
+struct WorldView_MeshStats
+{
+    // Number of block changes made in the world since the previous frame
+    int BlockEdits;
+    
+    // Number of layers that had their geometry re-generated
+    int LayersRebuilt;
+    
+    // Number of columns drawn at low detail, and how many of those had their geometry re-generated
+    int ColumnsLOD, ColumnsLODRebuilt;
+};
+
+// A single renderable model instance (the model itself is shared through the model registry)
 struct WorldView_Model
 {
     // Position and facing (NWSE)
     Vector3<int> Position;
     dFacing Facing;
     
-    // Model itself
-    VBuffer* ModelData;
+    // Model ID in the model registry
+    int ModelID;
 };
 
 // A column's layer VBO representation
@@ -46,6 +103,10 @@ struct WorldView_Plane
     // No matter what depth, always render
     VBuffer* WorldGeometry;
     
+    // Cube data of blocks with see-through texels (leaves, glass, etc.)
+    // Drawn after all opaque geometry, back-to-front
+    VBuffer* CutoutGeometry;
+    
     // Surfaces that are occluded by above layers
     // Only render if intersected layer
     VBuffer* HiddenGeometry;
@@ -63,6 +124,17 @@ struct WorldView_Column
 {
     // A list of layers
     WorldView_Plane* Planes;
+    
+    // True if the column is far enough to be drawn at low detail
+    bool UsingLOD;
+    
+    // Low-detail geometry: a height-map of the column's surface, at half the
+    // resolution, with skirts down to the lower neighboring cells
+    VBuffer* LODGeometry;
+    
+    // The layer cutoff and world revision the low-detail geometry was built with
+    int LODCutoff;
+    unsigned int LODRevision;
 };
 
 class WorldView
@@ -70,38 +142,86 @@ class WorldView
 public:
     
     // Constructor and destructor
-    WorldView(WorldContainer* WorldData, VolumeView* Designations, ItemsView* Items, StructsView* Structs, Entities* EntitiesList);
+    WorldView(WorldContainer* WorldData, WorldLight* Lighting, VolumeView* Designations, ItemsView* Items, StructsView* Structs, Entities* EntitiesList);
     ~WorldView();
     
     // Render the world (no projection changes)
-    // Only renders the foward facing chunks; positions are global coordinates, not chunk coordinates
-    // The "CameraRight.." variable is the right-facing vector on the x-z plane of the camera
-    // The y components are always ignored
+    // Only renders chunks within the current view frustum (read from the projection and
+    // model-view matrices) and not occluded by solid rock; positions are global coordinates, not chunk coordinates
+    // The camera position is only used for the max render distance; the y component is ignored
     // The camera angle is commonly used when making the 2D sprites face the camera
-    void Render(Vector3<float> CameraPos, Vector3<float> CameraRight, int LayerCutoff, float CameraAngle);
+    void Render(Vector3<float> CameraPos, int LayerCutoff, float CameraAngle);
     
     // Update the world (mostly used for textures, world effects, etc.)
     void Update(float dT);
     
+    // Set the color of the sky light (i.e. time of day and weather); applied to all sky-lit
+    // terrain by the terrain shader, so this is cheap to change every frame
+    void SetDaylight(Vector3<float> Color);
+    
+    // Get the frustum-culling statistics of the last rendered frame
+    WorldView_CullStats GetCullStats();
+    
+    // Get the re-meshing statistics of the last rendered frame
+    WorldView_MeshStats GetMeshStats();
+    
+    // Get the draw-call and state-change statistics of the last rendered frame's terrain
+    RenderQueue_Stats GetRenderStats();
+    
 protected:
     
-    // Generate the VBO associated with a column / chunk
+    // Generate the VBO associated with a column / chunk; only layers flagged
+    // as changed are re-generated, unless the column was never built
     void GenerateColumnVBO(int ChunkX, int ChunkZ);
     
     // Generate a VBO at the given layer
     bool GenerateLayerVBO(int ChunkX, int Y, int ChunkZ, WorldView_Plane* Layer);
     
+    // Generate the low-detail VBO of the given column, for the given layer cutoff
+    void GenerateColumnLOD(int ChunkX, int ChunkZ, int LayerCutoff);
+    
+    // Returns the height of the top-most solid block, at or below the cutoff, of the LOD cell
+    // starting at the given global position (-1 if there is none, or if out of the world)
+    int GetLODHeight(int x, int z, int LayerCutoff, dBlock* SurfaceBlock = NULL);
+    
+    // Returns a value that changes whenever the given column, or its direct neighbors, change
+    unsigned int GetColumnRevision(int ChunkX, int ChunkZ);
+    
     // Add a vertex (variable function types)
     // Note to self: I really need to redesign these functions to be much more simple (and face-based, not vertex based)
-    void AddVertex(VBuffer* Buffer, Vector3<float> Vertex, Vector3<float> Normal, int QuadCornerIndex, dBlock Block, bool BottomShiftedUp = false);
+    // The (sky, block) light level, from 0 to 1, is the one of the block the face is looking into
+    void AddVertex(VBuffer* Buffer, Vector3<float> Vertex, Vector3<float> Normal, int QuadCornerIndex, dBlock Block, Vector2<float> LightLevel, bool BottomShiftedUp = false);
     void AddVertex(VBuffer* Buffer, Vector3<float> Vertex); // Nothing special, just black
     
     // Remove / release all VBOs
     void ClearVBO();
     
+    // Returns the (sky, block) light levels, from 0 to 1, of the given block
+    Vector2<float> GetFaceLight(int x, int y, int z);
+    
     // Give a position (a vertex position, so the pos is a point on the cube), return the ambient-occlusion factor
     float GetAmbientOcclusion(Vector3<int> Pos);
     
+    // Count the occluding blocks around every corner of the given layer, from a padded copy of
+    // the layer's neighborhood, so that each corner is sampled only once per layer
+    void BuildOcclusion(int OriginX, int OriginY, int OriginZ);
+    
+    // Same as GetAmbientOcclusion(...), but read from the corners of the last built layer
+    float GetCornerOcclusion(Vector3<int> Pos);
+    
+    // Find the visible faces of all regular blocks of the given layer, a whole row at a time,
+    // from occupancy bit-masks of the layer's padded neighborhood
+    void BuildFaceMasks(int OriginX, int OriginY, int OriginZ);
+    
+    // Extract the six view-frustum planes from the current projection and model-view matrices
+    void ExtractFrustum();
+    
+    // Test an axis-aligned bounding box (global coordinates) against the view frustum
+    WorldView_CullResult CullBox(Vector3<float> Min, Vector3<float> Max);
+    
+    // Squared distance from the eye to the center of an axis-aligned bounding box; used to sort draws
+    float GetDepth(Vector3<float> BoxMin, Vector3<float> BoxMax);
+    
 private:
     
     /*** World Data ***/
@@ -109,17 +229,78 @@ private:
     // World data container
     WorldContainer* WorldData;
     
+    // World light levels
+    WorldLight* Lighting;
+    
     // Number of chunks in the X dimension (same as Z dimension)
     int ChunkCount;
     
     // How far we render objects up to
     float MaxRenderDist;
     
+    // Distance (in blocks) after which columns are drawn at low detail
+    float LODDistance;
+    
     /*** Graphical Data ***/
     
     // An array of columns, each column being a renderable structure
     WorldView_Column* Chunks;
     
+    // The six view-frustum planes as (a, b, c, d), normals pointing inwards
+    // Order: left, right, bottom, top, near, far
+    float FrustumPlanes[6][4];
+    
+    // The eye position, as read from the model-view matrix
+    Vector3<float> FrustumEye;
+    
+    // Per-column frustum results of this frame, and if the column is in view at all
+    WorldView_CullResult* ColumnCull;
+    bool* ColumnInView;
+    
+    // Connectivity-based occlusion of sections hidden behind solid rock
+    WorldVisibility* Visibility;
+    
+    // All block models, loaded once and drawn in batches
+    ModelRegistry* Models;
+    
+    // Applies the sky and block light, and time of day, to the terrain
+    Shader* TerrainShader;
+    
+    // All terrain geometry of a frame, drawn sorted by state once every column is visited
+    RenderQueue* TerrainQueue;
+    
+    // Culling statistics of the last rendered frame
+    WorldView_CullStats CullStats;
+    
+    // Re-meshing statistics of the last rendered frame, and the world's edit count at the time
+    WorldView_MeshStats MeshStats;
+    int LastEditCount;
+    
+    // Ambient occlusion of the layer being built: a padded block neighborhood (one flag per
+    // block, indexed [(y * (ColumnWidth + 2) + z) * (ColumnWidth + 2) + x]), the occluder count of
+    // each of its corners (two corner planes, indexed [(y * (ColumnWidth + 1) + z) * (ColumnWidth + 1) + x]),
+    // and the global position of the first block / corner
+    unsigned char* OcclusionBlocks;
+    unsigned char* OcclusionCorners;
+    Vector3<int> OcclusionOrigin;
+    
+    // Face visibility of the layer being built; each row has FaceMaskWords masks, with bit (x + 1)
+    // being block x of the row (so that the x neighbors of the row fit). For each row and face (same
+    // order as GameRender_FaceOffsets), indexed [(z * 5 + Face) * FaceMaskWords]: the visible faces,
+    // and the side faces only drawn as their top half (whole blocks next to half blocks)
+    int FaceMaskWords;
+    WorldView_RowMask* FaceMasks;
+    WorldView_RowMask* HalfFaceMasks;
+    
+    // Occupancy masks of the layer's padded neighborhood (ColumnWidth + 2 rows each, the first row
+    // being z = -1), and of the layer's own rows: open (air or special geometry) and half blocks,
+    // regular blocks and whole blocks, and open whole blocks right above the layer
+    WorldView_RowMask* OpenRows;
+    WorldView_RowMask* HalfRows;
+    WorldView_RowMask* CubeRows;
+    WorldView_RowMask* WholeRows;
+    WorldView_RowMask* TopRows;
+    
     /*** Secondary Rendering Elements ***/
     
     // Note: The below references are stringly for rendering only
@@ -0,0 +1,270 @@
+/***************************************************************
+ 
+ DwarfCraft - Dwarf Fortress / Minecraft clone
+ Copyright 2011 Jeremy Bridon - See License.txt for info
+ 
+ This source file is developed and maintained by:
+ + Jeremy Bridon jbridon@cores2.com
+ 
+***************************************************************/
+
+#include "WorldVisibility.h"
+
+// Internal: a single search step; the section, the face we came in from, and
+// a bit-mask of all the directions taken so far (so we never walk back)
+struct __WorldVisibility_Step
+{
+    int x, y, z;
+    int EntryFace;
+    unsigned char Directions;
+};
+
+// Internal: the face opposite of the given face
+static inline int __WorldVisibility_Opposite(int Face)
+{
+    return Face ^ 1;
+}
+
+WorldVisibility::WorldVisibility(WorldContainer* WorldData)
+{
+    // Save world and sizes
+    this->WorldData = WorldData;
+    ColumnWidth = WorldData->GetColumnWidth();
+    WorldHeight = WorldData->GetWorldHeight();
+    ChunkCount = WorldData->GetWorldWidth() / ColumnWidth;
+    
+    // Allocate all sections, none of them built yet
+    int SectionCount = ChunkCount * ChunkCount * WorldHeight;
+    Sections = new WorldVisibility_Section[SectionCount];
+    VisitedStamp = new unsigned int[SectionCount];
+    for(int i = 0; i < SectionCount; i++)
+    {
+        Sections[i].IsBuilt = false;
+        VisitedStamp[i] = 0;
+    }
+    CurrentStamp = 0;
+    
+    // Scratch buffers for the flood fill
+    FillStack = new int[ColumnWidth * ColumnWidth];
+    FillRegion = new unsigned char[ColumnWidth * ColumnWidth];
+    
+    // No stats yet
+    VisibleCount = 0;
+    RebuildCount = 0;
+}
+
+WorldVisibility::~WorldVisibility()
+{
+    delete[] Sections;
+    delete[] VisitedStamp;
+    delete[] FillStack;
+    delete[] FillRegion;
+}
+
+void WorldVisibility::Compute(Vector3<float> CameraPos, int LayerCutoff, const bool* ColumnInView)
+{
+    // New search stamp; on wrap-around, reset all stamps so nothing is falsely visible
+    CurrentStamp++;
+    if(CurrentStamp == 0)
+    {
+        for(int i = 0; i < ChunkCount * ChunkCount * WorldHeight; i++)
+            VisitedStamp[i] = 0;
+        CurrentStamp = 1;
+    }
+    VisibleCount = 0;
+    
+    // Clamp the cutoff
+    if(LayerCutoff >= WorldHeight)
+        LayerCutoff = WorldHeight - 1;
+    if(LayerCutoff < 0)
+        return;
+    
+    // Queue of sections to walk into
+    Queue<__WorldVisibility_Step> Steps;
+    
+    // If the camera is within the rendered volume, start from its own section
+    // (which may see through any of its faces, thus "no" entry face)
+    int CameraX = int(floor(CameraPos.x)) / ColumnWidth;
+    int CameraY = int(floor(CameraPos.y));
+    int CameraZ = int(floor(CameraPos.z)) / ColumnWidth;
+    if(CameraPos.x >= 0.0f && CameraPos.z >= 0.0f && CameraX < ChunkCount && CameraZ < ChunkCount && CameraY >= 0 && CameraY <= LayerCutoff)
+    {
+        __WorldVisibility_Step Start = {CameraX, CameraY, CameraZ, -1, 0};
+        VisitedStamp[(CameraY * ChunkCount + CameraZ) * ChunkCount + CameraX] = CurrentStamp;
+        VisibleCount++;
+        Steps.Enqueue(Start);
+    }
+    // Else, the camera is looking down onto the cutoff layer: everything above it is
+    // cut away, so each section at the cutoff is seen from its top face
+    else
+    {
+        for(int z = 0; z < ChunkCount; z++)
+        for(int x = 0; x < ChunkCount; x++)
+        {
+            if(ColumnInView != NULL && !ColumnInView[z * ChunkCount + x])
+                continue;
+            
+            __WorldVisibility_Step Start = {x, LayerCutoff, z, WorldVisibility_Face_Top, (unsigned char)(1 << WorldVisibility_Face_Bottom)};
+            VisitedStamp[(LayerCutoff * ChunkCount + z) * ChunkCount + x] = CurrentStamp;
+            VisibleCount++;
+            Steps.Enqueue(Start);
+        }
+    }
+    
+    // Breadth-first walk through all linked faces
+    while(!Steps.IsEmpty())
+    {
+        __WorldVisibility_Step Step = Steps.Dequeue();
+        WorldVisibility_Section* Section = GetSection(Step.x, Step.y, Step.z);
+        
+        // For each face we may leave through
+        for(int Face = 0; Face < WorldVisibility_FaceCount; Face++)
+        {
+            // Never walk back towards the camera
+            if((Step.Directions & (1 << __WorldVisibility_Opposite(Face))) != 0)
+                continue;
+            
+            // Must be able to see this face from the face we came in from
+            if(Step.EntryFace >= 0 && (Section->Links[Step.EntryFace] & (1 << Face)) == 0)
+                continue;
+            
+            // Neighbor section must be in the world, at or below the cutoff, and in view
+            int x = Step.x + WorldVisibility_FaceOffsets[Face].x;
+            int y = Step.y + WorldVisibility_FaceOffsets[Face].y;
+            int z = Step.z + WorldVisibility_FaceOffsets[Face].z;
+            if(x < 0 || x >= ChunkCount || z < 0 || z >= ChunkCount || y < 0 || y > LayerCutoff)
+                continue;
+            if(ColumnInView != NULL && !ColumnInView[z * ChunkCount + x])
+                continue;
+            
+            // Ignore if already reached
+            unsigned int& Stamp = VisitedStamp[(y * ChunkCount + z) * ChunkCount + x];
+            if(Stamp == CurrentStamp)
+                continue;
+            Stamp = CurrentStamp;
+            VisibleCount++;
+            
+            // Walk into it; we enter through the opposite face
+            __WorldVisibility_Step Next = {x, y, z, __WorldVisibility_Opposite(Face), (unsigned char)(Step.Directions | (1 << Face))};
+            Steps.Enqueue(Next);
+        }
+    }
+}
+
+bool WorldVisibility::IsVisible(int ChunkX, int Y, int ChunkZ)
+{
+    return VisitedStamp[(Y * ChunkCount + ChunkZ) * ChunkCount + ChunkX] == CurrentStamp;
+}
+
+int WorldVisibility::GetVisibleCount()
+{
+    return VisibleCount;
+}
+
+int WorldVisibility::GetRebuildCount()
+{
+    return RebuildCount;
+}
+
+WorldVisibility_Section* WorldVisibility::GetSection(int ChunkX, int Y, int ChunkZ)
+{
+    // Rebuild only if never built or the source plane changed since
+    WorldVisibility_Section* Section = &Sections[(Y * ChunkCount + ChunkZ) * ChunkCount + ChunkX];
+    unsigned int Revision = WorldData->GetChunk(ChunkX, ChunkZ)->Planes[Y].Revision;
+    if(!Section->IsBuilt || Section->Revision != Revision)
+    {
+        BuildSection(ChunkX, Y, ChunkZ, Section);
+        Section->Revision = Revision;
+        Section->IsBuilt = true;
+        RebuildCount++;
+    }
+    
+    return Section;
+}
+
+void WorldVisibility::BuildSection(int ChunkX, int Y, int ChunkZ, WorldVisibility_Section* Section)
+{
+    // Start with nothing linked
+    for(int i = 0; i < WorldVisibility_FaceCount; i++)
+        Section->Links[i] = 0;
+    
+    // Homogeneous planes are either fully open or fully closed
+    WorldContainer_Plane& Plane = WorldData->GetChunk(ChunkX, ChunkZ)->Planes[Y];
+    if(!Plane.Allocated)
+    {
+        if(!dIsOpaque(dBlock(Plane.Data.PlaneType)))
+        {
+            for(int i = 0; i < WorldVisibility_FaceCount; i++)
+                Section->Links[i] = (1 << WorldVisibility_FaceCount) - 1;
+        }
+        return;
+    }
+    
+    // Mark all opaque blocks as already filled (region 1), open blocks as unfilled (0)
+    const int BlockCount = ColumnWidth * ColumnWidth;
+    for(int i = 0; i < BlockCount; i++)
+        FillRegion[i] = dIsOpaque(Plane.Data.PlaneData[i]) ? 1 : 0;
+    
+    // Flood fill each open region; a section is a single layer high, so
+    // every open block touches both the top and bottom faces
+    for(int Seed = 0; Seed < BlockCount; Seed++)
+    {
+        // Ignore filled
+        if(FillRegion[Seed] != 0)
+            continue;
+        
+        // Faces touched by this region
+        unsigned char Faces = (1 << WorldVisibility_Face_Top) | (1 << WorldVisibility_Face_Bottom);
+        
+        int StackSize = 0;
+        FillStack[StackSize++] = Seed;
+        FillRegion[Seed] = 1;
+        
+        while(StackSize > 0)
+        {
+            // Pop and localize
+            int Index = FillStack[--StackSize];
+            int dx = Index % ColumnWidth;
+            int dz = Index / ColumnWidth;
+            
+            // Which side faces does this block touch?
+            if(dx == 0)
+                Faces |= (1 << WorldVisibility_Face_Left);
+            if(dx == ColumnWidth - 1)
+                Faces |= (1 << WorldVisibility_Face_Right);
+            if(dz == 0)
+                Faces |= (1 << WorldVisibility_Face_Back);
+            if(dz == ColumnWidth - 1)
+                Faces |= (1 << WorldVisibility_Face_Front);
+            
+            // Grow into the four neighbors
+            if(dx > 0 && FillRegion[Index - 1] == 0)
+            {
+                FillRegion[Index - 1] = 1;
+                FillStack[StackSize++] = Index - 1;
+            }
+            if(dx < ColumnWidth - 1 && FillRegion[Index + 1] == 0)
+            {
+                FillRegion[Index + 1] = 1;
+                FillStack[StackSize++] = Index + 1;
+            }
+            if(dz > 0 && FillRegion[Index - ColumnWidth] == 0)
+            {
+                FillRegion[Index - ColumnWidth] = 1;
+                FillStack[StackSize++] = Index - ColumnWidth;
+            }
+            if(dz < ColumnWidth - 1 && FillRegion[Index + ColumnWidth] == 0)
+            {
+                FillRegion[Index + ColumnWidth] = 1;
+                FillStack[StackSize++] = Index + ColumnWidth;
+            }
+        }
+        
+        // All faces of this region can see each other
+        for(int i = 0; i < WorldVisibility_FaceCount; i++)
+        {
+            if((Faces & (1 << i)) != 0)
+                Section->Links[i] |= Faces;
+        }
+    }
+}
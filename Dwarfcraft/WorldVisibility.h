@@ -0,0 +1,126 @@
+/***************************************************************
+ 
+ DwarfCraft - Dwarf Fortress / Minecraft clone
+ Copyright 2011 Jeremy Bridon - See License.txt for info
+ 
+ This source file is developed and maintained by:
+ + Jeremy Bridon jbridon@cores2.com
+ 
+ File: WorldVisibility.h/cpp
+ Desc: A connectivity-based visibility graph of the world, used to
+ skip rendering sections that are hidden behind solid rock.
+ 
+ A section is a single layer of a column (the same unit the world
+ view builds its VBOs with). For each section, we precompute which
+ of its six faces can see each other through non-opaque blocks
+ (i.e. a cave going from the west side to the bottom). These links
+ are rebuilt lazily, only for sections whose source plane has been
+ changed since (see WorldContainer_Plane::Revision).
+ 
+ At render time, a breadth-first search starts from the camera's
+ section (or from the cutoff layer if the camera is above it), and
+ only walks into neighboring sections through linked faces, never
+ stepping back towards the camera. Every section reached is
+ potentially visible; everything else is occluded.
+ 
+***************************************************************/
+
+// Inclusion guard
+#ifndef __WORLDVISIBILITY_H__
+#define __WORLDVISIBILITY_H__
+
+#include "WorldContainer.h"
+#include "Queue.h"
+
+// Faces of a section (bit indices of the face links)
+enum WorldVisibility_Face
+{
+    WorldVisibility_Face_Top = 0,   // y+
+    WorldVisibility_Face_Bottom,    // y-
+    WorldVisibility_Face_Left,      // x-
+    WorldVisibility_Face_Right,     // x+
+    WorldVisibility_Face_Back,      // z-
+    WorldVisibility_Face_Front,     // z+
+};
+
+// Total number of faces in a section
+static const int WorldVisibility_FaceCount = 6;
+
+// Section offsets (x is chunk, y is layer, z is chunk) when leaving through a face
+static const Vector3<int> WorldVisibility_FaceOffsets[WorldVisibility_FaceCount] =
+{
+    Vector3<int>(0, 1, 0),
+    Vector3<int>(0, -1, 0),
+    Vector3<int>(-1, 0, 0),
+    Vector3<int>(1, 0, 0),
+    Vector3<int>(0, 0, -1),
+    Vector3<int>(0, 0, 1),
+};
+
+// A single section's precomputed connectivity
+struct WorldVisibility_Section
+{
+    // For each face, a bit-mask of all the faces visible through this section
+    unsigned char Links[WorldVisibility_FaceCount];
+    
+    // The source plane revision these links were built from
+    unsigned int Revision;
+    
+    // False until the links are first built
+    bool IsBuilt;
+};
+
+class WorldVisibility
+{
+public:
+    
+    // Constructor and destructor
+    WorldVisibility(WorldContainer* WorldData);
+    ~WorldVisibility();
+    
+    // Find all potentially visible sections from the given camera position (global coordinates)
+    // Layers above the cutoff are never rendered, thus treated as empty
+    // The given column flags (ChunkCount x ChunkCount, indexed [z * ChunkCount + x]) limit
+    // the search to columns in view; if NULL, all columns are searched
+    void Compute(Vector3<float> CameraPos, int LayerCutoff, const bool* ColumnInView);
+    
+    // Returns true if the given section was reached during the last compute
+    bool IsVisible(int ChunkX, int Y, int ChunkZ);
+    
+    // Number of sections reached during the last compute
+    int GetVisibleCount();
+    
+    // Number of section links rebuilt since creation (edits cost one rebuild each)
+    int GetRebuildCount();
+    
+protected:
+    
+    // Returns the section at the given chunk / layer, rebuilding its links if the world changed
+    WorldVisibility_Section* GetSection(int ChunkX, int Y, int ChunkZ);
+    
+    // Flood-fill the section's non-opaque blocks and link all faces each region touches
+    void BuildSection(int ChunkX, int Y, int ChunkZ, WorldVisibility_Section* Section);
+    
+private:
+    
+    // World data container and short-hand sizes
+    WorldContainer* WorldData;
+    int ChunkCount, ColumnWidth, WorldHeight;
+    
+    // All sections, indexed as [(y * ChunkCount + z) * ChunkCount + x]
+    WorldVisibility_Section* Sections;
+    
+    // Per-section stamp of the last compute that reached it
+    unsigned int* VisitedStamp;
+    unsigned int CurrentStamp;
+    
+    // Flood-fill scratch buffers (one per block of a section)
+    int* FillStack;
+    unsigned char* FillRegion;
+    
+    // Statistics
+    int VisibleCount, RebuildCount;
+};
+
+// End of inclusion guard
+#endif
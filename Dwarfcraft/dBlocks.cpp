@@ -9,6 +9,91 @@
 ***************************************************************/
 
 #include "dBlocks.h"
+#include "TextureAtlas.h"
+
+// Internal: final texture of each block face, built when the terrain texture is loaded
+static dBlockFaceTexture __dBlocks_FaceTextures[dBlockType_Count][dBlockTexture_MetaCount][6];
+
+// Internal: where the items texture was packed in the sprite atlas
+static TextureAtlas_Image __dBlocks_ItemsImage;
+
+// Internal: computes the texture of the given block face; the tile origins must already be in pixels
+static void __dBlocks_ComputeFaceTexture(dBlockType BlockType, unsigned char Meta, dBlockFace Face, int TextureWidth, int TextureHeight, int TileSize, dBlockFaceTexture* Texture)
+{
+    // Default to white, no rotations
+    Texture->Color = Vector3<float>(1, 1, 1);
+    Texture->Rotations = 0;
+    
+    // Air has no texture
+    if(BlockType == dBlockType_Air)
+    {
+        Texture->Width = Texture->Height = 0.0f;
+        for(int i = 0; i < 4; i++)
+            Texture->UV[i] = Vector2<float>();
+        return;
+    }
+    
+    // Normalize terrain texture
+    Vector2<int> Origin = dBlockTexturePos[BlockType];
+    float x = float(Origin.x) / float(TextureWidth);
+    float y = float(Origin.y) / float(TextureHeight);
+    float width = float(TileSize) / float(TextureWidth);
+    float height = float(TileSize) / float(TextureHeight);
+    
+    // Dirt has different sides and tops IF it is 1 (grass), or 2 (snow)
+    if(BlockType == dBlockType_Dirt && Meta == 1)
+    {
+        // Set the top to grass (two faces left), else is grass (one face right)
+        if(Face == dBlockFace_Top)
+        {
+            Texture->Color = Vector3<float>(0.41, 0.66, 0.25);
+            x -= 2 * width;
+        }
+        else
+            x += width;
+    }
+    
+    // Snow
+    else if(BlockType == dBlockType_Dirt && Meta == 2)
+    {
+        // Set the top to snow (4 faces down), else is snow side (2 faces right, 4 down)
+        if(Face == dBlockFace_Top)
+            y += 4 * width;
+        else
+        {
+            x += 2 * width;
+            y += 4 * width;
+        }
+    }
+    
+    // Check special cases (trunk, face right)
+    else if(BlockType == dBlockType_Wood && Face == dBlockFace_Top)
+        x += width;
+    
+    // Grass has 7 total tiles (grows x+)
+    else if(BlockType == dBlockType_Grass && Meta > 0 && Meta <= 6)
+    {
+        // Offset based on valid meta
+        x += width * Meta;
+    }
+    
+    // Generic quad corners, then rotated as needed
+    Texture->UV[0] = Vector2<float>(x + width, y);
+    Texture->UV[1] = Vector2<float>(x, y);
+    Texture->UV[2] = Vector2<float>(x, y + height);
+    Texture->UV[3] = Vector2<float>(x + width, y + height);
+    for(int i = 0; i < Texture->Rotations; i++)
+    {
+        Vector2<float> Temp = Texture->UV[0];
+        Texture->UV[0] = Texture->UV[1];
+        Texture->UV[1] = Texture->UV[2];
+        Texture->UV[2] = Texture->UV[3];
+        Texture->UV[3] = Temp;
+    }
+    
+    Texture->Width = width;
+    Texture->Height = height;
+}
 
 GLuint dGetTerrainTextureID(int* Width, int* Height, int* TileSize)
 {
@@ -40,6 +125,13 @@ GLuint dGetTerrainTextureID(int* Width, int* Height, int* TileSize)
             dBlockTexturePos[i].x *= TextureTileSize;
             dBlockTexturePos[i].y *= TextureTileSize;
         }
+        
+        // Build the final texture of every block face
+        for(int i = 0; i < dBlockType_Count; i++)
+        for(int j = 0; j < dBlockTexture_MetaCount; j++)
+        for(int k = 0; k < 6; k++)
+            __dBlocks_ComputeFaceTexture(dBlockType(i), (unsigned char)j, dBlockFace(k), TextureWidth, TextureHeight, TextureTileSize, &__dBlocks_FaceTextures[i][j][k]);
+        
         // All done!
     }
     
@@ -55,71 +147,30 @@ GLuint dGetTerrainTextureID(int* Width, int* Height, int* TileSize)
 
 void dGetBlockTexture(dBlock Block, dBlockFace Face, float* x, float* y, float* width, float* height, Vector3<float>* color, int* rotations)
 {
-    // Get the total width and height
-    int TextureWidth, TextureHeight, TileSize;
-    dGetTerrainTextureID(&TextureWidth, &TextureHeight, &TileSize);
-    
-    // Get block type
-    dBlockType BlockType = Block.GetType();
+    // Make sure the table is built
+    dGetTerrainTextureID();
     
     // Does this block type exist, is none, or air? Just ignore..
+    dBlockType BlockType = Block.GetType();
     if(BlockType <= dBlockType_Air || BlockType >= dBlockType_Count)
         return;
     
-    // Normalize terrain texture
-    Vector2<int> Origin = dBlockTexturePos[BlockType];
-    *x = float(Origin.x) / float(TextureWidth);
-    *y = float(Origin.y) / float(TextureHeight);
-    *width = float(TileSize) / float(TextureWidth);
-    *height = float(TileSize) / float(TextureHeight);
-    
-    // Any desired texture rotations?
-    if(rotations != NULL)
-        *rotations = 0;
-    
-    // Default color to white, unless the texture is exceptional
+    // Post back from the table; the origin is the un-rotated upper-left corner
+    const dBlockFaceTexture& Texture = dGetBlockFaceTexture(Block, Face);
+    *x = Texture.UV[(1 + 4 - Texture.Rotations % 4) % 4].x;
+    *y = Texture.UV[(1 + 4 - Texture.Rotations % 4) % 4].y;
+    *width = Texture.Width;
+    *height = Texture.Height;
     if(color != NULL)
-        *color = Vector3<float>(1, 1, 1);
-    
-    // Dirt has different sides and tops IF it is 1 (grass), or 2 (snow)
-    if(BlockType == dBlockType_Dirt && Block.GetMeta() == 1)
-    {
-        // Set the top to grass (two faces left), else is grass (one face right)
-        if(Face == dBlockFace_Top)
-        {
-            if(color != NULL)
-                *color = Vector3<float>(0.41, 0.66, 0.25);
-            *x -= 2 * *width;
-        }
-        else
-            *x += *width;
-    }
-    
-    // Snow
-    else if(BlockType == dBlockType_Dirt && Block.GetMeta() == 2)
-    {
-        // Set the top to snow (4 faces down), else is snow side (2 faces right, 4 down)
-        if(Face == dBlockFace_Top)
-            *y += 4 * *width;
-        else
-        {
-            *x += 2 * *width;
-            *y += 4 * *width;
-        }
-    }
-    
-    // Check special cases (trunk, face right)
-    else if(BlockType == dBlockType_Wood && Face == dBlockFace_Top)
-    {
-        if(Face == dBlockFace_Top)
-            *x += *width;
-    }
-    // Grass has 7 total tiles (grows x+)
-    else if(BlockType == dBlockType_Grass && Block.GetMeta() > 0 && Block.GetMeta() <= 6)
-    {
-        // Offset based on valid meta
-        *x += *width * Block.GetMeta();
-    }
+        *color = Texture.Color;
+    if(rotations != NULL)
+        *rotations = Texture.Rotations;
+}
+
+const dBlockFaceTexture& dGetBlockFaceTexture(dBlock Block, dBlockFace Face)
+{
+    unsigned char Meta = Block.GetMeta();
+    return __dBlocks_FaceTextures[Block.GetType()][(Meta < dBlockTexture_MetaCount) ? Meta : 0][Face];
 }
 
 GLuint dGetItemTextureID(int* Width, int* Height, int* TileSize)
@@ -144,7 +195,13 @@ GLuint dGetItemTextureID(int* Width, int* Height, int* TileSize)
         // TODO: use different seasons in the future
         char* str;
         TerrainConfig.GetValue("General", "Items", &str);
-        TextureID = g2LoadImage(str, &TextureWidth, &TextureHeight, NULL, false, false);
+        bool Packed = TextureAtlas::GetShared()->GetImage(str, &__dBlocks_ItemsImage);
+        UtilAssert(Packed, "Unable to load art asset for items; \"%s\"", str);
+        
+        // Items are drawn from the sprite atlas, like all other sprites
+        TextureID = __dBlocks_ItemsImage.TextureID;
+        TextureWidth = __dBlocks_ItemsImage.PixelWidth;
+        TextureHeight = __dBlocks_ItemsImage.PixelHeight;
         
         // Convert all the grid positions into texture positions
         for(int i = 0; i < dItemType_Count; i++)
@@ -177,6 +234,9 @@ void dGetItemTexture(dItemType Item, float* x, float* y, float* width, float* he
     *y = float(Origin.y) / float(TextureHeight);
     *width = float(TileSize) / float(TextureWidth);
     *height = float(TileSize) / float(TextureHeight);
+    
+    // Into the atlas
+    TextureAtlas_ToAtlas(__dBlocks_ItemsImage, x, y, width, height);
 }
 
 GLuint dGetBreakingTexture(float* x, float* y, float* width, float* height)
@@ -190,59 +250,19 @@ GLuint dGetBreakingTexture(float* x, float* y, float* width, float* height)
     *height = (float)TileSize/(float)TextureHeight;
     *x = dBreakingTexturePos.x * *width;
     *y = dBreakingTexturePos.y * *height;
+    TextureAtlas_ToAtlas(__dBlocks_ItemsImage, x, y, width, height);
     
     // Done!
     return TextureID;
 }
 
-bool dAdjacentCheck(dBlock Source, dBlock Adjacent)
-{
-    // If adjacent is air, always render source
-    if(Adjacent.GetType() == dBlockType_Air)
-        return true;
-    
-    // If the adjacent has special geometry, always render source
-    else if(dHasSpecialGeometry(Adjacent))
-        return true;
-    
-    // If source is whole and the adjacent is a half block, always render source
-    else if(Source.IsWhole() && !Adjacent.IsWhole())
-        return true;
-    
-    // Else, nothing makes us visible, hide the source surface
-    else
-        return false;
-}
-
-bool dHasSpecialGeometry(dBlock Block)
-{
-    // Simplify accessor
-    dBlockType BlockType = Block.GetType();
-    
-    // Special models (Code is written this way to be simple)
-    if(BlockType == dBlockType_Mushroom || BlockType == dBlockType_Torch || BlockType == dBlockType_Chest ||
-       BlockType == dBlockType_Furnace || BlockType == dBlockType_Door || BlockType == dBlockType_Stairs || BlockType == dBlockType_Ladder ||
-       BlockType == dBlockType_CarpentryBench || BlockType == dBlockType_MasonryBench || BlockType == dBlockType_EngineeringBench ||
-       BlockType == dBlockType_KitchenBench || BlockType == dBlockType_SmithingBench)
-        return true;
-    
-    // Else, no match
-    return false;
-}
-
-bool dIsSolid(dBlock Block)
+const char* dGetBlockModel(dBlock Block)
 {
-    // If solid
-    // Simplify accessor
-    dBlockType BlockType = Block.GetType();
-    
-    // Only return true if solid
-    if(dHasSpecialGeometry(Block) ||
-       BlockType == dBlockType_Air || BlockType == dBlockType_Grass || BlockType == dBlockType_Bush ||
-       BlockType == dBlockType_Flower || BlockType == dBlockType_Mushroom || BlockType == dBlockType_Leaves)
-        return false;
+    // Note: the torch is drawn as the workbench during model testing
+    if(Block.GetType() == dBlockType_Mushroom || Block.GetType() == dBlockType_Torch)
+        return "WorkBenchModel.cfg";
     else
-        return true;
+        return NULL;
 }
 
 float dGetBreakTime(int ItemID, dBlock Block)
@@ -279,9 +299,3 @@ dItemType dGetItemFromBlock(dBlock Block)
     
     return dItem_None;
 }
-
-bool dBlockCollapses(dBlock Block)
-{
-    // If not a solid block, it collapses
-    return !dIsSolid(Block);
-}
@@ -123,6 +123,69 @@ enum dBlockFace
     dBlockFace_Back,
 };
 
+// Block properties, as bit-flags
+enum dBlockProperty
+{
+    dBlockProperty_Solid = 0x01,        // Can be walked on and blocks movement
+    dBlockProperty_Opaque = 0x02,       // Fully hides what is behind it (only while whole)
+    dBlockProperty_Special = 0x04,      // Has special geometry (drawn as a model, not a cube)
+    dBlockProperty_Collapses = 0x08,    // Breaks if its support is removed
+};
+
+// Properties of each block type
+static const unsigned char dBlockProperties[dBlockType_Count] =
+{
+    dBlockProperty_Collapses,                                   // Air
+    dBlockProperty_Solid | dBlockProperty_Opaque,               // Stone
+    dBlockProperty_Solid | dBlockProperty_Opaque,               // Cobblestone
+    dBlockProperty_Solid | dBlockProperty_Opaque,               // Dirt
+    dBlockProperty_Solid | dBlockProperty_Opaque,               // Bedrock
+    dBlockProperty_Solid | dBlockProperty_Opaque,               // Water
+    dBlockProperty_Solid | dBlockProperty_Opaque,               // Lava
+    dBlockProperty_Solid | dBlockProperty_Opaque,               // Sand
+    dBlockProperty_Solid | dBlockProperty_Opaque,               // Gravel
+    dBlockProperty_Solid | dBlockProperty_Opaque,               // Wood
+    dBlockProperty_Collapses,                                   // Leaves
+    dBlockProperty_Collapses,                                   // Grass
+    dBlockProperty_Collapses,                                   // Bush
+    dBlockProperty_Collapses,                                   // Flower
+    dBlockProperty_Special | dBlockProperty_Collapses,          // Mushroom
+    
+    dBlockProperty_Solid | dBlockProperty_Opaque,               // CoalOre
+    dBlockProperty_Solid | dBlockProperty_Opaque,               // IronOre
+    dBlockProperty_Solid | dBlockProperty_Opaque,               // SilverOre
+    dBlockProperty_Solid | dBlockProperty_Opaque,               // GoldOre
+    dBlockProperty_Solid | dBlockProperty_Opaque,               // DiamondOre
+    
+    dBlockProperty_Solid | dBlockProperty_Opaque,               // Plank
+    dBlockProperty_Special | dBlockProperty_Collapses,          // Torch
+    dBlockProperty_Special | dBlockProperty_Collapses,          // Chest
+    dBlockProperty_Special | dBlockProperty_Collapses,          // Furnace
+    dBlockProperty_Special | dBlockProperty_Collapses,          // Door
+    dBlockProperty_Special | dBlockProperty_Collapses,          // Stairs
+    dBlockProperty_Solid,                                       // Glass
+    dBlockProperty_Special | dBlockProperty_Collapses,          // Ladder
+    
+    dBlockProperty_Special | dBlockProperty_Collapses,          // CarpentryBench
+    dBlockProperty_Special | dBlockProperty_Collapses,          // MasonryBench
+    dBlockProperty_Special | dBlockProperty_Collapses,          // EngineeringBench
+    dBlockProperty_Special | dBlockProperty_Collapses,          // KitchenBench
+    dBlockProperty_Special | dBlockProperty_Collapses,          // SmithingBench
+};
+
+// Number of metas that have their own block textures; all higher metas look like meta 0
+static const int dBlockTexture_MetaCount = 8;
+
+// Final texture of a block face: the four UV corners (in quad order, rotations
+// already applied), the tile size, the tint color, and the number of rotations
+struct dBlockFaceTexture
+{
+    Vector2<float> UV[4];
+    float Width, Height;
+    Vector3<float> Color;
+    int Rotations;
+};
+
 // Non-block, used for designations texture selection
 static const Vector2<int> dDesignationTexturePos(0, 16); // Paired with UI
 
@@ -352,27 +415,57 @@ GLuint dGetTerrainTextureID(int* Width = NULL, int* Height = NULL, int* TileSize
 // Returns the texture coordinates of a cube; may do internal rotation so the coordinates are correct without the UV indices having to change
 void dGetBlockTexture(dBlock Block, dBlockFace Face, float* x, float* y, float* width, float* height, Vector3<float>* color = NULL, int* rotations = NULL);
 
-// Get the item texture (allocates it internally if not yet allocates)
+// Returns the final texture of the given block face, from the table built when the terrain texture
+// is loaded; only valid once it is (i.e. after any call to dGetTerrainTextureID)
+const dBlockFaceTexture& dGetBlockFaceTexture(dBlock Block, dBlockFace Face);
+
+// Get the item texture (allocates it internally if not yet allocates); this is the item image's
+// sprite atlas page, while the width and height are still those of the item image itself
 GLuint dGetItemTextureID(int* Width = NULL, int* Height = NULL, int* TileSize = NULL);
 
-// Returns the texture coordinates of an item
+// Returns the texture coordinates of an item, within the sprite atlas
 void dGetItemTexture(dItemType Item, float* x, float* y, float* width, float* height);
 
-// Get the breaking texture
+// Get the breaking texture; coordinates are within the sprite atlas
 GLuint dGetBreakingTexture(float* x, float* y, float* width, float* height);
 
+// Returns true if the given block type has all of the given properties (see dBlockProperty)
+inline bool dHasProperty(dBlock Block, unsigned char Properties)
+{
+    return (dBlockProperties[Block.GetType()] & Properties) == Properties;
+}
+
+// Returns true if the given block is / has special geometry
+// Commonly used in foilage / blants
+inline bool dHasSpecialGeometry(dBlock Block)
+{
+    return dHasProperty(Block, dBlockProperty_Special);
+}
+
 // Returns true if the surface from source touching adjacent should be rendered
 // For example, if the given source block is dir, and the adjacent is air, all
 // source surfaces should be be rendered. Another example: If the source is solid
 // and the given block is grass, then we should render the source surfaces (because grass is see-through)
-bool dAdjacentCheck(dBlock Source, dBlock Adjacent);
+inline bool dAdjacentCheck(dBlock Source, dBlock Adjacent)
+{
+    // Render if the adjacent is air, has special geometry, or is a half block next to a whole source
+    return Adjacent.GetType() == dBlockType_Air || dHasSpecialGeometry(Adjacent) || (Source.IsWhole() && !Adjacent.IsWhole());
+}
 
-// Returns true if the given block is / has special geometry
-// Commonly used in foilage / blants
-bool dHasSpecialGeometry(dBlock Block);
+// Returns the configuration file of the 3D model the given block is drawn as, or NULL if it has none
+const char* dGetBlockModel(dBlock Block);
 
 // Returns true if the given block is solid
-bool dIsSolid(dBlock Block);
+inline bool dIsSolid(dBlock Block)
+{
+    return dHasProperty(Block, dBlockProperty_Solid);
+}
+
+// Returns true if the given block fully hides what is behind it (a whole, solid, non see-through block)
+inline bool dIsOpaque(dBlock Block)
+{
+    return Block.IsWhole() && dHasProperty(Block, dBlockProperty_Opaque);
+}
 
 // Returns the amount of seconds (as a fraction) of the time it takes to use the given tool against the given block type
 float dGetBreakTime(int ItemID, dBlock Block);
@@ -382,6 +475,9 @@ float dGetBreakTime(int ItemID, dBlock Block);
 dItemType dGetItemFromBlock(dBlock Block);
 
 // Returns true if the given block (like mushrooms) break if the support is removed
-bool dBlockCollapses(dBlock Block);
+inline bool dBlockCollapses(dBlock Block)
+{
+    return dHasProperty(Block, dBlockProperty_Collapses);
+}
 
 #endif
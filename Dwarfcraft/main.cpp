@@ -12,10 +12,36 @@
 ***************************************************************/
 
 #include "MainView.h"
+#include "ModelFile.h"
+#include "PathBench.h"
 
 // Main application entry point
 int main (int argc, const char * argv[])
 {
+    // Offline model conversion: "Dwarfcraft --convertmodel <model.obx> ..."
+    if(argc > 1 && strcmp(argv[1], "--convertmodel") == 0)
+    {
+        int FailCount = 0;
+        for(int i = 2; i < argc; i++)
+        {
+            char BinaryFile[512];
+            ModelFile::GetBinaryName(argv[i], BinaryFile, sizeof(BinaryFile));
+            
+            bool Success = ModelFile::Convert(argv[i], BinaryFile);
+            printf("%s: \"%s\" to \"%s\"\n", Success ? "Converted" : "Failed", argv[i], BinaryFile);
+            if(!Success)
+                FailCount++;
+        }
+        return (FailCount == 0) ? 0 : 1;
+    }
+    
+    // Path-planning benchmark: "Dwarfcraft --pathbench <results.json> [seed ...]"
+    if(argc > 2 && strcmp(argv[1], "--pathbench") == 0)
+    {
+        PathBench Bench(argv[2]);
+        return Bench.Run(argv + 3, argc - 3) ? 0 : 1;
+    }
+    
     // Initialize application
     MainView Client;
 
@@ -153,22 +153,15 @@ protected:
     
     // Draw a given source location into a spcific width, like a three-part button
     __g2EXPORT void DrawComponentStretch(g2ThemeElement ElementType, int DestX, int DestY, int Width);
-    
-    // Draw a given source location into a spcific width, like a three-part button
     __g2EXPORT void DrawComponentStretch(const char* ElementName, int DestX, int DestY, int Width);
     
     // Draw a given source location into a specific width (stretched), and a limited height (cut)
     // The start and end height are y-pixel values and are defined as 0 at the top and [Element height - 1] bottom
     __g2EXPORT void DrawComponentStretch(g2ThemeElement ElementType, int DestX, int DestY, int Width, int StartHeight, int EndHeight);
-    
-    // Draw a given source location into a specific width (stretched), and a limited height (cut)
-    // The start and end height are y-pixel values and are defined as 0 at the top and [Element height - 1] bottom
     __g2EXPORT void DrawComponentStretch(const char* ElementName, int DestX, int DestY, int Width, int StartHeight, int EndHeight);
     
     // Draw the object into a square-like output
     __g2EXPORT void DrawComponentRect(g2ThemeElement ElementType, int DestX, int DestY, int Width, int Height);
-    
-    // Draw the object into a square-like output
     __g2EXPORT void DrawComponentRect(const char* ElementName, int DestX, int DestY, int Width, int Height);
     
     // Draw a character with 1-1 scale
@@ -21,11 +21,6 @@
     
     // Suppress std-c lib buffer-overflow warnings
     #pragma warning(disable:4996)
-    
-    // This is a Dwarfcraft-specific extension to Glui2
-    #include <gl/glew.h>
-    
-    // Standard includes
     #include <windows.h>
     #include <gl/glut.h>
     #include <gl/glext.h>